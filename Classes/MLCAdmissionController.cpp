@@ -0,0 +1,182 @@
+#include "MLCAdmissionController.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <vector>
+
+namespace {
+
+const double kInitialPrefillTokensPerSecond = 200.0;
+const double kInitialDecodeTokensPerSecond = 20.0;
+// Expected completion length until the first request finishes
+const double kInitialCompletionTokens = 256.0;
+// Weight of the newest sample in the running averages
+const double kSmoothing = 0.2;
+
+double smooth(double average, double sample) {
+    return average + kSmoothing * (sample - average);
+}
+
+double seconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<double>(duration).count();
+}
+
+} // namespace
+
+MLCAdmissionController::MLCAdmissionController(int slots, int kv_capacity_tokens)
+    : slots_(std::max(1, slots)),
+      kv_capacity_(std::max(0, kv_capacity_tokens)),
+      prefill_tokens_per_second_(kInitialPrefillTokensPerSecond),
+      decode_tokens_per_second_(kInitialDecodeTokensPerSecond),
+      completion_tokens_(kInitialCompletionTokens) {}
+
+void MLCAdmissionController::configure(const MLCAdmissionControlConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+}
+
+void MLCAdmissionController::setKVCapacity(int kv_capacity_tokens) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    kv_capacity_ = std::max(0, kv_capacity_tokens);
+}
+
+double MLCAdmissionController::expectedTokens(const Entry& entry) const {
+    double expected = entry.expected_tokens > 0 ? entry.expected_tokens : completion_tokens_;
+    return std::min(static_cast<double>(entry.max_tokens), expected);
+}
+
+double MLCAdmissionController::serviceSeconds(const Entry& entry) const {
+    return entry.prompt_tokens / prefill_tokens_per_second_ + expectedTokens(entry) / decode_tokens_per_second_;
+}
+
+double MLCAdmissionController::remainingSeconds(const Entry& entry) const {
+    if (entry.generated == 0) return serviceSeconds(entry);
+    // A request past its expected length is assumed to be close to done
+    double left = std::max(expectedTokens(entry) - entry.generated, 1.0);
+    left = std::min(left, static_cast<double>(std::max(entry.max_tokens - entry.generated, 1)));
+    return left / decode_tokens_per_second_;
+}
+
+double MLCAdmissionController::estimateLocked(int kv_tokens, int* queue_depth, double* next_free) const {
+    // Expected free time and KV reservation of each busy slot, earliest first
+    using Busy = std::pair<double, int>;
+    std::priority_queue<Busy, std::vector<Busy>, std::greater<Busy>> busy;
+    int kv_reserved = 0;
+    double now = 0.0;
+
+    // Advances `now` until a slot and enough KV are free for `need` tokens
+    auto waitFor = [&](int need) {
+        bool waited = false;
+        need = kv_capacity_ > 0 ? std::min(need, kv_capacity_) : 0;
+        while (!busy.empty() &&
+               (static_cast<int>(busy.size()) >= slots_ || (kv_capacity_ > 0 && kv_reserved + need > kv_capacity_))) {
+            if (!waited) *next_free = std::max(0.0, busy.top().first);
+            now = std::max(now, busy.top().first);
+            kv_reserved -= busy.top().second;
+            busy.pop();
+            waited = true;
+        }
+        return waited;
+    };
+
+    *queue_depth = 0;
+    for (const auto& arrival : arrival_order_) {
+        const Entry& entry = entries_.at(arrival.second).second;
+        bool waited = waitFor(entry.kv_tokens) || now > 0.0;
+        // Requests that fit right away are taken to be running already
+        busy.push(Busy(now + (waited ? serviceSeconds(entry) : remainingSeconds(entry)), entry.kv_tokens));
+        kv_reserved += entry.kv_tokens;
+        if (waited) ++*queue_depth;
+    }
+
+    *next_free = 0.0;
+    waitFor(kv_tokens);
+    return now;
+}
+
+MLCAdmissionDecision MLCAdmissionController::admit(const std::string& request_id, int prompt_tokens, int max_tokens,
+                                                   int expected_tokens, int reserve_tokens) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    MLCAdmissionDecision decision;
+    // Without a prediction, reserving max_tokens would serialize the engine;
+    // the engine allocates KV lazily, so the average completion is closer
+    int reserve = reserve_tokens > 0 ? reserve_tokens
+                                     : static_cast<int>(std::min<double>(max_tokens, completion_tokens_));
+    int kv_tokens = prompt_tokens + reserve;
+    double next_free = 0.0;
+    double wait = estimateLocked(kv_tokens, &decision.queue_depth, &next_free);
+    decision.estimated_wait_ms = static_cast<int64_t>(wait * 1000.0);
+
+    if (config_.enabled && wait > 0.0 &&
+        (decision.queue_depth >= config_.max_queued || decision.estimated_wait_ms > config_.max_wait_ms)) {
+        decision.admitted = false;
+        // By then either a slot has freed up or the queue has drained below the ceiling
+        double retry = std::max(next_free, wait - config_.max_wait_ms / 1000.0);
+        decision.retry_after_ms = std::max<int64_t>(1, static_cast<int64_t>(retry * 1000.0));
+        return decision;
+    }
+
+    Entry entry;
+    entry.prompt_tokens = prompt_tokens;
+    entry.max_tokens = max_tokens;
+    entry.expected_tokens = expected_tokens;
+    entry.kv_tokens = kv_tokens;
+    entry.started_immediately = wait == 0.0;
+    entry.admitted_at = Clock::now();
+    uint64_t order = next_order_++;
+    arrival_order_[order] = request_id;
+    entries_[request_id] = std::make_pair(order, entry);
+    return decision;
+}
+
+void MLCAdmissionController::onTokens(const std::string& request_id, int count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(request_id);
+    if (it == entries_.end() || count <= 0) return;
+    Entry& entry = it->second.second;
+    if (entry.generated == 0) {
+        entry.first_token_at = Clock::now();
+        double ttft = seconds(entry.first_token_at - entry.admitted_at);
+        if (entry.started_immediately && ttft > 0.0 && entry.prompt_tokens > 0) {
+            prefill_tokens_per_second_ = smooth(prefill_tokens_per_second_, entry.prompt_tokens / ttft);
+        }
+    }
+    entry.generated += count;
+}
+
+void MLCAdmissionController::onFinish(const std::string& request_id, bool completed) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(request_id);
+    if (it == entries_.end()) return;
+    const Entry& entry = it->second.second;
+
+    if (completed && entry.generated > 1) {
+        double decode = seconds(Clock::now() - entry.first_token_at);
+        if (decode > 0.0) {
+            decode_tokens_per_second_ = smooth(decode_tokens_per_second_, (entry.generated - 1) / decode);
+        }
+    }
+    if (completed && entry.generated > 0) {
+        completion_tokens_ = has_completion_samples_ ? smooth(completion_tokens_, entry.generated) : entry.generated;
+        has_completion_samples_ = true;
+    }
+
+    arrival_order_.erase(it->second.first);
+    entries_.erase(it);
+}
+
+int64_t MLCAdmissionController::estimatedWaitMs() const {
+    return load().estimated_wait_ms;
+}
+
+MLCAdmissionController::Load MLCAdmissionController::load() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Load load;
+    double next_free = 0.0;
+    // For a request of average size; the estimate also counts who waits ahead of it
+    int kv_tokens = static_cast<int>(completion_tokens_);
+    load.estimated_wait_ms = static_cast<int64_t>(estimateLocked(kv_tokens, &load.queue_depth, &next_free) * 1000.0);
+    load.kv_capacity_tokens = kv_capacity_;
+    for (const auto& entry : entries_) load.kv_reserved_tokens += entry.second.second.kv_tokens;
+    return load;
+}
@@ -0,0 +1,104 @@
+#ifndef MLCAdmissionController_h
+#define MLCAdmissionController_h
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+struct MLCAdmissionControlConfig {
+    // When disabled requests are still tracked, so estimates stay warm
+    bool enabled = false;
+    // Requests allowed to wait for a free sequence slot
+    int max_queued = 4;
+    // Requests whose estimated wait exceeds this are refused
+    int max_wait_ms = 3000;
+};
+
+struct MLCAdmissionDecision {
+    bool admitted = true;
+    int64_t estimated_wait_ms = 0;
+    // Suggested delay before retrying a refused request
+    int64_t retry_after_ms = 0;
+    // Requests waiting for a slot ahead of this one
+    int queue_depth = 0;
+};
+
+// Load shedding in front of the engine. Tracks every in-flight request in
+// arrival order; a request occupies one of the engine's `slots` sequences and
+// reserves KV cache for its prompt plus its predicted completion, and waits
+// while either runs out. The wait of a new request is estimated by replaying
+// the queue against the slots' expected free times, using running averages of
+// prefill and decode throughput and per-request completion length estimates
+// (MLCLengthPredictor), falling back to the average length of finished
+// requests. Refusal is decided under one mutex without touching the engine,
+// so an overloaded caller learns it in microseconds.
+class MLCAdmissionController {
+public:
+    // `kv_capacity_tokens` is the engine's KV pool (max_total_sequence_length);
+    // 0 tracks slots only
+    MLCAdmissionController(int slots, int kv_capacity_tokens);
+
+    void configure(const MLCAdmissionControlConfig& config);
+    // The KV pool is only known once the model's cache layout has been read
+    void setKVCapacity(int kv_capacity_tokens);
+
+    // Registers the request if admitted. `expected_tokens` (0 = unknown) drives
+    // the wait estimate and `reserve_tokens` (0 = unknown) its KV reservation.
+    MLCAdmissionDecision admit(const std::string& request_id, int prompt_tokens, int max_tokens,
+                               int expected_tokens = 0, int reserve_tokens = 0);
+    void onTokens(const std::string& request_id, int count);
+    // `completed` requests contribute throughput and length samples
+    void onFinish(const std::string& request_id, bool completed);
+
+    int64_t estimatedWaitMs() const;
+
+    struct Load {
+        int queue_depth = 0;         // admitted requests that cannot start yet
+        int64_t estimated_wait_ms = 0;
+        int kv_capacity_tokens = 0;
+        int kv_reserved_tokens = 0;
+    };
+    Load load() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        int prompt_tokens = 0;
+        int max_tokens = 0;
+        int expected_tokens = 0;
+        int kv_tokens = 0;
+        int generated = 0;
+        // Admitted straight into a free slot, so its TTFT measures prefill
+        bool started_immediately = false;
+        Clock::time_point admitted_at;
+        Clock::time_point first_token_at;
+    };
+
+    double expectedTokens(const Entry& entry) const;
+    double serviceSeconds(const Entry& entry) const;
+    double remainingSeconds(const Entry& entry) const;
+    // Returns the estimated wait in seconds of a request needing `kv_tokens`;
+    // fills queue depth and the time until the earliest slot frees up
+    double estimateLocked(int kv_tokens, int* queue_depth, double* next_free) const;
+
+    const int slots_;
+    MLCAdmissionControlConfig config_;
+
+    mutable std::mutex mutex_;
+    int kv_capacity_;
+    uint64_t next_order_ = 0;
+    std::map<uint64_t, std::string> arrival_order_;
+    std::unordered_map<std::string, std::pair<uint64_t, Entry>> entries_;
+
+    // Running averages, seeded with conservative TinyLlama-on-phone figures
+    double prefill_tokens_per_second_;
+    double decode_tokens_per_second_;
+    double completion_tokens_;
+    bool has_completion_samples_ = false;
+};
+
+#endif /* MLCAdmissionController_h */
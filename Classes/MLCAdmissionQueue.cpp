@@ -0,0 +1,76 @@
+#include "MLCAdmissionQueue.h"
+#include "MLCCpuTopology.h"
+#include <algorithm>
+#include <climits>
+
+MLCAdmissionQueue::MLCAdmissionQueue(std::chrono::microseconds window, int max_batch_tokens, BatchObserver observer)
+    : window_(window), max_batch_tokens_(max_batch_tokens), observer_(std::move(observer)) {
+    thread_ = MLCCpuTopology::startBridgeThread([this]() { run(); });
+}
+
+MLCAdmissionQueue::~MLCAdmissionQueue() {
+    stop();
+}
+
+void MLCAdmissionQueue::push(int prompt_tokens, int expected_tokens, Dispatch dispatch) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (pending_.empty()) {
+            deadline_ = std::chrono::steady_clock::now() + window_;
+        }
+        pending_.push_back(Pending{prompt_tokens, expected_tokens, std::move(dispatch)});
+        pending_tokens_ += prompt_tokens;
+    }
+    pending_cv_.notify_one();
+}
+
+void MLCAdmissionQueue::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    pending_cv_.notify_one();
+    if (thread_.joinable()) thread_.join();
+}
+
+void MLCAdmissionQueue::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        pending_cv_.wait(lock, [this]() { return stopping_ || !pending_.empty(); });
+        if (pending_.empty()) return;
+
+        pending_cv_.wait_until(lock, deadline_, [this]() {
+            return stopping_ || pending_tokens_ >= max_batch_tokens_;
+        });
+
+        // Take requests in arrival order while they fit the budget; the first
+        // one always goes even if it alone exceeds it
+        size_t count = 0;
+        int batch_tokens = 0;
+        while (count < pending_.size() &&
+               (count == 0 || batch_tokens + pending_[count].prompt_tokens <= max_batch_tokens_)) {
+            batch_tokens += pending_[count].prompt_tokens;
+            ++count;
+        }
+        std::vector<Pending> batch(std::make_move_iterator(pending_.begin()),
+                                   std::make_move_iterator(pending_.begin() + static_cast<std::ptrdiff_t>(count)));
+        pending_.erase(pending_.begin(), pending_.begin() + static_cast<std::ptrdiff_t>(count));
+        pending_tokens_ -= batch_tokens;
+        // Short requests first: they free their sequence and KV soonest, so the
+        // engine is less likely to have to preempt to fit the long ones
+        std::stable_sort(batch.begin(), batch.end(), [](const Pending& a, const Pending& b) {
+            int a_tokens = a.expected_tokens > 0 ? a.expected_tokens : INT_MAX;
+            int b_tokens = b.expected_tokens > 0 ? b.expected_tokens : INT_MAX;
+            return a_tokens < b_tokens;
+        });
+        // Leftovers have already waited a full window
+        deadline_ = std::chrono::steady_clock::now();
+
+        lock.unlock();
+        for (Pending& pending : batch) {
+            pending.dispatch();
+        }
+        if (observer_) observer_(batch.size(), batch_tokens);
+        lock.lock();
+    }
+}
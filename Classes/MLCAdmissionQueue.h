@@ -0,0 +1,61 @@
+#ifndef MLCAdmissionQueue_h
+#define MLCAdmissionQueue_h
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Short admission window in front of the engine. The first request of a burst
+// opens the window; everything that arrives before it closes, up to a
+// prompt-token budget, is dispatched back to back on the admission thread so
+// the engine finds the whole burst waiting in one step and prefills it as a
+// single packed batch instead of one prefill per request. Within a batch,
+// requests expected to finish soonest go first.
+class MLCAdmissionQueue {
+public:
+    using Dispatch = std::function<void()>;
+    // Called on the admission thread after each batch with its size and tokens
+    using BatchObserver = std::function<void(size_t requests, int prompt_tokens)>;
+
+    MLCAdmissionQueue(std::chrono::microseconds window, int max_batch_tokens, BatchObserver observer);
+    ~MLCAdmissionQueue();
+
+    MLCAdmissionQueue(const MLCAdmissionQueue&) = delete;
+    MLCAdmissionQueue& operator=(const MLCAdmissionQueue&) = delete;
+
+    // Queues `dispatch` (which hands one request to the engine) for the current
+    // window. A request at or above the token budget closes the window at once.
+    // `expected_tokens` is its predicted completion length, 0 if unknown.
+    void push(int prompt_tokens, int expected_tokens, Dispatch dispatch);
+
+    // Dispatches anything still waiting and joins the admission thread
+    void stop();
+
+private:
+    struct Pending {
+        int prompt_tokens;
+        int expected_tokens;
+        Dispatch dispatch;
+    };
+
+    void run();
+
+    const std::chrono::microseconds window_;
+    const int max_batch_tokens_;
+    BatchObserver observer_;
+
+    std::mutex mutex_;
+    std::condition_variable pending_cv_;
+    std::vector<Pending> pending_;
+    int pending_tokens_ = 0;
+    std::chrono::steady_clock::time_point deadline_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+#endif /* MLCAdmissionQueue_h */
@@ -0,0 +1,47 @@
+#ifndef MLCBackend_h
+#define MLCBackend_h
+
+#include "MLCDeliverySink.h"
+#include <memory>
+#include <string>
+
+// Text-level description of one generation, common to every backend
+struct MLCBackendRequest {
+    std::string prompt;
+    // Replaces the backend's default system prompt when `has_system` is set
+    std::string system;
+    bool has_system = false;
+    int max_tokens = 0;
+    float temperature = 0.0f;
+    // Similarity-cache class for the local engine; remote backends ignore it
+    std::string request_class;
+    // LOGPROBS events per token from the local engine; remote backends ignore it
+    int top_logprobs = 0;
+};
+
+// Handle to a running generation
+class MLCBackendStream {
+public:
+    virtual ~MLCBackendStream() = default;
+
+    // Stops generating as soon as possible. The sink receives no further calls
+    // once cancel() returns, apart from one already in progress.
+    virtual void cancel() = 0;
+};
+
+// Something that can turn a prompt into streamed text: the on-device engine or
+// a remote API. Output goes to the sink from a backend-owned thread, with the
+// same contract as MLCDeliverySink (chunks, then onFinish or onError once).
+class MLCBackend {
+public:
+    virtual ~MLCBackend() = default;
+
+    virtual const char* name() const = 0;
+
+    // Starts generating. On failure returns nullptr, stores an MLC_LLM_* code
+    // in `status` and never calls the sink.
+    virtual std::shared_ptr<MLCBackendStream> start(const MLCBackendRequest& request,
+                                                    std::unique_ptr<MLCDeliverySink> sink, int* status) = 0;
+};
+
+#endif /* MLCBackend_h */
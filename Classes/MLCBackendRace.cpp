@@ -0,0 +1,261 @@
+#include "MLCBackendRace.h"
+#include "MLCBridge.h"
+#include "MLCCpuTopology.h"
+#include "MLCMetrics.h"
+#include <iostream>
+
+struct MLCBackendRace::Race : public std::enable_shared_from_this<Race> {
+    static constexpr int kPrimary = 0;
+    static constexpr int kFallback = 1;
+    static constexpr int kNone = -1;
+
+    MLCBackendRequest request;
+    std::shared_ptr<MLCBackend> backends[2];
+    std::unique_ptr<MLCDeliverySink> sink;
+    MLCMetrics* metrics = nullptr;
+    std::shared_ptr<std::atomic<bool>> stopped;
+    std::chrono::steady_clock::time_point started_at;
+
+    // Arm that owns the caller's sink; only that arm's thread touches it
+    std::atomic<int> winner{kNone};
+
+    std::mutex mutex;
+    bool started[2] = {false, false};
+    bool failed[2] = {false, false};
+    std::shared_ptr<MLCBackendStream> streams[2];
+
+    int startArm(int arm);
+    bool claim(int arm);
+    void armFailed(int arm, const std::string& message);
+    void onDeadline();
+};
+
+// Sink handed to one arm; forwards to the caller's sink once the arm has won
+class MLCBackendRace::ArmSink : public MLCDeliverySink {
+public:
+    ArmSink(std::shared_ptr<Race> race, int arm) : race_(std::move(race)), arm_(arm) {}
+
+    void onChunk(const std::string& text) override {
+        if (text.empty()) return;
+        if (race_->claim(arm_)) race_->sink->onChunk(text);
+    }
+
+    void onTokens(const std::vector<int32_t>& token_ids) override {
+        if (race_->winner == arm_) race_->sink->onTokens(token_ids);
+    }
+
+    void onLogprobs(const std::vector<std::string>& logprob_json) override {
+        if (race_->winner == arm_) race_->sink->onLogprobs(logprob_json);
+    }
+
+    void flush() override {
+        if (race_->winner == arm_) race_->sink->flush();
+    }
+
+    void onFinish(const MLCFinishInfo& info) override {
+        // An arm that finishes without any text still answers first
+        if (race_->claim(arm_)) race_->sink->onFinish(info);
+    }
+
+    void onError(const std::string& message) override {
+        if (race_->winner == arm_) {
+            race_->sink->onError(message);
+        } else if (race_->winner == Race::kNone) {
+            race_->armFailed(arm_, message);
+        }
+    }
+
+    // A losing arm looks like a closed peer, so backends stop feeding it
+    bool closed() const override {
+        int winner = race_->winner;
+        if (winner == Race::kNone) return false;
+        return winner != arm_ || race_->sink->closed();
+    }
+
+private:
+    std::shared_ptr<Race> race_;
+    int arm_;
+};
+
+int MLCBackendRace::Race::startArm(int arm) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (started[arm]) return MLC_LLM_OK;
+        if (stopped->load() || winner != kNone) return MLC_LLM_ERROR_FAILED;
+        started[arm] = true;
+    }
+    if (arm == kFallback) {
+        if (metrics) metrics->race_fallback_starts++;
+        auto waited = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - started_at);
+        std::cout << "☁️ Starting " << backends[arm]->name() << " backend after " << waited.count() << " ms" << std::endl;
+    }
+
+    int status = MLC_LLM_OK;
+    std::shared_ptr<MLCBackendStream> stream =
+        backends[arm]->start(request, std::make_unique<ArmSink>(shared_from_this(), arm), &status);
+
+    bool lost;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!stream) {
+            failed[arm] = true;
+            return status;
+        }
+        streams[arm] = stream;
+        // The other arm may have won while this one was starting
+        int current = winner;
+        lost = current != kNone && current != arm;
+    }
+    if (lost) stream->cancel();
+    return MLC_LLM_OK;
+}
+
+bool MLCBackendRace::Race::claim(int arm) {
+    std::shared_ptr<MLCBackendStream> loser;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        int current = winner;
+        if (current != kNone) return current == arm;
+        winner = arm;
+        loser = streams[1 - arm];
+    }
+    // Cancelled outside the lock: a backend may call back into its sink while
+    // it is being cancelled
+    if (loser) loser->cancel();
+    if (arm == kFallback) {
+        if (metrics) metrics->race_fallback_wins++;
+        std::cout << "☁️ " << backends[arm]->name() << " backend answered first" << std::endl;
+    }
+    return true;
+}
+
+void MLCBackendRace::Race::armFailed(int arm, const std::string& message) {
+    bool start_fallback = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (winner != kNone) return;
+        failed[arm] = true;
+        int other = 1 - arm;
+        if (arm == kPrimary && backends[kFallback] && !started[kFallback]) {
+            start_fallback = true;
+        } else if (started[other] && !failed[other]) {
+            // The other arm may still answer
+            return;
+        } else {
+            winner = arm;
+        }
+    }
+    if (start_fallback) {
+        std::cerr << "⚠️ " << backends[arm]->name() << " backend failed before its first token: " << message << std::endl;
+        if (startArm(kFallback) == MLC_LLM_OK) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        if (winner != kNone) return;
+        winner = arm;
+    }
+    sink->onError(message);
+}
+
+void MLCBackendRace::Race::onDeadline() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (winner != kNone || started[kFallback]) return;
+    }
+    if (startArm(kFallback) != MLC_LLM_OK) {
+        // The primary keeps running and still owns the request
+        std::lock_guard<std::mutex> lock(mutex);
+        if (failed[kPrimary] && winner == kNone) {
+            winner = kPrimary;
+            sink->onError("all backends failed");
+        }
+    }
+}
+
+MLCBackendRace::MLCBackendRace(MLCMetrics* metrics)
+    : metrics_(metrics), stopped_(std::make_shared<std::atomic<bool>>(false)) {}
+
+MLCBackendRace::~MLCBackendRace() {
+    stop();
+}
+
+int MLCBackendRace::start(const MLCBackendRequest& request, std::shared_ptr<MLCBackend> primary,
+                          std::shared_ptr<MLCBackend> fallback, std::chrono::milliseconds deadline,
+                          std::unique_ptr<MLCDeliverySink> sink) {
+    if (!primary) return MLC_LLM_ERROR_INVALID;
+    if (!fallback) {
+        int status = MLC_LLM_OK;
+        return primary->start(request, std::move(sink), &status) ? MLC_LLM_OK : status;
+    }
+    if (stopped_->load()) return MLC_LLM_ERROR_FAILED;
+
+    auto race = std::make_shared<Race>();
+    race->request = request;
+    race->backends[Race::kPrimary] = std::move(primary);
+    race->backends[Race::kFallback] = std::move(fallback);
+    race->sink = std::move(sink);
+    race->metrics = metrics_;
+    race->stopped = stopped_;
+    // Measured from submission so primary setup (tokenization, admission) counts
+    race->started_at = std::chrono::steady_clock::now();
+
+    int status = race->startArm(Race::kPrimary);
+    if (status != MLC_LLM_OK) {
+        // Refused or broken locally: go straight to the fallback. If that fails
+        // too the caller gets the error and the sink is never called.
+        std::cerr << "⚠️ " << race->backends[Race::kPrimary]->name() << " backend unavailable ("
+                  << status << "), using " << race->backends[Race::kFallback]->name() << std::endl;
+        return race->startArm(Race::kFallback);
+    }
+
+    std::weak_ptr<Race> weak_race = race;
+    schedule(race->started_at + deadline, [weak_race]() {
+        if (auto pending = weak_race.lock()) pending->onDeadline();
+    });
+    return MLC_LLM_OK;
+}
+
+void MLCBackendRace::stop() {
+    stopped_->store(true);
+    {
+        std::lock_guard<std::mutex> lock(timer_mutex_);
+        timer_stopping_ = true;
+        deadlines_.clear();
+    }
+    timer_cv_.notify_one();
+    if (timer_thread_.joinable()) timer_thread_.join();
+}
+
+void MLCBackendRace::schedule(std::chrono::steady_clock::time_point when, std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(timer_mutex_);
+        if (timer_stopping_) return;
+        deadlines_.emplace(when, std::move(task));
+        // Started with the first race so engines that never race pay nothing
+        if (!timer_thread_.joinable()) {
+            timer_thread_ = MLCCpuTopology::startBridgeThread([this]() { runTimer(); });
+        }
+    }
+    timer_cv_.notify_one();
+}
+
+void MLCBackendRace::runTimer() {
+    std::unique_lock<std::mutex> lock(timer_mutex_);
+    while (!timer_stopping_) {
+        if (deadlines_.empty()) {
+            timer_cv_.wait(lock);
+            continue;
+        }
+        auto next = deadlines_.begin();
+        // Copied: stop() may clear the map while we wait
+        std::chrono::steady_clock::time_point due = next->first;
+        if (std::chrono::steady_clock::now() < due) {
+            timer_cv_.wait_until(lock, due);
+            continue;
+        }
+        std::function<void()> task = std::move(next->second);
+        deadlines_.erase(next);
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef MLCBackendRace_h
+#define MLCBackendRace_h
+
+#include "MLCBackend.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+class MLCMetrics;
+
+// First-token race between two backends. The primary (the on-device engine)
+// starts at once; if it has produced no text when the deadline passes, the
+// fallback (a remote API) is started as well. Whichever streams first owns the
+// caller's sink from then on and the other is cancelled. A primary that fails
+// before its first token, including being refused by admission control, starts
+// the fallback immediately.
+//
+// Deadlines are kept on one timer thread with a steady clock, so the switch
+// happens at the configured instant rather than on the next caller poll.
+class MLCBackendRace {
+public:
+    explicit MLCBackendRace(MLCMetrics* metrics);
+    ~MLCBackendRace();
+
+    MLCBackendRace(const MLCBackendRace&) = delete;
+    MLCBackendRace& operator=(const MLCBackendRace&) = delete;
+
+    // Returns an MLC_LLM_* code. Without a fallback this simply runs `primary`.
+    int start(const MLCBackendRequest& request, std::shared_ptr<MLCBackend> primary,
+              std::shared_ptr<MLCBackend> fallback, std::chrono::milliseconds deadline,
+              std::unique_ptr<MLCDeliverySink> sink);
+
+    // Cancels pending deadlines and joins the timer thread. Races still in
+    // flight keep their current arms but start no new ones.
+    void stop();
+
+private:
+    struct Race;
+    class ArmSink;
+
+    void schedule(std::chrono::steady_clock::time_point when, std::function<void()> task);
+    void runTimer();
+
+    MLCMetrics* metrics_;
+    std::shared_ptr<std::atomic<bool>> stopped_;
+
+    std::mutex timer_mutex_;
+    std::condition_variable timer_cv_;
+    std::multimap<std::chrono::steady_clock::time_point, std::function<void()>> deadlines_;
+    bool timer_stopping_ = false;
+    std::thread timer_thread_;
+};
+
+#endif /* MLCBackendRace_h */
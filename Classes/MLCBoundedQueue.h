@@ -0,0 +1,59 @@
+#ifndef MLCBoundedQueue_h
+#define MLCBoundedQueue_h
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+// Fixed-capacity blocking queue connecting pipeline stages. A full queue blocks
+// the producer, which is how a slow stage pushes back on the ones before it.
+template <typename T>
+class MLCBoundedQueue {
+public:
+    explicit MLCBoundedQueue(size_t capacity) : capacity_(capacity ? capacity : 1) {}
+
+    // Blocks while the queue is full; returns false once the queue is closed
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this]() { return closed_ || items_.size() < capacity_; });
+        if (closed_) return false;
+        items_.push_back(std::move(item));
+        not_empty_.notify_one();
+        return true;
+    }
+
+    // Blocks while the queue is empty; returns false once it is closed and drained
+    bool pop(T* item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this]() { return closed_ || !items_.empty(); });
+        if (items_.empty()) return false;
+        *item = std::move(items_.front());
+        items_.pop_front();
+        not_full_.notify_one();
+        return true;
+    }
+
+    // Wakes all waiters; pending items can still be popped
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return items_.size();
+    }
+
+private:
+    const size_t capacity_;
+    mutable std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+    std::deque<T> items_;
+    bool closed_ = false;
+};
+
+#endif /* MLCBoundedQueue_h */
@@ -1,10 +1,47 @@
 #include "MLCBridge.h"
+#include "MLCAdmissionController.h"
+#include "MLCAdmissionQueue.h"
+#include "MLCBackend.h"
+#include "MLCBackendRace.h"
+#include "MLCChatTemplate.h"
+#include "MLCCpuTopology.h"
+#include "MLCDartSink.h"
+#include "MLCDeliverySink.h"
+#include "MLCDisaggCoordinator.h"
+#include "MLCDocumentIndex.h"
+#include "MLCEngineConfig.h"
+#include "MLCEvents.h"
+#include "MLCFlightRecorder.h"
+#include "MLCFdSink.h"
+#include "MLCIngestPipeline.h"
+#include "MLCJson.h"
+#include "MLCJsonStream.h"
+#include "MLCKVCacheLayout.h"
+#include "MLCLengthPredictor.h"
+#include "MLCMetrics.h"
+#include "MLCOpenAIBackend.h"
+#include "MLCPrewarmer.h"
+#include "MLCRepetitionDetector.h"
+#include "MLCReplicaRouter.h"
+#include "MLCSimilarityCache.h"
+#include "MLCTelemetryPage.h"
+#include "MLCTokenizer.h"
+#include "MLCWeightPrefetcher.h"
 #include <string>
 #include <vector>
 #include <memory>
 #include <iostream>
 #include <functional>
 #include <chrono>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
 
 // Include TVM FFI headers for real MLC-LLM integration
 #include <tvm/runtime/module.h>
@@ -13,190 +50,2469 @@
 
 using namespace tvm::runtime;
 
+static_assert(static_cast<int>(MLCJsonValue::Type::Object) == MLC_LLM_JSON_OBJECT &&
+              static_cast<int>(MLCJsonValue::Type::Null) == MLC_LLM_JSON_NULL,
+              "MLC_LLM_JSON_* constants must mirror MLCJsonValue::Type");
+
+namespace {
+
+// Outcome of the calling thread's most recent submit, for mlc_llm_last_admission_status
+thread_local mlc_llm_admission_status_t t_last_admission = {};
+
+// Earlier output tokens replayed into a continuation's detokenizer
+const int kResumePrimeTokens = 8;
+
+// Collects the next-token log-probabilities of a score request for the caller
+// blocked in MLCEngineWrapper::score(). Shared because the sink itself is
+// destroyed with the request state on the stream-back thread.
+struct MLCScoreResult {
+    std::mutex mutex;
+    std::condition_variable done_cv;
+    bool done = false;
+    std::string error;
+    std::vector<std::pair<std::string, float>> top_logprobs;
+};
+
+class MLCScoreSink : public MLCDeliverySink {
+public:
+    explicit MLCScoreSink(std::shared_ptr<MLCScoreResult> result) : result_(std::move(result)) {}
+    // A request dropped without finishing (cancelled, engine shut down) must
+    // still wake the caller
+    ~MLCScoreSink() override {
+        if (!completed_) complete("request ended without a result");
+    }
+
+    void onChunk(const std::string&) override {}
+
+    void onLogprobs(const std::vector<std::string>& logprob_json) override {
+        if (logprob_json.empty()) return;
+        MLCJsonValue record;
+        if (!MLCJson::parse(logprob_json[0], &record)) return;
+        const MLCJsonValue* top = record.get("top_logprobs");
+        if (!top) return;
+        std::lock_guard<std::mutex> lock(result_->mutex);
+        for (const MLCJsonValue& entry : top->array) {
+            const MLCJsonValue* token = entry.get("token");
+            const MLCJsonValue* logprob = entry.get("logprob");
+            if (token && logprob) {
+                result_->top_logprobs.emplace_back(token->asString(), static_cast<float>(logprob->asNumber()));
+            }
+        }
+    }
+
+    void onFinish(const MLCFinishInfo&) override { complete(""); }
+
+    void onError(const std::string& message) override { complete(message); }
+
+private:
+    void complete(const std::string& error) {
+        completed_ = true;
+        {
+            std::lock_guard<std::mutex> lock(result_->mutex);
+            result_->done = true;
+            result_->error = error;
+        }
+        result_->done_cv.notify_all();
+    }
+
+    std::shared_ptr<MLCScoreResult> result_;
+    bool completed_ = false;
+};
+
+// Output of a blocking generate, gathered by MLCBufferSink. Shared because
+// the sink is destroyed with the request state on the stream-back thread.
+struct MLCBufferResult {
+    std::mutex mutex;
+    std::condition_variable done_cv;
+    bool done = false;
+    std::string error;
+    MLCFinishInfo info;
+};
+
+// Copies every chunk into one caller-owned buffer; the caller only hears
+// about the request once, when it ends
+class MLCBufferSink : public MLCDeliverySink {
+public:
+    MLCBufferSink(std::shared_ptr<MLCBufferResult> result, char* buffer, size_t capacity, size_t* length)
+        : result_(std::move(result)), buffer_(buffer), capacity_(capacity), length_(length) {
+        *length_ = 0;
+        if (capacity_ > 0) buffer_[0] = '\0';
+    }
+    // Cancelled requests, engine teardown and refused race arms drop the sink
+    // without a final call; the caller blocked in generateSync still wakes
+    ~MLCBufferSink() override {
+        if (!completed_) complete(MLCFinishInfo(), "request ended without a result");
+    }
+
+    void onChunk(const std::string& text) override {
+        // Written before done is set under the mutex, so the woken caller sees it
+        size_t used = std::min(*length_, capacity_ > 0 ? capacity_ - 1 : 0);
+        size_t room = capacity_ > 0 ? capacity_ - 1 - used : 0;
+        size_t count = std::min(room, text.size());
+        if (count > 0) {
+            std::memcpy(buffer_ + used, text.data(), count);
+            buffer_[used + count] = '\0';
+        }
+        *length_ += text.size();
+    }
+
+    void onFinish(const MLCFinishInfo& info) override { complete(info, ""); }
+
+    void onError(const std::string& message) override { complete(MLCFinishInfo(), message); }
+
+private:
+    void complete(const MLCFinishInfo& info, const std::string& error) {
+        completed_ = true;
+        {
+            std::lock_guard<std::mutex> lock(result_->mutex);
+            result_->done = true;
+            result_->info = info;
+            result_->error = error;
+        }
+        result_->done_cv.notify_all();
+    }
+
+    std::shared_ptr<MLCBufferResult> result_;
+    char* buffer_;
+    size_t capacity_;
+    size_t* length_;
+    bool completed_ = false;
+};
+
+// First word of a prompt, lowercased; instructions like "summarize" or "list"
+// say a lot about the answer's length
+std::string leadWord(const std::string& prompt) {
+    std::string word;
+    for (char c : prompt) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (std::isalpha(byte)) {
+            if (word.size() < 24) word += static_cast<char>(std::tolower(byte));
+        } else if (!word.empty()) {
+            break;
+        }
+    }
+    return word;
+}
+
+// Feeds a raced request's JSON subscriptions from whichever backend answers
+class MLCJsonTeeSink : public MLCDeliverySink {
+public:
+    MLCJsonTeeSink(std::unique_ptr<MLCDeliverySink> sink, std::unique_ptr<MLCJsonStream> json_stream)
+        : sink_(std::move(sink)), json_stream_(std::move(json_stream)) {}
+
+    void onChunk(const std::string& text) override {
+        sink_->onChunk(text);
+        json_stream_->feed(text);
+    }
+
+    void onTokens(const std::vector<int32_t>& token_ids) override { sink_->onTokens(token_ids); }
+    void onLogprobs(const std::vector<std::string>& logprob_json) override { sink_->onLogprobs(logprob_json); }
+    void flush() override { sink_->flush(); }
+    void onFinish(const MLCFinishInfo& info) override { sink_->onFinish(info); }
+    void onError(const std::string& message) override { sink_->onError(message); }
+    bool closed() const override { return sink_->closed(); }
+
+private:
+    std::unique_ptr<MLCDeliverySink> sink_;
+    std::unique_ptr<MLCJsonStream> json_stream_;
+};
+
+// Holds a routed request's place on its replica until the engine lets go of
+// the sink, however the request ends
+class MLCRoutedSink : public MLCDeliverySink {
+public:
+    MLCRoutedSink(std::unique_ptr<MLCDeliverySink> sink, std::shared_ptr<MLCReplicaRouter> router, size_t replica)
+        : sink_(std::move(sink)), router_(std::move(router)), replica_(replica) {}
+    ~MLCRoutedSink() override { router_->onFinish(replica_); }
+
+    void onChunk(const std::string& text) override { sink_->onChunk(text); }
+    void onTokens(const std::vector<int32_t>& token_ids) override { sink_->onTokens(token_ids); }
+    void onLogprobs(const std::vector<std::string>& logprob_json) override { sink_->onLogprobs(logprob_json); }
+    void flush() override { sink_->flush(); }
+    void onFinish(const MLCFinishInfo& info) override { sink_->onFinish(info); }
+    void onError(const std::string& message) override { sink_->onError(message); }
+    bool closed() const override { return sink_->closed(); }
+
+private:
+    std::unique_ptr<MLCDeliverySink> sink_;
+    std::shared_ptr<MLCReplicaRouter> router_;
+    size_t replica_;
+};
+
+// Output of a KV handoff step, which has no user-visible text
+class MLCDiscardSink : public MLCDeliverySink {
+public:
+    void onChunk(const std::string&) override {}
+    void onFinish(const MLCFinishInfo&) override {}
+    void onError(const std::string&) override {}
+};
+
+// Lets the disaggregation coordinator keep the caller's sink when an engine
+// refuses the request it was handed with, so the caller still hears about it
+class MLCSharedSink : public MLCDeliverySink {
+public:
+    explicit MLCSharedSink(std::shared_ptr<MLCDeliverySink> sink) : sink_(std::move(sink)) {}
+
+    void onChunk(const std::string& text) override { sink_->onChunk(text); }
+    void onTokens(const std::vector<int32_t>& token_ids) override { sink_->onTokens(token_ids); }
+    void onLogprobs(const std::vector<std::string>& logprob_json) override { sink_->onLogprobs(logprob_json); }
+    void flush() override { sink_->flush(); }
+    void onFinish(const MLCFinishInfo& info) override { sink_->onFinish(info); }
+    void onError(const std::string& message) override { sink_->onError(message); }
+    bool closed() const override { return sink_->closed(); }
+
+private:
+    std::shared_ptr<MLCDeliverySink> sink_;
+};
+
+// Reports how a prewarm request ended. The engine drops a preempted one
+// without further calls, which reports a failure from the destructor.
+class MLCPrewarmSink : public MLCDeliverySink {
+public:
+    MLCPrewarmSink(MLCPrewarmer::Done done, int prefix_tokens) : done_(std::move(done)), prefix_tokens_(prefix_tokens) {}
+    ~MLCPrewarmSink() override { report(false); }
+
+    void onChunk(const std::string&) override {}
+    // A prefix only needs its prompt processed; a completion is cached only when whole
+    void onFinish(const MLCFinishInfo& info) override { report(prefix_tokens_ > 0 || info.finish_reason == "stop"); }
+    void onError(const std::string&) override { report(false); }
+
+private:
+    void report(bool ok) {
+        if (!done_) return;
+        MLCPrewarmer::Done done = std::move(done_);
+        done_ = nullptr;
+        done(ok, ok ? prefix_tokens_ : 0);
+    }
+
+    MLCPrewarmer::Done done_;
+    int prefix_tokens_;
+};
+
+} // namespace
+
 class MLCEngineWrapper {
 private:
+    // Per-request stream stage: delivery sink plus any output monitors
+    struct RequestState {
+        uint64_t seq = 0;   // request number in flight-recorder events
+        std::unique_ptr<MLCDeliverySink> sink;
+        std::unique_ptr<MLCRepetitionDetector> repetition;
+        std::unique_ptr<MLCJsonStream> json_stream;
+        MLCTokenizer::Streamer detokenizer;
+        int max_tokens = 0;
+        int prompt_tokens = 0;
+        int completion_tokens = 0;
+        bool wants_logprobs = false;
+        bool internal = false;   // issued by the bridge (KV handoff step, prewarming)
+        // Session whose tokens are retained for mlc_llm_continue when the
+        // request stops at max_tokens, and those tokens (prompt + output)
+        std::string retain_session;
+        std::vector<int32_t> token_history;
+        std::chrono::steady_clock::time_point submitted_at;
+        std::chrono::steady_clock::time_point first_token_at;
+
+        // Decoded text that may still turn out to be the start of a stop string
+        std::string held_text;
+
+        // Set when the request may populate the similarity cache
+        std::string cache_class;
+        std::string cache_prompt;
+        std::string output;
+
+        // Completion-length prediction made at submit, scored at finish
+        MLCLengthFeatures length_features;
+        MLCLengthPrediction length_prediction;
+    };
+
+    // The on-device engine as a race arm
+    class LocalBackend : public MLCBackend {
+    public:
+        explicit LocalBackend(MLCEngineWrapper* engine) : engine_(engine) {}
+
+        const char* name() const override { return "local"; }
+
+        std::shared_ptr<MLCBackendStream> start(const MLCBackendRequest& request,
+                                                std::unique_ptr<MLCDeliverySink> sink, int* status) override {
+            mlc_llm_request_t req;
+            mlc_llm_request_init(&req);
+            req.prompt = request.prompt.c_str();
+            req.system = request.has_system ? request.system.c_str() : nullptr;
+            req.max_tokens = request.max_tokens;
+            req.temperature = request.temperature;
+            req.request_class = request.request_class.empty() ? nullptr : request.request_class.c_str();
+
+            std::string request_id;
+            SubmitOptions options;
+            options.request_id_out = &request_id;
+            options.top_logprobs = request.top_logprobs;
+            *status = engine_->submit(req, std::move(sink), options);
+            if (*status != MLC_LLM_OK) return nullptr;
+            return std::make_shared<LocalStream>(engine_, request_id);
+        }
+
+    private:
+        class LocalStream : public MLCBackendStream {
+        public:
+            LocalStream(MLCEngineWrapper* engine, std::string request_id)
+                : engine_(engine), request_id_(std::move(request_id)) {}
+
+            // Cache hits complete inside submit() and have no id to cancel
+            void cancel() override {
+                if (!request_id_.empty()) engine_->cancelRequest(request_id_);
+            }
+
+        private:
+            MLCEngineWrapper* engine_;
+            std::string request_id_;
+        };
+
+        MLCEngineWrapper* engine_;
+    };
+
     std::string model_path_;
-    std::function<void(const char*)> token_callback_;
+    MLCEngineConfig config_;
+    MLCKVCacheLayout kv_layout_;
+    MLCThreadLayout thread_layout_;
+    MLCAdmissionController admission_control_;
+    MLCLengthPredictor length_predictor_;
     bool is_initialized_;
-    Module json_ffi_engine_;
-    PackedFunc init_background_engine_;
+    std::atomic<uint64_t> next_request_seq_{0};
+    MLCMetrics metrics_;
+    // Stream-back payloads and registrations; the flight recorder's stall
+    // watchdog compares it with requests_in_flight
+    std::atomic<uint64_t> last_progress_ns_{0};
+    int flight_probe_ = 0;
+    std::mutex telemetry_mutex_;
+    std::unique_ptr<MLCTelemetryPage> telemetry_;
+
+    std::mutex config_mutex_;
+    MLCRepetitionConfig repetition_config_;
+    MLCSimilarityCache similarity_cache_;
+
+    // Prompts are templated and tokenized here rather than in the engine so
+    // static template fragments are tokenized once per process
+    std::unique_ptr<MLCTokenizer> tokenizer_;
+    std::unique_ptr<MLCChatTemplate> chat_template_;
+    int vocab_size_ = 0;
+
+    // In-flight requests keyed by request id; touched by the caller thread on
+    // submit and by the stream-back thread on every payload
+    std::mutex requests_mutex_;
+    std::unordered_map<std::string, RequestState> requests_;
+    // SubmitOptions::on_usage callbacks; the usage record trails the finish
+    std::unordered_map<std::string, std::function<void(const std::string&)>> usage_waiters_;
+
+    // Sequences cut off at max_tokens, by session, until their grace period
+    // ends. Their KV stays in the engine's prefix cache as recycled sequences,
+    // so resubmitting the tokens only prefills the last one. Guarded by
+    // requests_mutex_.
+    struct RetainedSequence {
+        std::vector<int32_t> tokens;
+        int output_tokens = 0;
+        std::chrono::steady_clock::time_point expires_at;
+    };
+    std::unordered_map<std::string, RetainedSequence> retained_;
+    Module engine_;
+    PackedFunc init_threaded_engine_;
     PackedFunc reload_;
-    PackedFunc chat_completion_;
+    PackedFunc add_request_;
+    PackedFunc abort_request_;
     PackedFunc run_background_loop_;
     PackedFunc run_background_stream_back_loop_;
-    PackedFunc get_last_error_;
+    PackedFunc exit_background_loop_;
+    PackedFunc create_request_;
+    PackedFunc create_token_data_;
+    PackedFunc unpack_stream_output_;
+    std::thread background_loop_thread_;
+    std::thread stream_back_loop_thread_;
+    std::unique_ptr<MLCAdmissionQueue> admission_;
+    std::unique_ptr<MLCWeightPrefetcher> prefetcher_;
+    std::atomic<bool> startup_profiling_{false};
+
+    // Alternative backends for MLC_LLM_BACKEND_RACE / _REMOTE requests
+    std::shared_ptr<LocalBackend> local_backend_;
+    std::mutex backend_mutex_;
+    std::shared_ptr<MLCOpenAIBackend> remote_backend_;
+    int first_token_timeout_ms_ = 500;
+    MLCBackendRace race_{&metrics_};
+
+    MLCDocumentIndex document_index_;
+    std::mutex ingest_mutex_;
+    std::unique_ptr<MLCIngestPipeline> ingest_;
+
+    std::mutex prewarm_mutex_;
+    std::unique_ptr<MLCPrewarmer> prewarmer_;
+
+    static PackedFunc getGlobal(const char* name) {
+        const PackedFunc* func = Registry::Get(name);
+        if (!func) {
+            throw std::runtime_error(std::string("Cannot find ") + name + " function");
+        }
+        return *func;
+    }
 
 public:
-    MLCEngineWrapper(const std::string& model_path) : model_path_(model_path), is_initialized_(false) {
+    MLCEngineWrapper(const std::string& model_path, const MLCEngineConfig& config)
+        : model_path_(model_path), config_(config), admission_control_(config.max_num_sequence, config.max_total_sequence_length),
+          is_initialized_(false),
+          local_backend_(std::make_shared<LocalBackend>(this)) {
         std::cout << "🔧 Creating REAL MLC Engine with model path: " << model_path << std::endl;
-        
+
         try {
-            // Create the real MLC-LLM JSON FFI engine
-            const PackedFunc* create_func = Registry::Get("mlc.json_ffi.CreateJSONFFIEngine");
-            if (!create_func) {
-                throw std::runtime_error("Cannot find mlc.json_ffi.CreateJSONFFIEngine function");
-            }
-            
-            json_ffi_engine_ = (*create_func)();
-            
+            // The chat template comes from the same config the engine reads
+            MLCJsonValue chat_config;
+            std::string config_error;
+            if (!MLCJson::parseFile(model_path + "/mlc-chat-config.json", &chat_config, &config_error)) {
+                throw std::runtime_error("Cannot read mlc-chat-config.json: " + config_error);
+            }
+            tokenizer_ = std::make_unique<MLCTokenizer>(model_path);
+            MLCTokenizer* tokenizer = tokenizer_.get();
+            chat_template_ = std::make_unique<MLCChatTemplate>([tokenizer](const std::string& text) {
+                return tokenizer->encode(text);
+            });
+            if (!chat_template_->load(chat_config, &config_error)) {
+                throw std::runtime_error(config_error);
+            }
+            if (const MLCJsonValue* vocab_size = chat_config.get("vocab_size")) {
+                vocab_size_ = vocab_size->asInt();
+            }
+            configureKVCache(chat_config);
+            planThreadLayout();
+
+            // Create the real MLC-LLM threaded serve engine. Unlike the JSON FFI
+            // engine it accepts pre-tokenized prompts.
+            engine_ = getGlobal("mlc.serve.create_threaded_engine")();
+
             // Get all the required methods
-            init_background_engine_ = json_ffi_engine_->GetFunction("init_background_engine");
-            reload_ = json_ffi_engine_->GetFunction("reload");
-            chat_completion_ = json_ffi_engine_->GetFunction("chat_completion");
-            run_background_loop_ = json_ffi_engine_->GetFunction("run_background_loop");
-            run_background_stream_back_loop_ = json_ffi_engine_->GetFunction("run_background_stream_back_loop");
-            get_last_error_ = json_ffi_engine_->GetFunction("get_last_error");
-            
+            init_threaded_engine_ = engine_->GetFunction("init_threaded_engine");
+            reload_ = engine_->GetFunction("reload");
+            add_request_ = engine_->GetFunction("add_request");
+            abort_request_ = engine_->GetFunction("abort_request");
+            run_background_loop_ = engine_->GetFunction("run_background_loop");
+            run_background_stream_back_loop_ = engine_->GetFunction("run_background_stream_back_loop");
+            exit_background_loop_ = engine_->GetFunction("exit_background_loop");
+            create_request_ = getGlobal("mlc.serve.Request");
+            create_token_data_ = getGlobal("mlc.serve.TokenData");
+            unpack_stream_output_ = getGlobal("mlc.serve.RequestStreamOutputUnpack");
+
             // Create streaming callback
             PackedFunc stream_callback = PackedFunc([this](TVMArgs args, TVMRetValue* rv) {
-                std::string response_json = args[0].operator std::string();
-                // Parse and extract tokens from JSON response
-                this->processStreamResponse(response_json);
+                Array<ObjectRef> outputs = args[0];
+                this->processStreamOutputs(outputs);
+            });
+
+            // Initialize with Metal device 0
+            init_threaded_engine_(DLDevice{kDLMetal, 0}, stream_callback, nullptr);
+
+            // Both loops block until exit_background_loop; reload is executed by
+            // the background loop so they must be running first
+            background_loop_thread_ = std::thread([this]() {
+                MLCFlightRecorder::nameThread("engine-loop");
+                applyComputeLayout();
+                run_background_loop_();
             });
-            
-            // Initialize with Metal device (device_type=8 for Metal, device_id=0)
-            init_background_engine_(8, 0, stream_callback);
-            
+            stream_back_loop_thread_ = MLCCpuTopology::startBridgeThread([this]() {
+                MLCFlightRecorder::nameThread("stream-back");
+                run_background_stream_back_loop_();
+            });
+
+            startStartupPrefetch();
+
+            // Quantized KV pages are read by model libraries built for them
+            std::string kv_cache_field;
+            if (kv_layout_.dtype != MLCKVCacheDtype::Float16) {
+                kv_cache_field = std::string("\"kv_cache_dtype\": \"") + MLCKVCacheLayout::dtypeName(kv_layout_.dtype) + "\",";
+            }
+
+            // Finished sequences stay in the radix prefix cache for continuation
+            std::string retention_field;
+            if (config_.continue_retain_ms > 0) {
+                retention_field = R"("prefix_cache_mode": "radix", "prefix_cache_max_num_recycling_seqs": )" +
+                                  std::to_string(std::max(config_.continue_max_sequences, config_.max_num_sequence)) + ",";
+            }
+
             // Create engine configuration for TinyLlama
             std::string engine_config = R"({
-                "model": ")" + model_path + R"(",
-                "model_lib": "TinyLlama-1.1B-MLC",
-                "device": "metal:0",
-                "max_num_sequence": 1,
-                "max_total_sequence_length": 2048,
-                "prefill_chunk_size": 2048,
+                "model": ")" + MLCJson::escape(model_path) + R"(",
+                "model_lib": ")" + MLCJson::escape(config_.model_lib) + R"(",
+                "mode": "local",
+                "max_num_sequence": )" + std::to_string(config_.max_num_sequence) + R"(,
+                "max_total_sequence_length": )" + std::to_string(config_.max_total_sequence_length) + R"(,
+                "prefill_chunk_size": )" + std::to_string(config_.prefill_chunk_size) + R"(,
+                )" + kv_cache_field + R"(
+                )" + retention_field + R"(
                 "max_history_size": 1
             })";
-            
+
             // Reload the model
-            reload_(engine_config);
-            
+            MLCFlightRecorder::record(MLCFlightEventType::Reload, 0, 0);
+            try {
+                reload_(engine_config);
+            } catch (...) {
+                MLCFlightRecorder::record(MLCFlightEventType::Reload, 0, 2);
+                throw;
+            }
+            MLCFlightRecorder::record(MLCFlightEventType::Reload, 0, 1);
+
+            if (config_.admission_window_us > 0) {
+                int max_batch_tokens = config_.admission_max_tokens > 0 ? config_.admission_max_tokens
+                                                                        : config_.prefill_chunk_size;
+                admission_ = std::make_unique<MLCAdmissionQueue>(
+                    std::chrono::microseconds(config_.admission_window_us), max_batch_tokens,
+                    [this](size_t requests, int tokens) {
+                        // Runs on the admission thread only
+                        MLCFlightRecorder::record(MLCFlightEventType::AdmissionBatch, 0, static_cast<uint32_t>(requests),
+                                                  tokens);
+                        metrics_.admission_batches++;
+                        metrics_.admission_batched_requests += requests;
+                    });
+            }
+
+            flight_probe_ = MLCFlightRecorder::instance().addProbe([this](uint64_t* last_progress_ns) {
+                *last_progress_ns = last_progress_ns_;
+                return metrics_.requests_in_flight > 0;
+            });
+
             is_initialized_ = true;
-            std::cout << "✅ REAL MLC-LLM engine initialized successfully" << std::endl;
-            
+            std::cout << "✅ REAL MLC-LLM engine initialized successfully (template "
+                      << chat_template_->name() << ")" << std::endl;
+
         } catch (const std::exception& e) {
             std::cerr << "❌ Failed to initialize REAL MLC engine: " << e.what() << std::endl;
             is_initialized_ = false;
         }
     }
-    
+
     ~MLCEngineWrapper() {
         std::cout << "🗑️ Destroying REAL MLC Engine" << std::endl;
-        if (is_initialized_) {
+        if (flight_probe_) MLCFlightRecorder::instance().removeProbe(flight_probe_);
+        stopTelemetry();
+        configurePrewarm(false, MLCPrewarmConfig());
+        if (!similarity_cache_.persistPath().empty()) {
+            saveSimilarityCache("");
+        }
+        stopIngest();
+        // Remote workers may call back into the engine when they win or fail
+        race_.stop();
+        setRemoteBackend(nullptr, first_token_timeout_ms_);
+        finishStartupProfile();
+        if (prefetcher_) {
+            prefetcher_->stop();
+        }
+        // Hand over anything still in the admission window before the loops exit
+        if (admission_) {
+            admission_->stop();
+        }
+        if (background_loop_thread_.joinable() || stream_back_loop_thread_.joinable()) {
             try {
-                PackedFunc exit_loop = json_ffi_engine_->GetFunction("exit_background_loop");
-                exit_loop();
+                exit_background_loop_();
             } catch (...) {
                 // Ignore cleanup errors
             }
+            if (background_loop_thread_.joinable()) background_loop_thread_.join();
+            if (stream_back_loop_thread_.joinable()) stream_back_loop_thread_.join();
         }
+        MLCCpuTopology::removeBridgeCpus(thread_layout_.bridge_cpus);
     }
-    
-    void processStreamResponse(const std::string& response_json) {
-        if (!token_callback_) return;
-        
-        // Parse the JSON response and extract content
-        // For now, do basic parsing - in production you'd use a proper JSON parser
-        std::cout << "📡 Stream response: " << response_json << std::endl;
-        
-        // Look for content field in the JSON
-        size_t content_pos = response_json.find("\"content\":\"");
-        if (content_pos != std::string::npos) {
-            size_t start = content_pos + 11; // Length of "\"content\":\""
-            size_t end = response_json.find("\"", start);
-            if (end != std::string::npos) {
-                std::string content = response_json.substr(start, end - start);
-                if (!content.empty()) {
-                    token_callback_(content.c_str());
+
+    void processStreamOutputs(const Array<ObjectRef>& outputs) {
+        // Each payload holds one RequestStreamOutput per request that advanced
+        // in the last engine step
+        std::lock_guard<std::mutex> lock(requests_mutex_);
+        std::vector<std::string> touched;
+        last_progress_ns_ = MLCFlightRecorder::nowNs();
+        MLCFlightRecorder::record(MLCFlightEventType::Payload, 0, static_cast<uint32_t>(outputs.size()));
+
+        for (const ObjectRef& output : outputs) {
+            // [request_id, group_delta_token_ids, group_delta_logprob_json_strs,
+            //  group_finish_reason, request_final_usage_json_str, group_extra_prefix_string]
+            Array<ObjectRef> fields = unpack_stream_output_(output);
+            std::string request_id = Downcast<String>(fields[0]);
+
+            // The trailing usage-only record carries no token deltas
+            if (!fields[1].defined()) {
+                if (!usage_waiters_.empty() && fields[4].defined()) {
+                    notifyUsage(request_id, Downcast<String>(fields[4]));
+                }
+                continue;
+            }
+            auto it = requests_.find(request_id);
+            if (it == requests_.end()) continue;
+            RequestState& state = it->second;
+            Array<IntTuple> group_delta_token_ids = Downcast<Array<IntTuple>>(fields[1]);
+            Array<Optional<String>> group_finish_reason = Downcast<Array<Optional<String>>>(fields[3]);
+            if (group_delta_token_ids.size() == 0) continue;
+
+            if (state.wants_logprobs && fields[2].defined()) {
+                Array<Array<String>> group_delta_logprobs = Downcast<Array<Array<String>>>(fields[2]);
+                if (group_delta_logprobs.size() > 0) {
+                    std::vector<std::string> logprob_json;
+                    for (const String& record : group_delta_logprobs[0]) logprob_json.push_back(record);
+                    state.sink->onLogprobs(logprob_json);
+                }
+            }
+
+            const std::vector<int32_t>& stop_token_ids = chat_template_->stopTokenIds();
+            std::vector<int32_t> token_ids;
+            bool looping = false;
+            int delta_tokens = static_cast<int>(group_delta_token_ids[0].size());
+            admission_control_.onTokens(request_id, delta_tokens);
+            if (state.completion_tokens == 0 && delta_tokens > 0) {
+                state.first_token_at = std::chrono::steady_clock::now();
+                if (!state.internal) {
+                    uint64_t ttft_us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                        state.first_token_at - state.submitted_at).count());
+                    metrics_.ttft_us.record(ttft_us);
+                    metrics_.ttft_samples++;
+                    metrics_.ttft_total_us += ttft_us;
+                }
+            }
+            metrics_.completion_tokens_generated += delta_tokens;
+            MLCFlightRecorder::record(MLCFlightEventType::Tokens, state.seq, static_cast<uint32_t>(delta_tokens),
+                                      state.completion_tokens + delta_tokens);
+            metrics_.kv_tokens_in_use += delta_tokens;
+            for (int64_t token_id : group_delta_token_ids[0]) {
+                state.completion_tokens++;
+                if (!state.retain_session.empty()) state.token_history.push_back(static_cast<int32_t>(token_id));
+                if (state.repetition && state.repetition->addToken(static_cast<uint64_t>(token_id))) {
+                    looping = true;
                 }
+                if (std::find(stop_token_ids.begin(), stop_token_ids.end(), token_id) == stop_token_ids.end()) {
+                    token_ids.push_back(static_cast<int32_t>(token_id));
+                }
+            }
+
+            bool stopped = deliverText(state, state.detokenizer.put(token_ids), false);
+            if (!token_ids.empty()) state.sink->onTokens(token_ids);
+            if (stopped) {
+                abortRequest(request_id);
+                finishRequest(state, "stop");
+                retireRequest(it, true);
+                continue;
+            }
+
+            if (looping && handleRepetition(request_id, state)) {
+                retireRequest(it, false);
+                continue;
+            }
+
+            Optional<String> finish_reason = group_finish_reason[0];
+            if (finish_reason.defined()) {
+                std::string reason = finish_reason.value();
+                if (reason == "error") {
+                    state.sink->onError("inference error");
+                    if (!state.internal) metrics_.requests_failed++;
+                } else {
+                    deliverText(state, state.detokenizer.finish(), true);
+                    finishRequest(state, reason);
+                }
+                retireRequest(it, reason != "error");
+                continue;
+            }
+            touched.push_back(request_id);
+        }
+
+        // One flush per payload lets batching sinks coalesce a whole engine step
+        for (const std::string& request_id : touched) {
+            auto it = requests_.find(request_id);
+            it->second.sink->flush();
+            if (it->second.sink->closed()) {
+                std::cerr << "❌ Output of " << request_id << " closed, aborting" << std::endl;
+                abortRequest(request_id);
+                if (!it->second.internal) metrics_.requests_failed++;
+                retireRequest(it, false);
             }
         }
     }
-    
-    int generate(const std::string& prompt, int max_tokens, float temperature, void (*callback)(const char*)) {
-        if (!is_initialized_) {
-            std::cerr << "❌ REAL Engine not initialized" << std::endl;
-            return -1;
+
+    // Hands a request's final usage JSON ("" when it failed) to its on_usage
+    // callback; call with requests_mutex_ held
+    void notifyUsage(const std::string& request_id, const std::string& usage_json) {
+        auto waiter = usage_waiters_.find(request_id);
+        if (waiter == usage_waiters_.end()) return;
+        auto callback = std::move(waiter->second);
+        usage_waiters_.erase(waiter);
+        callback(usage_json);
+    }
+
+    // Drops a finished request; call with requests_mutex_ held
+    void retireRequest(std::unordered_map<std::string, RequestState>::iterator it, bool completed) {
+        admission_control_.onFinish(it->first, completed);
+        releaseLoad(it->second);
+        requests_.erase(it);
+    }
+
+    // Undoes the load gauges a registered request added
+    void releaseLoad(const RequestState& state) {
+        metrics_.requests_in_flight--;
+        metrics_.kv_tokens_in_use -= state.prompt_tokens + state.completion_tokens;
+    }
+
+    // Appends decoded text to the request's output. Text that could be the start
+    // of a stop string is held back until the next delta (or `final`). Returns
+    // true if a stop string was found; the text from it onwards is dropped.
+    bool deliverText(RequestState& state, const std::string& text, bool final) {
+        state.held_text += text;
+        const std::string& held = state.held_text;
+
+        size_t emit = held.size();
+        bool stopped = false;
+        for (const std::string& stop : chat_template_->stopStrings()) {
+            size_t pos = held.find(stop);
+            if (pos != std::string::npos && pos < emit) {
+                emit = pos;
+                stopped = true;
+            }
         }
-        
-        std::cout << "🔄 REAL MLC Engine generating for prompt: " << prompt << std::endl;
-        
-        // Store callback for use in streaming
-        token_callback_ = callback;
-        
-        // Create OpenAI-style chat completion request
-        std::string request_json = R"({
-            "messages": [
-                {
-                    "role": "user", 
-                    "content": ")" + prompt + R"("
+        if (!stopped && !final) {
+            size_t hold = 0;
+            for (const std::string& stop : chat_template_->stopStrings()) {
+                for (size_t length = std::min(stop.size() - 1, held.size()); length > hold; --length) {
+                    if (held.compare(held.size() - length, length, stop, 0, length) == 0) {
+                        hold = length;
+                        break;
+                    }
                 }
-            ],
-            "model": "TinyLlama-1.1B-MLC",
-            "max_tokens": )" + std::to_string(max_tokens) + R"(,
-            "temperature": )" + std::to_string(temperature) + R"(,
-            "stream": true
-        })";
-        
-        // Generate unique request ID
-        std::string request_id = "req_" + std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::system_clock::now().time_since_epoch()).count());
-        
+            }
+            emit = held.size() - hold;
+        }
+
+        if (emit > 0) {
+            std::string chunk = held.substr(0, emit);
+            state.sink->onChunk(chunk);
+            metrics_.chunks_delivered++;
+            if (state.json_stream) state.json_stream->feed(chunk);
+            if (!state.cache_class.empty()) state.output += chunk;
+        }
+        state.held_text.erase(0, stopped ? std::string::npos : emit);
+        return stopped;
+    }
+
+    std::string startupProfilePath() const {
+        return config_.startup_profile_path.empty() ? MLCWeightPrefetcher::defaultProfilePath(model_path_)
+                                                    : config_.startup_profile_path;
+    }
+
+    // Replays a recorded weight read order, or records one on this start
+    void startStartupPrefetch() {
+        if (!config_.startup_prefetch) return;
+        auto prefetcher = std::make_unique<MLCWeightPrefetcher>(model_path_);
+        std::string error;
+        if (!prefetcher->loadLayout(&error)) {
+            std::cerr << "⚠️ Startup prefetch disabled: " << error << std::endl;
+            return;
+        }
+        if (prefetcher->loadProfile(startupProfilePath())) {
+            std::cout << "📦 Prefetching weights in recorded startup order" << std::endl;
+            prefetcher->startPrefetch();
+        } else {
+            std::cout << "📦 Recording startup weight access profile" << std::endl;
+            prefetcher->startProfiling();
+            startup_profiling_ = true;
+        }
+        prefetcher_ = std::move(prefetcher);
+    }
+
+    // Picks the compute threads and CPUs, and the cores left to the bridge
+    void planThreadLayout() {
+        std::vector<int> cpus;
+        if (!config_.compute_cpus.empty() && !MLCCpuTopology::parseCpuList(config_.compute_cpus, &cpus)) {
+            throw std::runtime_error("Invalid compute_cpus: " + config_.compute_cpus);
+        }
+        MLCCpuTopology topology = MLCCpuTopology::detect();
+        thread_layout_ = topology.plan(config_.compute_threads, config_.compute_cpus);
+        std::cout << "🧵 Thread layout (" << topology.cores.size() << " CPUs, " << thread_layout_.fast_cores
+                  << " fast cores): " << thread_layout_.describe() << std::endl;
+        // Bridge threads started from here on keep off this engine's compute cores
+        MLCCpuTopology::addBridgeCpus(thread_layout_.bridge_cpus);
+    }
+
+    // Runs on the engine loop thread: TVM's thread pool belongs to the thread
+    // that launches kernels, and is created when first used
+    void applyComputeLayout() {
+        if (thread_layout_.compute_threads == 0) return;
+        MLCCpuTopology::pinCurrentThread(thread_layout_.compute_cpus);
+        const PackedFunc* config_threadpool = Registry::Get("runtime.config_threadpool");
+        if (!config_threadpool) {
+            std::cerr << "⚠️ runtime.config_threadpool unavailable; keeping the default thread pool" << std::endl;
+            return;
+        }
         try {
-            // Call the REAL MLC-LLM chat completion
-            std::cout << "🚀 Calling REAL MLC-LLM chat_completion with request: " << request_json << std::endl;
-            bool success = chat_completion_(request_json, request_id);
-            
-            if (!success) {
-                std::string error = get_last_error_();
-                std::cerr << "❌ REAL MLC Generation failed: " << error << std::endl;
-                return -2;
-            }
-            
-            std::cout << "✅ REAL MLC-LLM generation started successfully" << std::endl;
-            return 0;
-            
+            if (thread_layout_.compute_cpus.empty()) {
+                // kBig: the runtime picks its fastest cores itself
+                (*config_threadpool)(1, thread_layout_.compute_threads);
+            } else {
+                Array<String> cpus;
+                for (int cpu : thread_layout_.compute_cpus) cpus.push_back(String(std::to_string(cpu)));
+                // kSpecifyOneCorePerThread
+                (*config_threadpool)(-2, thread_layout_.compute_threads, cpus);
+            }
         } catch (const std::exception& e) {
-            std::cerr << "❌ REAL Generation failed: " << e.what() << std::endl;
-            return -2;
+            std::cerr << "⚠️ Could not configure the compute thread pool: " << e.what() << std::endl;
         }
     }
-    
-    bool isInitialized() const {
-        return is_initialized_;
+
+    // Sizes the KV pool for the configured page format. The caller's
+    // max_total_sequence_length is a float16-sized budget, so quantized pages
+    // turn the same memory into more tokens.
+    void configureKVCache(const MLCJsonValue& chat_config) {
+        MLCKVCacheDtype dtype;
+        if (!MLCKVCacheLayout::parseDtype(config_.kv_cache_dtype, &dtype)) {
+            throw std::runtime_error("Unknown kv_cache_dtype: " + config_.kv_cache_dtype);
+        }
+        // MLC ignores a kv_cache_dtype its model library was not built for and
+        // keeps float16 pages, which the inflated token budget below would then
+        // overrun; only a library declared as quantized gets the larger pool
+        MLCKVCacheDtype compiled;
+        if (!MLCKVCacheLayout::compiledDtype(chat_config, &compiled)) {
+            throw std::runtime_error("mlc-chat-config.json declares an unknown kv_cache_dtype");
+        }
+        if (dtype != MLCKVCacheDtype::Float16 && compiled != dtype) {
+            throw std::runtime_error(std::string("kv_cache_dtype ") + MLCKVCacheLayout::dtypeName(dtype) +
+                                     " needs a model library compiled for it, but mlc-chat-config.json declares " +
+                                     MLCKVCacheLayout::dtypeName(compiled));
+        }
+        if (!MLCKVCacheLayout::fromChatConfig(chat_config, dtype, &kv_layout_)) {
+            if (dtype != MLCKVCacheDtype::Float16) {
+                throw std::runtime_error("mlc-chat-config.json lacks the attention shape to size a quantized KV cache");
+            }
+            metrics_.kv_cache_capacity_tokens = config_.max_total_sequence_length;
+            return;
+        }
+
+        int budget = config_.max_total_sequence_length;
+        int capacity = kv_layout_.tokensForFloat16Budget(budget);
+        config_.max_total_sequence_length = capacity;
+        admission_control_.setKVCapacity(capacity);
+
+        int64_t bytes_per_token = kv_layout_.bytesPerToken();
+        metrics_.kv_cache_bytes_per_token = bytes_per_token;
+        metrics_.kv_cache_capacity_tokens = capacity;
+        metrics_.kv_cache_bytes_saved = (kv_layout_.float16BytesPerToken() - bytes_per_token) * capacity;
+        std::cout << "🧮 KV cache " << MLCKVCacheLayout::dtypeName(dtype) << ": " << bytes_per_token
+                  << " bytes/token, " << capacity << " tokens (" << capacity * bytes_per_token / (1024 * 1024)
+                  << " MiB)" << std::endl;
+        if (capacity != budget) {
+            std::cout << "🧮 max_total_sequence_length " << budget << " raised to " << capacity
+                      << " for the same KV memory" << std::endl;
+        }
     }
-};
 
-extern "C" {
+    // The profile covers loading and the first prefill; ends with the first
+    // completed request (or at shutdown)
+    void finishStartupProfile() {
+        if (!startup_profiling_.exchange(false)) return;
+        prefetcher_->finishProfiling();
+        if (prefetcher_->saveProfile(startupProfilePath())) {
+            std::cout << "✅ Saved startup profile (" << prefetcher_->profile().size() << " ranges)" << std::endl;
+        }
+    }
 
-void* mlc_llm_create_engine(const char* model_path) {
-    try {
-        std::cout << "🚀 Creating REAL MLC-LLM engine (no more fake tokens!)" << std::endl;
-        auto* engine = new MLCEngineWrapper(std::string(model_path));
-        if (!engine->isInitialized()) {
-            delete engine;
-            return nullptr;
+    void finishRequest(RequestState& state, const std::string& finish_reason) {
+        MLCFinishInfo info;
+        info.finish_reason = finish_reason;
+        info.prompt_tokens = state.prompt_tokens;
+        info.completion_tokens = state.completion_tokens;
+        // Only complete answers are worth replaying
+        if (!state.cache_class.empty() && finish_reason == "stop") {
+            similarity_cache_.insert(state.cache_class, state.cache_prompt, state.output);
+            metrics_.similarity_cache_inserts++;
+        }
+        if (!state.retain_session.empty() && finish_reason == "length") retainSequence(state);
+        state.sink->onFinish(info);
+        MLCFlightRecorder::record(MLCFlightEventType::Finish, state.seq,
+                                  finish_reason == "stop"     ? kFlightFinishStop
+                                  : finish_reason == "length" ? kFlightFinishLength
+                                                              : kFlightFinishOther,
+                                  state.completion_tokens);
+        // Warm-ups and handoff steps are the bridge's own: they are not counted
+        // for callers and do not end the startup profile
+        if (!state.internal) {
+            metrics_.requests_completed++;
+            finishStartupProfile();
+        }
+
+        // The first token is prefill; the rest show the KV format's decode cost
+        if (state.completion_tokens > 1) {
+            uint64_t decode_us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - state.first_token_at).count());
+            metrics_.decode_tokens += state.completion_tokens - 1;
+            metrics_.decode_time_us += decode_us;
+            metrics_.inter_token_us.record(decode_us / (state.completion_tokens - 1));
+        }
+
+        if (state.internal) return;
+        MLCLengthPredictor::Outcome outcome = length_predictor_.observe(
+            state.length_features, state.length_prediction, state.completion_tokens, finish_reason == "length");
+        if (outcome.scored) {
+            metrics_.length_predictions_scored++;
+            if (outcome.underpredicted) metrics_.length_underpredictions++;
+            metrics_.length_abs_error_tokens += outcome.abs_error_tokens;
         }
-        return static_cast<void*>(engine);
-    } catch (const std::exception& e) {
-        std::cerr << "❌ Failed to create REAL MLC engine: " << e.what() << std::endl;
-        return nullptr;
     }
-}
 
-int mlc_llm_generate(void* engine, const char* prompt, int max_tokens, float temperature, void (*callback)(const char*)) {
-    if (!engine || !prompt) {
-        return -1;
+    // Keeps a cut-off sequence for continueSession; call with requests_mutex_ held
+    void retainSequence(RequestState& state) {
+        auto now = std::chrono::steady_clock::now();
+        pruneRetained(now);
+        auto existing = retained_.find(state.retain_session);
+        if (existing == retained_.end() && static_cast<int>(retained_.size()) >= config_.continue_max_sequences) {
+            // The engine recycles the oldest sequences first as well
+            auto oldest = std::min_element(retained_.begin(), retained_.end(), [](const auto& a, const auto& b) {
+                return a.second.expires_at < b.second.expires_at;
+            });
+            retained_.erase(oldest);
+        }
+        RetainedSequence& retained = retained_[state.retain_session];
+        retained.tokens = std::move(state.token_history);
+        retained.output_tokens = state.completion_tokens;
+        retained.expires_at = now + std::chrono::milliseconds(config_.continue_retain_ms);
     }
-    
-    try {
-        std::cout << "🎯 REAL inference requested - NO MORE HARDCODED TOKENS!" << std::endl;
-        auto* mlc_engine = static_cast<MLCEngineWrapper*>(engine);
-        return mlc_engine->generate(std::string(prompt), max_tokens, temperature, callback);
-    } catch (const std::exception& e) {
-        std::cerr << "❌ REAL Generation failed: " << e.what() << std::endl;
-        return -2;
+
+    // Call with requests_mutex_ held
+    void pruneRetained(std::chrono::steady_clock::time_point now) {
+        for (auto it = retained_.begin(); it != retained_.end();) {
+            it = it->second.expires_at <= now ? retained_.erase(it) : std::next(it);
+        }
+    }
+
+    // Resumes the session's last sequence that stopped at max_tokens for up
+    // to `extra_tokens` more. The prompt is the retained prompt + output, all
+    // but the last token of which the engine's prefix cache still holds.
+    int continueSession(const mlc_llm_request_t& req, int extra_tokens) {
+        if (!is_initialized_ || !req.session_id || extra_tokens <= 0) return MLC_LLM_ERROR_INVALID;
+        RetainedSequence retained;
+        {
+            std::lock_guard<std::mutex> lock(requests_mutex_);
+            pruneRetained(std::chrono::steady_clock::now());
+            auto it = retained_.find(req.session_id);
+            if (it == retained_.end()) {
+                metrics_.continuation_misses++;
+                std::cerr << "❌ Nothing retained to continue for session " << req.session_id << std::endl;
+                return MLC_LLM_ERROR_EXPIRED;
+            }
+            retained = it->second;
+        }
+        if (static_cast<int>(retained.tokens.size()) + extra_tokens > config_.max_total_sequence_length) {
+            std::cerr << "❌ Continuation exceeds max_total_sequence_length" << std::endl;
+            return MLC_LLM_ERROR_INVALID;
+        }
+
+        std::unique_ptr<MLCDeliverySink> sink;
+        int status = makeSink(req, &sink);
+        if (status != 0) return status;
+
+        // Delivery settings come from `req`; the text is a token-id prompt, so
+        // caches, templates and JSON subscriptions do not apply
+        mlc_llm_request_t continuation = req;
+        continuation.prompt = nullptr;
+        continuation.system = nullptr;
+        continuation.request_class = nullptr;
+        continuation.json_paths = nullptr;
+        continuation.num_json_paths = 0;
+        continuation.token_ids = retained.tokens.data();
+        continuation.num_token_ids = static_cast<int>(retained.tokens.size());
+        continuation.validate_token_ids = 0;
+        continuation.max_tokens = extra_tokens;
+        SubmitOptions options;
+        options.resume_output_tokens = retained.output_tokens;
+        status = submit(continuation, std::move(sink), options);
+        if (status == MLC_LLM_OK) metrics_.continuations++;
+        return status;
+    }
+
+    // Reports a request that failed after submit() returned
+    void failRequest(const std::string& request_id, const std::string& message) {
+        std::lock_guard<std::mutex> lock(requests_mutex_);
+        auto it = requests_.find(request_id);
+        if (it == requests_.end()) return;
+        MLCFlightRecorder::record(MLCFlightEventType::Error, it->second.seq);
+        it->second.sink->onError(message);
+        if (!it->second.internal) metrics_.requests_failed++;
+        retireRequest(it, false);
+        notifyUsage(request_id, "");
+    }
+
+    // Stops a request whose output is no longer wanted; its sink gets no
+    // further calls
+    void cancelRequest(const std::string& request_id) {
+        std::lock_guard<std::mutex> lock(requests_mutex_);
+        auto it = requests_.find(request_id);
+        if (it == requests_.end()) return;
+        MLCFlightRecorder::record(MLCFlightEventType::Cancel, it->second.seq);
+        abortRequest(request_id);
+        retireRequest(it, false);
+    }
+
+    void abortRequest(const std::string& request_id) {
+        try {
+            abort_request_(String(request_id));
+        } catch (const std::exception& e) {
+            std::cerr << "❌ Failed to abort request " << request_id << ": " << e.what() << std::endl;
+        }
+    }
+
+    // Called with requests_mutex_ held when a request's detector first fires.
+    // Returns true if the request was terminated and must be dropped.
+    bool handleRepetition(const std::string& request_id, RequestState& state) {
+        metrics_.repetition_detections++;
+        std::cout << "🔁 Repetition loop detected in " << request_id
+                  << " (period " << state.repetition->period() << " tokens)" << std::endl;
+
+        bool abort_on_loop;
+        {
+            std::lock_guard<std::mutex> lock(config_mutex_);
+            abort_on_loop = repetition_config_.abort_on_loop;
+        }
+        if (!abort_on_loop) {
+            // Report once, then stop monitoring this request
+            state.repetition.reset();
+            return false;
+        }
+
+        abortRequest(request_id);
+
+        metrics_.repetition_aborts++;
+        if (state.max_tokens > state.completion_tokens) {
+            metrics_.repetition_tokens_saved += state.max_tokens - state.completion_tokens;
+        }
+
+        MLCFinishInfo info;
+        info.finish_reason = "repetition";
+        info.prompt_tokens = state.prompt_tokens;
+        info.completion_tokens = state.completion_tokens;
+        state.sink->onFinish(info);
+        MLCFlightRecorder::record(MLCFlightEventType::Finish, state.seq, kFlightFinishRepetition,
+                                  state.completion_tokens);
+        if (!state.internal) metrics_.requests_completed++;
+        return true;
+    }
+
+    int setRepetitionConfig(const MLCRepetitionConfig& config) {
+        std::lock_guard<std::mutex> lock(config_mutex_);
+        repetition_config_ = config;
+        return 0;
+    }
+
+    void getMetrics(mlc_llm_metrics_t* out) const {
+        metrics_.snapshot(out);
+    }
+
+    int startTelemetry(const std::string& name, std::chrono::milliseconds interval) {
+        auto last_at = std::chrono::steady_clock::now();
+        uint64_t last_tokens = metrics_.completion_tokens_generated;
+        // Runs on the publisher thread only, so its rate state needs no lock
+        auto collect = [this, last_at, last_tokens](mlc_llm_telemetry_page_t* page) mutable {
+            metrics_.snapshot(&page->metrics);
+            MLCAdmissionController::Load load = admission_control_.load();
+            page->queue_depth = load.queue_depth;
+            page->estimated_wait_ms = load.estimated_wait_ms;
+            page->kv_capacity_tokens = load.kv_capacity_tokens;
+            page->kv_reserved_tokens = load.kv_reserved_tokens;
+
+            auto now = std::chrono::steady_clock::now();
+            double seconds = std::chrono::duration<double>(now - last_at).count();
+            uint64_t tokens = page->metrics.completion_tokens_generated;
+            page->tokens_per_second = seconds > 0.0 ? static_cast<double>(tokens - last_tokens) / seconds : 0.0;
+            last_at = now;
+            last_tokens = tokens;
+
+            metrics_.ttft_us.snapshot(page->ttft_us);
+            metrics_.inter_token_us.snapshot(page->inter_token_us);
+        };
+
+        auto telemetry = std::make_unique<MLCTelemetryPage>(name, interval, collect);
+        std::lock_guard<std::mutex> lock(telemetry_mutex_);
+        if (telemetry_) telemetry_->stop();
+        telemetry_.reset();
+        std::string error;
+        if (!telemetry->start(&error)) {
+            std::cerr << "❌ Telemetry page unavailable: " << error << std::endl;
+            return -2;
+        }
+        telemetry_ = std::move(telemetry);
+        std::cout << "📡 Publishing telemetry to " << name << " every " << interval.count() << " ms" << std::endl;
+        return 0;
+    }
+
+    int stopTelemetry() {
+        std::lock_guard<std::mutex> lock(telemetry_mutex_);
+        if (telemetry_) telemetry_->stop();
+        telemetry_.reset();
+        return 0;
+    }
+
+    static std::unique_ptr<MLCJsonStream> makeJsonStream(const mlc_llm_request_t& req) {
+        if (!req.json_callback || !req.json_paths || req.num_json_paths <= 0) return nullptr;
+
+        std::vector<std::string> paths(req.json_paths, req.json_paths + req.num_json_paths);
+        mlc_llm_json_callback_t json_callback = req.json_callback;
+        void* json_user_data = req.json_user_data;
+        return std::make_unique<MLCJsonStream>(paths, [json_callback, json_user_data](const MLCJsonStreamEvent& event) {
+            mlc_llm_json_event_t c_event;
+            c_event.kind = event.kind == MLCJsonStreamEvent::Kind::Value ? MLC_LLM_JSON_VALUE : MLC_LLM_JSON_STRING_DELTA;
+            c_event.type = static_cast<int>(event.type);
+            c_event.subscription = event.subscription;
+            c_event.path = event.path.c_str();
+            c_event.data = event.data.c_str();
+            c_event.length = event.data.size();
+            json_callback(json_user_data, &c_event);
+        });
+    }
+
+    // Replays a cached completion through the request's normal stream stage,
+    // synchronously on the caller's thread
+    void deliverCached(const mlc_llm_request_t& req, MLCDeliverySink& sink, const std::string& completion) {
+        sink.onChunk(completion);
+        if (auto json_stream = makeJsonStream(req)) json_stream->feed(completion);
+        sink.flush();
+
+        MLCFinishInfo info;
+        info.finish_reason = "cache";
+        sink.onFinish(info);
+    }
+
+    int configureSimilarityCache(const MLCSimilarityCacheConfig& config) {
+        similarity_cache_.configure(config);
+        if (!config.persist_path.empty() && similarity_cache_.load(config.persist_path)) {
+            std::cout << "✅ Loaded " << similarity_cache_.size() << " similarity cache entries" << std::endl;
+        }
+        return 0;
+    }
+
+    int saveSimilarityCache(const std::string& path) {
+        std::string target = path.empty() ? similarity_cache_.persistPath() : path;
+        if (target.empty()) return -1;
+        return similarity_cache_.save(target) ? 0 : -2;
+    }
+
+    std::string nextRequestId(uint64_t* seq) {
+        *seq = next_request_seq_.fetch_add(1) + 1;
+        return "req_" + std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count()) +
+            "_" + std::to_string(*seq);
+    }
+
+    // mlc.serve.TokenData takes the token ids as variadic arguments
+    ObjectRef makeTokenData(const std::vector<int32_t>& token_ids) const {
+        std::vector<TVMValue> values(token_ids.size());
+        std::vector<int> type_codes(token_ids.size());
+        TVMArgsSetter setter(values.data(), type_codes.data());
+        for (size_t i = 0; i < token_ids.size(); ++i) {
+            setter(i, token_ids[i]);
+        }
+        TVMRetValue rv;
+        create_token_data_.CallPacked(TVMArgs(values.data(), type_codes.data(), static_cast<int>(token_ids.size())), &rv);
+        return rv;
+    }
+
+    std::string generationConfig(int max_tokens, float temperature, int top_logprobs,
+                                 const std::string& disagg_config = "") const {
+        std::string stop_token_ids;
+        for (int32_t token_id : chat_template_->stopTokenIds()) {
+            if (!stop_token_ids.empty()) stop_token_ids += ", ";
+            stop_token_ids += std::to_string(token_id);
+        }
+        std::string logprobs;
+        if (top_logprobs > 0) {
+            logprobs = R"(,
+            "logprobs": true,
+            "top_logprobs": )" + std::to_string(top_logprobs);
+        }
+        std::string debug;
+        if (!disagg_config.empty()) {
+            debug = R"(,
+            "debug_config": {"disagg_config": )" + disagg_config + "}";
+        }
+        // Stop strings are matched on decoded text in deliverText()
+        return R"({
+            "n": 1,
+            "temperature": )" + std::to_string(temperature) + R"(,
+            "max_tokens": )" + std::to_string(max_tokens) + R"(,
+            "stop_token_ids": [)" + stop_token_ids + "]" + logprobs + debug + R"(
+        })";
+    }
+
+    int vocabSize() const {
+        return vocab_size_;
+    }
+
+    bool validateTokenIds(const int32_t* token_ids, int num_token_ids) const {
+        for (int i = 0; i < num_token_ids; ++i) {
+            if (token_ids[i] < 0 || (vocab_size_ > 0 && token_ids[i] >= vocab_size_)) {
+                std::cerr << "❌ Token id " << token_ids[i] << " at position " << i
+                          << " is outside the vocabulary (size " << vocab_size_ << ")" << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int score(const int32_t* token_ids, int num_token_ids, bool validate, int top_logprobs,
+              mlc_llm_logprob_callback_t callback, void* user_data) {
+        mlc_llm_request_t req;
+        mlc_llm_request_init(&req);
+        req.token_ids = token_ids;
+        req.num_token_ids = num_token_ids;
+        req.validate_token_ids = validate ? 1 : 0;
+        req.max_tokens = 1;
+        // Logprobs follow the sampling distribution, so keep it unscaled
+        req.temperature = 1.0f;
+
+        auto result = std::make_shared<MLCScoreResult>();
+        SubmitOptions options;
+        options.top_logprobs = top_logprobs;
+        int status = submit(req, std::make_unique<MLCScoreSink>(result), options);
+        if (status != 0) return status;
+
+        std::unique_lock<std::mutex> lock(result->mutex);
+        result->done_cv.wait(lock, [&result]() { return result->done; });
+        if (!result->error.empty()) {
+            std::cerr << "❌ REAL Scoring failed: " << result->error << std::endl;
+            return -2;
+        }
+
+        std::vector<mlc_llm_token_logprob_t> entries;
+        for (const auto& entry : result->top_logprobs) {
+            entries.push_back(mlc_llm_token_logprob_t{entry.first.c_str(), entry.second});
+        }
+        callback(user_data, entries.data(), static_cast<int>(entries.size()));
+        return 0;
+    }
+
+    int generateSync(const mlc_llm_request_t& req, char* out_buf, size_t cap, size_t* out_len,
+                     mlc_llm_usage_t* out_usage) {
+        auto result = std::make_shared<MLCBufferResult>();
+        std::unique_ptr<MLCDeliverySink> sink = std::make_unique<MLCBufferSink>(result, out_buf, cap, out_len);
+        int status = req.backend != MLC_LLM_BACKEND_LOCAL ? submitToBackends(req, std::move(sink))
+                                                         : submit(req, std::move(sink));
+        if (status != 0) return status;
+
+        std::unique_lock<std::mutex> lock(result->mutex);
+        result->done_cv.wait(lock, [&result]() { return result->done; });
+        if (!result->error.empty()) {
+            std::cerr << "❌ REAL Generation failed: " << result->error << std::endl;
+            return -2;
+        }
+        if (out_usage) {
+            *out_usage = mlc_llm_usage_t{};
+            out_usage->prompt_tokens = result->info.prompt_tokens;
+            out_usage->completion_tokens = result->info.completion_tokens;
+            snprintf(out_usage->finish_reason, sizeof(out_usage->finish_reason), "%s",
+                     result->info.finish_reason.c_str());
+        }
+        return 0;
+    }
+
+    int submit(const mlc_llm_request_t& req) {
+        std::unique_ptr<MLCDeliverySink> sink;
+        int status = makeSink(req, &sink);
+        if (status != 0) return status;
+        if (req.backend != MLC_LLM_BACKEND_LOCAL) {
+            return submitToBackends(req, std::move(sink));
+        }
+        SubmitOptions options;
+        options.top_logprobs = binaryOutput(req) ? req.top_logprobs : 0;
+        return submit(req, std::move(sink), options);
+    }
+
+    // Only binary output has a place for logprobs
+    static bool binaryOutput(const mlc_llm_request_t& req) {
+        if (req.output_fd >= 0) return req.output_framing == MLC_LLM_FRAMING_BINARY;
+        if (req.dart_port != 0) return req.dart_binary != 0;
+        return req.event_callback != nullptr;
+    }
+
+    // The delivery sink `req` asks for
+    static int makeSink(const mlc_llm_request_t& req, std::unique_ptr<MLCDeliverySink>* sink) {
+        if (req.output_fd >= 0) {
+            if (req.output_framing < MLC_LLM_FRAMING_RAW || req.output_framing > MLC_LLM_FRAMING_BINARY) {
+                return -1;
+            }
+            *sink = std::make_unique<MLCFdSink>(req.output_fd, static_cast<MLCFdSink::Framing>(req.output_framing),
+                                                req.output_zerocopy != 0, req.output_timeout_ms);
+        } else if (req.dart_port != 0) {
+            if (!MLCDartPortSink::isApiInitialized()) {
+                std::cerr << "❌ Dart API not initialized, call mlc_llm_dart_initialize first" << std::endl;
+                return -1;
+            }
+            *sink = std::make_unique<MLCDartPortSink>(req.dart_port, req.dart_binary != 0);
+        } else if (req.event_callback) {
+            *sink = std::make_unique<MLCEventCallbackSink>(req.event_callback, req.event_user_data);
+        } else {
+            *sink = std::make_unique<MLCCallbackSink>(req.callback);
+        }
+        return 0;
+    }
+
+    // Prompt token ids `req` would be submitted with: the chat-templated text
+    // prompt or its token ids as given
+    int encodePrompt(const mlc_llm_request_t& req, std::vector<int32_t>* prompt_ids) {
+        if (!is_initialized_) return -1;
+        if (req.token_ids && req.num_token_ids > 0) {
+            prompt_ids->assign(req.token_ids, req.token_ids + req.num_token_ids);
+            metrics_.prompt_tokens_direct += prompt_ids->size();
+            return 0;
+        }
+        std::string prompt = req.prompt ? req.prompt : "";
+        std::string system = req.system ? req.system : "";
+        // Only the user text is tokenized here; template fragments are cached
+        MLCChatTemplate::Stats stats;
+        *prompt_ids = chat_template_->encodePrompt(req.system ? &system : nullptr,
+                                                   {MLCChatMessage{"user", prompt}}, &stats);
+        metrics_.prompt_tokens_cached += stats.cached_tokens;
+        metrics_.prompt_tokens_encoded += stats.encoded_tokens;
+        return 0;
+    }
+
+    int submitToBackends(const mlc_llm_request_t& req, std::unique_ptr<MLCDeliverySink> sink) {
+        if (req.backend != MLC_LLM_BACKEND_RACE && req.backend != MLC_LLM_BACKEND_REMOTE) {
+            return MLC_LLM_ERROR_INVALID;
+        }
+        if (req.token_ids && req.num_token_ids > 0) {
+            std::cerr << "❌ Token-id prompts cannot be sent to a remote backend" << std::endl;
+            return MLC_LLM_ERROR_INVALID;
+        }
+
+        std::shared_ptr<MLCOpenAIBackend> remote;
+        int first_token_timeout_ms;
+        {
+            std::lock_guard<std::mutex> lock(backend_mutex_);
+            remote = remote_backend_;
+            first_token_timeout_ms = first_token_timeout_ms_;
+        }
+        if (!remote) {
+            if (req.backend == MLC_LLM_BACKEND_REMOTE) {
+                std::cerr << "❌ No remote backend configured" << std::endl;
+                return MLC_LLM_ERROR_INVALID;
+            }
+            // Nothing to race against
+            SubmitOptions options;
+            options.top_logprobs = binaryOutput(req) ? req.top_logprobs : 0;
+            return submit(req, std::move(sink), options);
+        }
+        if (req.first_token_timeout_ms > 0) first_token_timeout_ms = req.first_token_timeout_ms;
+
+        MLCBackendRequest request;
+        request.prompt = req.prompt ? req.prompt : "";
+        request.has_system = req.system != nullptr;
+        request.system = req.system ? req.system : "";
+        request.max_tokens = req.max_tokens;
+        request.temperature = req.temperature;
+        request.request_class = req.request_class ? req.request_class : "";
+        request.top_logprobs = binaryOutput(req) ? req.top_logprobs : 0;
+
+        // JSON subscriptions follow the winning backend's text
+        if (auto json_stream = makeJsonStream(req)) {
+            sink = std::make_unique<MLCJsonTeeSink>(std::move(sink), std::move(json_stream));
+        }
+        if (req.backend == MLC_LLM_BACKEND_REMOTE) {
+            return race_.start(request, remote, nullptr, std::chrono::milliseconds(0), std::move(sink));
+        }
+        return race_.start(request, local_backend_, remote, std::chrono::milliseconds(first_token_timeout_ms),
+                           std::move(sink));
+    }
+
+    // Swaps the remote backend; streams still running on the old one are ended
+    int setRemoteBackend(std::shared_ptr<MLCOpenAIBackend> backend, int first_token_timeout_ms) {
+        std::shared_ptr<MLCOpenAIBackend> previous;
+        {
+            std::lock_guard<std::mutex> lock(backend_mutex_);
+            previous = std::move(remote_backend_);
+            remote_backend_ = std::move(backend);
+            first_token_timeout_ms_ = first_token_timeout_ms;
+        }
+        if (previous) previous->shutdown();
+        return 0;
+    }
+
+    struct SubmitOptions {
+        int top_logprobs = 0;
+        // Receives the engine request id, empty for similarity-cache hits
+        std::string* request_id_out = nullptr;
+        // Already encoded prompt (see encodePrompt), so it is not tokenized twice
+        const std::vector<int32_t>* prompt_ids = nullptr;
+        // generation_config.debug_config.disagg_config (MLCDisaggCoordinator)
+        std::string disagg_config;
+        // Issued by the bridge itself (KV handoff steps, prewarming) rather than
+        // a caller: kept out of length prediction and prewarming statistics
+        bool internal = false;
+        // Continuation of a retained sequence: the prompt ends with this many
+        // tokens of earlier output, which the detokenizer picks up from
+        int resume_output_tokens = 0;
+        // Receives the request's final usage JSON once the engine has sent it,
+        // or "" if the request failed after submit() returned. Runs on the
+        // stream-back thread with the request table locked: it must not call
+        // back into this engine.
+        std::function<void(const std::string& usage_json)> on_usage;
+    };
+
+    int submit(const mlc_llm_request_t& req, std::unique_ptr<MLCDeliverySink> sink) {
+        return submit(req, std::move(sink), SubmitOptions());
+    }
+
+    int submit(const mlc_llm_request_t& req, std::unique_ptr<MLCDeliverySink> sink, const SubmitOptions& options) {
+        int top_logprobs = options.top_logprobs;
+        if (!is_initialized_) {
+            std::cerr << "❌ REAL Engine not initialized" << std::endl;
+            return -1;
+        }
+
+        bool has_token_ids = req.token_ids && req.num_token_ids > 0;
+        if (has_token_ids && req.validate_token_ids && !validateTokenIds(req.token_ids, req.num_token_ids)) {
+            return -1;
+        }
+
+        std::string prompt = req.prompt ? req.prompt : "";
+        int max_tokens = req.max_tokens;
+        float temperature = req.temperature;
+        std::string system = req.system ? req.system : "";
+
+        // A custom system prompt changes the answer, so it is part of the cache key.
+        // Token-id prompts have no text to compare and bypass the cache.
+        std::string request_class = req.request_class ? req.request_class : "";
+        std::string cache_prompt = req.system ? system + "\n" + prompt : prompt;
+        bool cacheable = !has_token_ids && similarity_cache_.acceptsClass(request_class);
+        if (!options.internal) notePrewarm(req, request_class, cacheable);
+        if (cacheable) {
+            std::string cached;
+            if (similarity_cache_.lookup(request_class, cache_prompt, &cached)) {
+                if (!options.internal) metrics_.requests_submitted++;
+                metrics_.similarity_cache_hits++;
+                MLCFlightRecorder::record(MLCFlightEventType::CacheHit);
+                deliverCached(req, *sink, cached);
+                if (!options.internal) metrics_.requests_completed++;
+                return 0;
+            }
+            metrics_.similarity_cache_misses++;
+        }
+
+        if (has_token_ids) {
+            std::cout << "🔄 REAL MLC Engine generating for " << req.num_token_ids << " prompt tokens" << std::endl;
+        } else {
+            std::cout << "🔄 REAL MLC Engine generating for prompt: " << prompt << std::endl;
+        }
+
+        uint64_t seq = 0;
+        std::string request_id = nextRequestId(&seq);
+
+        // Decided before any tokenization so refusal stays cheap; prompt size
+        // is estimated from its bytes
+        int estimated_prompt_tokens = options.prompt_ids ? static_cast<int>(options.prompt_ids->size())
+                                    : has_token_ids    ? req.num_token_ids
+                                                       : static_cast<int>(prompt.size() / 3) + 1;
+        MLCFlightRecorder::record(MLCFlightEventType::Submit, seq, static_cast<uint32_t>(estimated_prompt_tokens),
+                                  max_tokens);
+        MLCLengthFeatures length_features;
+        length_features.request_class = request_class;
+        length_features.template_name = has_token_ids ? "" : chat_template_->name();
+        length_features.system_hash = req.system ? std::hash<std::string>()(system) : 0;
+        length_features.lead_word = leadWord(prompt);
+        length_features.prompt_tokens = estimated_prompt_tokens;
+        length_features.max_tokens = max_tokens;
+        MLCLengthPrediction length_prediction = length_predictor_.predict(length_features);
+
+        MLCAdmissionDecision decision = admission_control_.admit(request_id, estimated_prompt_tokens, max_tokens,
+                                                                 length_prediction.expected_tokens,
+                                                                 length_prediction.reserve_tokens);
+        t_last_admission.estimated_wait_ms = decision.estimated_wait_ms;
+        t_last_admission.retry_after_ms = decision.retry_after_ms;
+        t_last_admission.queue_depth = decision.queue_depth;
+        MLCFlightRecorder::record(decision.admitted ? MLCFlightEventType::Admit : MLCFlightEventType::Reject, seq,
+                                  static_cast<uint32_t>(decision.queue_depth), decision.estimated_wait_ms);
+        if (!decision.admitted) {
+            if (!options.internal) metrics_.requests_rejected++;
+            std::cout << "⛔ Overloaded, refusing request (estimated wait " << decision.estimated_wait_ms
+                      << " ms, retry after " << decision.retry_after_ms << " ms)" << std::endl;
+            return MLC_LLM_ERROR_OVERLOADED;
+        }
+
+        RequestState state;
+        state.seq = seq;
+        try {
+            std::vector<int32_t> prompt_ids;
+            if (options.prompt_ids) {
+                prompt_ids = *options.prompt_ids;
+            } else {
+                encodePrompt(req, &prompt_ids);
+            }
+            int prompt_tokens = static_cast<int>(prompt_ids.size());
+            state.prompt_tokens = prompt_tokens;
+            state.wants_logprobs = top_logprobs > 0;
+            state.internal = options.internal;
+            state.length_features = length_features;
+            state.length_prediction = length_prediction;
+
+            ObjectRef request = create_request_(String(request_id), Array<ObjectRef>{makeTokenData(prompt_ids)},
+                                                String(generationConfig(max_tokens, temperature, top_logprobs,
+                                                                        options.disagg_config)));
+            state.detokenizer = tokenizer_->createStreamer();
+            if (options.resume_output_tokens > 0) {
+                // Decoded but not delivered again; sets up word boundaries and
+                // partial characters for the first new tokens
+                const std::vector<int32_t>& stop_token_ids = chat_template_->stopTokenIds();
+                std::vector<int32_t> tail;
+                int begin = prompt_tokens - std::min(options.resume_output_tokens, kResumePrimeTokens);
+                for (int i = begin; i < prompt_tokens; ++i) {
+                    if (std::find(stop_token_ids.begin(), stop_token_ids.end(), prompt_ids[i]) == stop_token_ids.end()) {
+                        tail.push_back(prompt_ids[i]);
+                    }
+                }
+                state.detokenizer.put(tail);
+            }
+            if (config_.continue_retain_ms > 0 && req.session_id && *req.session_id && !options.internal) {
+                state.retain_session = req.session_id;
+                state.token_history = prompt_ids;
+            }
+
+            state.sink = std::move(sink);
+            state.max_tokens = max_tokens;
+            if (cacheable) {
+                state.cache_class = request_class;
+                state.cache_prompt = cache_prompt;
+            }
+            state.json_stream = makeJsonStream(req);
+            {
+                std::lock_guard<std::mutex> lock(config_mutex_);
+                if (repetition_config_.enabled) {
+                    state.repetition = std::make_unique<MLCRepetitionDetector>(repetition_config_);
+                }
+            }
+
+            // Register before submitting so the first stream-back payload finds the sink
+            state.submitted_at = std::chrono::steady_clock::now();
+            {
+                std::lock_guard<std::mutex> lock(requests_mutex_);
+                // A newer turn replaces what the session could continue
+                if (!state.retain_session.empty()) retained_.erase(state.retain_session);
+                requests_[request_id] = std::move(state);
+                if (options.on_usage) usage_waiters_[request_id] = options.on_usage;
+                metrics_.requests_in_flight++;
+                metrics_.kv_tokens_in_use += prompt_tokens;
+                last_progress_ns_ = MLCFlightRecorder::nowNs();
+            }
+            if (!options.internal) metrics_.requests_submitted++;
+
+            // Call the REAL MLC-LLM engine, directly or with the rest of a burst
+            if (admission_) {
+                admission_->push(prompt_tokens, length_prediction.expected_tokens, [this, request, request_id, seq,
+                                                                                     prompt_tokens]() {
+                    // A raced request may have lost while waiting in the window
+                    {
+                        std::lock_guard<std::mutex> lock(requests_mutex_);
+                        if (!requests_.count(request_id)) return;
+                    }
+                    try {
+                        MLCFlightRecorder::record(MLCFlightEventType::Dispatch, seq, static_cast<uint32_t>(prompt_tokens));
+                        add_request_(request);
+                    } catch (const std::exception& e) {
+                        std::cerr << "❌ REAL Generation failed: " << e.what() << std::endl;
+                        failRequest(request_id, e.what());
+                    }
+                });
+            } else {
+                MLCFlightRecorder::record(MLCFlightEventType::Dispatch, seq, static_cast<uint32_t>(prompt_tokens));
+                add_request_(request);
+            }
+
+            std::cout << "✅ REAL MLC-LLM generation started successfully" << std::endl;
+            if (options.request_id_out) *options.request_id_out = request_id;
+            return 0;
+
+        } catch (const std::exception& e) {
+            std::cerr << "❌ REAL Generation failed: " << e.what() << std::endl;
+            MLCFlightRecorder::record(MLCFlightEventType::Error, seq);
+            if (!options.internal) metrics_.requests_failed++;
+            dropRequest(request_id);
+            return -2;
+        }
+    }
+
+    // Replaces the prewarmer; the old one saves its hot items first
+    int configurePrewarm(bool enabled, const MLCPrewarmConfig& config) {
+        std::lock_guard<std::mutex> lock(prewarm_mutex_);
+        prewarmer_.reset();
+        if (!enabled || !is_initialized_) return enabled ? -1 : 0;
+        prewarmer_ = std::make_unique<MLCPrewarmer>(
+            config, &metrics_,
+            [this](const MLCPrewarmItem& item, int max_tokens, MLCPrewarmer::Done done) {
+                return runPrewarm(item, max_tokens, std::move(done));
+            },
+            [this](const std::string& request_id) { cancelRequest(request_id); },
+            [this]() {
+                std::lock_guard<std::mutex> lock(requests_mutex_);
+                for (const auto& entry : requests_) {
+                    if (!entry.second.internal) return true;
+                }
+                return false;
+            });
+        return 0;
+    }
+
+    // Counts a caller's request towards prewarming and preempts any warm-up
+    void notePrewarm(const mlc_llm_request_t& req, const std::string& request_class, bool cacheable) {
+        std::lock_guard<std::mutex> lock(prewarm_mutex_);
+        if (!prewarmer_) return;
+        // Token-id prompts carry no template, so no system block to share
+        if (!(req.token_ids && req.num_token_ids > 0)) {
+            MLCPrewarmItem prefix;
+            prefix.has_system = req.system != nullptr;
+            if (req.system) prefix.system = req.system;
+            prewarmer_->observe(prefix);
+            if (cacheable) {
+                MLCPrewarmItem completion = prefix;
+                completion.kind = MLCPrewarmItem::Kind::Completion;
+                completion.request_class = request_class;
+                completion.prompt = req.prompt ? req.prompt : "";
+                completion.max_tokens = req.max_tokens;
+                prewarmer_->observe(completion);
+            }
+        }
+        prewarmer_->preempt();
+    }
+
+    // Runs on the prewarmer thread
+    std::string runPrewarm(const MLCPrewarmItem& item, int max_tokens, MLCPrewarmer::Done done) {
+        mlc_llm_request_t req;
+        mlc_llm_request_init(&req);
+        req.max_tokens = max_tokens;
+        // Greedy, so a warmed completion is the model's most likely answer
+        req.temperature = 0.0f;
+        req.system = item.has_system ? item.system.c_str() : nullptr;
+
+        SubmitOptions options;
+        options.internal = true;
+        std::string request_id;
+        options.request_id_out = &request_id;
+        std::vector<int32_t> prefix_ids;
+        int prefix_tokens = 0;
+        if (item.kind == MLCPrewarmItem::Kind::Prefix) {
+            // The engine's prefix cache keeps the block's KV once the request ends
+            prefix_ids = chat_template_->encodeSystemPrefix(item.has_system ? &item.system : nullptr);
+            if (prefix_ids.empty()) {
+                done(false, 0);
+                return "";
+            }
+            prefix_tokens = static_cast<int>(prefix_ids.size());
+            options.prompt_ids = &prefix_ids;
+        } else {
+            std::string cached;
+            std::string cache_prompt = item.has_system ? item.system + "\n" + item.prompt : item.prompt;
+            if (similarity_cache_.lookup(item.request_class, cache_prompt, &cached)) {
+                done(true, 0);
+                return "";
+            }
+            req.prompt = item.prompt.c_str();
+            req.request_class = item.request_class.c_str();
+        }
+        submit(req, std::make_unique<MLCPrewarmSink>(std::move(done), prefix_tokens), options);
+        return request_id;
+    }
+
+    int startIngest(const MLCIngestConfig& config) {
+        if (!is_initialized_) return -1;
+        MLCTokenizer* tokenizer = tokenizer_.get();
+        auto pipeline = std::make_unique<MLCIngestPipeline>(
+            config,
+            [tokenizer](const std::string& text) { return tokenizer->encode(text); },
+            [tokenizer](const std::vector<int32_t>& token_ids) { return tokenizer->decode(token_ids); },
+            [this]() {
+                std::lock_guard<std::mutex> lock(requests_mutex_);
+                return !requests_.empty();
+            },
+            &document_index_, &metrics_);
+
+        std::lock_guard<std::mutex> lock(ingest_mutex_);
+        if (ingest_) ingest_->stop();
+        ingest_ = std::move(pipeline);
+        ingest_->start();
+        std::cout << "📚 Ingesting from " << config.directories.size() << " directories" << std::endl;
+        return 0;
+    }
+
+    int stopIngest() {
+        std::lock_guard<std::mutex> lock(ingest_mutex_);
+        if (!ingest_) return 0;
+        ingest_->stop();
+        ingest_.reset();
+        return 0;
+    }
+
+    int queryDocuments(const std::string& query, int top_k, mlc_llm_ingest_hit_callback_t callback, void* user_data) {
+        if (!is_initialized_) return -1;
+        std::vector<MLCDocumentHit> hits = document_index_.query(tokenizer_->encode(query), static_cast<size_t>(top_k));
+        std::vector<mlc_llm_ingest_hit_t> c_hits;
+        for (const MLCDocumentHit& hit : hits) {
+            c_hits.push_back(mlc_llm_ingest_hit_t{hit.path.c_str(), hit.chunk_index, hit.text.c_str(), hit.score});
+        }
+        callback(user_data, c_hits.data(), static_cast<int>(c_hits.size()));
+        return 0;
+    }
+
+    void dropRequest(const std::string& request_id) {
+        std::lock_guard<std::mutex> lock(requests_mutex_);
+        // Admission may have registered the request before it reached requests_
+        admission_control_.onFinish(request_id, false);
+        // submit() reports the failure itself, so the callback is not run
+        usage_waiters_.erase(request_id);
+        auto it = requests_.find(request_id);
+        if (it == requests_.end()) return;
+        releaseLoad(it->second);
+        requests_.erase(it);
+    }
+
+    int setAdmissionConfig(const MLCAdmissionControlConfig& config) {
+        admission_control_.configure(config);
+        return 0;
+    }
+
+    int64_t estimatedWaitMs() const {
+        return admission_control_.estimatedWaitMs();
+    }
+
+    const MLCThreadLayout& threadLayout() const {
+        return thread_layout_;
+    }
+
+    bool isInitialized() const {
+        return is_initialized_;
+    }
+};
+
+namespace {
+
+// Engine replicas behind one router. Prompts are tokenized once, by the first
+// replica, and the ids are reused by whichever replica is chosen, so replicas
+// must share a model and tokenizer.
+struct MLCRouterHandle {
+    std::vector<MLCEngineWrapper*> engines;
+    std::shared_ptr<MLCReplicaRouter> router;
+
+    int submit(const mlc_llm_request_t& req) {
+        std::unique_ptr<MLCDeliverySink> sink;
+        int status = MLCEngineWrapper::makeSink(req, &sink);
+        if (status != 0) return status;
+
+        std::vector<int32_t> prompt_ids;
+        status = engines[0]->encodePrompt(req, &prompt_ids);
+        if (status != 0) return status;
+
+        MLCReplicaRouter::Route route = router->route(prompt_ids, req.session_id ? req.session_id : "");
+        std::cout << "🧭 Routing to replica " << route.replica << " (" << route.cached_tokens << " of "
+                  << prompt_ids.size() << " prompt tokens cached)" << std::endl;
+        // From here the sink releases the replica, including when submit fails
+        sink = std::make_unique<MLCRoutedSink>(std::move(sink), router, route.replica);
+
+        MLCEngineWrapper* engine = engines[route.replica];
+        if (req.backend != MLC_LLM_BACKEND_LOCAL) {
+            return engine->submitToBackends(req, std::move(sink));
+        }
+        MLCEngineWrapper::SubmitOptions options;
+        options.prompt_ids = &prompt_ids;
+        return engine->submit(req, std::move(sink), options);
+    }
+};
+
+// A prefill-only engine and a decode engine, stepped through MLC-LLM's KV
+// handoff by MLCDisaggCoordinator. Both load the same model; prompts are
+// tokenized once, by the decode engine.
+struct MLCDisaggHandle {
+    // Reached by step callbacks that can fire after mlc_llm_destroy_disagg,
+    // which clears `handle` before deleting it
+    struct Anchor {
+        std::mutex mutex;
+        MLCDisaggHandle* handle = nullptr;
+    };
+
+    MLCEngineWrapper* prefill = nullptr;
+    MLCEngineWrapper* decode = nullptr;
+    std::shared_ptr<Anchor> anchor;
+    std::unique_ptr<MLCDisaggCoordinator> coordinator;
+
+    // What the later steps need of the caller's request, which is only
+    // valid during submit()
+    struct Handoff {
+        std::vector<int32_t> prompt_ids;
+        std::string prompt;
+        std::string system;
+        bool has_system = false;
+        int max_tokens = 0;
+        float temperature = 0.0f;
+        int top_logprobs = 0;
+        std::string session_id;   // retained on the decode engine for mlc_llm_continue
+        std::shared_ptr<MLCDeliverySink> sink;
+        std::chrono::steady_clock::time_point step_started;
+    };
+
+    int submit(const mlc_llm_request_t& req) {
+        coordinator->counters.requests++;
+        std::unique_ptr<MLCDeliverySink> sink;
+        int status = MLCEngineWrapper::makeSink(req, &sink);
+        if (status != 0) return status;
+
+        std::vector<int32_t> prompt_ids;
+        status = decode->encodePrompt(req, &prompt_ids);
+        if (status != 0) return status;
+
+        // JSON subscriptions and remote backends read the caller's request
+        // after submit returns, so those requests stay on the decode engine.
+        // So do cache classes: a similarity-cache hit on the final step would
+        // leave the KV pages reserved for the handoff unused.
+        int top_logprobs = MLCEngineWrapper::binaryOutput(req) ? req.top_logprobs : 0;
+        int min_tokens = std::max(2, coordinator->config().min_prefill_tokens);
+        bool handoff = req.backend == MLC_LLM_BACKEND_LOCAL && !(req.json_paths && req.num_json_paths > 0) &&
+                       !(req.request_class && *req.request_class) &&
+                       static_cast<int>(prompt_ids.size()) >= min_tokens;
+        if (!handoff) {
+            coordinator->counters.colocated++;
+            if (req.backend != MLC_LLM_BACKEND_LOCAL) return decode->submitToBackends(req, std::move(sink));
+            MLCEngineWrapper::SubmitOptions options;
+            options.prompt_ids = &prompt_ids;
+            options.top_logprobs = top_logprobs;
+            return decode->submit(req, std::move(sink), options);
+        }
+
+        auto state = std::make_shared<Handoff>();
+        state->prompt_ids = std::move(prompt_ids);
+        state->prompt = req.prompt ? req.prompt : "";
+        state->has_system = req.system != nullptr;
+        state->system = req.system ? req.system : "";
+        state->max_tokens = req.max_tokens;
+        state->temperature = req.temperature;
+        state->top_logprobs = top_logprobs;
+        state->session_id = req.session_id ? req.session_id : "";
+        state->sink = std::move(sink);
+        state->step_started = std::chrono::steady_clock::now();
+
+        // The decode engine keeps the last prompt token to prefill itself
+        MLCEngineWrapper::SubmitOptions options;
+        options.prompt_ids = &state->prompt_ids;
+        options.disagg_config = MLCDisaggCoordinator::prepareReceiveConfig(static_cast<int>(state->prompt_ids.size()) - 1);
+        options.internal = true;
+        std::shared_ptr<Anchor> anchor_ref = anchor;
+        options.on_usage = [anchor_ref, state](const std::string& usage_json) {
+            std::lock_guard<std::mutex> lock(anchor_ref->mutex);
+            MLCDisaggHandle* handle = anchor_ref->handle;
+            if (!handle) {
+                state->sink->onError("disaggregated serving was shut down");
+                return;
+            }
+            handle->coordinator->post([handle, state, usage_json]() { handle->send(state, usage_json); });
+        };
+        status = decode->submit(stepRequest(*state), std::make_unique<MLCDiscardSink>(), options);
+        if (status != 0) coordinator->counters.failed++;
+        return status;
+    }
+
+    static mlc_llm_request_t stepRequest(const Handoff& state) {
+        mlc_llm_request_t req;
+        mlc_llm_request_init(&req);
+        req.prompt = state.prompt.c_str();
+        req.system = state.has_system ? state.system.c_str() : nullptr;
+        req.max_tokens = 1;
+        req.temperature = state.temperature;
+        return req;
+    }
+
+    // Coordinator thread: the decode engine has reserved the prompt's KV pages
+    void send(const std::shared_ptr<Handoff>& state, const std::string& usage_json) {
+        auto now = std::chrono::steady_clock::now();
+        coordinator->counters.prepare_us += static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(now - state->step_started).count());
+
+        int prompt_tokens = static_cast<int>(state->prompt_ids.size());
+        int prefix_matched = 0;
+        std::string metadata;
+        if (!MLCDisaggCoordinator::parsePrepareReceiveUsage(usage_json, &prefix_matched, &metadata)) {
+            // Nothing was reserved, so prefilling on the decode engine is safe
+            std::cerr << "⚠️ Decode engine returned no KV handoff metadata; prefilling locally" << std::endl;
+            coordinator->counters.fallbacks++;
+            generate(state, "");
+            return;
+        }
+
+        int end = prompt_tokens - 1;
+        int begin = std::min(prefix_matched, end);
+        coordinator->counters.prefix_reused_tokens += static_cast<uint64_t>(begin);
+        if (begin < end) {
+            MLCEngineWrapper::SubmitOptions options;
+            options.prompt_ids = &state->prompt_ids;
+            options.disagg_config = MLCDisaggCoordinator::remoteSendConfig(begin, end, metadata,
+                                                                           coordinator->config().decode_group_offset);
+            options.internal = true;
+            std::shared_ptr<Anchor> anchor_ref = anchor;
+            options.on_usage = [anchor_ref, now](const std::string&) {
+                std::lock_guard<std::mutex> lock(anchor_ref->mutex);
+                if (!anchor_ref->handle) return;
+                anchor_ref->handle->coordinator->counters.prefill_us += static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - now).count());
+            };
+            int status = prefill->submit(stepRequest(*state), std::make_unique<MLCDiscardSink>(), options);
+            if (status != 0) {
+                // The decode engine's reserved pages were never filled; a
+                // local prefill could match them, so the request fails instead
+                coordinator->counters.failed++;
+                state->sink->onError(status == MLC_LLM_ERROR_OVERLOADED ? "prefill engine overloaded"
+                                                                        : "prefill engine refused the KV handoff");
+                return;
+            }
+            coordinator->counters.handoff_tokens += static_cast<uint64_t>(end - begin);
+        }
+        coordinator->counters.handoffs++;
+        // Issued alongside the send; the decode engine waits for the KV to land
+        generate(state, MLCDisaggCoordinator::startGenerationConfig(end));
+    }
+
+    void generate(const std::shared_ptr<Handoff>& state, const std::string& disagg_config) {
+        mlc_llm_request_t req = stepRequest(*state);
+        req.max_tokens = state->max_tokens;
+        req.session_id = state->session_id.empty() ? nullptr : state->session_id.c_str();
+        MLCEngineWrapper::SubmitOptions options;
+        options.prompt_ids = &state->prompt_ids;
+        options.disagg_config = disagg_config;
+        options.top_logprobs = state->top_logprobs;
+        int status = decode->submit(req, std::make_unique<MLCSharedSink>(state->sink), options);
+        if (status != 0) {
+            coordinator->counters.failed++;
+            state->sink->onError(status == MLC_LLM_ERROR_OVERLOADED ? "decode engine overloaded" : "generation failed");
+        }
+    }
+};
+
+} // namespace
+
+extern "C" {
+
+void* mlc_llm_create_engine(const char* model_path) {
+    return mlc_llm_create_engine_ex(model_path, nullptr);
+}
+
+void mlc_llm_engine_config_init(mlc_llm_engine_config_t* config) {
+    if (!config) {
+        return;
+    }
+    *config = mlc_llm_engine_config_t{};
+    config->max_num_sequence = 4;
+    config->admission_window_us = 2000;
+}
+
+void* mlc_llm_create_engine_ex(const char* model_path, const mlc_llm_engine_config_t* config) {
+    if (!model_path) {
+        return nullptr;
+    }
+
+    MLCEngineConfig engine_config;
+    if (config) {
+        if (config->model_lib) engine_config.model_lib = config->model_lib;
+        if (config->max_num_sequence > 0) engine_config.max_num_sequence = config->max_num_sequence;
+        if (config->max_total_sequence_length > 0) engine_config.max_total_sequence_length = config->max_total_sequence_length;
+        if (config->prefill_chunk_size > 0) engine_config.prefill_chunk_size = config->prefill_chunk_size;
+        if (config->admission_window_us > 0) engine_config.admission_window_us = config->admission_window_us;
+        if (config->admission_max_tokens > 0) engine_config.admission_max_tokens = config->admission_max_tokens;
+        engine_config.startup_prefetch = config->disable_startup_prefetch == 0;
+        if (config->startup_profile_path) engine_config.startup_profile_path = config->startup_profile_path;
+        if (config->kv_cache_dtype) engine_config.kv_cache_dtype = config->kv_cache_dtype;
+        if (config->compute_threads > 0) engine_config.compute_threads = config->compute_threads;
+        if (config->compute_cpus) engine_config.compute_cpus = config->compute_cpus;
+        if (config->continue_retain_ms > 0) engine_config.continue_retain_ms = config->continue_retain_ms;
+        if (config->continue_max_sequences > 0) engine_config.continue_max_sequences = config->continue_max_sequences;
+    }
+
+    try {
+        std::cout << "🚀 Creating REAL MLC-LLM engine (no more fake tokens!)" << std::endl;
+        auto* engine = new MLCEngineWrapper(std::string(model_path), engine_config);
+        if (!engine->isInitialized()) {
+            delete engine;
+            return nullptr;
+        }
+        return static_cast<void*>(engine);
+    } catch (const std::exception& e) {
+        std::cerr << "❌ Failed to create REAL MLC engine: " << e.what() << std::endl;
+        return nullptr;
+    }
+}
+
+int mlc_llm_generate(void* engine, const char* prompt, int max_tokens, float temperature, void (*callback)(const char*)) {
+    if (!engine || !prompt) {
+        return -1;
+    }
+    
+    std::cout << "🎯 REAL inference requested - NO MORE HARDCODED TOKENS!" << std::endl;
+    mlc_llm_request_t req;
+    mlc_llm_request_init(&req);
+    req.prompt = prompt;
+    req.max_tokens = max_tokens;
+    req.temperature = temperature;
+    req.callback = callback;
+    return mlc_llm_submit(engine, &req);
+}
+
+intptr_t mlc_llm_dart_initialize(void* dart_api_data) {
+    return MLCDartPortSink::initializeApi(dart_api_data);
+}
+
+int mlc_llm_generate_to_port(void* engine, const char* prompt, int max_tokens, float temperature, int64_t port) {
+    if (!engine || !prompt || port == 0) {
+        return -1;
+    }
+
+    mlc_llm_request_t req;
+    mlc_llm_request_init(&req);
+    req.prompt = prompt;
+    req.max_tokens = max_tokens;
+    req.temperature = temperature;
+    req.dart_port = port;
+    return mlc_llm_submit(engine, &req);
+}
+
+void mlc_llm_request_init(mlc_llm_request_t* req) {
+    if (!req) {
+        return;
+    }
+    *req = mlc_llm_request_t{};
+    req->max_tokens = 2048;
+    req->temperature = 0.7f;
+    req->output_fd = -1;
+}
+
+int mlc_llm_submit(void* engine, const mlc_llm_request_t* req) {
+    t_last_admission = mlc_llm_admission_status_t{};
+    if (!engine || !req) {
+        return t_last_admission.status = -1;
+    }
+    if (!req->prompt && !(req->token_ids && req->num_token_ids > 0)) {
+        return t_last_admission.status = -1;
+    }
+
+    try {
+        auto* mlc_engine = static_cast<MLCEngineWrapper*>(engine);
+        return t_last_admission.status = mlc_engine->submit(*req);
+    } catch (const std::exception& e) {
+        std::cerr << "❌ REAL Generation failed: " << e.what() << std::endl;
+        return t_last_admission.status = -2;
+    }
+}
+
+int mlc_llm_continue(void* engine, const mlc_llm_request_t* req, int extra_tokens) {
+    t_last_admission = mlc_llm_admission_status_t{};
+    if (!engine || !req || !req->session_id || extra_tokens <= 0) {
+        return t_last_admission.status = -1;
+    }
+
+    try {
+        return t_last_admission.status = static_cast<MLCEngineWrapper*>(engine)->continueSession(*req, extra_tokens);
+    } catch (const std::exception& e) {
+        std::cerr << "❌ REAL Generation failed: " << e.what() << std::endl;
+        return t_last_admission.status = -2;
+    }
+}
+
+void* mlc_llm_create_router(void* const* engines, int num_engines, const mlc_llm_router_config_t* config) {
+    if (!engines || num_engines <= 0) {
+        return nullptr;
+    }
+    MLCRouterConfig router_config;
+    if (config) {
+        if (config->block_tokens > 0) router_config.block_tokens = config->block_tokens;
+        if (config->load_cost_tokens > 0) router_config.load_cost_tokens = config->load_cost_tokens;
+        if (config->session_ttl_ms > 0) router_config.session_ttl_ms = config->session_ttl_ms;
+        if (config->max_cached_blocks > 0) router_config.max_cached_blocks = static_cast<size_t>(config->max_cached_blocks);
+    }
+
+    auto* handle = new MLCRouterHandle();
+    for (int i = 0; i < num_engines; ++i) {
+        auto* engine = static_cast<MLCEngineWrapper*>(engines[i]);
+        if (!engine || !engine->isInitialized()) {
+            delete handle;
+            return nullptr;
+        }
+        handle->engines.push_back(engine);
+    }
+    handle->router = std::make_shared<MLCReplicaRouter>(handle->engines.size(), router_config);
+    std::cout << "🧭 Router over " << num_engines << " replicas" << std::endl;
+    return handle;
+}
+
+int mlc_llm_router_submit(void* router, const mlc_llm_request_t* req) {
+    t_last_admission = mlc_llm_admission_status_t{};
+    if (!router || !req) {
+        return t_last_admission.status = -1;
+    }
+    if (!req->prompt && !(req->token_ids && req->num_token_ids > 0)) {
+        return t_last_admission.status = -1;
+    }
+
+    try {
+        return t_last_admission.status = static_cast<MLCRouterHandle*>(router)->submit(*req);
+    } catch (const std::exception& e) {
+        std::cerr << "❌ REAL Generation failed: " << e.what() << std::endl;
+        return t_last_admission.status = -2;
+    }
+}
+
+int mlc_llm_router_stats(void* router, mlc_llm_replica_stats_t* out, int capacity) {
+    if (!router || (!out && capacity > 0)) {
+        return -1;
+    }
+    std::vector<MLCReplicaStats> stats = static_cast<MLCRouterHandle*>(router)->router->stats();
+    for (int i = 0; i < capacity && i < static_cast<int>(stats.size()); ++i) {
+        out[i].requests = stats[i].requests;
+        out[i].in_flight = stats[i].in_flight;
+        out[i].prompt_tokens = stats[i].prompt_tokens;
+        out[i].prefix_hit_tokens = stats[i].prefix_hit_tokens;
+        out[i].sticky_routes = stats[i].sticky_routes;
+        out[i].rebalanced = stats[i].rebalanced;
+    }
+    return static_cast<int>(stats.size());
+}
+
+void mlc_llm_destroy_router(void* router) {
+    // In-flight requests keep the routing state alive through their sinks
+    delete static_cast<MLCRouterHandle*>(router);
+}
+
+void* mlc_llm_create_disagg(void* prefill_engine, void* decode_engine, const mlc_llm_disagg_config_t* config) {
+    auto* prefill = static_cast<MLCEngineWrapper*>(prefill_engine);
+    auto* decode = static_cast<MLCEngineWrapper*>(decode_engine);
+    if (!prefill || !decode || prefill == decode || !prefill->isInitialized() || !decode->isInitialized()) {
+        return nullptr;
+    }
+    MLCDisaggConfig disagg_config;
+    if (config) {
+        if (config->min_prefill_tokens > 0) disagg_config.min_prefill_tokens = config->min_prefill_tokens;
+        if (config->decode_group_offset > 0) disagg_config.decode_group_offset = config->decode_group_offset;
+    }
+
+    auto* handle = new MLCDisaggHandle();
+    handle->prefill = prefill;
+    handle->decode = decode;
+    handle->anchor = std::make_shared<MLCDisaggHandle::Anchor>();
+    handle->anchor->handle = handle;
+    handle->coordinator = std::make_unique<MLCDisaggCoordinator>(disagg_config);
+    std::cout << "🔀 Disaggregated serving: prefill on " << prefill->threadLayout().describe() << "; decode on "
+              << decode->threadLayout().describe() << std::endl;
+    return handle;
+}
+
+int mlc_llm_disagg_submit(void* disagg, const mlc_llm_request_t* req) {
+    t_last_admission = mlc_llm_admission_status_t{};
+    if (!disagg || !req) {
+        return t_last_admission.status = -1;
+    }
+    if (!req->prompt && !(req->token_ids && req->num_token_ids > 0)) {
+        return t_last_admission.status = -1;
+    }
+
+    try {
+        return t_last_admission.status = static_cast<MLCDisaggHandle*>(disagg)->submit(*req);
+    } catch (const std::exception& e) {
+        std::cerr << "❌ REAL Generation failed: " << e.what() << std::endl;
+        return t_last_admission.status = -2;
+    }
+}
+
+int mlc_llm_disagg_stats(void* disagg, mlc_llm_disagg_stats_t* out) {
+    if (!disagg || !out) {
+        return -1;
+    }
+    MLCDisaggStats stats = static_cast<MLCDisaggHandle*>(disagg)->coordinator->stats();
+    out->requests = stats.requests;
+    out->handoffs = stats.handoffs;
+    out->colocated = stats.colocated;
+    out->fallbacks = stats.fallbacks;
+    out->failed = stats.failed;
+    out->handoff_tokens = stats.handoff_tokens;
+    out->prefix_reused_tokens = stats.prefix_reused_tokens;
+    out->prepare_us = stats.prepare_us;
+    out->prefill_us = stats.prefill_us;
+    return 0;
+}
+
+void mlc_llm_destroy_disagg(void* disagg) {
+    if (!disagg) {
+        return;
+    }
+    auto* handle = static_cast<MLCDisaggHandle*>(disagg);
+    {
+        // Handoffs whose decode-side reservation completes from now on end
+        // with an error instead of reaching the coordinator
+        std::lock_guard<std::mutex> lock(handle->anchor->mutex);
+        handle->anchor->handle = nullptr;
+    }
+    // Runs handoff steps already queued, so their requests still complete
+    delete handle;
+}
+
+int mlc_llm_generate_sync(void* engine, const mlc_llm_request_t* req, char* out_buf, size_t cap, size_t* out_len,
+                          mlc_llm_usage_t* out_usage) {
+    t_last_admission = mlc_llm_admission_status_t{};
+    if (!engine || !req || (!out_buf && cap > 0) || !out_len) {
+        return t_last_admission.status = -1;
+    }
+    if (!req->prompt && !(req->token_ids && req->num_token_ids > 0)) {
+        return t_last_admission.status = -1;
+    }
+
+    try {
+        auto* mlc_engine = static_cast<MLCEngineWrapper*>(engine);
+        return t_last_admission.status = mlc_engine->generateSync(*req, out_buf, cap, out_len, out_usage);
+    } catch (const std::exception& e) {
+        std::cerr << "❌ REAL Generation failed: " << e.what() << std::endl;
+        return t_last_admission.status = -2;
+    }
+}
+
+int mlc_llm_set_admission_config(void* engine, const mlc_llm_admission_config_t* config) {
+    if (!engine || !config) {
+        return -1;
+    }
+
+    MLCAdmissionControlConfig admission;
+    admission.enabled = config->enabled != 0;
+    if (config->max_queued > 0) admission.max_queued = config->max_queued;
+    if (config->max_wait_ms > 0) admission.max_wait_ms = config->max_wait_ms;
+    return static_cast<MLCEngineWrapper*>(engine)->setAdmissionConfig(admission);
+}
+
+int mlc_llm_set_remote_backend(void* engine, const mlc_llm_remote_backend_config_t* config) {
+    if (!engine) {
+        return -1;
+    }
+    auto* mlc_engine = static_cast<MLCEngineWrapper*>(engine);
+    if (!config) {
+        return mlc_engine->setRemoteBackend(nullptr, 500);
+    }
+    if (!config->base_url || !config->model) {
+        return -1;
+    }
+
+    MLCOpenAIConfig remote;
+    remote.base_url = config->base_url;
+    remote.api_key = config->api_key ? config->api_key : "";
+    remote.model = config->model;
+    if (config->connect_timeout_ms > 0) remote.connect_timeout_ms = config->connect_timeout_ms;
+    if (config->read_timeout_ms > 0) remote.read_timeout_ms = config->read_timeout_ms;
+    std::string error;
+    if (!MLCOpenAIBackend::validateConfig(remote, &error)) {
+        std::cerr << "❌ Invalid remote backend: " << error << std::endl;
+        return -1;
+    }
+    int first_token_timeout_ms = config->first_token_timeout_ms > 0 ? config->first_token_timeout_ms : 500;
+    return mlc_engine->setRemoteBackend(std::make_shared<MLCOpenAIBackend>(remote), first_token_timeout_ms);
+}
+
+int mlc_llm_last_admission_status(mlc_llm_admission_status_t* out) {
+    if (!out) {
+        return -1;
+    }
+    *out = t_last_admission;
+    return 0;
+}
+
+int64_t mlc_llm_estimated_wait_ms(void* engine) {
+    if (!engine) {
+        return -1;
+    }
+    return static_cast<MLCEngineWrapper*>(engine)->estimatedWaitMs();
+}
+
+int mlc_llm_vocab_size(void* engine) {
+    if (!engine) {
+        return -1;
+    }
+    return static_cast<MLCEngineWrapper*>(engine)->vocabSize();
+}
+
+int mlc_llm_generate_tokens(void* engine, const int32_t* token_ids, int num_token_ids, int max_tokens, float temperature, void (*callback)(const char*)) {
+    if (!engine || !token_ids || num_token_ids <= 0) {
+        return -1;
+    }
+
+    mlc_llm_request_t req;
+    mlc_llm_request_init(&req);
+    req.token_ids = token_ids;
+    req.num_token_ids = num_token_ids;
+    req.max_tokens = max_tokens;
+    req.temperature = temperature;
+    req.callback = callback;
+    return mlc_llm_submit(engine, &req);
+}
+
+int mlc_llm_score_tokens(void* engine, const int32_t* token_ids, int num_token_ids, int validate_token_ids,
+                         int top_logprobs, mlc_llm_logprob_callback_t callback, void* user_data) {
+    // The engine reports at most 5 alternatives per position
+    if (!engine || !token_ids || num_token_ids <= 0 || !callback || top_logprobs < 1 || top_logprobs > 5) {
+        return -1;
+    }
+
+    try {
+        auto* mlc_engine = static_cast<MLCEngineWrapper*>(engine);
+        return mlc_engine->score(token_ids, num_token_ids, validate_token_ids != 0, top_logprobs, callback, user_data);
+    } catch (const std::exception& e) {
+        std::cerr << "❌ REAL Scoring failed: " << e.what() << std::endl;
+        return -2;
+    }
+}
+
+int mlc_llm_ingest_start(void* engine, const mlc_llm_ingest_config_t* config) {
+    if (!engine || !config || !config->directories || config->num_directories <= 0 ||
+        (config->num_extensions > 0 && !config->extensions)) {
+        return -1;
+    }
+
+    MLCIngestConfig ingest;
+    for (int i = 0; i < config->num_directories; ++i) {
+        if (config->directories[i]) ingest.directories.push_back(config->directories[i]);
+    }
+    if (config->num_extensions > 0) {
+        ingest.extensions.clear();
+        for (int i = 0; i < config->num_extensions; ++i) {
+            if (config->extensions[i]) ingest.extensions.push_back(config->extensions[i]);
+        }
+    }
+    if (config->chunk_tokens > 0) ingest.chunk_tokens = config->chunk_tokens;
+    if (config->chunk_overlap_tokens > 0) ingest.chunk_overlap_tokens = config->chunk_overlap_tokens;
+    if (config->parser_threads > 0) ingest.parser_threads = config->parser_threads;
+    if (config->queue_capacity > 0) ingest.queue_capacity = static_cast<size_t>(config->queue_capacity);
+    if (config->poll_interval_ms > 0) ingest.poll_interval_ms = config->poll_interval_ms;
+
+    try {
+        return static_cast<MLCEngineWrapper*>(engine)->startIngest(ingest);
+    } catch (const std::exception& e) {
+        std::cerr << "❌ Failed to start ingestion: " << e.what() << std::endl;
+        return -2;
+    }
+}
+
+int mlc_llm_ingest_stop(void* engine) {
+    if (!engine) {
+        return -1;
+    }
+    return static_cast<MLCEngineWrapper*>(engine)->stopIngest();
+}
+
+int mlc_llm_ingest_query(void* engine, const char* query, int top_k, mlc_llm_ingest_hit_callback_t callback, void* user_data) {
+    if (!engine || !query || top_k <= 0 || !callback) {
+        return -1;
+    }
+
+    try {
+        return static_cast<MLCEngineWrapper*>(engine)->queryDocuments(query, top_k, callback, user_data);
+    } catch (const std::exception& e) {
+        std::cerr << "❌ Document query failed: " << e.what() << std::endl;
+        return -2;
+    }
+}
+
+int mlc_llm_set_repetition_config(void* engine, const mlc_llm_repetition_config_t* config) {
+    if (!engine || !config) {
+        return -1;
+    }
+
+    MLCRepetitionConfig repetition;
+    repetition.enabled = config->enabled != 0;
+    if (config->ngram_size > 0) repetition.ngram_size = config->ngram_size;
+    if (config->min_repeats > 0) repetition.min_repeats = config->min_repeats;
+    if (config->max_period > 0) repetition.max_period = config->max_period;
+    if (config->min_loop_tokens > 0) repetition.min_loop_tokens = config->min_loop_tokens;
+    repetition.abort_on_loop = config->abort_on_loop != 0;
+    return static_cast<MLCEngineWrapper*>(engine)->setRepetitionConfig(repetition);
+}
+
+int mlc_llm_configure_similarity_cache(void* engine, const mlc_llm_similarity_cache_config_t* config) {
+    if (!engine || !config || (config->num_request_classes > 0 && !config->request_classes)) {
+        return -1;
+    }
+
+    MLCSimilarityCacheConfig cache;
+    for (int i = 0; i < config->num_request_classes; ++i) {
+        if (config->request_classes[i]) cache.request_classes.insert(config->request_classes[i]);
+    }
+    if (config->min_similarity > 0.0f) cache.min_similarity = config->min_similarity;
+    if (config->max_hamming_distance > 0) cache.max_hamming_distance = config->max_hamming_distance;
+    if (config->capacity > 0) cache.capacity = static_cast<size_t>(config->capacity);
+    if (config->persist_path) cache.persist_path = config->persist_path;
+    return static_cast<MLCEngineWrapper*>(engine)->configureSimilarityCache(cache);
+}
+
+int mlc_llm_similarity_cache_save(void* engine, const char* path) {
+    if (!engine) {
+        return -1;
+    }
+    return static_cast<MLCEngineWrapper*>(engine)->saveSimilarityCache(path ? path : "");
+}
+
+int mlc_llm_configure_prewarm(void* engine, const mlc_llm_prewarm_config_t* config) {
+    if (!engine || !config) {
+        return -1;
+    }
+
+    MLCPrewarmConfig prewarm;
+    if (config->top_k > 0) prewarm.top_k = static_cast<size_t>(config->top_k);
+    if (config->min_count > 0) prewarm.min_count = static_cast<uint32_t>(config->min_count);
+    if (config->idle_ms > 0) prewarm.idle = std::chrono::milliseconds(config->idle_ms);
+    if (config->max_prefix_tokens > 0) prewarm.max_prefix_tokens = config->max_prefix_tokens;
+    if (config->completion_max_tokens > 0) prewarm.completion_max_tokens = config->completion_max_tokens;
+    if (config->persist_path) prewarm.persist_path = config->persist_path;
+    return static_cast<MLCEngineWrapper*>(engine)->configurePrewarm(config->enabled != 0, prewarm);
+}
+
+int mlc_llm_get_metrics(void* engine, mlc_llm_metrics_t* out) {
+    if (!engine || !out) {
+        return -1;
+    }
+    static_cast<MLCEngineWrapper*>(engine)->getMetrics(out);
+    return 0;
+}
+
+int mlc_llm_flight_recorder_configure(const mlc_llm_flight_recorder_config_t* config) {
+    if (!config) {
+        return -1;
+    }
+    MLCFlightRecorder::Config recorder_config;
+    if (config->dump_path) recorder_config.dump_path = config->dump_path;
+    if (config->stall_timeout_ms > 0) {
+        recorder_config.stall_timeout = std::chrono::milliseconds(config->stall_timeout_ms);
+    } else if (config->stall_timeout_ms < 0) {
+        recorder_config.stall_timeout = std::chrono::milliseconds(0);
+    }
+    recorder_config.install_signal_handlers = config->install_signal_handlers != 0;
+    MLCFlightRecorder::instance().configure(recorder_config);
+    return 0;
+}
+
+int mlc_llm_flight_recorder_dump(const char* path) {
+    return MLCFlightRecorder::instance().dump(path ? path : "", kFlightDumpRequested) ? 0 : -2;
+}
+
+int mlc_llm_telemetry_start(void* engine, const char* name, int interval_ms) {
+    if (!engine || !name || name[0] != '/') {
+        return -1;
+    }
+    int interval = interval_ms > 0 ? interval_ms : 250;
+    return static_cast<MLCEngineWrapper*>(engine)->startTelemetry(name, std::chrono::milliseconds(interval));
+}
+
+int mlc_llm_telemetry_stop(void* engine) {
+    if (!engine) {
+        return -1;
+    }
+    return static_cast<MLCEngineWrapper*>(engine)->stopTelemetry();
+}
+
+int mlc_llm_get_thread_layout(void* engine, mlc_llm_thread_layout_t* out) {
+    if (!engine || !out) {
+        return -1;
     }
+    const MLCThreadLayout& layout = static_cast<MLCEngineWrapper*>(engine)->threadLayout();
+    *out = mlc_llm_thread_layout_t{};
+    out->compute_threads = layout.compute_threads;
+    out->fast_cores = layout.fast_cores;
+    out->overridden = layout.overridden ? 1 : 0;
+    snprintf(out->compute_cpus, sizeof(out->compute_cpus), "%s", MLCCpuTopology::formatCpuList(layout.compute_cpus).c_str());
+    snprintf(out->bridge_cpus, sizeof(out->bridge_cpus), "%s", MLCCpuTopology::formatCpuList(layout.bridge_cpus).c_str());
+    return 0;
 }
 
 void mlc_llm_destroy_engine(void* engine) {
@@ -1,15 +1,562 @@
 #ifndef MLCBridge_h
 #define MLCBridge_h
 
+#include <stddef.h>
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Status codes returned by the generation entry points
+enum {
+    MLC_LLM_OK = 0,
+    MLC_LLM_ERROR_INVALID = -1,     // bad arguments or engine not initialized
+    MLC_LLM_ERROR_FAILED = -2,      // the engine failed to start the request
+    MLC_LLM_ERROR_OVERLOADED = -3,  // refused by admission control; see mlc_llm_last_admission_status
+    MLC_LLM_ERROR_EXPIRED = -4      // mlc_llm_continue: nothing retained for the session any more
+};
+
 // MLC-LLM C++ Bridge Functions
 void* mlc_llm_create_engine(const char* model_path);
 int mlc_llm_generate(void* engine, const char* prompt, int max_tokens, float temperature, void (*callback)(const char*));
 void mlc_llm_destroy_engine(void* engine);
 
+// Engine creation settings. Initialize with mlc_llm_engine_config_init, which
+// enables 4 concurrent sequences and a 2 ms admission window; other 0 / NULL
+// fields keep the defaults used by mlc_llm_create_engine.
+typedef struct {
+    const char* model_lib;          // default "TinyLlama-1.1B-MLC"
+    int max_num_sequence;           // default 1
+    int max_total_sequence_length;  // default 2048
+    int prefill_chunk_size;         // default 2048
+    // Requests arriving within this many microseconds share one prefill step
+    int admission_window_us;        // default 0 (off)
+    int admission_max_tokens;       // prompt tokens per admission batch, default prefill_chunk_size
+    // The first start records the order weights are read in; later starts
+    // prefetch in that order. The profile lives next to the model unless a
+    // path is given (use one when the model directory is read-only).
+    int disable_startup_prefetch;
+    const char* startup_profile_path;
+    // KV page storage: "float16" (default), "int8" or "float8_e4m3", the latter
+    // two with per-head scales. Quantized pages need a model library compiled
+    // for them, declared by the same "kv_cache_dtype" in mlc-chat-config.json;
+    // engine creation fails otherwise. max_total_sequence_length stays the
+    // float16 memory budget, so a quantized cache holds about twice the tokens
+    // in the same memory; see the kv_cache_* metrics.
+    const char* kv_cache_dtype;
+    // CPU compute thread pool. By default it is sized and pinned to the
+    // fastest physical cores (sysfs cpu_capacity / max frequency) and the
+    // bridge's threads run on the other cores; see mlc_llm_get_thread_layout.
+    int compute_threads;            // default 0 (one per fastest core)
+    const char* compute_cpus;       // e.g. "4-7"; overrides detection
+    // Replies cut off at max_tokens keep their tokens (and, in the prefix
+    // cache, their KV) this long for mlc_llm_continue
+    int continue_retain_ms;         // default 0 (off)
+    int continue_max_sequences;     // default 4
+} mlc_llm_engine_config_t;
+
+void mlc_llm_engine_config_init(mlc_llm_engine_config_t* config);
+void* mlc_llm_create_engine_ex(const char* model_path, const mlc_llm_engine_config_t* config);
+
+// Dart native-port delivery (bind with dart:ffi).
+// Call mlc_llm_dart_initialize once with NativeApi.initializeApiDLData; returns 0 on success.
+// mlc_llm_generate_to_port streams batched chunk messages straight to a ReceivePort's
+// sendPort.nativePort; see MLCDartSink.h for the message layout.
+intptr_t mlc_llm_dart_initialize(void* dart_api_data);
+int mlc_llm_generate_to_port(void* engine, const char* prompt, int max_tokens, float temperature, int64_t port);
+
+// Admission control / load shedding. With `enabled`, a request is refused with
+// MLC_LLM_ERROR_OVERLOADED when it would have to wait for a sequence slot and
+// either `max_queued` requests are already waiting or its estimated wait
+// exceeds `max_wait_ms`. 0 fields use the defaults (4 queued, 3000 ms).
+typedef struct {
+    int enabled;
+    int max_queued;
+    int max_wait_ms;
+} mlc_llm_admission_config_t;
+
+typedef struct {
+    int status;                 // MLC_LLM_OK or an MLC_LLM_ERROR_* code
+    int64_t estimated_wait_ms;  // time until a sequence slot frees up for the request
+    int64_t retry_after_ms;     // set when overloaded
+    int queue_depth;            // requests waiting ahead of it
+} mlc_llm_admission_status_t;
+
+int mlc_llm_set_admission_config(void* engine, const mlc_llm_admission_config_t* config);
+// Admission outcome of the calling thread's most recent mlc_llm_submit (or
+// any entry point built on it)
+int mlc_llm_last_admission_status(mlc_llm_admission_status_t* out);
+int64_t mlc_llm_estimated_wait_ms(void* engine);
+
+// Remote backend: an OpenAI-compatible chat completions API used by requests
+// with `backend` set to MLC_LLM_BACKEND_RACE or MLC_LLM_BACKEND_REMOTE.
+// https:// needs the platform TLS stack (Apple only); http:// works everywhere.
+typedef struct {
+    const char* base_url;        // e.g. "https://api.openai.com/v1"
+    const char* api_key;         // NULL for servers without auth
+    const char* model;
+    int first_token_timeout_ms;  // race deadline for the local first token, default 500
+    int connect_timeout_ms;      // default 5000
+    int read_timeout_ms;         // default 30000
+} mlc_llm_remote_backend_config_t;
+
+// Replaces the remote backend; NULL removes it. Streams running on the
+// previous backend end with an error.
+int mlc_llm_set_remote_backend(void* engine, const mlc_llm_remote_backend_config_t* config);
+
+enum {
+    MLC_LLM_BACKEND_LOCAL = 0,   // on-device engine only
+    MLC_LLM_BACKEND_RACE = 1,    // on-device first, remote if its first token is late
+    MLC_LLM_BACKEND_REMOTE = 2   // remote backend only
+};
+
+// Incremental JSON-path subscriptions over structured output.
+// Paths use dotted keys with indices or wildcards: "title", "items[*]", "items[*].name", "$" (root).
+// Subscribed strings stream MLC_LLM_JSON_STRING_DELTA events as they grow; every subscribed
+// value then produces one MLC_LLM_JSON_VALUE event when it closes. Event pointers are only
+// valid for the duration of the callback.
+enum {
+    MLC_LLM_JSON_STRING_DELTA = 0,
+    MLC_LLM_JSON_VALUE = 1
+};
+
+enum {
+    MLC_LLM_JSON_NULL = 0,
+    MLC_LLM_JSON_BOOL = 1,
+    MLC_LLM_JSON_NUMBER = 2,
+    MLC_LLM_JSON_STRING = 3,
+    MLC_LLM_JSON_ARRAY = 4,
+    MLC_LLM_JSON_OBJECT = 5
+};
+
+typedef struct {
+    int kind;              // MLC_LLM_JSON_STRING_DELTA or MLC_LLM_JSON_VALUE
+    int type;              // MLC_LLM_JSON_* value type
+    int subscription;      // index into mlc_llm_request_t.json_paths
+    const char* path;      // concrete path, e.g. "items[2].name"
+    const char* data;      // decoded text for strings, raw JSON otherwise
+    size_t length;
+} mlc_llm_json_event_t;
+
+typedef void (*mlc_llm_json_callback_t)(void* user_data, const mlc_llm_json_event_t* event);
+
+// Framings for mlc_llm_request_t.output_fd; see MLCFdSink.h for the formats
+enum {
+    MLC_LLM_FRAMING_RAW = 0,
+    MLC_LLM_FRAMING_SSE = 1,
+    MLC_LLM_FRAMING_LENGTH_PREFIXED = 2,
+    MLC_LLM_FRAMING_BINARY = 3           // MLC_LLM_EVENT_* events, as below
+};
+
+// Binary events. Output batches are runs of events that readers access in
+// place (MLCEvents.h, MLCEventReader.swift, mlc_events.dart): no text
+// protocol to parse. Every event starts 8-byte aligned with a 16-byte
+// little-endian header:
+//
+//   0  u32 size      bytes of the event, header and padding included (multiple of 8)
+//   4  u16 type      MLC_LLM_EVENT_*
+//   6  u16 version   MLC_LLM_EVENT_VERSION
+//   8  u32 count
+//  12  u32 aux
+//  16  payload
+//
+//   CHUNK      count = text bytes; payload = UTF-8 text
+//   TOKENS     count = token ids; payload = i32[count], stop tokens excluded
+//   LOGPROBS   count = tokens, aux = alternatives per token (k); payload =
+//              count * (1 + k) entries {f32 logprob, u32 offset, u32 length},
+//              each sampled token followed by its k alternatives, then the
+//              token strings they point at (offsets from the payload start).
+//              Missing alternatives have length 0 and logprob -inf.
+//   USAGE      payload = u32 prompt_tokens, u32 completion_tokens
+//   FINISH     aux = MLC_LLM_FINISH_*; count = reason bytes; payload = reason
+//   ERROR      count = message bytes; payload = message
+//   TOOL_CALL  count = name bytes, aux = argument bytes; payload = name, then
+//              the arguments JSON
+//
+// A request ends with USAGE + FINISH or with ERROR. Readers skip unknown
+// types by size, so newer producers stay readable.
+#define MLC_LLM_EVENT_VERSION 1
+#define MLC_LLM_EVENT_HEADER_SIZE 16
+
+enum {
+    MLC_LLM_EVENT_CHUNK = 1,
+    MLC_LLM_EVENT_TOKENS = 2,
+    MLC_LLM_EVENT_LOGPROBS = 3,
+    MLC_LLM_EVENT_USAGE = 4,
+    MLC_LLM_EVENT_FINISH = 5,
+    MLC_LLM_EVENT_ERROR = 6,
+    MLC_LLM_EVENT_TOOL_CALL = 7
+};
+
+enum {
+    MLC_LLM_FINISH_STOP = 0,
+    MLC_LLM_FINISH_LENGTH = 1,
+    MLC_LLM_FINISH_REPETITION = 2,
+    MLC_LLM_FINISH_CACHE = 3,
+    MLC_LLM_FINISH_OTHER = 255   // see the reason string
+};
+
+// One batch of events per engine step; `data` is only valid during the call
+typedef void (*mlc_llm_event_callback_t)(void* user_data, const uint8_t* data, size_t size);
+
+// Generation request. Always initialize with mlc_llm_request_init so fields added
+// later keep their defaults. Text chunks go to `callback` or, when `dart_port` is
+// non-zero, to that Dart port.
+typedef struct {
+    const char* prompt;
+    int max_tokens;
+    float temperature;
+    void (*callback)(const char*);
+    int64_t dart_port;
+
+    const char* const* json_paths;
+    int num_json_paths;
+    mlc_llm_json_callback_t json_callback;
+    void* json_user_data;
+
+    // Opt-in class for tolerant caches (e.g. "assistant"); NULL opts out
+    const char* request_class;
+
+    // Overrides the chat template's default system message; NULL keeps it
+    const char* system;
+
+    // Pre-tokenized prompt used verbatim instead of `prompt`; no chat template
+    // is applied. Non-zero `validate_token_ids` rejects ids outside the vocabulary.
+    const int32_t* token_ids;
+    int num_token_ids;
+    int validate_token_ids;
+
+    // When >= 0, output is written straight to this caller-owned fd (socket,
+    // pipe or file) instead of `callback`, framed per MLC_LLM_FRAMING_*; the fd
+    // is not closed. `output_zerocopy` uses MSG_ZEROCOPY for large batches on
+    // Linux sockets. A failed write, or output left unwritten for longer than
+    // `output_timeout_ms` (0 = 10 s), aborts the request.
+    int output_fd;
+    int output_framing;
+    int output_zerocopy;
+    int output_timeout_ms;
+
+    // MLC_LLM_BACKEND_*. Raced requests keep whichever backend streams first
+    // and cancel the other; token-id prompts are local only.
+    int backend;
+    int first_token_timeout_ms;  // per-request race deadline, 0 uses the backend config
+
+    // Binary output (MLC_LLM_EVENT_*). With `event_callback` set it replaces
+    // `callback`; non-zero `dart_binary` makes `dart_port` receive
+    // [3, Uint8List events] messages instead of text batches. Token ids are
+    // always included; `top_logprobs` > 0 adds LOGPROBS events.
+    mlc_llm_event_callback_t event_callback;
+    void* event_user_data;
+    int dart_binary;
+    int top_logprobs;
+
+    // Conversation id. mlc_llm_router_submit keeps the turns of one session on
+    // the replica that already caches their history; with continue_retain_ms
+    // set, a reply cut off at max_tokens can be resumed with mlc_llm_continue.
+    const char* session_id;
+} mlc_llm_request_t;
+
+void mlc_llm_request_init(mlc_llm_request_t* req);
+int mlc_llm_submit(void* engine, const mlc_llm_request_t* req);
+
+// Resumes the session's last reply that stopped at max_tokens, generating up
+// to `extra_tokens` more from its retained state: only the final token is
+// prefilled, so the first new token takes about one decode step. `req` gives
+// the session_id, temperature and delivery (callback, dart_port, output_fd);
+// its prompt, system, token_ids and max_tokens are ignored. Returns
+// MLC_LLM_ERROR_EXPIRED once the grace period has passed, in which case the
+// conversation has to be sent again. A continuation that also stops at
+// max_tokens can be continued in turn.
+int mlc_llm_continue(void* engine, const mlc_llm_request_t* req, int extra_tokens);
+
+// Prefix-cache-affinity routing over engine replicas loaded with the same
+// model. Each request goes to the replica expected to hold the longest prefix
+// of its prompt in its prefix cache (or to its session's replica), unless that
+// replica is busier by more than the prefill it would save. Engines must
+// outlive the router. 0 fields use the defaults noted.
+typedef struct {
+    int block_tokens;       // prefix granularity, default 16
+    int load_cost_tokens;   // prompt tokens one extra in-flight request outweighs, default 256
+    int session_ttl_ms;     // idle time before a session is forgotten, default 600000
+    int max_cached_blocks;  // prefix blocks remembered per replica, default 16384
+} mlc_llm_router_config_t;
+
+typedef struct {
+    uint64_t requests;
+    int in_flight;
+    uint64_t prompt_tokens;
+    uint64_t prefix_hit_tokens;  // prefix-hit rate = this / prompt_tokens (router's estimate)
+    uint64_t sticky_routes;      // requests kept on their session's replica
+    uint64_t rebalanced;         // requests sent away from the best-cached replica by load
+} mlc_llm_replica_stats_t;
+
+void* mlc_llm_create_router(void* const* engines, int num_engines, const mlc_llm_router_config_t* config);
+int mlc_llm_router_submit(void* router, const mlc_llm_request_t* req);
+// Fills up to `capacity` entries, one per engine in creation order; returns the replica count
+int mlc_llm_router_stats(void* router, mlc_llm_replica_stats_t* out, int capacity);
+void mlc_llm_destroy_router(void* router);
+
+// Disaggregated prefill and decode. Long prompts are prefilled by
+// `prefill_engine`, whose KV pages are then handed straight to
+// `decode_engine`, which streams the completion. Long prefills so stop
+// stalling the decode batch, and the decode engine can take many more
+// sequences (max_num_sequence) with steady step times. Give the two engines
+// disjoint core sets (compute_cpus). Both must load the same model, with
+// model libraries built with MLC-LLM's KV transfer support; without it every
+// request falls back to a local prefill on the decode engine (see
+// `fallbacks`). Destroy after its requests finish and before the engines.
+typedef struct {
+    int min_prefill_tokens;    // shorter prompts stay on the decode engine, default 128
+    int decode_group_offset;   // decode engine's first rank in the KV transfer group, default 0
+} mlc_llm_disagg_config_t;
+
+typedef struct {
+    uint64_t requests;
+    uint64_t handoffs;              // prefilled remotely
+    uint64_t colocated;             // short prompts, JSON subscriptions, cache classes, non-local backends
+    uint64_t fallbacks;             // decode engine offered no handoff
+    uint64_t failed;
+    uint64_t handoff_tokens;        // prompt tokens whose KV was transferred
+    uint64_t prefix_reused_tokens;  // already cached on the decode engine
+    uint64_t prepare_us;            // total decode-side KV reservation time
+    uint64_t prefill_us;            // total remote prefill + transfer time
+} mlc_llm_disagg_stats_t;
+
+void* mlc_llm_create_disagg(void* prefill_engine, void* decode_engine, const mlc_llm_disagg_config_t* config);
+int mlc_llm_disagg_submit(void* disagg, const mlc_llm_request_t* req);
+int mlc_llm_disagg_stats(void* disagg, mlc_llm_disagg_stats_t* out);
+void mlc_llm_destroy_disagg(void* disagg);
+
+// Blocking, non-streaming generation. Output is copied straight into the
+// caller's `out_buf` (NUL-terminated, at most cap - 1 bytes) with no per-chunk
+// callbacks, and the caller is woken once when the request ends. `*out_len`
+// gets the full output length, so a value >= cap means the text was cut.
+// The request's callback, dart_port and output_fd are ignored. Must not be
+// called from a delivery callback.
+typedef struct {
+    int prompt_tokens;
+    int completion_tokens;
+    char finish_reason[16];   // "stop", "length", "repetition", "cache", ...
+} mlc_llm_usage_t;
+
+int mlc_llm_generate_sync(void* engine, const mlc_llm_request_t* req, char* out_buf, size_t cap, size_t* out_len,
+                          mlc_llm_usage_t* out_usage);
+
+// Token-id input. Ids are used exactly as given, so the prompt is reproducible
+// and skips tokenization entirely.
+int mlc_llm_vocab_size(void* engine);
+int mlc_llm_generate_tokens(void* engine, const int32_t* token_ids, int num_token_ids, int max_tokens, float temperature, void (*callback)(const char*));
+
+typedef struct {
+    const char* token;
+    float logprob;
+} mlc_llm_token_logprob_t;
+
+typedef void (*mlc_llm_logprob_callback_t)(void* user_data, const mlc_llm_token_logprob_t* entries, int count);
+
+// Scores the next token after `token_ids`: reports the `top_logprobs` (1-5) most
+// likely continuations with their log-probabilities. Blocks for one decode step.
+int mlc_llm_score_tokens(void* engine, const int32_t* token_ids, int num_token_ids, int validate_token_ids,
+                         int top_logprobs, mlc_llm_logprob_callback_t callback, void* user_data);
+
+// Local document ingestion for retrieval. Watches `directories` (inotify on
+// Linux, periodic rescans elsewhere), chunks changed files by real token count
+// and keeps a BM25 index over the model's token ids up to date. Runs at
+// background priority and pauses while generation requests are in flight.
+// 0 / NULL fields use the defaults noted.
+typedef struct {
+    const char* const* directories;
+    int num_directories;
+    const char* const* extensions;  // default ".txt", ".md"
+    int num_extensions;
+    int chunk_tokens;               // default 256
+    int chunk_overlap_tokens;       // default 32, for paragraphs longer than a chunk
+    int parser_threads;             // default 2
+    int queue_capacity;             // per-stage backpressure bound, default 64
+    int poll_interval_ms;           // rescan period without inotify, default 2000
+} mlc_llm_ingest_config_t;
+
+typedef struct {
+    const char* path;
+    int chunk_index;
+    const char* text;
+    float score;
+} mlc_llm_ingest_hit_t;
+
+typedef void (*mlc_llm_ingest_hit_callback_t)(void* user_data, const mlc_llm_ingest_hit_t* hits, int count);
+
+// Starting again replaces the running pipeline's configuration; the index is kept
+int mlc_llm_ingest_start(void* engine, const mlc_llm_ingest_config_t* config);
+int mlc_llm_ingest_stop(void* engine);
+// Reports the `top_k` best chunks for `query` before returning
+int mlc_llm_ingest_query(void* engine, const char* query, int top_k, mlc_llm_ingest_hit_callback_t callback, void* user_data);
+
+// Repetition / degenerate-loop detection, applied to every request submitted after the call.
+// A looping request is aborted with finish reason "repetition" unless abort_on_loop is 0,
+// in which case loops are only counted in the metrics.
+typedef struct {
+    int enabled;
+    int ngram_size;       // tokens per hashed n-gram (default 4)
+    int min_repeats;      // full periods required (default 3)
+    int max_period;       // longest loop period in tokens (default 64)
+    int min_loop_tokens;  // repeated tokens required before acting (default 24)
+    int abort_on_loop;
+} mlc_llm_repetition_config_t;
+
+int mlc_llm_set_repetition_config(void* engine, const mlc_llm_repetition_config_t* config);
+
+// Near-duplicate prompt cache. Requests whose request_class is listed here are answered
+// from a previous completion when their normalized prompt is similar enough (SimHash/LSH
+// prefilter, trigram Jaccard verification). Completed "stop" responses populate the cache.
+// When persist_path is set the cache is loaded immediately and saved on engine destruction.
+typedef struct {
+    const char* const* request_classes;
+    int num_request_classes;
+    float min_similarity;        // Jaccard threshold in (0, 1], default 0.8
+    int max_hamming_distance;    // SimHash prefilter, default 3, at most 15
+    int capacity;                // maximum entries, default 1024
+    const char* persist_path;
+} mlc_llm_similarity_cache_config_t;
+
+int mlc_llm_configure_similarity_cache(void* engine, const mlc_llm_similarity_cache_config_t* config);
+// Saves the cache to `path`, or to the configured persist_path when NULL
+int mlc_llm_similarity_cache_save(void* engine, const char* path);
+
+// Idle-time prewarming. Request frequency is tracked in a count-min sketch;
+// once the engine has been idle for idle_ms, the hottest system prompts are
+// prefilled into the engine's prefix cache (up to max_prefix_tokens of KV in
+// total) and, for request classes the similarity cache accepts, the hottest
+// prompts get their greedy completion cached. One warm-up runs at a time and
+// is cancelled as soon as a caller request arrives. When persist_path is set
+// the hot items are loaded now and saved when prewarming is reconfigured or
+// the engine is destroyed. enabled = 0 stops prewarming.
+typedef struct {
+    int enabled;
+    int top_k;                   // hot items tracked, default 16
+    int min_count;               // requests before an item is warmed, default 3
+    int idle_ms;                 // default 2000
+    int max_prefix_tokens;       // default 8192
+    int completion_max_tokens;   // default 256
+    const char* persist_path;
+} mlc_llm_prewarm_config_t;
+
+int mlc_llm_configure_prewarm(void* engine, const mlc_llm_prewarm_config_t* config);
+
+typedef struct {
+    // Caller requests only; warm-ups and KV handoff steps are not counted here
+    uint64_t requests_submitted;
+    uint64_t requests_completed;
+    uint64_t requests_failed;
+    uint64_t requests_rejected;        // refused by admission control
+    uint64_t chunks_delivered;
+    uint64_t repetition_detections;
+    uint64_t repetition_aborts;
+    uint64_t repetition_tokens_saved;  // max_tokens minus tokens generated, summed over aborts
+    uint64_t similarity_cache_hits;
+    uint64_t similarity_cache_misses;
+    uint64_t similarity_cache_inserts;
+    uint64_t prompt_tokens_cached;     // prompt tokens taken from pre-tokenized template fragments
+    uint64_t prompt_tokens_encoded;    // prompt tokens produced by tokenizing request text
+    uint64_t prompt_tokens_direct;     // prompt tokens supplied as token ids
+    uint64_t admission_batches;           // bursts handed to the engine together
+    uint64_t admission_batched_requests;  // requests across those bursts
+    uint64_t ingest_files_indexed;
+    uint64_t ingest_files_unchanged;      // re-read but identical, not re-tokenized
+    uint64_t ingest_files_removed;
+    uint64_t ingest_chunks_indexed;
+    uint64_t ingest_tokens_indexed;
+    uint64_t length_predictions_scored;   // completed requests that had a length prediction
+    uint64_t length_underpredictions;     // ... that outgrew their KV reservation (misprediction rate = this / scored)
+    uint64_t length_abs_error_tokens;     // sum of |actual - predicted| completion tokens
+    uint64_t kv_cache_bytes_per_token;
+    uint64_t kv_cache_capacity_tokens;    // engine max_total_sequence_length
+    uint64_t kv_cache_bytes_saved;        // vs. float16 pages holding the same tokens
+    uint64_t decode_tokens;               // tokens after each request's first
+    uint64_t decode_time_us;              // ... and the time spent producing them (per-sequence decode rate)
+    uint64_t requests_in_flight;          // gauge
+    uint64_t kv_tokens_in_use;            // gauge: prompt + generated tokens of in-flight requests
+    uint64_t completion_tokens_generated;
+    uint64_t ttft_samples;
+    uint64_t ttft_total_us;               // mean time to first token = this / ttft_samples
+    uint64_t prewarm_prefixes;            // system prefixes warmed into the engine's prefix cache while idle
+    uint64_t prewarm_prefix_tokens;       // ... and the KV tokens they filled
+    uint64_t prewarm_completions;         // completions warmed into the similarity cache
+    uint64_t prewarm_preemptions;         // warm-ups cancelled for a caller request
+    uint64_t continuations;               // mlc_llm_continue calls resumed from retained state
+    uint64_t continuation_misses;         // ... that found nothing retained
+    uint64_t race_fallback_starts;        // raced requests that started the remote backend
+    uint64_t race_fallback_wins;          // ... and were answered by it
+} mlc_llm_metrics_t;
+
+int mlc_llm_get_metrics(void* engine, mlc_llm_metrics_t* out);
+
+// Shared-memory telemetry. While started, the engine republishes its metrics,
+// load gauges and latency histograms every `interval_ms` (default 250) into a
+// named segment that other processes can map read-only, so monitors need no
+// cooperation from the host app. `name` is a POSIX shm name ("/mlc_llm",
+// at most 31 bytes on Apple platforms) or, when it contains a second '/', a
+// file path to map instead (e.g. inside an iOS app container). The page is
+// seqlock protected: readers copy it while `sequence` is even and unchanged
+// (see tools/mlc_top.cpp).
+#define MLC_LLM_TELEMETRY_MAGIC 0x54434c4du   // "MLCT" in memory order
+#define MLC_LLM_TELEMETRY_VERSION 3
+#define MLC_LLM_TELEMETRY_BUCKETS 32            // bucket i: [2^i, 2^(i+1)) microseconds
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t page_size;          // sizeof(mlc_llm_telemetry_page_t) of the writer
+    uint32_t pid;
+    uint64_t sequence;           // odd while a snapshot is being written
+    uint64_t published_unix_us;
+    uint64_t interval_us;
+    mlc_llm_metrics_t metrics;
+    // Load at publication
+    int64_t queue_depth;         // admitted requests waiting for a slot or KV room
+    int64_t estimated_wait_ms;   // for a new average request
+    int64_t kv_capacity_tokens;
+    int64_t kv_reserved_tokens;  // admission control's reservations
+    double tokens_per_second;    // completion tokens over the last interval
+    uint64_t ttft_us[MLC_LLM_TELEMETRY_BUCKETS];
+    uint64_t inter_token_us[MLC_LLM_TELEMETRY_BUCKETS];
+} mlc_llm_telemetry_page_t;
+
+int mlc_llm_telemetry_start(void* engine, const char* name, int interval_ms);
+// Unmaps and removes the segment
+int mlc_llm_telemetry_stop(void* engine);
+
+// Flight recorder. The bridge always keeps the last 1024 events of every
+// thread (requests, chunks, admission decisions, reloads, errors) in
+// per-thread ring buffers at nanosecond resolution; recording costs a clock
+// read and is skipped entirely while idle. Configuring a dump path makes the
+// rings land there when an engine with requests in flight makes no progress
+// for `stall_timeout_ms`, and, with `install_signal_handlers`, on SIGSEGV,
+// SIGBUS, SIGILL, SIGFPE and SIGABRT (previous handlers still run).
+// Decode dumps with tools/mlc_flight_decode.cpp. Process-wide.
+typedef struct {
+    const char* dump_path;        // NULL disables automatic dumps
+    int stall_timeout_ms;         // default 10000, < 0 disables the watchdog
+    int install_signal_handlers;
+} mlc_llm_flight_recorder_config_t;
+
+int mlc_llm_flight_recorder_configure(const mlc_llm_flight_recorder_config_t* config);
+// Writes the rings now; NULL uses the configured dump path
+int mlc_llm_flight_recorder_dump(const char* path);
+
+// Compute thread pool layout chosen at engine creation. compute_threads is 0
+// when the runtime default was kept (no sysfs, e.g. on Apple platforms);
+// empty CPU lists mean unpinned.
+typedef struct {
+    int compute_threads;
+    int fast_cores;           // physical cores of the fastest core type
+    int overridden;           // set from compute_threads / compute_cpus
+    char compute_cpus[128];   // kernel CPU list syntax, e.g. "4-7"
+    char bridge_cpus[128];
+} mlc_llm_thread_layout_t;
+
+int mlc_llm_get_thread_layout(void* engine, mlc_llm_thread_layout_t* out);
+
 #ifdef __cplusplus
 }
 #endif
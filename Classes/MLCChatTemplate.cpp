@@ -0,0 +1,229 @@
+#include "MLCChatTemplate.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+
+const char* const kSystemPlaceholder = "{system_message}";
+const char* const kFunctionPlaceholder = "{function_string}";
+
+void splitAt(const std::string& text, const std::string& placeholder, std::string* before, std::string* after) {
+    size_t pos = text.find(placeholder);
+    if (pos == std::string::npos) {
+        *before = text;
+        after->clear();
+        return;
+    }
+    *before = text.substr(0, pos);
+    *after = text.substr(pos + placeholder.size());
+}
+
+std::string removeAll(std::string text, const std::string& needle) {
+    size_t pos;
+    while ((pos = text.find(needle)) != std::string::npos) {
+        text.erase(pos, needle.size());
+    }
+    return text;
+}
+
+bool endsWith(const std::string& text, const std::string& suffix) {
+    return !suffix.empty() && text.size() >= suffix.size() &&
+           text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // namespace
+
+MLCChatTemplate::MLCChatTemplate(Encoder encoder) : encoder_(std::move(encoder)) {}
+
+bool MLCChatTemplate::load(const MLCJsonValue& chat_config, std::string* error) {
+    const MLCJsonValue* conv = chat_config.get("conv_template");
+    if (!conv || !conv->isObject()) {
+        if (error) *error = "mlc-chat-config.json has no conv_template object";
+        return false;
+    }
+
+    auto readString = [conv](const char* key) {
+        const MLCJsonValue* value = conv->get(key);
+        return value ? value->asString() : std::string();
+    };
+
+    name_ = readString("name");
+    system_template_ = readString("system_template");
+    system_message_ = readString("system_message");
+    role_content_sep_ = readString("role_content_sep");
+    role_empty_sep_ = readString("role_empty_sep");
+    if (const MLCJsonValue* value = conv->get("add_role_after_system_message")) {
+        add_role_after_system_message_ = value->asBool(true);
+    }
+
+    if (const MLCJsonValue* roles = conv->get("roles")) {
+        for (const auto& role : roles->object) roles_[role.first] = role.second.asString();
+    }
+    if (!roles_.count("user") || !roles_.count("assistant")) {
+        if (error) *error = "conv_template must define user and assistant roles";
+        return false;
+    }
+    if (const MLCJsonValue* templates = conv->get("role_templates")) {
+        for (const auto& role : templates->object) role_templates_[role.first] = role.second.asString();
+    }
+    if (const MLCJsonValue* seps = conv->get("seps")) {
+        for (const MLCJsonValue& sep : seps->array) seps_.push_back(sep.asString());
+    }
+    if (seps_.empty()) seps_.push_back("");
+    if (seps_.size() == 1) seps_.push_back(seps_[0]);
+
+    if (const MLCJsonValue* stops = conv->get("stop_str")) {
+        for (const MLCJsonValue& stop : stops->array) {
+            if (!stop.asString().empty()) stop_strings_.push_back(stop.asString());
+        }
+    }
+    if (const MLCJsonValue* ids = conv->get("stop_token_ids")) {
+        for (const MLCJsonValue& id : ids->array) stop_token_ids_.push_back(id.asInt());
+    }
+    if (const MLCJsonValue* ids = conv->get("system_prefix_token_ids")) {
+        for (const MLCJsonValue& id : ids->array) system_prefix_token_ids_.push_back(id.asInt());
+    }
+    return true;
+}
+
+size_t MLCChatTemplate::cachedFragmentCount() const {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    return fragment_cache_.size();
+}
+
+void MLCChatTemplate::appendPiece(const std::string& text, bool is_static, std::vector<Piece>* pieces) const {
+    std::string cleaned = is_static ? removeAll(text, kFunctionPlaceholder) : text;
+    if (cleaned.empty()) return;
+    if (is_static && !pieces->empty() && pieces->back().is_static) {
+        pieces->back().text += cleaned;
+        return;
+    }
+    pieces->push_back(Piece{std::move(cleaned), is_static});
+}
+
+std::vector<MLCChatTemplate::Piece> MLCChatTemplate::buildPieces(
+    const std::string* system, const std::vector<MLCChatMessage>& messages, bool system_only) const {
+    std::vector<Piece> pieces;
+
+    const std::string& system_text = system ? *system : system_message_;
+    std::string system_before, system_after;
+    splitAt(system_template_, kSystemPlaceholder, &system_before, &system_after);
+    bool has_system = !(system_before.empty() && system_text.empty() && system_after.empty());
+    if (has_system) {
+        appendPiece(system_before, true, &pieces);
+        // The default system message is part of the template and can be cached
+        appendPiece(system_text, !system || *system == system_message_, &pieces);
+        appendPiece(system_after, true, &pieces);
+    }
+    if (system_only) return pieces;
+
+    for (size_t i = 0; i < messages.size(); ++i) {
+        const MLCChatMessage& message = messages[i];
+        auto role = roles_.find(message.role);
+        if (role == roles_.end()) {
+            throw std::invalid_argument("Role \"" + message.role + "\" is not supported by conv template " + name_);
+        }
+
+        std::string role_prefix;
+        if (add_role_after_system_message_ || !has_system || i != 0) {
+            role_prefix = role->second + role_content_sep_;
+        }
+
+        std::string placeholder = "{" + message.role + "_message}";
+        auto role_template = role_templates_.find(message.role);
+        std::string content_before, content_after;
+        splitAt(role_template != role_templates_.end() ? role_template->second : placeholder,
+                placeholder, &content_before, &content_after);
+
+        const std::string& separator = seps_[message.role == "assistant" ? 1 : 0];
+        appendPiece(role_prefix + content_before, true, &pieces);
+        appendPiece(message.content, false, &pieces);
+        appendPiece(content_after + separator, true, &pieces);
+    }
+
+    appendPiece(roles_.at("assistant") + role_empty_sep_, true, &pieces);
+    return pieces;
+}
+
+std::string MLCChatTemplate::anchorFor(const std::string& previous) const {
+    if (previous.empty()) return "";
+    // Special strings are tokenized atomically, so they make exact anchors
+    for (const std::string& sep : seps_) {
+        if (endsWith(previous, sep)) return sep;
+    }
+    for (const std::string& stop : stop_strings_) {
+        if (endsWith(previous, stop)) return stop;
+    }
+    // Otherwise the last UTF-8 character
+    size_t start = previous.size() - 1;
+    while (start > 0 && (static_cast<unsigned char>(previous[start]) & 0xC0) == 0x80) --start;
+    return previous.substr(start);
+}
+
+std::vector<int32_t> MLCChatTemplate::encodeAnchored(const std::string& anchor, const std::string& text) {
+    if (anchor.empty()) return encoder_(text);
+
+    std::vector<int32_t> anchor_ids;
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        auto it = fragment_cache_.find(std::string(1, '\0') + anchor);
+        if (it != fragment_cache_.end()) anchor_ids = it->second;
+    }
+    if (anchor_ids.empty()) {
+        anchor_ids = encoder_(anchor);
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        fragment_cache_[std::string(1, '\0') + anchor] = anchor_ids;
+    }
+
+    std::vector<int32_t> combined = encoder_(anchor + text);
+    if (combined.size() >= anchor_ids.size() &&
+        std::equal(anchor_ids.begin(), anchor_ids.end(), combined.begin())) {
+        return std::vector<int32_t>(combined.begin() + static_cast<std::ptrdiff_t>(anchor_ids.size()), combined.end());
+    }
+    // The anchor merged with the text; fall back to encoding the text alone
+    return encoder_(text);
+}
+
+std::vector<int32_t> MLCChatTemplate::encodePieces(const std::vector<Piece>& pieces, Stats* stats) {
+    std::vector<int32_t> token_ids = system_prefix_token_ids_;
+    if (stats) stats->cached_tokens += system_prefix_token_ids_.size();
+
+    std::string previous;
+    for (const Piece& piece : pieces) {
+        std::string anchor = anchorFor(previous);
+        std::vector<int32_t> ids;
+        if (piece.is_static) {
+            std::string key = anchor + '\0' + piece.text;
+            bool cached = false;
+            {
+                std::lock_guard<std::mutex> lock(cache_mutex_);
+                auto it = fragment_cache_.find(key);
+                if (it != fragment_cache_.end()) {
+                    ids = it->second;
+                    cached = true;
+                }
+            }
+            if (!cached) {
+                ids = encodeAnchored(anchor, piece.text);
+                std::lock_guard<std::mutex> lock(cache_mutex_);
+                fragment_cache_[key] = ids;
+            }
+            if (stats) (cached ? stats->cached_tokens : stats->encoded_tokens) += ids.size();
+        } else {
+            ids = encodeAnchored(anchor, piece.text);
+            if (stats) stats->encoded_tokens += ids.size();
+        }
+        token_ids.insert(token_ids.end(), ids.begin(), ids.end());
+        previous = piece.text;
+    }
+    return token_ids;
+}
+
+std::vector<int32_t> MLCChatTemplate::encodePrompt(const std::string* system,
+                                                   const std::vector<MLCChatMessage>& messages, Stats* stats) {
+    return encodePieces(buildPieces(system, messages, false), stats);
+}
+
+std::vector<int32_t> MLCChatTemplate::encodeSystemPrefix(const std::string* system) {
+    return encodePieces(buildPieces(system, {}, true), nullptr);
+}
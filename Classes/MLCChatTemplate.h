@@ -0,0 +1,88 @@
+#ifndef MLCChatTemplate_h
+#define MLCChatTemplate_h
+
+#include "MLCJson.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct MLCChatMessage {
+    std::string role;     // "system", "user" or "assistant"
+    std::string content;
+};
+
+// Native version of MLC-LLM's conversation template (conv_template in
+// mlc-chat-config.json) that assembles prompts directly as token ids.
+//
+// The template is split into static fragments (role markers, separators, the
+// system template around {system_message}, the default system message) and
+// dynamic text (message contents). Static fragments are tokenized once and
+// cached; only dynamic text is tokenized per request. Each piece is encoded
+// together with a short anchor taken from the end of the preceding piece and
+// the anchor's tokens are stripped again, so boundary behaviour such as the
+// SentencePiece leading-space rule matches tokenizing the whole prompt.
+class MLCChatTemplate {
+public:
+    using Encoder = std::function<std::vector<int32_t>(const std::string&)>;
+
+    struct Stats {
+        uint64_t cached_tokens = 0;    // tokens served from the fragment cache
+        uint64_t encoded_tokens = 0;   // tokens produced by tokenizing dynamic text
+    };
+
+    explicit MLCChatTemplate(Encoder encoder);
+
+    // Reads conv_template from a parsed mlc-chat-config.json
+    bool load(const MLCJsonValue& chat_config, std::string* error);
+
+    // Token ids for `messages` followed by the assistant generation prefix.
+    // `system` overrides the template's default system message when non-null.
+    std::vector<int32_t> encodePrompt(const std::string* system, const std::vector<MLCChatMessage>& messages,
+                                      Stats* stats = nullptr);
+
+    // Token ids of everything before the first user message (system block),
+    // which is identical across requests sharing a system prompt
+    std::vector<int32_t> encodeSystemPrefix(const std::string* system);
+
+    const std::string& name() const { return name_; }
+    const std::vector<int32_t>& stopTokenIds() const { return stop_token_ids_; }
+    const std::vector<std::string>& stopStrings() const { return stop_strings_; }
+    size_t cachedFragmentCount() const;
+
+private:
+    struct Piece {
+        std::string text;
+        bool is_static;
+    };
+
+    void appendPiece(const std::string& text, bool is_static, std::vector<Piece>* pieces) const;
+    std::vector<Piece> buildPieces(const std::string* system, const std::vector<MLCChatMessage>& messages,
+                                   bool system_only) const;
+    std::vector<int32_t> encodePieces(const std::vector<Piece>& pieces, Stats* stats);
+    std::vector<int32_t> encodeAnchored(const std::string& anchor, const std::string& text);
+    std::string anchorFor(const std::string& previous) const;
+
+    Encoder encoder_;
+
+    std::string name_;
+    std::string system_template_;
+    std::string system_message_;
+    std::vector<int32_t> system_prefix_token_ids_;
+    bool add_role_after_system_message_ = true;
+    std::unordered_map<std::string, std::string> roles_;
+    std::unordered_map<std::string, std::string> role_templates_;
+    std::vector<std::string> seps_;
+    std::string role_content_sep_;
+    std::string role_empty_sep_;
+    std::vector<std::string> stop_strings_;
+    std::vector<int32_t> stop_token_ids_;
+
+    mutable std::mutex cache_mutex_;
+    std::unordered_map<std::string, std::vector<int32_t>> fragment_cache_;  // anchor + '\0' + text
+};
+
+#endif /* MLCChatTemplate_h */
@@ -0,0 +1,221 @@
+#include "MLCCpuTopology.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+// Cores at least this fast relative to the fastest share its class. The pool
+// splits work evenly, so a core much slower than the rest holds every step up.
+const int64_t kFastCorePercent = 80;
+// With only one core type, the pool gives up a core to the bridge threads
+// once it has this many
+const size_t kReserveBridgeCoreAbove = 4;
+
+bool readLine(const std::string& path, std::string* line) {
+    std::ifstream file(path);
+    return static_cast<bool>(std::getline(file, *line));
+}
+
+int64_t readNumber(const std::string& path) {
+    std::string line;
+    if (!readLine(path, &line)) return 0;
+    return std::strtoll(line.c_str(), nullptr, 10);
+}
+
+// bridge_cpus of every engine that pinned its compute pool
+std::mutex g_bridge_cpus_mutex;
+std::vector<std::vector<int>>& engineBridgeCpus() {
+    // Leaked: detached bridge threads may start during static destruction
+    static auto* sets = new std::vector<std::vector<int>>();
+    return *sets;
+}
+
+} // namespace
+
+bool MLCCpuTopology::parseCpuList(const std::string& text, std::vector<int>* cpus) {
+    cpus->clear();
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t end = text.find(',', pos);
+        if (end == std::string::npos) end = text.size();
+        std::string range = text.substr(pos, end - pos);
+        pos = end + 1;
+        range.erase(std::remove_if(range.begin(), range.end(), ::isspace), range.end());
+        if (range.empty()) continue;
+
+        char* rest = nullptr;
+        long first = std::strtol(range.c_str(), &rest, 10);
+        long last = first;
+        if (*rest == '-') last = std::strtol(rest + 1, &rest, 10);
+        if (*rest != '\0' || first < 0 || last < first || last > 4095) return false;
+        for (long cpu = first; cpu <= last; ++cpu) cpus->push_back(static_cast<int>(cpu));
+    }
+    std::sort(cpus->begin(), cpus->end());
+    cpus->erase(std::unique(cpus->begin(), cpus->end()), cpus->end());
+    return !cpus->empty();
+}
+
+std::string MLCCpuTopology::formatCpuList(const std::vector<int>& cpus) {
+    std::vector<int> sorted = cpus;
+    std::sort(sorted.begin(), sorted.end());
+    std::string text;
+    for (size_t i = 0; i < sorted.size();) {
+        size_t j = i;
+        while (j + 1 < sorted.size() && sorted[j + 1] == sorted[j] + 1) ++j;
+        if (!text.empty()) text += ',';
+        text += std::to_string(sorted[i]);
+        if (j > i) text += '-' + std::to_string(sorted[j]);
+        i = j + 1;
+    }
+    return text;
+}
+
+MLCCpuTopology MLCCpuTopology::detect(const std::string& sysfs_root) {
+    MLCCpuTopology topology;
+    std::string online;
+    std::vector<int> cpus;
+    if (!readLine(sysfs_root + "/online", &online) || !parseCpuList(online, &cpus)) return topology;
+
+    for (int cpu : cpus) {
+        std::string dir = sysfs_root + "/cpu" + std::to_string(cpu);
+        MLCCpuCore core;
+        core.cpu = cpu;
+        core.physical = cpu;
+        std::string siblings_text;
+        std::vector<int> siblings;
+        if (readLine(dir + "/topology/thread_siblings_list", &siblings_text) && parseCpuList(siblings_text, &siblings)) {
+            core.physical = siblings.front();
+        }
+        core.capacity = static_cast<int>(readNumber(dir + "/cpu_capacity"));
+        core.max_freq_khz = readNumber(dir + "/cpufreq/cpuinfo_max_freq");
+        topology.cores.push_back(core);
+    }
+    return topology;
+}
+
+int64_t MLCCpuTopology::rank(const MLCCpuCore& core) const {
+    // Capacity already folds in microarchitecture, so it wins when any core has it
+    bool have_capacity = std::any_of(cores.begin(), cores.end(), [](const MLCCpuCore& c) { return c.capacity > 0; });
+    return have_capacity ? core.capacity : core.max_freq_khz;
+}
+
+MLCThreadLayout MLCCpuTopology::plan(int threads, const std::string& cpus) const {
+    MLCThreadLayout layout;
+    layout.overridden = threads > 0 || !cpus.empty();
+
+    // One entry per physical core, fastest first
+    std::vector<MLCCpuCore> physical;
+    for (const MLCCpuCore& core : cores) {
+        if (core.cpu == core.physical) physical.push_back(core);
+    }
+    std::stable_sort(physical.begin(), physical.end(),
+                     [this](const MLCCpuCore& a, const MLCCpuCore& b) { return rank(a) > rank(b); });
+    int64_t fastest = physical.empty() ? 0 : rank(physical.front());
+    for (const MLCCpuCore& core : physical) {
+        if (rank(core) * 100 >= fastest * kFastCorePercent) layout.fast_cores++;
+    }
+
+    if (!cpus.empty() && parseCpuList(cpus, &layout.compute_cpus)) {
+        if (threads > 0 && static_cast<size_t>(threads) < layout.compute_cpus.size()) {
+            layout.compute_cpus.resize(threads);
+        }
+    } else if (threads > 0) {
+        // More threads than physical cores is taken as asked, just unpinned
+        if (static_cast<size_t>(threads) <= physical.size()) {
+            for (int i = 0; i < threads; ++i) layout.compute_cpus.push_back(physical[i].cpu);
+        }
+        layout.compute_threads = threads;
+    } else {
+        size_t count = layout.fast_cores;
+        if (count == physical.size() && count >= kReserveBridgeCoreAbove) count--;
+        for (size_t i = 0; i < count; ++i) layout.compute_cpus.push_back(physical[i].cpu);
+    }
+    if (!layout.compute_cpus.empty()) layout.compute_threads = static_cast<int>(layout.compute_cpus.size());
+
+    // Bridge threads get every core the pool does not, SMT siblings included
+    std::unordered_map<int, int> physical_of;
+    for (const MLCCpuCore& core : cores) physical_of[core.cpu] = core.physical;
+    std::set<int> compute_physical;
+    for (int cpu : layout.compute_cpus) {
+        auto found = physical_of.find(cpu);
+        compute_physical.insert(found != physical_of.end() ? found->second : cpu);
+    }
+    if (!compute_physical.empty()) {
+        for (const MLCCpuCore& core : cores) {
+            if (!compute_physical.count(core.physical)) layout.bridge_cpus.push_back(core.cpu);
+        }
+    }
+    return layout;
+}
+
+bool MLCCpuTopology::pinCurrentThread(const std::vector<int>& cpus) {
+#if defined(__linux__)
+    if (cpus.empty()) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    // Apple platforms only take QoS hints, not core placement
+    (void)cpus;
+    return false;
+#endif
+}
+
+void MLCCpuTopology::addBridgeCpus(const std::vector<int>& cpus) {
+    if (cpus.empty()) return;
+    std::lock_guard<std::mutex> lock(g_bridge_cpus_mutex);
+    engineBridgeCpus().push_back(cpus);
+}
+
+void MLCCpuTopology::removeBridgeCpus(const std::vector<int>& cpus) {
+    if (cpus.empty()) return;
+    std::lock_guard<std::mutex> lock(g_bridge_cpus_mutex);
+    std::vector<std::vector<int>>& sets = engineBridgeCpus();
+    auto it = std::find(sets.begin(), sets.end(), cpus);
+    if (it != sets.end()) sets.erase(it);
+}
+
+std::vector<int> MLCCpuTopology::bridgeCpus() {
+    std::lock_guard<std::mutex> lock(g_bridge_cpus_mutex);
+    const std::vector<std::vector<int>>& sets = engineBridgeCpus();
+    if (sets.empty()) return {};
+    std::set<int> common(sets[0].begin(), sets[0].end());
+    for (size_t i = 1; i < sets.size(); ++i) {
+        std::set<int> next;
+        for (int cpu : sets[i]) {
+            if (common.count(cpu)) next.insert(cpu);
+        }
+        common.swap(next);
+    }
+    return std::vector<int>(common.begin(), common.end());
+}
+
+std::thread MLCCpuTopology::startBridgeThread(std::function<void()> body) {
+    std::vector<int> cpus = bridgeCpus();
+    return std::thread([cpus, body]() {
+        if (!cpus.empty()) pinCurrentThread(cpus);
+        body();
+    });
+}
+
+std::string MLCThreadLayout::describe() const {
+    if (compute_threads == 0) return "runtime default";
+    std::string text = std::to_string(compute_threads) + " compute threads";
+    text += compute_cpus.empty() ? " (unpinned)" : " on CPUs " + MLCCpuTopology::formatCpuList(compute_cpus);
+    if (!bridge_cpus.empty()) text += ", bridge threads on CPUs " + MLCCpuTopology::formatCpuList(bridge_cpus);
+    if (overridden) text += " (configured)";
+    return text;
+}
@@ -0,0 +1,66 @@
+#ifndef MLCCpuTopology_h
+#define MLCCpuTopology_h
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One online logical CPU as described by sysfs
+struct MLCCpuCore {
+    int cpu = 0;
+    int physical = 0;         // lowest logical CPU sharing this core (SMT siblings)
+    int capacity = 0;         // cpu_capacity, 0 when the kernel does not export it
+    int64_t max_freq_khz = 0; // cpufreq/cpuinfo_max_freq, 0 when unknown
+};
+
+// Where the compute thread pool and the bridge's own threads run
+struct MLCThreadLayout {
+    int compute_threads = 0;        // 0 leaves the runtime's default pool
+    std::vector<int> compute_cpus;  // one CPU per compute thread
+    std::vector<int> bridge_cpus;   // empty leaves bridge threads unpinned
+    int fast_cores = 0;             // physical cores in the fastest class
+    bool overridden = false;
+
+    std::string describe() const;
+};
+
+// Core types of a heterogeneous CPU (big.LITTLE, P/E cores), read from
+// /sys/devices/system/cpu. Cores are ranked by cpu_capacity where the kernel
+// exports it and by maximum frequency otherwise.
+struct MLCCpuTopology {
+    std::vector<MLCCpuCore> cores;
+
+    // Empty when sysfs is unavailable (Apple platforms, sandboxes)
+    static MLCCpuTopology detect(const std::string& sysfs_root = "/sys/devices/system/cpu");
+
+    // Parses the kernel's CPU list syntax, e.g. "0-3,6"
+    static bool parseCpuList(const std::string& text, std::vector<int>* cpus);
+    static std::string formatCpuList(const std::vector<int>& cpus);
+
+    int64_t rank(const MLCCpuCore& core) const;
+
+    // Sizes the pool to the fastest physical cores, one thread each, and puts
+    // bridge threads on the remaining cores. `threads` > 0 or a non-empty
+    // `cpus` list overrides the automatic choice.
+    MLCThreadLayout plan(int threads, const std::string& cpus) const;
+
+    // Restricts the calling thread to `cpus`; false where unsupported
+    static bool pinCurrentThread(const std::vector<int>& cpus);
+
+    // Process-wide placement of the bridge's own threads. Every engine with a
+    // pinned compute pool adds its layout's bridge_cpus; bridge threads then
+    // run on the CPUs that all of those engines leave free (unpinned when
+    // there are none).
+    static void addBridgeCpus(const std::vector<int>& cpus);
+    static void removeBridgeCpus(const std::vector<int>& cpus);
+    static std::vector<int> bridgeCpus();
+
+    // Starts one of the bridge's threads (stream-back, admission, workers,
+    // watchers, timers) on bridgeCpus(), off the engines' compute cores. Every
+    // thread the bridge creates goes through here.
+    static std::thread startBridgeThread(std::function<void()> body);
+};
+
+#endif /* MLCCpuTopology_h */
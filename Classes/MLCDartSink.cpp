@@ -0,0 +1,207 @@
+#include "MLCDartSink.h"
+#include "dart_api_dl.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+namespace {
+
+std::atomic<bool> g_dart_api_initialized{false};
+
+void freeExternalBuffer(void* /*isolate_callback_data*/, void* peer) {
+    std::free(peer);
+}
+
+} // namespace
+
+MLCDartPortSink::MLCDartPortSink(int64_t port, bool binary, size_t max_batch_bytes)
+    : port_(port),
+      binary_(binary),
+      max_batch_bytes_(max_batch_bytes),
+      pending_data_(nullptr),
+      pending_size_(0),
+      pending_capacity_(0) {}
+
+MLCDartPortSink::~MLCDartPortSink() {
+    std::free(pending_data_);
+}
+
+intptr_t MLCDartPortSink::initializeApi(void* dart_api_data) {
+    intptr_t result = Dart_InitializeApiDL(dart_api_data);
+    g_dart_api_initialized.store(result == 0, std::memory_order_release);
+    if (result != 0) {
+        std::cerr << "❌ Dart DL API initialization failed: " << result << std::endl;
+    }
+    return result;
+}
+
+bool MLCDartPortSink::isApiInitialized() {
+    return g_dart_api_initialized.load(std::memory_order_acquire);
+}
+
+bool MLCDartPortSink::post(void* message) {
+    if (!isApiInitialized() || port_ == ILLEGAL_PORT) return false;
+    return Dart_PostCObject_DL(port_, static_cast<Dart_CObject*>(message));
+}
+
+void MLCDartPortSink::append(const std::string& text) {
+    if (pending_size_ + text.size() > pending_capacity_) {
+        size_t capacity = pending_capacity_ ? pending_capacity_ * 2 : 256;
+        while (capacity < pending_size_ + text.size()) capacity *= 2;
+        auto* grown = static_cast<uint8_t*>(std::realloc(pending_data_, capacity));
+        if (!grown) throw std::bad_alloc();
+        pending_data_ = grown;
+        pending_capacity_ = capacity;
+    }
+    std::memcpy(pending_data_ + pending_size_, text.data(), text.size());
+    pending_size_ += text.size();
+}
+
+void MLCDartPortSink::onChunk(const std::string& text) {
+    if (text.empty()) return;
+    if (binary_) {
+        events_.chunk(text);
+        if (events_.size() >= max_batch_bytes_) flush();
+        return;
+    }
+    append(text);
+    pending_ends_.push_back(static_cast<int32_t>(pending_size_));
+    if (pending_size_ >= max_batch_bytes_) flush();
+}
+
+void MLCDartPortSink::onTokens(const std::vector<int32_t>& token_ids) {
+    if (binary_) events_.tokens(token_ids);
+}
+
+void MLCDartPortSink::onLogprobs(const std::vector<std::string>& logprob_json) {
+    if (binary_) events_.logprobs(logprob_json);
+}
+
+void MLCDartPortSink::postEvents() {
+    if (events_.empty()) return;
+    size_t size = 0;
+    uint8_t* data = events_.release(&size);
+
+    Dart_CObject kind;
+    kind.type = Dart_CObject_kInt32;
+    kind.value.as_int32 = kMessageEvents;
+
+    Dart_CObject bytes;
+    bytes.type = Dart_CObject_kExternalTypedData;
+    bytes.value.as_external_typed_data.type = Dart_TypedData_kUint8;
+    bytes.value.as_external_typed_data.length = static_cast<intptr_t>(size);
+    bytes.value.as_external_typed_data.data = data;
+    bytes.value.as_external_typed_data.peer = data;
+    bytes.value.as_external_typed_data.callback = freeExternalBuffer;
+
+    Dart_CObject* values[] = {&kind, &bytes};
+    Dart_CObject message;
+    message.type = Dart_CObject_kArray;
+    message.value.as_array.length = 2;
+    message.value.as_array.values = values;
+    if (!post(&message)) {
+        std::free(data);
+    }
+}
+
+void MLCDartPortSink::flush() {
+    if (binary_) {
+        postEvents();
+        return;
+    }
+    if (pending_ends_.empty()) return;
+
+    Dart_CObject kind;
+    kind.type = Dart_CObject_kInt32;
+    kind.value.as_int32 = kMessageChunks;
+
+    // The byte buffer is adopted by the VM; the finalizer frees it once the
+    // Uint8List is garbage collected on the Dart side.
+    Dart_CObject bytes;
+    bytes.type = Dart_CObject_kExternalTypedData;
+    bytes.value.as_external_typed_data.type = Dart_TypedData_kUint8;
+    bytes.value.as_external_typed_data.length = static_cast<intptr_t>(pending_size_);
+    bytes.value.as_external_typed_data.data = pending_data_;
+    bytes.value.as_external_typed_data.peer = pending_data_;
+    bytes.value.as_external_typed_data.callback = freeExternalBuffer;
+
+    // Offsets are small, so a copying typed-data object is cheaper than a finalizer
+    Dart_CObject ends;
+    ends.type = Dart_CObject_kTypedData;
+    ends.value.as_typed_data.type = Dart_TypedData_kInt32;
+    ends.value.as_typed_data.length = static_cast<intptr_t>(pending_ends_.size());
+    ends.value.as_typed_data.values = reinterpret_cast<const uint8_t*>(pending_ends_.data());
+
+    Dart_CObject* values[] = {&kind, &bytes, &ends};
+    Dart_CObject message;
+    message.type = Dart_CObject_kArray;
+    message.value.as_array.length = 3;
+    message.value.as_array.values = values;
+
+    if (!post(&message)) {
+        // Ownership only transfers on a successful post
+        std::free(pending_data_);
+    }
+    pending_data_ = nullptr;
+    pending_size_ = 0;
+    pending_capacity_ = 0;
+    pending_ends_.clear();
+}
+
+void MLCDartPortSink::onFinish(const MLCFinishInfo& info) {
+    if (binary_) {
+        events_.finish(info);
+        postEvents();
+        return;
+    }
+    flush();
+
+    Dart_CObject kind;
+    kind.type = Dart_CObject_kInt32;
+    kind.value.as_int32 = kMessageFinish;
+
+    Dart_CObject reason;
+    reason.type = Dart_CObject_kString;
+    reason.value.as_string = info.finish_reason.c_str();
+
+    Dart_CObject prompt_tokens;
+    prompt_tokens.type = Dart_CObject_kInt32;
+    prompt_tokens.value.as_int32 = info.prompt_tokens;
+
+    Dart_CObject completion_tokens;
+    completion_tokens.type = Dart_CObject_kInt32;
+    completion_tokens.value.as_int32 = info.completion_tokens;
+
+    Dart_CObject* values[] = {&kind, &reason, &prompt_tokens, &completion_tokens};
+    Dart_CObject message;
+    message.type = Dart_CObject_kArray;
+    message.value.as_array.length = 4;
+    message.value.as_array.values = values;
+    post(&message);
+}
+
+void MLCDartPortSink::onError(const std::string& error) {
+    if (binary_) {
+        events_.error(error);
+        postEvents();
+        return;
+    }
+    flush();
+
+    Dart_CObject kind;
+    kind.type = Dart_CObject_kInt32;
+    kind.value.as_int32 = kMessageError;
+
+    Dart_CObject text;
+    text.type = Dart_CObject_kString;
+    text.value.as_string = error.c_str();
+
+    Dart_CObject* values[] = {&kind, &text};
+    Dart_CObject message;
+    message.type = Dart_CObject_kArray;
+    message.value.as_array.length = 2;
+    message.value.as_array.values = values;
+    post(&message);
+}
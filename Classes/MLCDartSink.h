@@ -0,0 +1,66 @@
+#ifndef MLCDartSink_h
+#define MLCDartSink_h
+
+#include "MLCDeliverySink.h"
+#include "MLCEvents.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Posts a request's output straight to a Dart ReceivePort through the Dart DL API,
+// skipping the Swift/platform-channel hop. Chunks are batched and sent as one
+// message per flush:
+//
+//   [0, Uint8List utf8_bytes, Int32List chunk_end_offsets]   chunk batch
+//   [1, String finish_reason, int prompt_tokens, int completion_tokens]
+//   [2, String error_message]
+//
+// In binary mode every flush instead posts one batch of MLC_LLM_EVENT_*
+// events (chunks, token ids, logprobs, usage + finish, error):
+//
+//   [3, Uint8List events]
+//
+// Byte payloads are posted as external typed data, so the VM adopts the
+// buffer without copying and frees it through a finalizer.
+class MLCDartPortSink : public MLCDeliverySink {
+public:
+    static constexpr int32_t kMessageChunks = 0;
+    static constexpr int32_t kMessageFinish = 1;
+    static constexpr int32_t kMessageError = 2;
+    static constexpr int32_t kMessageEvents = 3;
+
+    // Flushes early once this many bytes are pending, even mid-payload
+    static constexpr size_t kDefaultMaxBatchBytes = 16 * 1024;
+
+    MLCDartPortSink(int64_t port, bool binary = false, size_t max_batch_bytes = kDefaultMaxBatchBytes);
+    ~MLCDartPortSink() override;
+
+    void onChunk(const std::string& text) override;
+    void onTokens(const std::vector<int32_t>& token_ids) override;
+    void onLogprobs(const std::vector<std::string>& logprob_json) override;
+    void flush() override;
+    void onFinish(const MLCFinishInfo& info) override;
+    void onError(const std::string& message) override;
+
+    // Initializes the dynamically linked Dart API. Must be called once with
+    // NativeApi.initializeApiDLData before any port sink posts. Returns 0 on success.
+    static intptr_t initializeApi(void* dart_api_data);
+    static bool isApiInitialized();
+
+private:
+    bool post(void* message);
+    void append(const std::string& text);
+    void postEvents();
+
+    int64_t port_;
+    bool binary_;
+    size_t max_batch_bytes_;
+    // Raw malloc buffer so ownership can be handed to the Dart VM on flush
+    uint8_t* pending_data_;
+    size_t pending_size_;
+    size_t pending_capacity_;
+    std::vector<int32_t> pending_ends_;
+    MLCEventWriter events_;
+};
+
+#endif /* MLCDartSink_h */
@@ -0,0 +1,54 @@
+#ifndef MLCDeliverySink_h
+#define MLCDeliverySink_h
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Final state of a request as reported to its sink
+struct MLCFinishInfo {
+    std::string finish_reason;
+    int prompt_tokens = 0;
+    int completion_tokens = 0;
+};
+
+// Destination for a single request's output. The engine wrapper calls onChunk()
+// for every decoded text delta, flush() once per stream-back payload, and
+// onFinish() exactly once. All calls happen on the stream-back thread.
+class MLCDeliverySink {
+public:
+    virtual ~MLCDeliverySink() = default;
+
+    virtual void onChunk(const std::string& text) = 0;
+    // Output token ids behind the last chunk(s), stop tokens excluded
+    virtual void onTokens(const std::vector<int32_t>&) {}
+    // Per-token log-probability records (MLC logprob JSON), only for requests
+    // submitted with top_logprobs
+    virtual void onLogprobs(const std::vector<std::string>&) {}
+    virtual void flush() {}
+    virtual void onFinish(const MLCFinishInfo& info) = 0;
+    virtual void onError(const std::string& message) = 0;
+
+    // True once output can no longer be delivered (e.g. the peer went away);
+    // the wrapper then aborts the request instead of generating into the void
+    virtual bool closed() const { return false; }
+};
+
+// Legacy delivery through a plain C function pointer, one call per chunk
+class MLCCallbackSink : public MLCDeliverySink {
+public:
+    explicit MLCCallbackSink(void (*callback)(const char*)) : callback_(callback) {}
+
+    void onChunk(const std::string& text) override {
+        if (callback_ && !text.empty()) callback_(text.c_str());
+    }
+
+    void onFinish(const MLCFinishInfo&) override {}
+
+    void onError(const std::string&) override {}
+
+private:
+    void (*callback_)(const char*);
+};
+
+#endif /* MLCDeliverySink_h */
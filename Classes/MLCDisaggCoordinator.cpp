@@ -0,0 +1,86 @@
+#include "MLCDisaggCoordinator.h"
+#include "MLCCpuTopology.h"
+#include "MLCFlightRecorder.h"
+#include "MLCJson.h"
+
+MLCDisaggCoordinator::MLCDisaggCoordinator(const MLCDisaggConfig& config) : config_(config) {
+    thread_ = MLCCpuTopology::startBridgeThread([this]() {
+        MLCFlightRecorder::nameThread("disagg");
+        run();
+    });
+}
+
+MLCDisaggCoordinator::~MLCDisaggCoordinator() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_one();
+    if (thread_.joinable()) thread_.join();
+}
+
+void MLCDisaggCoordinator::post(Task task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    cv_.notify_one();
+}
+
+void MLCDisaggCoordinator::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+        if (tasks_.empty()) break;
+        Task task = std::move(tasks_.front());
+        tasks_.pop_front();
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+}
+
+std::string MLCDisaggCoordinator::prepareReceiveConfig(int kv_window_end) {
+    return R"({"kind": "prepare_receive", "kv_window_begin": 0, "kv_window_end": )" + std::to_string(kv_window_end) +
+           "}";
+}
+
+std::string MLCDisaggCoordinator::remoteSendConfig(int kv_window_begin, int kv_window_end,
+                                                   const std::string& kv_append_metadata, int dst_group_offset) {
+    return R"({"kind": "remote_send", "kv_window_begin": )" + std::to_string(kv_window_begin) +
+           R"(, "kv_window_end": )" + std::to_string(kv_window_end) + R"(, "kv_append_metadata": )" +
+           kv_append_metadata + R"(, "dst_group_offset": )" + std::to_string(dst_group_offset) + "}";
+}
+
+std::string MLCDisaggCoordinator::startGenerationConfig(int kv_window_begin) {
+    return R"({"kind": "start_generation", "kv_window_begin": )" + std::to_string(kv_window_begin) + "}";
+}
+
+bool MLCDisaggCoordinator::parsePrepareReceiveUsage(const std::string& usage_json, int* prefix_matched_length,
+                                                    std::string* kv_append_metadata) {
+    MLCJsonValue usage;
+    if (!MLCJson::parse(usage_json, &usage)) return false;
+    const MLCJsonValue* extra = usage.get("extra");
+    if (!extra) return false;
+    const MLCJsonValue* matched = extra->get("prefix_matched_length");
+    const MLCJsonValue* metadata = extra->get("kv_append_metadata");
+    if (!matched || !matched->isNumber() || !metadata || metadata->isNull()) return false;
+    *prefix_matched_length = matched->asInt();
+    // Opaque to the bridge; passed on to remote_send as it came
+    *kv_append_metadata = MLCJson::serialize(*metadata);
+    return true;
+}
+
+MLCDisaggStats MLCDisaggCoordinator::stats() const {
+    MLCDisaggStats stats;
+    stats.requests = counters.requests;
+    stats.handoffs = counters.handoffs;
+    stats.colocated = counters.colocated;
+    stats.fallbacks = counters.fallbacks;
+    stats.failed = counters.failed;
+    stats.handoff_tokens = counters.handoff_tokens;
+    stats.prefix_reused_tokens = counters.prefix_reused_tokens;
+    stats.prepare_us = counters.prepare_us;
+    stats.prefill_us = counters.prefill_us;
+    return stats;
+}
@@ -0,0 +1,103 @@
+#ifndef MLCDisaggCoordinator_h
+#define MLCDisaggCoordinator_h
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct MLCDisaggConfig {
+    // Shorter prompts are prefilled by the decode instance itself: the
+    // handoff's extra round trip costs more than such a prefill
+    int min_prefill_tokens = 128;
+    // First rank of the decode instance in the engines' KV transfer group
+    int decode_group_offset = 0;
+};
+
+struct MLCDisaggStats {
+    uint64_t requests = 0;
+    uint64_t handoffs = 0;             // prefilled remotely, decoded locally
+    uint64_t colocated = 0;            // short prompts or unsupported options
+    uint64_t fallbacks = 0;            // handoff unavailable, decoded with a local prefill
+    uint64_t failed = 0;
+    uint64_t handoff_tokens = 0;       // prompt tokens whose KV was sent across
+    uint64_t prefix_reused_tokens = 0; // already in the decode instance's prefix cache
+    uint64_t prepare_us = 0;           // total time for the decode side to reserve KV
+    uint64_t prefill_us = 0;           // total remote prefill + send time
+};
+
+// Drives disaggregated serving between a prefill-only engine and a decode
+// engine using MLC-LLM's three-step KV handoff, requested per request through
+// generation_config.debug_config.disagg_config:
+//
+//   1. prepare_receive  on the decode engine reserves KV pages for the prompt
+//      (all but its last token) and reports how much of it is already cached
+//      plus the append metadata the sender needs;
+//   2. remote_send      on the prefill engine computes the remaining prompt
+//      KV and writes it straight into those pages;
+//   3. start_generation on the decode engine prefills the last token and
+//      streams the completion.
+//
+// Steps 2 and 3 are issued together; the decode engine holds the request
+// until its KV has arrived. This class holds the protocol and the counters;
+// the engine calls are made by the bridge on the coordinator thread, because
+// step 1 completes on the decode engine's stream-back thread.
+class MLCDisaggCoordinator {
+public:
+    using Task = std::function<void()>;
+
+    explicit MLCDisaggCoordinator(const MLCDisaggConfig& config);
+    // Runs the tasks already posted, then stops
+    ~MLCDisaggCoordinator();
+
+    MLCDisaggCoordinator(const MLCDisaggCoordinator&) = delete;
+    MLCDisaggCoordinator& operator=(const MLCDisaggCoordinator&) = delete;
+
+    const MLCDisaggConfig& config() const { return config_; }
+
+    void post(Task task);
+
+    // disagg_config objects for the three steps. Windows are token offsets
+    // into the prompt.
+    static std::string prepareReceiveConfig(int kv_window_end);
+    static std::string remoteSendConfig(int kv_window_begin, int kv_window_end, const std::string& kv_append_metadata,
+                                        int dst_group_offset);
+    static std::string startGenerationConfig(int kv_window_begin);
+
+    // Reads usage.extra of a finished prepare_receive request. False when the
+    // engine does not support disaggregation (no extra fields).
+    static bool parsePrepareReceiveUsage(const std::string& usage_json, int* prefix_matched_length,
+                                         std::string* kv_append_metadata);
+
+    struct Counters {
+        std::atomic<uint64_t> requests{0};
+        std::atomic<uint64_t> handoffs{0};
+        std::atomic<uint64_t> colocated{0};
+        std::atomic<uint64_t> fallbacks{0};
+        std::atomic<uint64_t> failed{0};
+        std::atomic<uint64_t> handoff_tokens{0};
+        std::atomic<uint64_t> prefix_reused_tokens{0};
+        std::atomic<uint64_t> prepare_us{0};
+        std::atomic<uint64_t> prefill_us{0};
+    };
+    Counters counters;
+
+    MLCDisaggStats stats() const;
+
+private:
+    void run();
+
+    const MLCDisaggConfig config_;
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Task> tasks_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+#endif /* MLCDisaggCoordinator_h */
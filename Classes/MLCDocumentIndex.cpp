@@ -0,0 +1,104 @@
+#include "MLCDocumentIndex.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Standard BM25 parameters
+const double kBm25K1 = 1.2;
+const double kBm25B = 0.75;
+
+} // namespace
+
+void MLCDocumentIndex::replaceFile(const std::string& path, std::vector<MLCDocumentChunk> chunks) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    removeFileLocked(path);
+
+    std::vector<uint64_t>& ids = file_chunks_[path];
+    for (MLCDocumentChunk& chunk : chunks) {
+        uint64_t id = next_chunk_id_++;
+        Entry entry;
+        for (int32_t token_id : chunk.token_ids) entry.term_counts[token_id]++;
+        for (const auto& term : entry.term_counts) postings_[term.first][id] = term.second;
+        total_tokens_ += chunk.token_ids.size();
+        entry.chunk = std::move(chunk);
+        chunks_.emplace(id, std::move(entry));
+        ids.push_back(id);
+    }
+    if (ids.empty()) file_chunks_.erase(path);
+}
+
+void MLCDocumentIndex::removeFile(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    removeFileLocked(path);
+}
+
+void MLCDocumentIndex::removeFileLocked(const std::string& path) {
+    auto file = file_chunks_.find(path);
+    if (file == file_chunks_.end()) return;
+    for (uint64_t id : file->second) {
+        auto it = chunks_.find(id);
+        if (it == chunks_.end()) continue;
+        for (const auto& term : it->second.term_counts) {
+            auto posting = postings_.find(term.first);
+            if (posting == postings_.end()) continue;
+            posting->second.erase(id);
+            if (posting->second.empty()) postings_.erase(posting);
+        }
+        total_tokens_ -= it->second.chunk.token_ids.size();
+        chunks_.erase(it);
+    }
+    file_chunks_.erase(file);
+}
+
+std::vector<MLCDocumentHit> MLCDocumentIndex::query(const std::vector<int32_t>& token_ids, size_t top_k) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<MLCDocumentHit> hits;
+    if (chunks_.empty() || top_k == 0) return hits;
+
+    const double num_chunks = static_cast<double>(chunks_.size());
+    const double average_length = static_cast<double>(total_tokens_) / num_chunks;
+
+    std::vector<int32_t> terms(token_ids);
+    std::sort(terms.begin(), terms.end());
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+
+    std::unordered_map<uint64_t, double> scores;
+    for (int32_t term : terms) {
+        auto posting = postings_.find(term);
+        if (posting == postings_.end()) continue;
+        double df = static_cast<double>(posting->second.size());
+        double idf = std::log(1.0 + (num_chunks - df + 0.5) / (df + 0.5));
+        for (const auto& occurrence : posting->second) {
+            double length = static_cast<double>(chunks_.at(occurrence.first).chunk.token_ids.size());
+            double tf = occurrence.second;
+            scores[occurrence.first] +=
+                idf * tf * (kBm25K1 + 1.0) / (tf + kBm25K1 * (1.0 - kBm25B + kBm25B * length / average_length));
+        }
+    }
+
+    std::vector<std::pair<double, uint64_t>> ranked;
+    ranked.reserve(scores.size());
+    for (const auto& score : scores) ranked.emplace_back(score.second, score.first);
+    size_t count = std::min(top_k, ranked.size());
+    std::partial_sort(ranked.begin(), ranked.begin() + static_cast<std::ptrdiff_t>(count), ranked.end(),
+                      [](const std::pair<double, uint64_t>& a, const std::pair<double, uint64_t>& b) {
+                          return a.first != b.first ? a.first > b.first : a.second < b.second;
+                      });
+
+    for (size_t i = 0; i < count; ++i) {
+        const MLCDocumentChunk& chunk = chunks_.at(ranked[i].second).chunk;
+        hits.push_back(MLCDocumentHit{chunk.path, chunk.chunk_index, chunk.text, static_cast<float>(ranked[i].first)});
+    }
+    return hits;
+}
+
+size_t MLCDocumentIndex::chunkCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return chunks_.size();
+}
+
+size_t MLCDocumentIndex::fileCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return file_chunks_.size();
+}
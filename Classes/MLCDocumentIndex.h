@@ -0,0 +1,54 @@
+#ifndef MLCDocumentIndex_h
+#define MLCDocumentIndex_h
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct MLCDocumentChunk {
+    std::string path;
+    int chunk_index = 0;
+    std::string text;
+    std::vector<int32_t> token_ids;
+};
+
+struct MLCDocumentHit {
+    std::string path;
+    int chunk_index;
+    std::string text;
+    float score;
+};
+
+// In-memory BM25 index whose terms are the model tokenizer's token ids, so
+// ingestion and queries share one tokenization and need no separate vocabulary.
+// Files are the unit of update: replaceFile() swaps all chunks of a file.
+class MLCDocumentIndex {
+public:
+    void replaceFile(const std::string& path, std::vector<MLCDocumentChunk> chunks);
+    void removeFile(const std::string& path);
+
+    std::vector<MLCDocumentHit> query(const std::vector<int32_t>& token_ids, size_t top_k) const;
+
+    size_t chunkCount() const;
+    size_t fileCount() const;
+
+private:
+    struct Entry {
+        MLCDocumentChunk chunk;
+        std::unordered_map<int32_t, uint32_t> term_counts;
+    };
+
+    void removeFileLocked(const std::string& path);
+
+    mutable std::mutex mutex_;
+    uint64_t next_chunk_id_ = 0;
+    std::unordered_map<uint64_t, Entry> chunks_;
+    std::unordered_map<std::string, std::vector<uint64_t>> file_chunks_;
+    // term -> chunk id -> term frequency
+    std::unordered_map<int32_t, std::unordered_map<uint64_t, uint32_t>> postings_;
+    uint64_t total_tokens_ = 0;
+};
+
+#endif /* MLCDocumentIndex_h */
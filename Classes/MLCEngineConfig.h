@@ -0,0 +1,45 @@
+#ifndef MLCEngineConfig_h
+#define MLCEngineConfig_h
+
+#include <string>
+
+// Creation-time settings for one engine. Defaults match the original
+// single-sequence TinyLlama configuration.
+struct MLCEngineConfig {
+    std::string model_lib = "TinyLlama-1.1B-MLC";
+    // Sequences decoded together; admission batching needs more than one
+    int max_num_sequence = 1;
+    int max_total_sequence_length = 2048;
+    int prefill_chunk_size = 2048;
+
+    // KV page format: "float16", "int8" or "float8_e4m3". The quantized formats
+    // need a model library compiled for them (declared as "kv_cache_dtype" in
+    // mlc-chat-config.json); max_total_sequence_length then stays a
+    // float16-sized memory budget that holds about twice the tokens.
+    std::string kv_cache_dtype = "float16";
+
+    // CPU compute thread pool. By default it gets one thread per core of the
+    // fastest core type found in sysfs, and the bridge's own threads are kept
+    // off those cores. A positive count or a CPU list ("4-7") overrides that.
+    int compute_threads = 0;
+    std::string compute_cpus;
+
+    // Requests arriving within this window are handed to the engine together
+    // so they share one prefill step. 0 submits every request immediately.
+    int admission_window_us = 0;
+    // Prompt-token budget of one admission batch; 0 uses prefill_chunk_size
+    int admission_max_tokens = 0;
+
+    // Sequences that stop at max_tokens while submitted with a session id are
+    // kept this long for mlc_llm_continue, up to continue_max_sequences of
+    // them. 0 turns retention off.
+    int continue_retain_ms = 0;
+    int continue_max_sequences = 4;
+
+    // Record / replay the weight read order at startup (MLCWeightPrefetcher).
+    // An empty path stores the profile next to the model.
+    bool startup_prefetch = true;
+    std::string startup_profile_path;
+};
+
+#endif /* MLCEngineConfig_h */
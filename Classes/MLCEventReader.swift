@@ -0,0 +1,128 @@
+import Foundation
+
+// MARK: - Binary bridge events (MLC_LLM_EVENT_*, layout in MLCBridge.h)
+
+/// One event of a batch from `mlc_llm_event_callback_t` or `MLC_LLM_FRAMING_BINARY`.
+/// Fields are read in place, so an event is only valid while its batch is.
+public struct MLCEvent {
+    public enum Kind: UInt16 {
+        case chunk = 1
+        case tokens = 2
+        case logprobs = 3
+        case usage = 4
+        case finish = 5
+        case error = 6
+        case toolCall = 7
+    }
+
+    public enum FinishCode: UInt32 {
+        case stop = 0
+        case length = 1
+        case repetition = 2
+        case cache = 3
+        case other = 255
+    }
+
+    static let headerSize = 16
+
+    /// The whole event, header included
+    public let bytes: UnsafeRawBufferPointer
+
+    public var size: Int { return Int(u32(0)) }
+    public var rawType: UInt16 { return u16(4) }
+    public var kind: Kind? { return Kind(rawValue: rawType) }
+    public var version: UInt16 { return u16(6) }
+    public var count: Int { return Int(u32(8)) }
+    public var aux: Int { return Int(u32(12)) }
+    public var payload: UnsafeRawBufferPointer {
+        return UnsafeRawBufferPointer(rebasing: bytes[MLCEvent.headerSize..<size])
+    }
+
+    /// UTF-8 bytes of a chunk, finish reason or error message
+    public var textBytes: UnsafeRawBufferPointer {
+        switch kind {
+        case .some(.chunk), .some(.finish), .some(.error):
+            return UnsafeRawBufferPointer(rebasing: payload[0..<count])
+        default:
+            return UnsafeRawBufferPointer(start: nil, count: 0)
+        }
+    }
+
+    public var text: String { return String(decoding: textBytes, as: UTF8.self) }
+
+    // Tokens
+    public var tokenCount: Int { return kind == .tokens ? count : 0 }
+    public func tokenId(at index: Int) -> Int32 {
+        return Int32(bitPattern: u32(MLCEvent.headerSize + 4 * index))
+    }
+
+    // Logprobs; rank 0 is the sampled token, 1...topK its alternatives
+    public var logprobTokenCount: Int { return kind == .logprobs ? count : 0 }
+    public var topK: Int { return kind == .logprobs ? aux : 0 }
+    public func logprob(token: Int, rank: Int) -> Float {
+        return Float(bitPattern: u32(logprobEntry(token: token, rank: rank)))
+    }
+    public func logprobToken(token: Int, rank: Int) -> String {
+        let entry = logprobEntry(token: token, rank: rank)
+        let offset = Int(u32(entry + 4))
+        let length = Int(u32(entry + 8))
+        return String(decoding: UnsafeRawBufferPointer(rebasing: payload[offset..<(offset + length)]), as: UTF8.self)
+    }
+
+    // Usage
+    public var promptTokens: Int { return kind == .usage ? Int(u32(MLCEvent.headerSize)) : 0 }
+    public var completionTokens: Int { return kind == .usage ? Int(u32(MLCEvent.headerSize + 4)) : 0 }
+
+    // Finish
+    public var finishCode: FinishCode { return FinishCode(rawValue: UInt32(aux)) ?? .other }
+
+    // Tool call
+    public var toolName: String {
+        guard kind == .toolCall else { return "" }
+        return String(decoding: UnsafeRawBufferPointer(rebasing: payload[0..<count]), as: UTF8.self)
+    }
+    public var toolArguments: String {
+        guard kind == .toolCall else { return "" }
+        return String(decoding: UnsafeRawBufferPointer(rebasing: payload[count..<(count + aux)]), as: UTF8.self)
+    }
+
+    private func u32(_ offset: Int) -> UInt32 {
+        return UInt32(littleEndian: bytes.load(fromByteOffset: offset, as: UInt32.self))
+    }
+
+    private func u16(_ offset: Int) -> UInt16 {
+        return UInt16(littleEndian: bytes.load(fromByteOffset: offset, as: UInt16.self))
+    }
+
+    private func logprobEntry(token: Int, rank: Int) -> Int {
+        return MLCEvent.headerSize + 12 * (token * (1 + aux) + rank)
+    }
+}
+
+/// Walks the events of one batch. Stops at the first event that does not fit,
+/// which `truncated` then reports; unknown event types are returned with a nil `kind`.
+public struct MLCEventReader: Sequence, IteratorProtocol {
+    private let batch: UnsafeRawBufferPointer
+    private var offset = 0
+    public private(set) var truncated = false
+
+    public init(_ batch: UnsafeRawBufferPointer) {
+        self.batch = batch
+    }
+
+    public mutating func next() -> MLCEvent? {
+        let remaining = batch.count - offset
+        guard remaining >= MLCEvent.headerSize else {
+            truncated = remaining != 0
+            return nil
+        }
+        let size = Int(UInt32(littleEndian: batch.load(fromByteOffset: offset, as: UInt32.self)))
+        guard size >= MLCEvent.headerSize, size % 8 == 0, size <= remaining else {
+            truncated = true
+            return nil
+        }
+        let event = MLCEvent(bytes: UnsafeRawBufferPointer(rebasing: batch[offset..<(offset + size)]))
+        offset += size
+        return event
+    }
+}
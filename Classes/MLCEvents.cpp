@@ -0,0 +1,162 @@
+#include "MLCEvents.h"
+#include "MLCJson.h"
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <new>
+
+namespace {
+
+size_t padded(size_t size) {
+    return (size + 7) & ~static_cast<size_t>(7);
+}
+
+void putU32(uint8_t* out, uint32_t value) {
+    std::memcpy(out, &value, sizeof(value));
+}
+
+void putU16(uint8_t* out, uint16_t value) {
+    std::memcpy(out, &value, sizeof(value));
+}
+
+struct LogprobEntry {
+    float logprob = -std::numeric_limits<float>::infinity();
+    std::string token;
+};
+
+} // namespace
+
+MLCEventWriter::~MLCEventWriter() {
+    std::free(data_);
+}
+
+uint8_t* MLCEventWriter::begin(uint16_t type, uint32_t count, uint32_t aux, size_t payload) {
+    size_t event_size = padded(MLC_LLM_EVENT_HEADER_SIZE + payload);
+    if (size_ + event_size > capacity_) {
+        size_t capacity = capacity_ ? capacity_ * 2 : 512;
+        while (capacity < size_ + event_size) capacity *= 2;
+        auto* grown = static_cast<uint8_t*>(std::realloc(data_, capacity));
+        if (!grown) throw std::bad_alloc();
+        data_ = grown;
+        capacity_ = capacity;
+    }
+    uint8_t* event = data_ + size_;
+    putU32(event, static_cast<uint32_t>(event_size));
+    putU16(event + 4, type);
+    putU16(event + 6, MLC_LLM_EVENT_VERSION);
+    putU32(event + 8, count);
+    putU32(event + 12, aux);
+    // Padding is zeroed so batches are deterministic byte for byte
+    std::memset(event + MLC_LLM_EVENT_HEADER_SIZE + payload, 0, event_size - MLC_LLM_EVENT_HEADER_SIZE - payload);
+    size_ += event_size;
+    return event + MLC_LLM_EVENT_HEADER_SIZE;
+}
+
+void MLCEventWriter::event(uint16_t type, uint32_t count, uint32_t aux, const std::string& payload) {
+    uint8_t* out = begin(type, count, aux, payload.size());
+    if (!payload.empty()) std::memcpy(out, payload.data(), payload.size());
+}
+
+void MLCEventWriter::chunk(const std::string& text) {
+    event(MLC_LLM_EVENT_CHUNK, static_cast<uint32_t>(text.size()), 0, text);
+}
+
+void MLCEventWriter::tokens(const std::vector<int32_t>& token_ids) {
+    if (token_ids.empty()) return;
+    size_t bytes = token_ids.size() * sizeof(int32_t);
+    uint8_t* out = begin(MLC_LLM_EVENT_TOKENS, static_cast<uint32_t>(token_ids.size()), 0, bytes);
+    std::memcpy(out, token_ids.data(), bytes);
+}
+
+void MLCEventWriter::logprobs(const std::vector<std::string>& logprob_json) {
+    // Parsed once here so no reader has to
+    std::vector<std::vector<LogprobEntry>> tokens;
+    size_t top_k = 0;
+    for (const std::string& json : logprob_json) {
+        MLCJsonValue record;
+        if (!MLCJson::parse(json, &record)) continue;
+        const MLCJsonValue* token = record.get("token");
+        const MLCJsonValue* logprob = record.get("logprob");
+        if (!token || !logprob) continue;
+        std::vector<LogprobEntry> entries(1);
+        entries[0].token = token->asString();
+        entries[0].logprob = static_cast<float>(logprob->asNumber());
+        if (const MLCJsonValue* top = record.get("top_logprobs")) {
+            for (const MLCJsonValue& alternative : top->array) {
+                const MLCJsonValue* alt_token = alternative.get("token");
+                const MLCJsonValue* alt_logprob = alternative.get("logprob");
+                if (!alt_token || !alt_logprob) continue;
+                LogprobEntry entry;
+                entry.token = alt_token->asString();
+                entry.logprob = static_cast<float>(alt_logprob->asNumber());
+                entries.push_back(std::move(entry));
+            }
+        }
+        top_k = std::max(top_k, entries.size() - 1);
+        tokens.push_back(std::move(entries));
+    }
+    if (tokens.empty()) return;
+
+    size_t table = tokens.size() * (1 + top_k) * 12;
+    size_t strings = 0;
+    for (const auto& entries : tokens) {
+        for (const LogprobEntry& entry : entries) strings += entry.token.size();
+    }
+    uint8_t* out = begin(MLC_LLM_EVENT_LOGPROBS, static_cast<uint32_t>(tokens.size()), static_cast<uint32_t>(top_k),
+                         table + strings);
+    size_t string_offset = table;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        for (size_t rank = 0; rank <= top_k; ++rank) {
+            LogprobEntry missing;
+            const LogprobEntry& entry = rank < tokens[i].size() ? tokens[i][rank] : missing;
+            uint8_t* slot = out + 12 * (i * (1 + top_k) + rank);
+            uint32_t bits;
+            std::memcpy(&bits, &entry.logprob, sizeof(bits));
+            putU32(slot, bits);
+            putU32(slot + 4, static_cast<uint32_t>(string_offset));
+            putU32(slot + 8, static_cast<uint32_t>(entry.token.size()));
+            if (!entry.token.empty()) std::memcpy(out + string_offset, entry.token.data(), entry.token.size());
+            string_offset += entry.token.size();
+        }
+    }
+}
+
+void MLCEventWriter::finish(const MLCFinishInfo& info) {
+    uint8_t* usage = begin(MLC_LLM_EVENT_USAGE, 0, 0, 8);
+    putU32(usage, static_cast<uint32_t>(info.prompt_tokens));
+    putU32(usage + 4, static_cast<uint32_t>(info.completion_tokens));
+    event(MLC_LLM_EVENT_FINISH, static_cast<uint32_t>(info.finish_reason.size()), finishCode(info.finish_reason),
+          info.finish_reason);
+}
+
+void MLCEventWriter::error(const std::string& message) {
+    event(MLC_LLM_EVENT_ERROR, static_cast<uint32_t>(message.size()), 0, message);
+}
+
+void MLCEventWriter::toolCall(const std::string& name, const std::string& arguments_json) {
+    event(MLC_LLM_EVENT_TOOL_CALL, static_cast<uint32_t>(name.size()), static_cast<uint32_t>(arguments_json.size()),
+          name + arguments_json);
+}
+
+uint8_t* MLCEventWriter::release(size_t* size) {
+    uint8_t* data = data_;
+    *size = size_;
+    data_ = nullptr;
+    size_ = 0;
+    capacity_ = 0;
+    return data;
+}
+
+uint32_t MLCEventWriter::finishCode(const std::string& finish_reason) {
+    if (finish_reason == "stop") return MLC_LLM_FINISH_STOP;
+    if (finish_reason == "length") return MLC_LLM_FINISH_LENGTH;
+    if (finish_reason == "repetition") return MLC_LLM_FINISH_REPETITION;
+    if (finish_reason == "cache") return MLC_LLM_FINISH_CACHE;
+    return MLC_LLM_FINISH_OTHER;
+}
+
+void MLCEventCallbackSink::flush() {
+    if (events_.empty()) return;
+    if (callback_) callback_(user_data_, events_.data(), events_.size());
+    events_.clear();
+}
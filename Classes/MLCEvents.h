@@ -0,0 +1,184 @@
+#ifndef MLCEvents_h
+#define MLCEvents_h
+
+#include "MLCBridge.h"
+#include "MLCDeliverySink.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Encodes a request's output as MLC_LLM_EVENT_* events (layout in MLCBridge.h)
+// into one growing buffer. The buffer is malloc'd so a batch can be handed
+// over without a copy (see MLCDartPortSink).
+class MLCEventWriter {
+public:
+    MLCEventWriter() = default;
+    ~MLCEventWriter();
+
+    MLCEventWriter(const MLCEventWriter&) = delete;
+    MLCEventWriter& operator=(const MLCEventWriter&) = delete;
+
+    void chunk(const std::string& text);
+    void tokens(const std::vector<int32_t>& token_ids);
+    // MLC logprob records; entries that do not parse are left out
+    void logprobs(const std::vector<std::string>& logprob_json);
+    // USAGE followed by FINISH
+    void finish(const MLCFinishInfo& info);
+    void error(const std::string& message);
+    void toolCall(const std::string& name, const std::string& arguments_json);
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    void clear() { size_ = 0; }
+    // Hands the batch over; the caller frees it with std::free
+    uint8_t* release(size_t* size);
+
+    static uint32_t finishCode(const std::string& finish_reason);
+
+private:
+    // Starts an event with `payload` bytes and returns where they go
+    uint8_t* begin(uint16_t type, uint32_t count, uint32_t aux, size_t payload);
+    void event(uint16_t type, uint32_t count, uint32_t aux, const std::string& payload);
+
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+};
+
+// View of one event inside a received batch; nothing is copied or decoded
+// up front. Accessors for other types return empty values.
+class MLCEventView {
+public:
+    MLCEventView() = default;
+    explicit MLCEventView(const uint8_t* data) : data_(data) {}
+
+    uint32_t size() const { return u32(0); }
+    uint16_t type() const { return u16(4); }
+    uint16_t version() const { return u16(6); }
+    uint32_t count() const { return u32(8); }
+    uint32_t aux() const { return u32(12); }
+    const uint8_t* payload() const { return data_ + MLC_LLM_EVENT_HEADER_SIZE; }
+
+    // CHUNK text, FINISH reason or ERROR message
+    std::string_view text() const {
+        uint16_t kind = type();
+        if (kind != MLC_LLM_EVENT_CHUNK && kind != MLC_LLM_EVENT_FINISH && kind != MLC_LLM_EVENT_ERROR) return {};
+        return std::string_view(reinterpret_cast<const char*>(payload()), count());
+    }
+
+    // TOKENS
+    uint32_t numTokens() const { return type() == MLC_LLM_EVENT_TOKENS ? count() : 0; }
+    int32_t tokenId(uint32_t index) const { return static_cast<int32_t>(u32(MLC_LLM_EVENT_HEADER_SIZE + 4 * index)); }
+
+    // LOGPROBS. Rank 0 is the sampled token, 1..topK() its alternatives.
+    uint32_t numLogprobTokens() const { return type() == MLC_LLM_EVENT_LOGPROBS ? count() : 0; }
+    uint32_t topK() const { return type() == MLC_LLM_EVENT_LOGPROBS ? aux() : 0; }
+    float logprob(uint32_t token, uint32_t rank) const {
+        uint32_t bits = u32(logprobEntry(token, rank));
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    std::string_view logprobToken(uint32_t token, uint32_t rank) const {
+        size_t entry = logprobEntry(token, rank);
+        return std::string_view(reinterpret_cast<const char*>(payload()) + u32(entry + 4), u32(entry + 8));
+    }
+
+    // USAGE
+    uint32_t promptTokens() const { return type() == MLC_LLM_EVENT_USAGE ? u32(MLC_LLM_EVENT_HEADER_SIZE) : 0; }
+    uint32_t completionTokens() const { return type() == MLC_LLM_EVENT_USAGE ? u32(MLC_LLM_EVENT_HEADER_SIZE + 4) : 0; }
+
+    // FINISH
+    uint32_t finishCode() const { return aux(); }
+
+    // TOOL_CALL
+    std::string_view toolName() const {
+        if (type() != MLC_LLM_EVENT_TOOL_CALL) return {};
+        return std::string_view(reinterpret_cast<const char*>(payload()), count());
+    }
+    std::string_view toolArguments() const {
+        if (type() != MLC_LLM_EVENT_TOOL_CALL) return {};
+        return std::string_view(reinterpret_cast<const char*>(payload()) + count(), aux());
+    }
+
+private:
+    uint32_t u32(size_t offset) const {
+        uint32_t value;
+        std::memcpy(&value, data_ + offset, sizeof(value));
+        return value;
+    }
+    uint16_t u16(size_t offset) const {
+        uint16_t value;
+        std::memcpy(&value, data_ + offset, sizeof(value));
+        return value;
+    }
+    size_t logprobEntry(uint32_t token, uint32_t rank) const {
+        return MLC_LLM_EVENT_HEADER_SIZE + 12 * (static_cast<size_t>(token) * (1 + aux()) + rank);
+    }
+
+    const uint8_t* data_ = nullptr;
+};
+
+// Walks the events of a batch. Stops at the first event that does not fit
+// the buffer, which truncated() then reports.
+class MLCEventReader {
+public:
+    MLCEventReader(const uint8_t* data, size_t size) : data_(data), size_(size) {}
+
+    bool next(MLCEventView* event) {
+        if (size_ - offset_ < MLC_LLM_EVENT_HEADER_SIZE) {
+            truncated_ = offset_ != size_;
+            return false;
+        }
+        MLCEventView view(data_ + offset_);
+        uint32_t event_size = view.size();
+        if (event_size < MLC_LLM_EVENT_HEADER_SIZE || event_size % 8 != 0 || event_size > size_ - offset_) {
+            truncated_ = true;
+            return false;
+        }
+        offset_ += event_size;
+        *event = view;
+        return true;
+    }
+
+    bool truncated() const { return truncated_; }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t offset_ = 0;
+    bool truncated_ = false;
+};
+
+// Binary delivery through a C function pointer, one event batch per flush
+class MLCEventCallbackSink : public MLCDeliverySink {
+public:
+    MLCEventCallbackSink(mlc_llm_event_callback_t callback, void* user_data)
+        : callback_(callback), user_data_(user_data) {}
+
+    void onChunk(const std::string& text) override {
+        if (!text.empty()) events_.chunk(text);
+    }
+    void onTokens(const std::vector<int32_t>& token_ids) override { events_.tokens(token_ids); }
+    void onLogprobs(const std::vector<std::string>& logprob_json) override { events_.logprobs(logprob_json); }
+    void flush() override;
+    void onFinish(const MLCFinishInfo& info) override {
+        events_.finish(info);
+        flush();
+    }
+    void onError(const std::string& message) override {
+        events_.error(message);
+        flush();
+    }
+
+private:
+    mlc_llm_event_callback_t callback_;
+    void* user_data_;
+    MLCEventWriter events_;
+};
+
+#endif /* MLCEvents_h */
@@ -0,0 +1,463 @@
+#include "MLCFdSink.h"
+#include "MLCCpuTopology.h"
+#include "MLCJson.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#endif
+
+#if defined(__linux__) && defined(MSG_ZEROCOPY) && defined(SO_ZEROCOPY)
+#define MLC_FD_SINK_ZEROCOPY 1
+#else
+#define MLC_FD_SINK_ZEROCOPY 0
+#endif
+
+namespace {
+
+#ifdef IOV_MAX
+const int kMaxIov = IOV_MAX;
+#else
+const int kMaxIov = 1024;
+#endif
+
+#ifdef MSG_NOSIGNAL
+const int kSendFlags = MSG_NOSIGNAL;
+#else
+const int kSendFlags = 0;
+#endif
+
+// How long a finished writer waits for outstanding zerocopy completions
+// before handing their buffers to the graveyard
+const int kZerocopyDrainTimeoutMs = 1000;
+
+// A zerocopy batch the kernel may still be reading from
+struct InFlight {
+    uint32_t last_send;
+    std::deque<std::string> storage;
+};
+
+// Pops the batches whose zerocopy sends have completed. Returns false once
+// the socket's error queue is empty.
+bool readCompletions(int fd, std::deque<InFlight>* in_flight) {
+#if MLC_FD_SINK_ZEROCOPY
+    char control[128];
+    struct msghdr message;
+    std::memset(&message, 0, sizeof(message));
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    if (recvmsg(fd, &message, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) return errno == EINTR;
+
+    for (struct cmsghdr* cm = CMSG_FIRSTHDR(&message); cm; cm = CMSG_NXTHDR(&message, cm)) {
+        bool recv_err = (cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+                        (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR);
+        if (!recv_err) continue;
+        const auto* err = reinterpret_cast<const struct sock_extended_err*>(CMSG_DATA(cm));
+        if (err->ee_errno != 0 || err->ee_origin != SO_EE_ORIGIN_ZEROCOPY) continue;
+        // Sends [ee_info, ee_data] have completed
+        uint32_t completed = err->ee_data;
+        while (!in_flight->empty() && static_cast<int32_t>(in_flight->front().last_send - completed) <= 0) {
+            in_flight->pop_front();
+        }
+    }
+    return true;
+#else
+    (void)fd;
+    in_flight->clear();
+    return false;
+#endif
+}
+
+// Zerocopy buffers of finished writers whose completions had not arrived.
+// Freeing them early would let the kernel send whatever reuses the memory, so
+// they stay here, with the writer's dup of the socket to read completions
+// from, until the kernel reports them done. Every writer thread reaps the
+// graveyard as it goes.
+struct ZerocopyGrave {
+    int fd;
+    std::deque<InFlight> in_flight;
+};
+
+std::mutex g_graves_mutex;
+// Leaked so detached writers can still reach it during static destruction
+std::vector<ZerocopyGrave>& graves() {
+    static auto* list = new std::vector<ZerocopyGrave>();
+    return *list;
+}
+
+void bury(int fd, std::deque<InFlight> in_flight) {
+    std::lock_guard<std::mutex> lock(g_graves_mutex);
+    graves().push_back(ZerocopyGrave{fd, std::move(in_flight)});
+}
+
+void reapGraves() {
+    std::lock_guard<std::mutex> lock(g_graves_mutex);
+    std::vector<ZerocopyGrave>& list = graves();
+    for (auto it = list.begin(); it != list.end();) {
+        while (!it->in_flight.empty() && readCompletions(it->fd, &it->in_flight)) {
+        }
+        if (it->in_flight.empty()) {
+            close(it->fd);
+            it = list.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+} // namespace
+
+struct MLCFdSink::Writer {
+    int fd = -1;   // dup of the caller's fd, closed when the writer is done
+    bool is_socket = false;
+    bool zerocopy = false;
+    std::chrono::milliseconds timeout{kDefaultWriteTimeoutMs};
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Batch> queue;
+    size_t queued_bytes = 0;
+    // Queue time of the batch being written, if any
+    bool writing = false;
+    std::chrono::steady_clock::time_point writing_since;
+    bool started = false;
+    bool finishing = false;   // the sink is gone; write out the queue and exit
+    bool failed = false;
+
+    // Writer thread only
+    std::deque<InFlight> in_flight;
+    uint32_t zerocopy_sends = 0;
+};
+
+MLCFdSink::MLCFdSink(int fd, Framing framing, bool zerocopy, int write_timeout_ms)
+    : framing_(framing), closed_(fd < 0) {
+    if (closed_) return;
+    int copy = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (copy < 0) {
+        std::cerr << "❌ Cannot duplicate output fd " << fd << ": " << std::strerror(errno) << std::endl;
+        closed_ = true;
+        return;
+    }
+    writer_ = std::make_shared<Writer>();
+    writer_->fd = copy;
+    if (write_timeout_ms > 0) writer_->timeout = std::chrono::milliseconds(write_timeout_ms);
+
+    struct stat info;
+    if (fstat(copy, &info) == 0) {
+        writer_->is_socket = S_ISSOCK(info.st_mode);
+    }
+#if defined(SO_NOSIGPIPE)
+    if (writer_->is_socket) {
+        int one = 1;
+        setsockopt(copy, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+    }
+#endif
+#if MLC_FD_SINK_ZEROCOPY
+    if (zerocopy && writer_->is_socket) {
+        int one = 1;
+        writer_->zerocopy = setsockopt(copy, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+        if (!writer_->zerocopy) {
+            std::cerr << "⚠️ SO_ZEROCOPY unavailable on fd " << fd << ": " << std::strerror(errno) << std::endl;
+        }
+    }
+#else
+    (void)zerocopy;
+#endif
+}
+
+MLCFdSink::~MLCFdSink() {
+    flush();
+    if (!writer_) return;
+    bool started;
+    {
+        std::lock_guard<std::mutex> lock(writer_->mutex);
+        writer_->finishing = true;
+        started = writer_->started;
+    }
+    // A running writer drains its queue and closes the fd on its own thread
+    if (started) {
+        writer_->cv.notify_one();
+    } else {
+        close(writer_->fd);
+    }
+}
+
+void MLCFdSink::appendStatic(const char* text) {
+    size_t size = std::strlen(text);
+    pending_.segments.push_back(Segment{text, size});
+    pending_.bytes += size;
+}
+
+void MLCFdSink::appendOwned(std::string text) {
+    if (text.empty()) return;
+    pending_.storage.push_back(std::move(text));
+    pending_.segments.push_back(Segment{pending_.storage.back().data(), pending_.storage.back().size()});
+    pending_.bytes += pending_.storage.back().size();
+}
+
+void MLCFdSink::appendFrame(uint8_t type, std::string payload) {
+    uint32_t length = static_cast<uint32_t>(payload.size());
+    std::string header(5, '\0');
+    header[0] = static_cast<char>(type);
+    for (int i = 0; i < 4; ++i) {
+        header[1 + i] = static_cast<char>((length >> (8 * i)) & 0xFF);
+    }
+    appendOwned(std::move(header));
+    appendOwned(std::move(payload));
+}
+
+void MLCFdSink::onChunk(const std::string& text) {
+    if (closed_ || text.empty()) return;
+    switch (framing_) {
+        case Framing::Raw:
+            appendOwned(text);
+            break;
+        case Framing::Sse:
+            appendStatic("data: {\"delta\":\"");
+            appendOwned(MLCJson::escape(text));
+            appendStatic("\"}\n\n");
+            break;
+        case Framing::LengthPrefixed:
+            appendFrame(kFrameChunk, text);
+            break;
+        case Framing::Binary:
+            events_.chunk(text);
+            break;
+    }
+}
+
+void MLCFdSink::onTokens(const std::vector<int32_t>& token_ids) {
+    if (!closed_ && framing_ == Framing::Binary) events_.tokens(token_ids);
+}
+
+void MLCFdSink::onLogprobs(const std::vector<std::string>& logprob_json) {
+    if (!closed_ && framing_ == Framing::Binary) events_.logprobs(logprob_json);
+}
+
+void MLCFdSink::onFinish(const MLCFinishInfo& info) {
+    if (closed_) return;
+    std::string json = "{\"finish_reason\":\"" + MLCJson::escape(info.finish_reason) +
+                       "\",\"prompt_tokens\":" + std::to_string(info.prompt_tokens) +
+                       ",\"completion_tokens\":" + std::to_string(info.completion_tokens) + "}";
+    if (framing_ == Framing::Sse) {
+        appendStatic("event: finish\ndata: ");
+        appendOwned(std::move(json));
+        appendStatic("\n\ndata: [DONE]\n\n");
+    } else if (framing_ == Framing::LengthPrefixed) {
+        appendFrame(kFrameFinish, std::move(json));
+    } else if (framing_ == Framing::Binary) {
+        events_.finish(info);
+    }
+    flush();
+}
+
+void MLCFdSink::onError(const std::string& message) {
+    if (closed_) return;
+    if (framing_ == Framing::Sse) {
+        appendStatic("event: error\ndata: {\"message\":\"");
+        appendOwned(MLCJson::escape(message));
+        appendStatic("\"}\n\n");
+    } else if (framing_ == Framing::LengthPrefixed) {
+        appendFrame(kFrameError, message);
+    } else if (framing_ == Framing::Binary) {
+        events_.error(message);
+    }
+    flush();
+}
+
+void MLCFdSink::flush() {
+    if (!events_.empty()) {
+        appendOwned(std::string(reinterpret_cast<const char*>(events_.data()), events_.size()));
+        events_.clear();
+    }
+    if (pending_.segments.empty()) return;
+    Batch batch = std::move(pending_);
+    pending_ = Batch();
+    if (closed_) return;
+
+    batch.queued_at = std::chrono::steady_clock::now();
+    bool start = false;
+    {
+        std::lock_guard<std::mutex> lock(writer_->mutex);
+        if (writer_->failed) {
+            closed_ = true;
+        } else if (writer_->queued_bytes + batch.bytes > kMaxQueuedBytes) {
+            std::cerr << "❌ Output fd " << writer_->fd << " fell " << (writer_->queued_bytes >> 10)
+                      << " KB behind, giving up" << std::endl;
+            writer_->failed = true;
+            closed_ = true;
+        } else {
+            writer_->queued_bytes += batch.bytes;
+            writer_->queue.push_back(std::move(batch));
+            start = !writer_->started;
+            writer_->started = true;
+        }
+    }
+    if (start) {
+        // Started with the first output, so sinks that never write cost no thread
+        std::shared_ptr<Writer> writer = writer_;
+        MLCCpuTopology::startBridgeThread([writer]() { runWriter(writer); }).detach();
+    } else {
+        writer_->cv.notify_one();
+    }
+}
+
+bool MLCFdSink::closed() const {
+    if (closed_) return true;
+    std::lock_guard<std::mutex> lock(writer_->mutex);
+    if (writer_->failed) return true;
+    if (!writer_->writing && writer_->queue.empty()) return false;
+    // The oldest unwritten batch tells whether the reader is still reading
+    auto oldest = writer_->writing ? writer_->writing_since : writer_->queue.front().queued_at;
+    if (std::chrono::steady_clock::now() - oldest <= writer_->timeout) return false;
+    std::cerr << "❌ Output fd " << writer_->fd << " accepted nothing for " << writer_->timeout.count() << " ms"
+              << std::endl;
+    writer_->failed = true;
+    return true;
+}
+
+void MLCFdSink::runWriter(const std::shared_ptr<Writer>& writer) {
+    std::unique_lock<std::mutex> lock(writer->mutex);
+    while (true) {
+        writer->cv.wait(lock, [&writer]() { return !writer->queue.empty() || writer->finishing; });
+        if (writer->queue.empty()) break;
+        Batch batch = std::move(writer->queue.front());
+        writer->queue.pop_front();
+        writer->writing = true;
+        writer->writing_since = batch.queued_at;
+        bool failed = writer->failed;
+        lock.unlock();
+
+        // After a failure the rest of the queue is dropped unwritten
+        bool zerocopy_sent = false;
+        bool ok = !failed && writeBatch(*writer, batch, &zerocopy_sent);
+        if (zerocopy_sent) {
+            // The kernel still reads from these pages; keep them until completion
+            writer->in_flight.push_back(InFlight{writer->zerocopy_sends - 1, std::move(batch.storage)});
+        }
+        reapZerocopy(*writer, 0);
+        reapGraves();
+
+        lock.lock();
+        writer->writing = false;
+        writer->queued_bytes -= batch.bytes;
+        if (!ok) writer->failed = true;
+    }
+    lock.unlock();
+
+    // The sink is gone; nothing waits on this thread any more
+    reapZerocopy(*writer, kZerocopyDrainTimeoutMs);
+    if (writer->in_flight.empty()) {
+        close(writer->fd);
+    } else {
+        bury(writer->fd, std::move(writer->in_flight));
+    }
+    writer->fd = -1;
+}
+
+bool MLCFdSink::waitWritable(const Writer& writer) {
+    struct pollfd pfd;
+    pfd.fd = writer.fd;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+    int ready;
+    while ((ready = poll(&pfd, 1, static_cast<int>(writer.timeout.count()))) < 0) {
+        if (errno != EINTR) return false;
+    }
+    if (ready == 0) {
+        std::cerr << "❌ Output fd " << writer.fd << " accepted nothing for " << writer.timeout.count() << " ms"
+                  << std::endl;
+    }
+    return (pfd.revents & POLLOUT) != 0;
+}
+
+bool MLCFdSink::writeBatch(Writer& writer, Batch& batch, bool* zerocopy_sent) {
+    std::vector<struct iovec> iov(batch.segments.size());
+    for (size_t i = 0; i < batch.segments.size(); ++i) {
+        iov[i].iov_base = const_cast<char*>(batch.segments[i].data);
+        iov[i].iov_len = batch.segments[i].size;
+    }
+
+    bool zerocopy = writer.zerocopy && batch.bytes >= kZerocopyMinBytes;
+    size_t index = 0;
+    while (index < iov.size()) {
+        int count = static_cast<int>(std::min(iov.size() - index, static_cast<size_t>(kMaxIov)));
+        ssize_t written;
+        if (writer.is_socket) {
+            struct msghdr message;
+            std::memset(&message, 0, sizeof(message));
+            message.msg_iov = &iov[index];
+            message.msg_iovlen = count;
+            // Never blocks, so a stalled peer is noticed by the bounded poll below
+            int flags = kSendFlags | MSG_DONTWAIT;
+#if MLC_FD_SINK_ZEROCOPY
+            if (zerocopy) flags |= MSG_ZEROCOPY;
+#endif
+            written = sendmsg(writer.fd, &message, flags);
+        } else {
+            written = writev(writer.fd, &iov[index], count);
+        }
+
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (!waitWritable(writer)) return false;
+                continue;
+            }
+#if MLC_FD_SINK_ZEROCOPY
+            if (zerocopy && errno == ENOBUFS) {
+                // Out of optmem for pinned pages; fall back to copying sends
+                zerocopy = false;
+                continue;
+            }
+#endif
+            std::cerr << "❌ Output fd " << writer.fd << " write failed: " << std::strerror(errno) << std::endl;
+            return false;
+        }
+        if (zerocopy) {
+            writer.zerocopy_sends++;
+            *zerocopy_sent = true;
+        }
+
+        // Skip fully written vectors and trim a partially written one
+        size_t remaining = static_cast<size_t>(written);
+        while (index < iov.size() && remaining >= iov[index].iov_len) {
+            remaining -= iov[index].iov_len;
+            ++index;
+        }
+        if (remaining > 0) {
+            iov[index].iov_base = static_cast<char*>(iov[index].iov_base) + remaining;
+            iov[index].iov_len -= remaining;
+        }
+    }
+    return true;
+}
+
+void MLCFdSink::reapZerocopy(Writer& writer, int timeout_ms) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (!writer.in_flight.empty()) {
+        if (readCompletions(writer.fd, &writer.in_flight)) continue;
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0) break;
+        // Completions arrive on the error queue, which poll reports as POLLERR
+        struct pollfd pfd;
+        pfd.fd = writer.fd;
+        pfd.events = 0;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, static_cast<int>(left.count())) <= 0) break;
+    }
+}
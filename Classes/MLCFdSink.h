@@ -0,0 +1,101 @@
+#ifndef MLCFdSink_h
+#define MLCFdSink_h
+
+#include "MLCDeliverySink.h"
+#include "MLCEvents.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Writes a request's output straight to a caller-owned file descriptor (socket,
+// pipe or file), skipping the callback and the caller's own writer thread.
+// Frames are queued per chunk and written with one writev()/sendmsg() per
+// flush, so the kernel sees a whole engine step as a single write.
+//
+//   Raw             chunk text only; finish and errors are not written
+//   Sse             data: {"delta":"..."}\n\n per chunk, then
+//                   event: finish / event: error and data: [DONE]
+//   LengthPrefixed  [u8 type][u32 little-endian length][payload], type 0 chunk
+//                   text, 1 finish JSON, 2 error message (as MLCDartPortSink)
+//   Binary          MLC_LLM_EVENT_* events (MLCBridge.h), including token ids
+//                   and logprobs; one event batch per flush
+//
+// The caller's fd is never closed by the sink. Writes happen on a writer
+// thread of the sink's own, through a dup() of the fd, so a peer that stops
+// reading never holds up the stream-back thread (or the engine lock it runs
+// under), and a caller closing its fd early cannot redirect output into a
+// reused descriptor. A batch that has waited longer than the write timeout,
+// or a backlog beyond kMaxQueuedBytes, marks the sink closed, which aborts
+// the request. On sockets SIGPIPE is suppressed. Pipes are not covered, so
+// callers streaming into pipes should ignore SIGPIPE.
+class MLCFdSink : public MLCDeliverySink {
+public:
+    enum class Framing { Raw = 0, Sse = 1, LengthPrefixed = 2, Binary = 3 };
+
+    static constexpr uint8_t kFrameChunk = 0;
+    static constexpr uint8_t kFrameFinish = 1;
+    static constexpr uint8_t kFrameError = 2;
+
+    // Batches at least this large go out with MSG_ZEROCOPY when enabled; below
+    // it page pinning and completion tracking cost more than the copy
+    static constexpr size_t kZerocopyMinBytes = 16 * 1024;
+
+    static constexpr int kDefaultWriteTimeoutMs = 10000;
+    // Output queued for a slow reader beyond this fails the request
+    static constexpr size_t kMaxQueuedBytes = 8 << 20;
+
+    // `zerocopy` is honoured only for Linux sockets that accept SO_ZEROCOPY;
+    // `write_timeout_ms` <= 0 uses kDefaultWriteTimeoutMs
+    MLCFdSink(int fd, Framing framing, bool zerocopy, int write_timeout_ms = 0);
+    ~MLCFdSink() override;
+
+    void onChunk(const std::string& text) override;
+    void onTokens(const std::vector<int32_t>& token_ids) override;
+    void onLogprobs(const std::vector<std::string>& logprob_json) override;
+    void flush() override;
+    void onFinish(const MLCFinishInfo& info) override;
+    void onError(const std::string& message) override;
+    bool closed() const override;
+
+private:
+    struct Segment {
+        const char* data;
+        size_t size;
+    };
+
+    // One flush worth of output. Segments point into `storage` or at string
+    // literals; a deque keeps element addresses stable when it is moved.
+    struct Batch {
+        std::vector<Segment> segments;
+        std::deque<std::string> storage;
+        size_t bytes = 0;
+        std::chrono::steady_clock::time_point queued_at;
+    };
+
+    // Shared by the sink and its writer thread, which outlives the sink until
+    // the queue is written out
+    struct Writer;
+
+    void appendStatic(const char* text);
+    void appendOwned(std::string text);
+    void appendFrame(uint8_t type, std::string payload);
+
+    static void runWriter(const std::shared_ptr<Writer>& writer);
+    static bool writeBatch(Writer& writer, Batch& batch, bool* zerocopy_sent);
+    static bool waitWritable(const Writer& writer);
+    static void reapZerocopy(Writer& writer, int timeout_ms);
+
+    Framing framing_;
+    bool closed_;
+    std::shared_ptr<Writer> writer_;
+
+    Batch pending_;
+    // Binary framing encodes here until the flush queues the batch
+    MLCEventWriter events_;
+};
+
+#endif /* MLCFdSink_h */
@@ -0,0 +1,263 @@
+#include "MLCFlightRecorder.h"
+#include "MLCCpuTopology.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace {
+
+struct FlightRing {
+    std::atomic<bool> owned{false};
+    std::atomic<uint64_t> head{0};
+    uint32_t thread = 0;
+    char name[16] = {};
+    MLCFlightEvent events[MLCFlightRecorder::kEventsPerThread] = {};
+};
+
+// Plain globals so the signal handler needs no locks or allocation
+std::atomic<FlightRing*> g_rings[MLCFlightRecorder::kMaxRings];
+std::atomic<int> g_ring_count{0};
+std::atomic<uint32_t> g_next_thread{1};
+char g_dump_path[1024];
+std::atomic<bool> g_has_dump_path{false};
+
+const int kFatalSignals[] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT};
+const int kFatalSignalCount = sizeof(kFatalSignals) / sizeof(kFatalSignals[0]);
+struct sigaction g_previous_actions[kFatalSignalCount];
+std::atomic<bool> g_signal_handlers_installed{false};
+
+uint64_t clockNs(clockid_t clock) {
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + static_cast<uint64_t>(now.tv_nsec);
+}
+
+// A thread's claim on a ring; released for reuse when the thread exits, so
+// short-lived worker threads do not use up the ring table
+struct ThreadSlot {
+    FlightRing* ring = nullptr;
+    uint32_t serial = 0;
+
+    ~ThreadSlot() {
+        if (ring) ring->owned.store(false, std::memory_order_release);
+    }
+};
+
+thread_local ThreadSlot t_slot;
+
+FlightRing* acquireRing() {
+    int count = std::min(g_ring_count.load(std::memory_order_acquire), MLCFlightRecorder::kMaxRings);
+    for (int i = 0; i < count; ++i) {
+        FlightRing* ring = g_rings[i].load(std::memory_order_acquire);
+        bool expected = false;
+        if (ring && ring->owned.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) return ring;
+    }
+    int index = g_ring_count.fetch_add(1, std::memory_order_acq_rel);
+    if (index >= MLCFlightRecorder::kMaxRings) return nullptr;
+    auto* ring = new FlightRing();
+    ring->owned.store(true, std::memory_order_relaxed);
+    g_rings[index].store(ring, std::memory_order_release);
+    return ring;
+}
+
+FlightRing* threadRing() {
+    ThreadSlot& slot = t_slot;
+    if (!slot.ring) {
+        slot.ring = acquireRing();
+        if (!slot.ring) return nullptr;
+        if (slot.serial == 0) slot.serial = g_next_thread.fetch_add(1, std::memory_order_relaxed);
+        slot.ring->thread = slot.serial;
+        slot.ring->name[0] = '\0';
+    }
+    return slot.ring;
+}
+
+bool writeAll(int fd, const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+// Async-signal-safe: only open/write/close/clock_gettime, no allocation or
+// locks. Rings are copied as they are, so an event being written at the
+// moment of the dump may come out torn.
+bool dumpTo(const char* path, MLCFlightDumpReason reason, int signal) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+
+    int count = std::min(g_ring_count.load(std::memory_order_acquire), MLCFlightRecorder::kMaxRings);
+    MLCFlightDumpHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "MLCFLT01", 8);
+    header.event_size = sizeof(MLCFlightEvent);
+    header.reason = reason;
+    header.signal = signal;
+    header.dump_steady_ns = clockNs(CLOCK_MONOTONIC);
+    header.dump_unix_ns = clockNs(CLOCK_REALTIME);
+    for (int i = 0; i < count; ++i) {
+        if (g_rings[i].load(std::memory_order_acquire)) header.ring_count++;
+    }
+
+    bool ok = writeAll(fd, &header, sizeof(header));
+    for (int i = 0; ok && i < count; ++i) {
+        FlightRing* ring = g_rings[i].load(std::memory_order_acquire);
+        if (!ring) continue;
+        MLCFlightRingHeader ring_header;
+        memset(&ring_header, 0, sizeof(ring_header));
+        memcpy(ring_header.thread_name, ring->name, sizeof(ring_header.thread_name));
+        ring_header.thread_name[sizeof(ring_header.thread_name) - 1] = '\0';
+        ring_header.thread = ring->thread;
+        ring_header.capacity = MLCFlightRecorder::kEventsPerThread;
+        ring_header.head = ring->head.load(std::memory_order_acquire);
+        ok = writeAll(fd, &ring_header, sizeof(ring_header)) && writeAll(fd, ring->events, sizeof(ring->events));
+    }
+    close(fd);
+    return ok;
+}
+
+void onFatalSignal(int signal) {
+    if (g_has_dump_path.load(std::memory_order_acquire)) {
+        dumpTo(g_dump_path, kFlightDumpSignal, signal);
+    }
+    // Hand the signal on to whoever was installed before us (crash reporters,
+    // the default action)
+    for (int i = 0; i < kFatalSignalCount; ++i) {
+        if (kFatalSignals[i] == signal) sigaction(signal, &g_previous_actions[i], nullptr);
+    }
+    raise(signal);
+}
+
+void installSignalHandlers() {
+    if (g_signal_handlers_installed.exchange(true)) return;
+    // Runs on the faulting thread's stack; a stack overflow will not be recorded
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = onFatalSignal;
+    sigemptyset(&action.sa_mask);
+    for (int i = 0; i < kFatalSignalCount; ++i) {
+        sigaction(kFatalSignals[i], &action, &g_previous_actions[i]);
+    }
+}
+
+} // namespace
+
+MLCFlightRecorder& MLCFlightRecorder::instance() {
+    // Never destroyed: signal handlers and exiting threads may still use it
+    static MLCFlightRecorder* recorder = new MLCFlightRecorder();
+    return *recorder;
+}
+
+uint64_t MLCFlightRecorder::nowNs() {
+    return clockNs(CLOCK_MONOTONIC);
+}
+
+void MLCFlightRecorder::record(MLCFlightEventType type, uint64_t request, uint32_t arg0, int64_t arg1) {
+    FlightRing* ring = threadRing();
+    if (!ring) return;
+    // Single writer per ring; the release store publishes the event to dumps
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    MLCFlightEvent& event = ring->events[head % kEventsPerThread];
+    event.time_ns = nowNs();
+    event.type = static_cast<uint16_t>(type);
+    event.thread = static_cast<uint16_t>(t_slot.serial);
+    event.arg0 = arg0;
+    event.request = request;
+    event.arg1 = arg1;
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void MLCFlightRecorder::nameThread(const char* name) {
+    FlightRing* ring = threadRing();
+    if (!ring) return;
+    strncpy(ring->name, name, sizeof(ring->name) - 1);
+    ring->name[sizeof(ring->name) - 1] = '\0';
+}
+
+void MLCFlightRecorder::configure(const Config& config) {
+    std::thread previous;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        config_ = config;
+        // Published before the handlers can read it; never shrinks under them
+        g_has_dump_path.store(false, std::memory_order_release);
+        if (!config.dump_path.empty() && config.dump_path.size() < sizeof(g_dump_path)) {
+            memcpy(g_dump_path, config.dump_path.c_str(), config.dump_path.size() + 1);
+            g_has_dump_path.store(true, std::memory_order_release);
+        }
+        stopping_ = true;
+        previous = std::move(watchdog_);
+    }
+    cv_.notify_all();
+    if (previous.joinable()) previous.join();
+
+    if (config.install_signal_handlers) installSignalHandlers();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = false;
+    if (config_.stall_timeout.count() > 0 && !config_.dump_path.empty()) {
+        watchdog_ = MLCCpuTopology::startBridgeThread([this]() { runWatchdog(); });
+    }
+}
+
+bool MLCFlightRecorder::dump(const std::string& path, MLCFlightDumpReason reason) {
+    record(MLCFlightEventType::Dump, 0, reason);
+    std::string target;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        target = path.empty() ? config_.dump_path : path;
+    }
+    if (target.empty()) return false;
+    return dumpTo(target.c_str(), reason, 0);
+}
+
+int MLCFlightRecorder::addProbe(ProgressProbe probe) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int id = ++next_probe_id_;
+    probes_[id] = std::move(probe);
+    return id;
+}
+
+void MLCFlightRecorder::removeProbe(int id) {
+    // Probes run under the mutex, so none is running once this returns
+    std::lock_guard<std::mutex> lock(mutex_);
+    probes_.erase(id);
+    stalled_.erase(id);
+}
+
+void MLCFlightRecorder::runWatchdog() {
+    nameThread("flight-watchdog");
+    std::unique_lock<std::mutex> lock(mutex_);
+    std::chrono::milliseconds period = std::min(std::chrono::milliseconds(1000), config_.stall_timeout / 4 + std::chrono::milliseconds(1));
+    while (!stopping_) {
+        cv_.wait_for(lock, period, [this]() { return stopping_; });
+        if (stopping_) break;
+
+        uint64_t now = nowNs();
+        uint64_t timeout_ns = static_cast<uint64_t>(config_.stall_timeout.count()) * 1000000ULL;
+        for (auto& entry : probes_) {
+            uint64_t last_progress = 0;
+            bool busy = entry.second(&last_progress);
+            bool stalled = busy && now > last_progress && now - last_progress > timeout_ns;
+            // One dump per stall
+            if (stalled && !stalled_[entry.first]) {
+                int64_t stalled_ms = static_cast<int64_t>((now - last_progress) / 1000000ULL);
+                record(MLCFlightEventType::Stall, 0, static_cast<uint32_t>(entry.first), stalled_ms);
+                record(MLCFlightEventType::Dump, 0, kFlightDumpStall);
+                dumpTo(config_.dump_path.c_str(), kFlightDumpStall, 0);
+            }
+            stalled_[entry.first] = stalled;
+        }
+    }
+}
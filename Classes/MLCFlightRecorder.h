@@ -0,0 +1,144 @@
+#ifndef MLCFlightRecorder_h
+#define MLCFlightRecorder_h
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Event kinds; values are part of the dump format
+enum class MLCFlightEventType : uint16_t {
+    Submit = 1,           // arg0 estimated prompt tokens, arg1 max_tokens
+    Admit = 2,            // arg0 queue depth, arg1 estimated wait ms
+    Reject = 3,           // arg0 queue depth, arg1 estimated wait ms
+    CacheHit = 4,
+    Dispatch = 5,         // handed to the engine; arg0 prompt tokens
+    AdmissionBatch = 6,   // arg0 requests, arg1 prompt tokens
+    Payload = 7,          // stream-back payload; arg0 request outputs
+    Tokens = 8,           // arg0 new tokens, arg1 completion tokens so far
+    Finish = 9,           // arg0 MLCFlightFinish, arg1 completion tokens
+    Error = 10,
+    Cancel = 11,
+    Reload = 12,          // arg0 0 = start, 1 = done, 2 = failed
+    Stall = 13,           // arg0 watched engine, arg1 ms without progress
+    Dump = 14,            // arg0 MLCFlightDumpReason
+};
+
+enum MLCFlightFinish : uint32_t {
+    kFlightFinishOther = 0,
+    kFlightFinishStop = 1,
+    kFlightFinishLength = 2,
+    kFlightFinishRepetition = 3,
+};
+
+enum MLCFlightDumpReason : uint32_t {
+    kFlightDumpRequested = 0,
+    kFlightDumpStall = 1,
+    kFlightDumpSignal = 2,   // the signal number is in the file header
+};
+
+// Dump file layout, all little-endian as written by the host:
+//   MLCFlightDumpHeader, then per thread ring an MLCFlightRingHeader followed
+//   by `capacity` MLCFlightEvent slots. A ring's newest event is at
+//   (head - 1) % capacity; slots with time_ns == 0 were never written.
+struct MLCFlightEvent {
+    uint64_t time_ns;   // steady clock
+    uint16_t type;      // MLCFlightEventType
+    uint16_t thread;    // writer's thread serial
+    uint32_t arg0;
+    uint64_t request;   // request sequence number, 0 for engine-wide events
+    int64_t arg1;
+};
+static_assert(sizeof(MLCFlightEvent) == 32, "MLCFlightEvent is part of the dump format");
+
+struct MLCFlightDumpHeader {
+    char magic[8];             // "MLCFLT01"
+    uint32_t event_size;
+    uint32_t ring_count;
+    uint32_t reason;           // MLCFlightDumpReason
+    int32_t signal;
+    uint64_t dump_steady_ns;   // clocks read together at dump time, to place
+    uint64_t dump_unix_ns;     // steady timestamps on the wall clock
+};
+
+struct MLCFlightRingHeader {
+    char thread_name[16];
+    uint32_t thread;           // serial of the thread that last owned the ring
+    uint32_t capacity;
+    uint64_t head;             // events ever written to the ring
+};
+
+inline const char* MLCFlightEventName(uint16_t type) {
+    switch (static_cast<MLCFlightEventType>(type)) {
+        case MLCFlightEventType::Submit: return "submit";
+        case MLCFlightEventType::Admit: return "admit";
+        case MLCFlightEventType::Reject: return "reject";
+        case MLCFlightEventType::CacheHit: return "cache-hit";
+        case MLCFlightEventType::Dispatch: return "dispatch";
+        case MLCFlightEventType::AdmissionBatch: return "admission-batch";
+        case MLCFlightEventType::Payload: return "payload";
+        case MLCFlightEventType::Tokens: return "tokens";
+        case MLCFlightEventType::Finish: return "finish";
+        case MLCFlightEventType::Error: return "error";
+        case MLCFlightEventType::Cancel: return "cancel";
+        case MLCFlightEventType::Reload: return "reload";
+        case MLCFlightEventType::Stall: return "stall";
+        case MLCFlightEventType::Dump: return "dump";
+    }
+    return "unknown";
+}
+
+// Process-wide flight recorder. Every thread that records gets its own ring
+// of the last kEventsPerThread events, so recording is a clock read and one
+// 32-byte store with no lock or shared cache line; an idle engine records
+// nothing. Rings are dumped on request, when a watched engine stalls, or
+// from a fatal-signal handler (the dump path is async-signal-safe).
+class MLCFlightRecorder {
+public:
+    static constexpr uint32_t kEventsPerThread = 1024;
+    static constexpr int kMaxRings = 64;
+
+    struct Config {
+        std::string dump_path;   // automatic dumps go here; empty disables them
+        std::chrono::milliseconds stall_timeout{10000};   // 0 disables the watchdog
+        bool install_signal_handlers = false;
+    };
+
+    // Reports whether an engine has work in flight and when it last made progress
+    using ProgressProbe = std::function<bool(uint64_t* last_progress_ns)>;
+
+    static MLCFlightRecorder& instance();
+
+    static void record(MLCFlightEventType type, uint64_t request = 0, uint32_t arg0 = 0, int64_t arg1 = 0);
+    // Names the calling thread in dumps (at most 15 bytes are kept)
+    static void nameThread(const char* name);
+    static uint64_t nowNs();
+
+    void configure(const Config& config);
+    // `path` empty uses the configured dump path
+    bool dump(const std::string& path, MLCFlightDumpReason reason);
+
+    int addProbe(ProgressProbe probe);
+    void removeProbe(int id);
+
+private:
+    MLCFlightRecorder() = default;
+
+    void runWatchdog();
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    Config config_;
+    bool stopping_ = false;
+    std::thread watchdog_;
+    int next_probe_id_ = 0;
+    std::map<int, ProgressProbe> probes_;
+    std::map<int, bool> stalled_;
+};
+
+#endif /* MLCFlightRecorder_h */
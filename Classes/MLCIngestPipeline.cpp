@@ -0,0 +1,411 @@
+#include "MLCIngestPipeline.h"
+#include "MLCCpuTopology.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <dirent.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__APPLE__)
+#include <pthread/qos.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+
+const uint64_t kFnvOffset = 1469598103934665603ULL;
+const uint64_t kFnvPrime = 1099511628211ULL;
+
+uint64_t contentHash(const std::string& data) {
+    uint64_t hash = kFnvOffset;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= kFnvPrime;
+    }
+    return hash;
+}
+
+int64_t mtimeNs(const struct stat& info) {
+#if defined(__APPLE__)
+    return static_cast<int64_t>(info.st_mtimespec.tv_sec) * 1000000000LL + info.st_mtimespec.tv_nsec;
+#else
+    return static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000LL + info.st_mtim.tv_nsec;
+#endif
+}
+
+// Ingestion must never compete with interactive inference for CPU
+void lowerThreadPriority() {
+#if defined(__APPLE__)
+    pthread_set_qos_class_self_np(QOS_CLASS_BACKGROUND, 0);
+#elif defined(__linux__)
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+#endif
+}
+
+std::vector<std::string> splitParagraphs(const std::string& text) {
+    std::vector<std::string> paragraphs;
+    std::istringstream lines(text);
+    std::string line;
+    std::string current;
+    while (std::getline(lines, line)) {
+        bool blank = line.find_first_not_of(" \t\r") == std::string::npos;
+        if (blank) {
+            if (!current.empty()) paragraphs.push_back(std::move(current));
+            current.clear();
+            continue;
+        }
+        if (!current.empty()) current += '\n';
+        current += line;
+    }
+    if (!current.empty()) paragraphs.push_back(std::move(current));
+    return paragraphs;
+}
+
+} // namespace
+
+MLCIngestPipeline::MLCIngestPipeline(MLCIngestConfig config, Encoder encoder, Decoder decoder, BusyCheck busy,
+                                     MLCDocumentIndex* index, MLCMetrics* metrics)
+    : config_(std::move(config)),
+      encoder_(std::move(encoder)),
+      decoder_(std::move(decoder)),
+      busy_(std::move(busy)),
+      index_(index),
+      metrics_(metrics),
+      work_queue_(config_.queue_capacity),
+      update_queue_(config_.queue_capacity) {}
+
+MLCIngestPipeline::~MLCIngestPipeline() {
+    stop();
+}
+
+void MLCIngestPipeline::start() {
+    watcher_thread_ = MLCCpuTopology::startBridgeThread([this]() { watchLoop(); });
+    for (int i = 0; i < std::max(1, config_.parser_threads); ++i) {
+        parser_threads_.push_back(MLCCpuTopology::startBridgeThread([this]() { parseLoop(); }));
+    }
+    indexer_thread_ = MLCCpuTopology::startBridgeThread([this]() { indexLoop(); });
+}
+
+void MLCIngestPipeline::stop() {
+    if (stopping_.exchange(true)) return;
+    // Upstream first: the watcher and parsers stop taking work, the indexer
+    // still drains what the parsers hand over
+    work_queue_.close();
+    if (watcher_thread_.joinable()) watcher_thread_.join();
+    for (std::thread& thread : parser_threads_) {
+        if (thread.joinable()) thread.join();
+    }
+    update_queue_.close();
+    if (indexer_thread_.joinable()) indexer_thread_.join();
+}
+
+bool MLCIngestPipeline::matchesExtension(const std::string& path) const {
+    for (const std::string& extension : config_.extensions) {
+        if (path.size() >= extension.size() &&
+            path.compare(path.size() - extension.size(), extension.size(), extension) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void MLCIngestPipeline::waitUntilIdle() const {
+    while (!stopping_ && busy_ && busy_()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+void MLCIngestPipeline::enqueue(const std::string& path, bool only_if_changed) {
+    struct stat info;
+    bool exists = stat(path.c_str(), &info) == 0;
+
+    uint64_t generation;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        if (only_if_changed && exists) {
+            auto it = committed_.find(path);
+            if (it != committed_.end() && it->second.mtime_ns == mtimeNs(info) &&
+                it->second.size == static_cast<int64_t>(info.st_size)) {
+                return;
+            }
+        }
+        // A queued path is read when dequeued, which picks up later changes too
+        if (!queued_.insert(path).second) return;
+        generation = next_generation_++;
+        generations_[path] = generation;
+    }
+    work_queue_.push(WorkItem{path, generation});
+}
+
+void MLCIngestPipeline::scanDirectory(const std::string& directory, std::unordered_set<std::string>* seen) {
+#if defined(__linux__)
+    if (inotify_fd_ >= 0) {
+        int wd = inotify_add_watch(inotify_fd_, directory.c_str(),
+                                   IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CREATE | IN_ONLYDIR);
+        if (wd >= 0) {
+            watch_dirs_[wd] = directory;
+        } else {
+            std::cerr << "⚠️ Cannot watch " << directory << ": " << std::strerror(errno) << std::endl;
+        }
+    }
+#endif
+
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) return;
+    while (struct dirent* entry = readdir(dir)) {
+        if (stopping_) break;
+        if (entry->d_name[0] == '.') continue;
+        std::string path = directory + "/" + entry->d_name;
+        struct stat info;
+        // lstat: symlinked directories could loop
+        if (lstat(path.c_str(), &info) != 0) continue;
+        if (S_ISDIR(info.st_mode)) {
+            scanDirectory(path, seen);
+        } else if (S_ISREG(info.st_mode) && matchesExtension(path)) {
+            seen->insert(path);
+            enqueue(path, true);
+        }
+    }
+    closedir(dir);
+}
+
+void MLCIngestPipeline::rescan() {
+    std::unordered_set<std::string> seen;
+    for (const std::string& directory : config_.directories) {
+        scanDirectory(directory, &seen);
+    }
+
+    // Indexed files that no longer exist
+    std::vector<std::string> missing;
+    {
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        for (const auto& file : committed_) {
+            if (!seen.count(file.first)) missing.push_back(file.first);
+        }
+    }
+    for (const std::string& path : missing) {
+        enqueue(path, false);
+    }
+}
+
+void MLCIngestPipeline::watchLoop() {
+    lowerThreadPriority();
+
+#if defined(__linux__)
+    inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd_ < 0) {
+        std::cerr << "⚠️ inotify unavailable, falling back to rescans: " << std::strerror(errno) << std::endl;
+    }
+#endif
+
+    rescan();
+
+#if defined(__linux__)
+    if (inotify_fd_ >= 0) {
+        alignas(struct inotify_event) char buffer[16 * 1024];
+        while (!stopping_) {
+            struct pollfd pfd;
+            pfd.fd = inotify_fd_;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            // Bounded wait so stop() is noticed promptly
+            if (poll(&pfd, 1, 250) <= 0) continue;
+
+            ssize_t length = read(inotify_fd_, buffer, sizeof(buffer));
+            for (ssize_t offset = 0; offset < length && !stopping_;) {
+                const auto* event = reinterpret_cast<const struct inotify_event*>(buffer + offset);
+                offset += static_cast<ssize_t>(sizeof(struct inotify_event) + event->len);
+
+                if (event->mask & IN_Q_OVERFLOW) {
+                    // Events were lost; a rescan re-establishes the truth
+                    rescan();
+                    continue;
+                }
+                auto dir = watch_dirs_.find(event->wd);
+                if (dir == watch_dirs_.end()) continue;
+                if (event->mask & IN_IGNORED) {
+                    watch_dirs_.erase(dir);
+                    continue;
+                }
+                if (event->len == 0 || event->name[0] == '.') continue;
+                std::string path = dir->second + "/" + event->name;
+
+                if (event->mask & IN_ISDIR) {
+                    if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                        std::unordered_set<std::string> seen;
+                        scanDirectory(path, &seen);
+                    } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                        std::vector<std::string> removed;
+                        {
+                            std::lock_guard<std::mutex> lock(state_mutex_);
+                            std::string prefix = path + "/";
+                            for (const auto& file : committed_) {
+                                if (file.first.compare(0, prefix.size(), prefix) == 0) removed.push_back(file.first);
+                            }
+                        }
+                        for (const std::string& file : removed) enqueue(file, false);
+                    }
+                    continue;
+                }
+                // Creation is followed by IN_CLOSE_WRITE once the writer is done
+                if (matchesExtension(path) &&
+                    (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM))) {
+                    enqueue(path, false);
+                }
+            }
+        }
+        close(inotify_fd_);
+        inotify_fd_ = -1;
+        return;
+    }
+#endif
+
+    while (!stopping_) {
+        for (int waited = 0; waited < config_.poll_interval_ms && !stopping_; waited += 50) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        if (!stopping_) rescan();
+    }
+}
+
+void MLCIngestPipeline::parseLoop() {
+    lowerThreadPriority();
+
+    WorkItem item;
+    while (work_queue_.pop(&item)) {
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            queued_.erase(item.path);
+        }
+
+        IndexUpdate update;
+        update.path = item.path;
+        update.generation = item.generation;
+
+        struct stat info;
+        if (stat(item.path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+            update.removed = true;
+        } else if (static_cast<size_t>(info.st_size) > config_.max_file_bytes) {
+            std::cerr << "⚠️ Skipping " << item.path << " (" << info.st_size << " bytes)" << std::endl;
+            update.removed = true;
+        } else {
+            std::ifstream file(item.path, std::ios::binary);
+            std::string text((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+            update.mtime_ns = mtimeNs(info);
+            update.size = static_cast<int64_t>(info.st_size);
+            update.content_hash = contentHash(text);
+
+            bool unchanged = false;
+            {
+                std::lock_guard<std::mutex> lock(state_mutex_);
+                auto it = committed_.find(item.path);
+                if (it != committed_.end() && it->second.content_hash == update.content_hash) {
+                    // Touched but identical; remember the new stat so scans skip it
+                    it->second.mtime_ns = update.mtime_ns;
+                    it->second.size = update.size;
+                    unchanged = true;
+                }
+            }
+            if (unchanged) {
+                metrics_->ingest_files_unchanged++;
+                continue;
+            }
+
+            waitUntilIdle();
+            if (stopping_) break;
+            update.chunks = chunkText(item.path, text);
+            if (stopping_) break;
+        }
+
+        if (!update_queue_.push(std::move(update))) break;
+    }
+}
+
+void MLCIngestPipeline::indexLoop() {
+    lowerThreadPriority();
+
+    IndexUpdate update;
+    while (update_queue_.pop(&update)) {
+        bool was_indexed;
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            // Parsers run in parallel; never let an older read replace a newer one
+            uint64_t& applied = applied_[update.path];
+            if (applied > update.generation) continue;
+            applied = update.generation;
+            was_indexed = committed_.count(update.path) != 0;
+        }
+
+        if (update.removed) {
+            index_->removeFile(update.path);
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            committed_.erase(update.path);
+            if (was_indexed) metrics_->ingest_files_removed++;
+            continue;
+        }
+
+        size_t chunks = update.chunks.size();
+        uint64_t tokens = 0;
+        for (const MLCDocumentChunk& chunk : update.chunks) tokens += chunk.token_ids.size();
+        index_->replaceFile(update.path, std::move(update.chunks));
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            committed_[update.path] = FileState{update.mtime_ns, update.size, update.content_hash};
+        }
+        metrics_->ingest_files_indexed++;
+        metrics_->ingest_chunks_indexed += chunks;
+        metrics_->ingest_tokens_indexed += tokens;
+    }
+}
+
+std::vector<MLCDocumentChunk> MLCIngestPipeline::chunkText(const std::string& path, const std::string& text) const {
+    const size_t limit = static_cast<size_t>(std::max(1, config_.chunk_tokens));
+    const size_t overlap = std::min(static_cast<size_t>(std::max(0, config_.chunk_overlap_tokens)), limit - 1);
+
+    std::vector<MLCDocumentChunk> chunks;
+    MLCDocumentChunk current;
+    auto emit = [&chunks, &path](MLCDocumentChunk* chunk) {
+        if (chunk->token_ids.empty()) return;
+        chunk->path = path;
+        chunk->chunk_index = static_cast<int>(chunks.size());
+        chunks.push_back(std::move(*chunk));
+        *chunk = MLCDocumentChunk();
+    };
+
+    for (const std::string& paragraph : splitParagraphs(text)) {
+        if (stopping_) break;
+        std::vector<int32_t> ids = encoder_(paragraph);
+        if (ids.size() > limit) {
+            // Too long for one chunk: overlapping token windows
+            emit(&current);
+            for (size_t start = 0; start < ids.size(); start += limit - overlap) {
+                size_t end = std::min(ids.size(), start + limit);
+                MLCDocumentChunk window;
+                window.token_ids.assign(ids.begin() + static_cast<std::ptrdiff_t>(start),
+                                        ids.begin() + static_cast<std::ptrdiff_t>(end));
+                window.text = decoder_(window.token_ids);
+                emit(&window);
+                if (end == ids.size()) break;
+            }
+            continue;
+        }
+        if (current.token_ids.size() + ids.size() > limit) emit(&current);
+        if (!current.text.empty()) current.text += "\n\n";
+        current.text += paragraph;
+        current.token_ids.insert(current.token_ids.end(), ids.begin(), ids.end());
+    }
+    emit(&current);
+    return chunks;
+}
@@ -0,0 +1,125 @@
+#ifndef MLCIngestPipeline_h
+#define MLCIngestPipeline_h
+
+#include "MLCBoundedQueue.h"
+#include "MLCDocumentIndex.h"
+#include "MLCMetrics.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+struct MLCIngestConfig {
+    std::vector<std::string> directories;
+    // Only files with these suffixes are ingested
+    std::vector<std::string> extensions = {".txt", ".md"};
+    int chunk_tokens = 256;
+    // Token overlap between windows of a paragraph longer than chunk_tokens
+    int chunk_overlap_tokens = 32;
+    int parser_threads = 2;
+    // Capacity of each inter-stage queue
+    size_t queue_capacity = 64;
+    // Larger files are skipped
+    size_t max_file_bytes = 4 * 1024 * 1024;
+    // Rescan period where inotify is unavailable
+    int poll_interval_ms = 2000;
+};
+
+// Background document ingestion feeding an MLCDocumentIndex:
+//
+//   watcher --(paths)--> parsers x N --(chunks)--> indexer
+//
+// The watcher does an initial scan and then follows inotify events (Linux) or
+// rescans periodically (elsewhere). Parsers read, chunk and tokenize changed
+// files with the model tokenizer. The indexer applies whole-file updates.
+// Stages are joined by bounded queues, so a slow stage blocks the ones before
+// it. All threads run at background priority. Parsers also pause while `busy`
+// reports interactive work in flight.
+//
+// Files whose size and mtime are unchanged are not re-read, and files whose
+// content hash is unchanged are not re-tokenized.
+class MLCIngestPipeline {
+public:
+    using Encoder = std::function<std::vector<int32_t>(const std::string&)>;
+    using Decoder = std::function<std::string(const std::vector<int32_t>&)>;
+    using BusyCheck = std::function<bool()>;
+
+    MLCIngestPipeline(MLCIngestConfig config, Encoder encoder, Decoder decoder, BusyCheck busy,
+                      MLCDocumentIndex* index, MLCMetrics* metrics);
+    ~MLCIngestPipeline();
+
+    MLCIngestPipeline(const MLCIngestPipeline&) = delete;
+    MLCIngestPipeline& operator=(const MLCIngestPipeline&) = delete;
+
+    void start();
+    void stop();
+
+    // Splits text into chunks of at most chunk_tokens real tokens, keeping
+    // paragraphs whole where they fit
+    std::vector<MLCDocumentChunk> chunkText(const std::string& path, const std::string& text) const;
+
+private:
+    struct WorkItem {
+        std::string path;
+        uint64_t generation = 0;
+    };
+
+    struct IndexUpdate {
+        std::string path;
+        uint64_t generation = 0;
+        bool removed = false;
+        int64_t mtime_ns = 0;
+        int64_t size = 0;
+        uint64_t content_hash = 0;
+        std::vector<MLCDocumentChunk> chunks;
+    };
+
+    struct FileState {
+        int64_t mtime_ns = 0;
+        int64_t size = 0;
+        uint64_t content_hash = 0;
+    };
+
+    void watchLoop();
+    void parseLoop();
+    void indexLoop();
+
+    void scanDirectory(const std::string& directory, std::unordered_set<std::string>* seen);
+    void rescan();
+    void enqueue(const std::string& path, bool only_if_changed);
+    bool matchesExtension(const std::string& path) const;
+    void waitUntilIdle() const;
+
+    MLCIngestConfig config_;
+    Encoder encoder_;
+    Decoder decoder_;
+    BusyCheck busy_;
+    MLCDocumentIndex* index_;
+    MLCMetrics* metrics_;
+
+    MLCBoundedQueue<WorkItem> work_queue_;
+    MLCBoundedQueue<IndexUpdate> update_queue_;
+    std::atomic<bool> stopping_{false};
+    std::thread watcher_thread_;
+    std::vector<std::thread> parser_threads_;
+    std::thread indexer_thread_;
+
+    std::mutex state_mutex_;
+    std::unordered_map<std::string, FileState> committed_;   // as last indexed
+    std::unordered_map<std::string, uint64_t> generations_;  // latest enqueued
+    std::unordered_map<std::string, uint64_t> applied_;      // latest indexed
+    std::unordered_set<std::string> queued_;
+    uint64_t next_generation_ = 1;
+
+#if defined(__linux__)
+    int inotify_fd_ = -1;
+    std::unordered_map<int, std::string> watch_dirs_;
+#endif
+};
+
+#endif /* MLCIngestPipeline_h */
@@ -0,0 +1,364 @@
+#include "MLCJson.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+class Parser {
+public:
+    explicit Parser(const std::string& text) : text_(text), pos_(0) {}
+
+    bool parseDocument(MLCJsonValue* out, std::string* error) {
+        skipWhitespace();
+        if (!parseValue(out, 0)) {
+            if (error) *error = error_ + " at offset " + std::to_string(pos_);
+            return false;
+        }
+        skipWhitespace();
+        if (pos_ != text_.size()) {
+            if (error) *error = "trailing characters at offset " + std::to_string(pos_);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static constexpr int kMaxDepth = 128;
+
+    const std::string& text_;
+    size_t pos_;
+    std::string error_;
+
+    bool fail(const char* message) {
+        error_ = message;
+        return false;
+    }
+
+    void skipWhitespace() {
+        while (pos_ < text_.size()) {
+            char c = text_[pos_];
+            if (c != ' ' && c != '\t' && c != '\n' && c != '\r') break;
+            ++pos_;
+        }
+    }
+
+    bool consumeLiteral(const char* literal) {
+        size_t i = 0;
+        while (literal[i]) {
+            if (pos_ + i >= text_.size() || text_[pos_ + i] != literal[i]) return false;
+            ++i;
+        }
+        pos_ += i;
+        return true;
+    }
+
+    bool parseValue(MLCJsonValue* out, int depth) {
+        if (depth > kMaxDepth) return fail("nesting too deep");
+        if (pos_ >= text_.size()) return fail("unexpected end of input");
+
+        char c = text_[pos_];
+        if (c == '{') return parseObject(out, depth);
+        if (c == '[') return parseArray(out, depth);
+        if (c == '"') {
+            out->type = MLCJsonValue::Type::String;
+            return parseString(&out->string);
+        }
+        if (c == 't' && consumeLiteral("true")) {
+            out->type = MLCJsonValue::Type::Bool;
+            out->boolean = true;
+            return true;
+        }
+        if (c == 'f' && consumeLiteral("false")) {
+            out->type = MLCJsonValue::Type::Bool;
+            out->boolean = false;
+            return true;
+        }
+        if (c == 'n' && consumeLiteral("null")) {
+            out->type = MLCJsonValue::Type::Null;
+            return true;
+        }
+        if (c == '-' || (c >= '0' && c <= '9')) return parseNumber(out);
+        return fail("unexpected character");
+    }
+
+    bool parseObject(MLCJsonValue* out, int depth) {
+        out->type = MLCJsonValue::Type::Object;
+        ++pos_;
+        skipWhitespace();
+        if (pos_ < text_.size() && text_[pos_] == '}') {
+            ++pos_;
+            return true;
+        }
+        while (true) {
+            skipWhitespace();
+            if (pos_ >= text_.size() || text_[pos_] != '"') return fail("expected object key");
+            std::string key;
+            if (!parseString(&key)) return false;
+            skipWhitespace();
+            if (pos_ >= text_.size() || text_[pos_] != ':') return fail("expected ':'");
+            ++pos_;
+            skipWhitespace();
+            out->object.emplace_back(std::move(key), MLCJsonValue());
+            if (!parseValue(&out->object.back().second, depth + 1)) return false;
+            skipWhitespace();
+            if (pos_ >= text_.size()) return fail("unterminated object");
+            if (text_[pos_] == ',') {
+                ++pos_;
+                continue;
+            }
+            if (text_[pos_] == '}') {
+                ++pos_;
+                return true;
+            }
+            return fail("expected ',' or '}'");
+        }
+    }
+
+    bool parseArray(MLCJsonValue* out, int depth) {
+        out->type = MLCJsonValue::Type::Array;
+        ++pos_;
+        skipWhitespace();
+        if (pos_ < text_.size() && text_[pos_] == ']') {
+            ++pos_;
+            return true;
+        }
+        while (true) {
+            skipWhitespace();
+            out->array.emplace_back();
+            if (!parseValue(&out->array.back(), depth + 1)) return false;
+            skipWhitespace();
+            if (pos_ >= text_.size()) return fail("unterminated array");
+            if (text_[pos_] == ',') {
+                ++pos_;
+                continue;
+            }
+            if (text_[pos_] == ']') {
+                ++pos_;
+                return true;
+            }
+            return fail("expected ',' or ']'");
+        }
+    }
+
+    bool parseHex4(unsigned* out) {
+        if (pos_ + 4 > text_.size()) return fail("truncated unicode escape");
+        unsigned value = 0;
+        for (int i = 0; i < 4; ++i) {
+            char c = text_[pos_++];
+            value <<= 4;
+            if (c >= '0' && c <= '9') value |= c - '0';
+            else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+            else return fail("invalid unicode escape");
+        }
+        *out = value;
+        return true;
+    }
+
+    static void appendUtf8(std::string* out, unsigned codepoint) {
+        if (codepoint < 0x80) {
+            out->push_back(static_cast<char>(codepoint));
+        } else if (codepoint < 0x800) {
+            out->push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+            out->push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+        } else if (codepoint < 0x10000) {
+            out->push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+            out->push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+            out->push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+        } else {
+            out->push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
+            out->push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+            out->push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+            out->push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+        }
+    }
+
+    bool parseString(std::string* out) {
+        ++pos_; // opening quote
+        while (pos_ < text_.size()) {
+            char c = text_[pos_++];
+            if (c == '"') return true;
+            if (c != '\\') {
+                out->push_back(c);
+                continue;
+            }
+            if (pos_ >= text_.size()) break;
+            char escaped = text_[pos_++];
+            switch (escaped) {
+                case '"': out->push_back('"'); break;
+                case '\\': out->push_back('\\'); break;
+                case '/': out->push_back('/'); break;
+                case 'b': out->push_back('\b'); break;
+                case 'f': out->push_back('\f'); break;
+                case 'n': out->push_back('\n'); break;
+                case 'r': out->push_back('\r'); break;
+                case 't': out->push_back('\t'); break;
+                case 'u': {
+                    unsigned codepoint = 0;
+                    if (!parseHex4(&codepoint)) return false;
+                    if (codepoint >= 0xD800 && codepoint <= 0xDBFF &&
+                        pos_ + 1 < text_.size() && text_[pos_] == '\\' && text_[pos_ + 1] == 'u') {
+                        pos_ += 2;
+                        unsigned low = 0;
+                        if (!parseHex4(&low)) return false;
+                        if (low >= 0xDC00 && low <= 0xDFFF) {
+                            codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                        } else {
+                            appendUtf8(out, 0xFFFD);
+                            codepoint = low;
+                        }
+                    }
+                    appendUtf8(out, codepoint);
+                    break;
+                }
+                default:
+                    return fail("invalid escape sequence");
+            }
+        }
+        return fail("unterminated string");
+    }
+
+    bool parseNumber(MLCJsonValue* out) {
+        size_t start = pos_;
+        if (text_[pos_] == '-') ++pos_;
+        while (pos_ < text_.size()) {
+            char c = text_[pos_];
+            if ((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-') {
+                ++pos_;
+            } else {
+                break;
+            }
+        }
+        std::string literal = text_.substr(start, pos_ - start);
+        char* end = nullptr;
+        double value = std::strtod(literal.c_str(), &end);
+        if (end == literal.c_str() || *end != '\0') return fail("invalid number");
+        out->type = MLCJsonValue::Type::Number;
+        out->number = value;
+        return true;
+    }
+};
+
+void serializeInto(const MLCJsonValue& value, std::string* out) {
+    switch (value.type) {
+        case MLCJsonValue::Type::Null:
+            out->append("null");
+            break;
+        case MLCJsonValue::Type::Bool:
+            out->append(value.boolean ? "true" : "false");
+            break;
+        case MLCJsonValue::Type::Number: {
+            if (!std::isfinite(value.number)) {
+                out->append("null");
+            } else if (value.number == std::floor(value.number) && std::fabs(value.number) < 1e15) {
+                out->append(std::to_string(static_cast<long long>(value.number)));
+            } else {
+                char buffer[32];
+                std::snprintf(buffer, sizeof(buffer), "%.17g", value.number);
+                out->append(buffer);
+            }
+            break;
+        }
+        case MLCJsonValue::Type::String:
+            out->push_back('"');
+            out->append(MLCJson::escape(value.string));
+            out->push_back('"');
+            break;
+        case MLCJsonValue::Type::Array:
+            out->push_back('[');
+            for (size_t i = 0; i < value.array.size(); ++i) {
+                if (i) out->push_back(',');
+                serializeInto(value.array[i], out);
+            }
+            out->push_back(']');
+            break;
+        case MLCJsonValue::Type::Object:
+            out->push_back('{');
+            for (size_t i = 0; i < value.object.size(); ++i) {
+                if (i) out->push_back(',');
+                out->push_back('"');
+                out->append(MLCJson::escape(value.object[i].first));
+                out->append("\":");
+                serializeInto(value.object[i].second, out);
+            }
+            out->push_back('}');
+            break;
+    }
+}
+
+} // namespace
+
+const MLCJsonValue* MLCJsonValue::get(const std::string& key) const {
+    if (type != Type::Object) return nullptr;
+    for (const auto& member : object) {
+        if (member.first == key) return &member.second;
+    }
+    return nullptr;
+}
+
+std::string MLCJsonValue::asString(const std::string& fallback) const {
+    return type == Type::String ? string : fallback;
+}
+
+double MLCJsonValue::asNumber(double fallback) const {
+    return type == Type::Number ? number : fallback;
+}
+
+int MLCJsonValue::asInt(int fallback) const {
+    return type == Type::Number ? static_cast<int>(number) : fallback;
+}
+
+bool MLCJsonValue::asBool(bool fallback) const {
+    return type == Type::Bool ? boolean : fallback;
+}
+
+bool MLCJson::parse(const std::string& text, MLCJsonValue* out, std::string* error) {
+    *out = MLCJsonValue();
+    Parser parser(text);
+    return parser.parseDocument(out, error);
+}
+
+bool MLCJson::parseFile(const std::string& path, MLCJsonValue* out, std::string* error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        if (error) *error = "cannot open " + path;
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return parse(buffer.str(), out, error);
+}
+
+std::string MLCJson::escape(const std::string& text) {
+    std::string out;
+    out.reserve(text.size() + 8);
+    for (unsigned char c : text) {
+        switch (c) {
+            case '"': out.append("\\\""); break;
+            case '\\': out.append("\\\\"); break;
+            case '\b': out.append("\\b"); break;
+            case '\f': out.append("\\f"); break;
+            case '\n': out.append("\\n"); break;
+            case '\r': out.append("\\r"); break;
+            case '\t': out.append("\\t"); break;
+            default:
+                if (c < 0x20) {
+                    char buffer[8];
+                    std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                    out.append(buffer);
+                } else {
+                    out.push_back(static_cast<char>(c));
+                }
+        }
+    }
+    return out;
+}
+
+std::string MLCJson::serialize(const MLCJsonValue& value) {
+    std::string out;
+    serializeInto(value, &out);
+    return out;
+}
@@ -0,0 +1,50 @@
+#ifndef MLCJson_h
+#define MLCJson_h
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Minimal JSON document model used by the bridge to read MLC-LLM stream-back
+// payloads and model configuration files. Objects keep their key order.
+struct MLCJsonValue {
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<MLCJsonValue> array;
+    std::vector<std::pair<std::string, MLCJsonValue>> object;
+
+    bool isNull() const { return type == Type::Null; }
+    bool isString() const { return type == Type::String; }
+    bool isNumber() const { return type == Type::Number; }
+    bool isArray() const { return type == Type::Array; }
+    bool isObject() const { return type == Type::Object; }
+
+    // Returns the member named `key`, or nullptr if this is not an object or the key is absent
+    const MLCJsonValue* get(const std::string& key) const;
+
+    std::string asString(const std::string& fallback = "") const;
+    double asNumber(double fallback = 0.0) const;
+    int asInt(int fallback = 0) const;
+    bool asBool(bool fallback = false) const;
+};
+
+class MLCJson {
+public:
+    // Parses a complete JSON document. Returns false and fills `error` on malformed input.
+    static bool parse(const std::string& text, MLCJsonValue* out, std::string* error = nullptr);
+
+    // Reads and parses a JSON file from disk
+    static bool parseFile(const std::string& path, MLCJsonValue* out, std::string* error = nullptr);
+
+    // Escapes `text` for embedding inside a JSON string literal (without surrounding quotes)
+    static std::string escape(const std::string& text);
+
+    // Serializes a value back to compact JSON
+    static std::string serialize(const MLCJsonValue& value);
+};
+
+#endif /* MLCJson_h */
@@ -0,0 +1,405 @@
+#include "MLCJsonStream.h"
+#include <cstdlib>
+
+namespace {
+
+bool isWhitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+bool isScalarChar(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           c == '.' || c == '+' || c == '-';
+}
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+} // namespace
+
+MLCJsonStream::MLCJsonStream(const std::vector<std::string>& paths, Callback callback)
+    : callback_(std::move(callback)),
+      state_(State::Preamble),
+      string_is_key_(false),
+      string_escape_(false),
+      unicode_digits_(0),
+      unicode_value_(0),
+      high_surrogate_(0),
+      string_emitted_(0) {
+    for (const std::string& path : paths) {
+        std::vector<Segment> segments;
+        if (!parsePath(path, &segments)) {
+            // Keep indices aligned with the caller's list; an unparsable path never matches
+            segments.clear();
+            segments.push_back(Segment{true, false, "", -1});
+        }
+        subscriptions_.push_back(std::move(segments));
+    }
+}
+
+bool MLCJsonStream::parsePath(const std::string& path, std::vector<Segment>* out) {
+    size_t pos = 0;
+    if (pos < path.size() && path[pos] == '$') ++pos;
+    if (pos < path.size() && path[pos] == '.') ++pos;
+
+    while (pos < path.size()) {
+        if (path[pos] == '[') {
+            size_t close = path.find(']', pos);
+            if (close == std::string::npos) return false;
+            std::string inner = path.substr(pos + 1, close - pos - 1);
+            Segment segment{true, inner == "*", "", 0};
+            if (!segment.wildcard) {
+                if (inner.empty()) return false;
+                char* end = nullptr;
+                segment.index = std::strtoll(inner.c_str(), &end, 10);
+                if (*end != '\0' || segment.index < 0) return false;
+            }
+            out->push_back(segment);
+            pos = close + 1;
+            if (pos < path.size() && path[pos] == '.') ++pos;
+        } else {
+            size_t end = path.find_first_of(".[", pos);
+            if (end == std::string::npos) end = path.size();
+            std::string key = path.substr(pos, end - pos);
+            if (key.empty()) return false;
+            out->push_back(Segment{false, key == "*", key, 0});
+            pos = end;
+            if (pos < path.size() && path[pos] == '.') ++pos;
+        }
+    }
+    return true;
+}
+
+bool MLCJsonStream::matches(const std::vector<Segment>& pattern) const {
+    if (pattern.size() != stack_.size()) return false;
+    for (size_t i = 0; i < pattern.size(); ++i) {
+        const Segment& segment = pattern[i];
+        const Frame& frame = stack_[i];
+        if (frame.is_object) {
+            if (segment.is_index) return false;
+            if (!segment.wildcard && segment.key != frame.key) return false;
+        } else {
+            if (!segment.is_index) return false;
+            if (!segment.wildcard && segment.index != frame.index) return false;
+        }
+    }
+    return true;
+}
+
+void MLCJsonStream::matchCurrent(std::vector<int>* out) const {
+    out->clear();
+    for (size_t i = 0; i < subscriptions_.size(); ++i) {
+        if (matches(subscriptions_[i])) out->push_back(static_cast<int>(i));
+    }
+}
+
+std::string MLCJsonStream::currentPath() const {
+    if (stack_.empty()) return "$";
+    std::string path;
+    for (const Frame& frame : stack_) {
+        if (frame.is_object) {
+            if (!path.empty()) path.push_back('.');
+            path.append(frame.key);
+        } else {
+            path.push_back('[');
+            path.append(std::to_string(frame.index));
+            path.push_back(']');
+        }
+    }
+    return path;
+}
+
+void MLCJsonStream::emit(MLCJsonStreamEvent::Kind kind, MLCJsonValue::Type type, int subscription,
+                         const std::string& path, const std::string& data) {
+    if (!callback_) return;
+    MLCJsonStreamEvent event{kind, type, subscription, path, data};
+    callback_(event);
+}
+
+void MLCJsonStream::feed(const std::string& text) {
+    for (char c : text) {
+        if (state_ == State::Done || state_ == State::Failed) break;
+        for (Capture& capture : captures_) {
+            capture.raw.push_back(c);
+        }
+        processChar(c);
+    }
+    if (state_ == State::InString && !string_is_key_) {
+        flushStringDelta();
+    }
+}
+
+void MLCJsonStream::beginValue(char c) {
+    std::vector<int> matched;
+    matchCurrent(&matched);
+    std::string path = matched.empty() ? std::string() : currentPath();
+
+    if (c == '{' || c == '[') {
+        bool is_object = c == '{';
+        stack_.push_back(Frame{is_object, "", 0});
+        for (int subscription : matched) {
+            captures_.push_back(Capture{subscription, path, stack_.size(),
+                                        is_object ? MLCJsonValue::Type::Object : MLCJsonValue::Type::Array,
+                                        std::string(1, c)});
+        }
+        state_ = is_object ? State::ExpectKeyOrEnd : State::ExpectValue;
+        // An empty array closes straight away; ExpectValue accepts ']' while index is 0
+        return;
+    }
+    if (c == '"') {
+        string_is_key_ = false;
+        string_escape_ = false;
+        unicode_digits_ = 0;
+        high_surrogate_ = 0;
+        string_value_.clear();
+        string_emitted_ = 0;
+        string_subscriptions_ = std::move(matched);
+        string_path_ = std::move(path);
+        state_ = State::InString;
+        return;
+    }
+    if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n') {
+        scalar_.assign(1, c);
+        scalar_subscriptions_ = std::move(matched);
+        scalar_path_ = std::move(path);
+        state_ = State::InScalar;
+        return;
+    }
+    state_ = State::Failed;
+}
+
+void MLCJsonStream::endValue() {
+    state_ = stack_.empty() ? State::Done : State::ExpectCommaOrEnd;
+}
+
+void MLCJsonStream::processChar(char c) {
+    switch (state_) {
+        case State::Preamble:
+            if (c == '{' || c == '[') beginValue(c);
+            return;
+
+        case State::ExpectValue:
+            if (isWhitespace(c)) return;
+            if (c == ']' && !stack_.empty() && !stack_.back().is_object && stack_.back().index == 0) {
+                // Empty array: the '[' was just opened and no element has started
+                stack_.back().index = -1;
+                state_ = State::ExpectCommaOrEnd;
+                processChar(c);
+                return;
+            }
+            beginValue(c);
+            return;
+
+        case State::ExpectKeyOrEnd:
+        case State::ExpectKey:
+            if (isWhitespace(c)) return;
+            if (c == '"') {
+                string_is_key_ = true;
+                string_escape_ = false;
+                unicode_digits_ = 0;
+                high_surrogate_ = 0;
+                string_value_.clear();
+                state_ = State::InString;
+                return;
+            }
+            if (c == '}' && state_ == State::ExpectKeyOrEnd) {
+                state_ = State::ExpectCommaOrEnd;
+                processChar(c);
+                return;
+            }
+            state_ = State::Failed;
+            return;
+
+        case State::ExpectColon:
+            if (isWhitespace(c)) return;
+            state_ = c == ':' ? State::ExpectValue : State::Failed;
+            return;
+
+        case State::ExpectCommaOrEnd: {
+            if (isWhitespace(c)) return;
+            if (stack_.empty()) {
+                state_ = State::Failed;
+                return;
+            }
+            Frame& top = stack_.back();
+            if (c == ',') {
+                if (top.is_object) {
+                    state_ = State::ExpectKey;
+                } else {
+                    ++top.index;
+                    state_ = State::ExpectValue;
+                }
+                return;
+            }
+            if ((c == '}' && top.is_object) || (c == ']' && !top.is_object)) {
+                size_t depth = stack_.size();
+                for (size_t i = captures_.size(); i-- > 0;) {
+                    if (captures_[i].depth != depth) continue;
+                    emit(MLCJsonStreamEvent::Kind::Value, captures_[i].type, captures_[i].subscription,
+                         captures_[i].path, captures_[i].raw);
+                    captures_.erase(captures_.begin() + static_cast<std::ptrdiff_t>(i));
+                }
+                stack_.pop_back();
+                endValue();
+                return;
+            }
+            state_ = State::Failed;
+            return;
+        }
+
+        case State::InString:
+            if (unicode_digits_ > 0) {
+                int digit = hexValue(c);
+                if (digit < 0) {
+                    state_ = State::Failed;
+                    return;
+                }
+                unicode_value_ = (unicode_value_ << 4) | static_cast<unsigned>(digit);
+                if (--unicode_digits_ == 0) appendCodepoint(unicode_value_);
+                return;
+            }
+            if (string_escape_) {
+                string_escape_ = false;
+                switch (c) {
+                    case '"': appendCodepoint('"'); break;
+                    case '\\': appendCodepoint('\\'); break;
+                    case '/': appendCodepoint('/'); break;
+                    case 'b': appendCodepoint('\b'); break;
+                    case 'f': appendCodepoint('\f'); break;
+                    case 'n': appendCodepoint('\n'); break;
+                    case 'r': appendCodepoint('\r'); break;
+                    case 't': appendCodepoint('\t'); break;
+                    case 'u':
+                        unicode_digits_ = 4;
+                        unicode_value_ = 0;
+                        break;
+                    default:
+                        state_ = State::Failed;
+                }
+                return;
+            }
+            if (c == '\\') {
+                string_escape_ = true;
+                return;
+            }
+            if (c == '"') {
+                finishString();
+                return;
+            }
+            if (string_is_key_ || !string_subscriptions_.empty()) {
+                if (high_surrogate_) {
+                    high_surrogate_ = 0;
+                    appendCodepoint(0xFFFD);
+                }
+                string_value_.push_back(c);
+            }
+            return;
+
+        case State::InScalar:
+            if (isScalarChar(c)) {
+                scalar_.push_back(c);
+                return;
+            }
+            finishScalar();
+            if (state_ != State::Failed && state_ != State::Done) processChar(c);
+            return;
+
+        case State::Done:
+        case State::Failed:
+            return;
+    }
+}
+
+void MLCJsonStream::appendCodepoint(unsigned codepoint) {
+    if (!string_is_key_ && string_subscriptions_.empty()) return;
+
+    if (codepoint >= 0xD800 && codepoint <= 0xDBFF) {
+        if (high_surrogate_) {
+            high_surrogate_ = 0;
+            appendCodepoint(0xFFFD);
+        }
+        high_surrogate_ = codepoint;
+        return;
+    }
+    if (codepoint >= 0xDC00 && codepoint <= 0xDFFF) {
+        if (!high_surrogate_) {
+            codepoint = 0xFFFD;
+        } else {
+            codepoint = 0x10000 + ((high_surrogate_ - 0xD800) << 10) + (codepoint - 0xDC00);
+            high_surrogate_ = 0;
+        }
+    } else if (high_surrogate_) {
+        high_surrogate_ = 0;
+        appendCodepoint(0xFFFD);
+    }
+
+    std::string& out = string_value_;
+    if (codepoint < 0x80) {
+        out.push_back(static_cast<char>(codepoint));
+    } else if (codepoint < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+        out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    } else if (codepoint < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    }
+}
+
+void MLCJsonStream::flushStringDelta() {
+    if (string_subscriptions_.empty() || string_emitted_ >= string_value_.size()) return;
+    std::string delta = string_value_.substr(string_emitted_);
+    string_emitted_ = string_value_.size();
+    for (int subscription : string_subscriptions_) {
+        emit(MLCJsonStreamEvent::Kind::StringDelta, MLCJsonValue::Type::String, subscription, string_path_, delta);
+    }
+}
+
+void MLCJsonStream::finishString() {
+    if (high_surrogate_) {
+        high_surrogate_ = 0;
+        appendCodepoint(0xFFFD);
+    }
+    if (string_is_key_) {
+        if (!stack_.empty()) stack_.back().key = string_value_;
+        state_ = State::ExpectColon;
+        return;
+    }
+    flushStringDelta();
+    for (int subscription : string_subscriptions_) {
+        emit(MLCJsonStreamEvent::Kind::Value, MLCJsonValue::Type::String, subscription, string_path_, string_value_);
+    }
+    string_subscriptions_.clear();
+    endValue();
+}
+
+void MLCJsonStream::finishScalar() {
+    MLCJsonValue::Type type;
+    if (scalar_ == "true" || scalar_ == "false") {
+        type = MLCJsonValue::Type::Bool;
+    } else if (scalar_ == "null") {
+        type = MLCJsonValue::Type::Null;
+    } else {
+        char* end = nullptr;
+        std::strtod(scalar_.c_str(), &end);
+        if (end == scalar_.c_str() || *end != '\0') {
+            state_ = State::Failed;
+            return;
+        }
+        type = MLCJsonValue::Type::Number;
+    }
+    for (int subscription : scalar_subscriptions_) {
+        emit(MLCJsonStreamEvent::Kind::Value, type, subscription, scalar_path_, scalar_);
+    }
+    scalar_subscriptions_.clear();
+    endValue();
+}
@@ -0,0 +1,118 @@
+#ifndef MLCJsonStream_h
+#define MLCJsonStream_h
+
+#include "MLCJson.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct MLCJsonStreamEvent {
+    enum class Kind {
+        StringDelta,  // text appended to a subscribed string since the previous delta
+        Value         // a subscribed value has closed
+    };
+
+    Kind kind;
+    MLCJsonValue::Type type;
+    int subscription;       // index of the matching path in the subscription list
+    std::string path;       // concrete path of the value, e.g. "items[2].name"
+    std::string data;       // decoded text for strings, raw JSON for everything else
+};
+
+// Incremental JSON assembler for model output. Text is fed as it streams in and
+// is scanned exactly once; values whose path matches a subscription are reported
+// as soon as they close, and subscribed strings additionally stream their
+// decoded contents as they grow.
+//
+// Subscription paths use dotted keys with array indices or wildcards:
+// "title", "items[*]", "items[*].name", "meta.tags[0]". An optional leading "$"
+// or "$." is ignored; "$" alone subscribes to the root value. Any prose before
+// the first '{' or '[' (e.g. a markdown fence) is skipped, and scanning stops
+// once the root value closes.
+class MLCJsonStream {
+public:
+    using Callback = std::function<void(const MLCJsonStreamEvent&)>;
+
+    MLCJsonStream(const std::vector<std::string>& paths, Callback callback);
+
+    void feed(const std::string& text);
+
+    bool done() const { return state_ == State::Done; }
+    bool failed() const { return state_ == State::Failed; }
+
+private:
+    struct Segment {
+        bool is_index;
+        bool wildcard;
+        std::string key;
+        int64_t index;
+    };
+
+    struct Frame {
+        bool is_object;
+        std::string key;      // current member key (objects)
+        int64_t index;        // current element index (arrays)
+    };
+
+    struct Capture {
+        int subscription;
+        std::string path;
+        size_t depth;         // stack depth of the captured container once open
+        MLCJsonValue::Type type;
+        std::string raw;
+    };
+
+    enum class State {
+        Preamble,
+        ExpectValue,
+        ExpectKeyOrEnd,     // just after '{'
+        ExpectKey,          // after ',' in an object
+        ExpectColon,
+        ExpectCommaOrEnd,
+        InString,
+        InScalar,           // number or literal
+        Done,
+        Failed
+    };
+
+    static bool parsePath(const std::string& path, std::vector<Segment>* out);
+    bool matches(const std::vector<Segment>& pattern) const;
+    std::string currentPath() const;
+    void matchCurrent(std::vector<int>* out) const;
+
+    void processChar(char c);
+    void beginValue(char c);
+    void endValue();
+    void appendCodepoint(unsigned codepoint);
+    void finishString();
+    void finishScalar();
+    void flushStringDelta();
+    void emit(MLCJsonStreamEvent::Kind kind, MLCJsonValue::Type type, int subscription,
+              const std::string& path, const std::string& data);
+
+    std::vector<std::vector<Segment>> subscriptions_;
+    Callback callback_;
+
+    State state_;
+    std::vector<Frame> stack_;
+    std::vector<Capture> captures_;
+
+    // String scanning
+    bool string_is_key_;
+    bool string_escape_;
+    int unicode_digits_;      // remaining hex digits of a \\u escape, 0 when not in one
+    unsigned unicode_value_;
+    unsigned high_surrogate_;
+    std::string string_value_;
+    size_t string_emitted_;
+    std::vector<int> string_subscriptions_;
+    std::string string_path_;
+
+    // Scalar scanning
+    std::string scalar_;
+    std::vector<int> scalar_subscriptions_;
+    std::string scalar_path_;
+};
+
+#endif /* MLCJsonStream_h */
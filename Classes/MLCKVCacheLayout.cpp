@@ -0,0 +1,87 @@
+#include "MLCKVCacheLayout.h"
+#include "MLCJson.h"
+
+namespace {
+
+const int64_t kFloat16Bytes = 2;
+const int64_t kScaleBytes = 2;
+
+} // namespace
+
+bool MLCKVCacheLayout::parseDtype(const std::string& name, MLCKVCacheDtype* dtype) {
+    if (name.empty() || name == "float16") {
+        *dtype = MLCKVCacheDtype::Float16;
+    } else if (name == "int8") {
+        *dtype = MLCKVCacheDtype::Int8;
+    } else if (name == "float8_e4m3") {
+        *dtype = MLCKVCacheDtype::Float8E4M3;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* MLCKVCacheLayout::dtypeName(MLCKVCacheDtype dtype) {
+    switch (dtype) {
+        case MLCKVCacheDtype::Int8: return "int8";
+        case MLCKVCacheDtype::Float8E4M3: return "float8_e4m3";
+        case MLCKVCacheDtype::Float16: break;
+    }
+    return "float16";
+}
+
+bool MLCKVCacheLayout::compiledDtype(const MLCJsonValue& chat_config, MLCKVCacheDtype* dtype) {
+    const MLCJsonValue* declared = chat_config.get("kv_cache_dtype");
+    if (!declared) {
+        const MLCJsonValue* model = chat_config.get("model_config");
+        declared = model ? model->get("kv_cache_dtype") : nullptr;
+    }
+    if (!declared) {
+        *dtype = MLCKVCacheDtype::Float16;
+        return true;
+    }
+    return declared->isString() && parseDtype(declared->string, dtype);
+}
+
+bool MLCKVCacheLayout::fromChatConfig(const MLCJsonValue& chat_config, MLCKVCacheDtype dtype,
+                                      MLCKVCacheLayout* layout) {
+    const MLCJsonValue* model = chat_config.get("model_config");
+    if (!model) return false;
+    const MLCJsonValue* layers = model->get("num_hidden_layers");
+    const MLCJsonValue* heads = model->get("num_attention_heads");
+    if (!layers || !heads || heads->asInt() <= 0) return false;
+
+    // Grouped-query models share each KV head across several query heads
+    const MLCJsonValue* kv_heads = model->get("num_key_value_heads");
+    const MLCJsonValue* head_dim = model->get("head_dim");
+    const MLCJsonValue* hidden_size = model->get("hidden_size");
+
+    MLCKVCacheLayout result;
+    result.dtype = dtype;
+    result.layers = layers->asInt();
+    result.kv_heads = kv_heads ? kv_heads->asInt() : heads->asInt();
+    if (head_dim && head_dim->asInt() > 0) {
+        result.head_dim = head_dim->asInt();
+    } else if (hidden_size) {
+        result.head_dim = hidden_size->asInt() / heads->asInt();
+    }
+    if (result.layers <= 0 || result.kv_heads <= 0 || result.head_dim <= 0) return false;
+    *layout = result;
+    return true;
+}
+
+int64_t MLCKVCacheLayout::float16BytesPerToken() const {
+    // Keys and values for every layer and KV head
+    return 2 * static_cast<int64_t>(layers) * kv_heads * head_dim * kFloat16Bytes;
+}
+
+int64_t MLCKVCacheLayout::bytesPerToken() const {
+    if (dtype == MLCKVCacheDtype::Float16) return float16BytesPerToken();
+    return 2 * static_cast<int64_t>(layers) * kv_heads * (head_dim + kScaleBytes);
+}
+
+int MLCKVCacheLayout::tokensForFloat16Budget(int float16_tokens) const {
+    int64_t bytes = bytesPerToken();
+    if (bytes <= 0) return float16_tokens;
+    return static_cast<int>(static_cast<int64_t>(float16_tokens) * float16BytesPerToken() / bytes);
+}
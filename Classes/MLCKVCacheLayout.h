@@ -0,0 +1,43 @@
+#ifndef MLCKVCacheLayout_h
+#define MLCKVCacheLayout_h
+
+#include <cstdint>
+#include <string>
+
+struct MLCJsonValue;
+
+// Storage format of the engine's KV pages. The quantized formats keep one
+// byte per element plus a float16 scale per head and token.
+enum class MLCKVCacheDtype {
+    Float16,
+    Int8,
+    Float8E4M3,
+};
+
+// Bytes the paged KV cache needs per token, from the model architecture in
+// mlc-chat-config.json
+struct MLCKVCacheLayout {
+    MLCKVCacheDtype dtype = MLCKVCacheDtype::Float16;
+    int layers = 0;
+    int kv_heads = 0;
+    int head_dim = 0;
+
+    static bool parseDtype(const std::string& name, MLCKVCacheDtype* dtype);
+    static const char* dtypeName(MLCKVCacheDtype dtype);
+
+    // The page format the model library was compiled for, as declared by
+    // "kv_cache_dtype" in mlc-chat-config.json (top level or model_config);
+    // float16 when undeclared. False for a format this bridge does not know.
+    static bool compiledDtype(const MLCJsonValue& chat_config, MLCKVCacheDtype* dtype);
+
+    // False when the config lacks the attention shape
+    static bool fromChatConfig(const MLCJsonValue& chat_config, MLCKVCacheDtype dtype, MLCKVCacheLayout* layout);
+
+    int64_t bytesPerToken() const;
+    int64_t float16BytesPerToken() const;
+
+    // Tokens that fit in the memory a float16 cache of `float16_tokens` would use
+    int tokensForFloat16Budget(int float16_tokens) const;
+};
+
+#endif /* MLCKVCacheLayout_h */
@@ -0,0 +1,128 @@
+#include "MLCLengthPredictor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+const size_t kBuckets = 4096;
+// Normalized LMS step size in log-token space
+const double kLearningRate = 0.3;
+// Completed requests before predictions replace max_tokens
+const uint64_t kWarmupSamples = 8;
+// A class's own residual spread is trusted after this many samples
+const int kMinClassSamples = 5;
+// Initial guess of log(1 + tokens) and of the residual variance around it
+const double kInitialLogTokens = std::log1p(128.0);
+const double kInitialVariance = 0.5;
+const double kSpreadSmoothing = 0.1;
+// One-sided 90% quantile of a normal distribution
+const double kReserveZ = 1.2816;
+
+uint32_t bucketOf(const std::string& feature) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : feature) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return static_cast<uint32_t>(hash % kBuckets);
+}
+
+// Powers of two keep nearby lengths in the same bucket
+std::string log2Bucket(int value) {
+    int bucket = 0;
+    while (value > 1) {
+        value >>= 1;
+        ++bucket;
+    }
+    return std::to_string(bucket);
+}
+
+} // namespace
+
+MLCLengthPredictor::MLCLengthPredictor() : weights_(kBuckets, 0.0) {
+    weights_[bucketOf("bias")] = kInitialLogTokens;
+    residual_.variance = kInitialVariance;
+}
+
+std::vector<uint32_t> MLCLengthPredictor::hashFeatures(const MLCLengthFeatures& features) {
+    char system[17];
+    snprintf(system, sizeof(system), "%016llx", static_cast<unsigned long long>(features.system_hash));
+    std::string prompt_bucket = log2Bucket(features.prompt_tokens);
+    return {
+        bucketOf("bias"),
+        bucketOf("class=" + features.request_class),
+        bucketOf("template=" + features.template_name),
+        bucketOf(std::string("system=") + system),
+        bucketOf("lead=" + features.lead_word),
+        bucketOf("prompt=" + prompt_bucket),
+        bucketOf("max=" + log2Bucket(features.max_tokens)),
+        bucketOf("class+lead=" + features.request_class + "|" + features.lead_word),
+        bucketOf("class+prompt=" + features.request_class + "|" + prompt_bucket),
+    };
+}
+
+double MLCLengthPredictor::scoreLocked(const std::vector<uint32_t>& buckets) const {
+    double score = 0.0;
+    for (uint32_t bucket : buckets) score += weights_[bucket];
+    return score;
+}
+
+double MLCLengthPredictor::residualVarianceLocked(const std::string& request_class) const {
+    auto it = class_residual_.find(request_class);
+    if (it != class_residual_.end() && it->second.samples >= kMinClassSamples) return it->second.variance;
+    return residual_.variance;
+}
+
+MLCLengthPrediction MLCLengthPredictor::predict(const MLCLengthFeatures& features) const {
+    MLCLengthPrediction prediction;
+    std::vector<uint32_t> buckets = hashFeatures(features);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (samples_ < kWarmupSamples) {
+        // No opinion yet; callers fall back to their own averages
+        return prediction;
+    }
+
+    double log_tokens = scoreLocked(buckets);
+    double spread = std::sqrt(residualVarianceLocked(features.request_class));
+    double expected = std::expm1(std::max(log_tokens, 0.0));
+    double reserve = std::expm1(std::max(log_tokens + kReserveZ * spread, 0.0));
+    double ceiling = features.max_tokens > 0 ? features.max_tokens : reserve;
+    prediction.expected_tokens = static_cast<int>(std::lround(std::min(std::max(expected, 1.0), ceiling)));
+    prediction.reserve_tokens = static_cast<int>(std::lround(std::min(std::max(reserve, 1.0), ceiling)));
+    return prediction;
+}
+
+MLCLengthPredictor::Outcome MLCLengthPredictor::observe(const MLCLengthFeatures& features,
+                                                        const MLCLengthPrediction& predicted,
+                                                        int completion_tokens, bool truncated) {
+    Outcome outcome;
+    if (completion_tokens <= 0) return outcome;
+    if (predicted.expected_tokens > 0) {
+        outcome.scored = true;
+        outcome.underpredicted = completion_tokens > predicted.reserve_tokens;
+        outcome.abs_error_tokens = std::abs(completion_tokens - predicted.expected_tokens);
+    }
+
+    std::vector<uint32_t> buckets = hashFeatures(features);
+    double target = std::log1p(static_cast<double>(completion_tokens));
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    double error = target - scoreLocked(buckets);
+    // A truncated request only proves the prediction was too low
+    if (truncated && error <= 0.0) return outcome;
+
+    double step = kLearningRate * error / static_cast<double>(buckets.size());
+    for (uint32_t bucket : buckets) weights_[bucket] += step;
+
+    double squared = error * error;
+    residual_.variance += kSpreadSmoothing * (squared - residual_.variance);
+    residual_.samples++;
+    Spread& spread = class_residual_[features.request_class];
+    if (spread.samples == 0) spread.variance = residual_.variance;
+    spread.variance += kSpreadSmoothing * (squared - spread.variance);
+    spread.samples++;
+    samples_++;
+    return outcome;
+}
@@ -0,0 +1,63 @@
+#ifndef MLCLengthPredictor_h
+#define MLCLengthPredictor_h
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// What is known about a request before it runs
+struct MLCLengthFeatures {
+    std::string request_class;
+    std::string template_name;   // empty for raw token-id prompts
+    uint64_t system_hash = 0;    // 0 when the template's default system prompt is used
+    std::string lead_word;       // first word of the prompt, lowercased ("summarize", "list", ...)
+    int prompt_tokens = 0;
+    int max_tokens = 0;
+};
+
+struct MLCLengthPrediction {
+    int expected_tokens = 0;   // point estimate, used for scheduling
+    int reserve_tokens = 0;    // high quantile, used for KV reservation
+};
+
+// Online output-length model. A linear model over hashed features predicts
+// log(1 + completion tokens) and is updated with one normalized LMS step per
+// completed request. The spread of its residuals, tracked per request class,
+// turns the point estimate into a reservation that covers ~90% of requests.
+// Until enough requests have completed predictions are 0 (unknown).
+class MLCLengthPredictor {
+public:
+    struct Outcome {
+        bool scored = false;          // false for samples that carry no information
+        bool underpredicted = false;  // needed more than reserve_tokens
+        int abs_error_tokens = 0;     // |actual - expected|
+    };
+
+    MLCLengthPredictor();
+
+    MLCLengthPrediction predict(const MLCLengthFeatures& features) const;
+
+    // `truncated` requests stopped at max_tokens, so their true length is only
+    // known to be at least `completion_tokens`
+    Outcome observe(const MLCLengthFeatures& features, const MLCLengthPrediction& predicted, int completion_tokens,
+                    bool truncated);
+
+private:
+    static std::vector<uint32_t> hashFeatures(const MLCLengthFeatures& features);
+    double scoreLocked(const std::vector<uint32_t>& buckets) const;
+    double residualVarianceLocked(const std::string& request_class) const;
+
+    mutable std::mutex mutex_;
+    std::vector<double> weights_;
+    uint64_t samples_ = 0;
+    struct Spread {
+        double variance = 0.0;
+        int samples = 0;
+    };
+    Spread residual_;
+    std::unordered_map<std::string, Spread> class_residual_;
+};
+
+#endif /* MLCLengthPredictor_h */
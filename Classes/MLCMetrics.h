@@ -0,0 +1,138 @@
+#ifndef MLCMetrics_h
+#define MLCMetrics_h
+
+#include "MLCBridge.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+// Log2 latency histogram: bucket i counts samples of [2^i, 2^(i+1)) microseconds
+class MLCLatencyHistogram {
+public:
+    void record(uint64_t micros) {
+        int bucket = 0;
+        while (micros > 1 && bucket < MLC_LLM_TELEMETRY_BUCKETS - 1) {
+            micros >>= 1;
+            ++bucket;
+        }
+        buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void snapshot(uint64_t* out) const {
+        for (int i = 0; i < MLC_LLM_TELEMETRY_BUCKETS; ++i) out[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> buckets_[MLC_LLM_TELEMETRY_BUCKETS] = {};
+};
+
+// Process-lifetime counters for one engine. Updated lock-free from the submit
+// and stream-back threads; read through mlc_llm_get_metrics().
+class MLCMetrics {
+public:
+    std::atomic<uint64_t> requests_submitted{0};
+    std::atomic<uint64_t> requests_completed{0};
+    std::atomic<uint64_t> requests_failed{0};
+    std::atomic<uint64_t> requests_rejected{0};
+    std::atomic<uint64_t> chunks_delivered{0};
+
+    std::atomic<uint64_t> repetition_detections{0};
+    std::atomic<uint64_t> repetition_aborts{0};
+    std::atomic<uint64_t> repetition_tokens_saved{0};
+
+    std::atomic<uint64_t> similarity_cache_hits{0};
+    std::atomic<uint64_t> similarity_cache_misses{0};
+    std::atomic<uint64_t> similarity_cache_inserts{0};
+
+    std::atomic<uint64_t> prompt_tokens_cached{0};
+    std::atomic<uint64_t> prompt_tokens_encoded{0};
+    std::atomic<uint64_t> prompt_tokens_direct{0};
+
+    std::atomic<uint64_t> admission_batches{0};
+    std::atomic<uint64_t> admission_batched_requests{0};
+
+    std::atomic<uint64_t> ingest_files_indexed{0};
+    std::atomic<uint64_t> ingest_files_unchanged{0};
+    std::atomic<uint64_t> ingest_files_removed{0};
+    std::atomic<uint64_t> ingest_chunks_indexed{0};
+    std::atomic<uint64_t> ingest_tokens_indexed{0};
+
+    std::atomic<uint64_t> length_predictions_scored{0};
+    std::atomic<uint64_t> length_underpredictions{0};
+    std::atomic<uint64_t> length_abs_error_tokens{0};
+
+    std::atomic<uint64_t> kv_cache_bytes_per_token{0};
+    std::atomic<uint64_t> kv_cache_capacity_tokens{0};
+    std::atomic<uint64_t> kv_cache_bytes_saved{0};
+    std::atomic<uint64_t> decode_tokens{0};
+    std::atomic<uint64_t> decode_time_us{0};
+
+    // Gauges of current load
+    std::atomic<int64_t> requests_in_flight{0};
+    std::atomic<int64_t> kv_tokens_in_use{0};
+    std::atomic<uint64_t> completion_tokens_generated{0};
+    std::atomic<uint64_t> ttft_samples{0};
+    std::atomic<uint64_t> ttft_total_us{0};
+    MLCLatencyHistogram ttft_us;
+    // Mean time between a request's tokens, one sample per finished request
+    MLCLatencyHistogram inter_token_us;
+
+    // Idle-time warm-ups (MLCPrewarmer)
+    std::atomic<uint64_t> prewarm_prefixes{0};
+    std::atomic<uint64_t> prewarm_prefix_tokens{0};
+    std::atomic<uint64_t> prewarm_completions{0};
+    std::atomic<uint64_t> prewarm_preemptions{0};
+
+    std::atomic<uint64_t> continuations{0};
+    std::atomic<uint64_t> continuation_misses{0};
+
+    std::atomic<uint64_t> race_fallback_starts{0};
+    std::atomic<uint64_t> race_fallback_wins{0};
+
+    void snapshot(mlc_llm_metrics_t* out) const {
+        out->requests_submitted = requests_submitted.load(std::memory_order_relaxed);
+        out->requests_completed = requests_completed.load(std::memory_order_relaxed);
+        out->requests_failed = requests_failed.load(std::memory_order_relaxed);
+        out->requests_rejected = requests_rejected.load(std::memory_order_relaxed);
+        out->chunks_delivered = chunks_delivered.load(std::memory_order_relaxed);
+        out->repetition_detections = repetition_detections.load(std::memory_order_relaxed);
+        out->repetition_aborts = repetition_aborts.load(std::memory_order_relaxed);
+        out->repetition_tokens_saved = repetition_tokens_saved.load(std::memory_order_relaxed);
+        out->similarity_cache_hits = similarity_cache_hits.load(std::memory_order_relaxed);
+        out->similarity_cache_misses = similarity_cache_misses.load(std::memory_order_relaxed);
+        out->similarity_cache_inserts = similarity_cache_inserts.load(std::memory_order_relaxed);
+        out->prompt_tokens_cached = prompt_tokens_cached.load(std::memory_order_relaxed);
+        out->prompt_tokens_encoded = prompt_tokens_encoded.load(std::memory_order_relaxed);
+        out->prompt_tokens_direct = prompt_tokens_direct.load(std::memory_order_relaxed);
+        out->admission_batches = admission_batches.load(std::memory_order_relaxed);
+        out->admission_batched_requests = admission_batched_requests.load(std::memory_order_relaxed);
+        out->ingest_files_indexed = ingest_files_indexed.load(std::memory_order_relaxed);
+        out->ingest_files_unchanged = ingest_files_unchanged.load(std::memory_order_relaxed);
+        out->ingest_files_removed = ingest_files_removed.load(std::memory_order_relaxed);
+        out->ingest_chunks_indexed = ingest_chunks_indexed.load(std::memory_order_relaxed);
+        out->ingest_tokens_indexed = ingest_tokens_indexed.load(std::memory_order_relaxed);
+        out->length_predictions_scored = length_predictions_scored.load(std::memory_order_relaxed);
+        out->length_underpredictions = length_underpredictions.load(std::memory_order_relaxed);
+        out->length_abs_error_tokens = length_abs_error_tokens.load(std::memory_order_relaxed);
+        out->kv_cache_bytes_per_token = kv_cache_bytes_per_token.load(std::memory_order_relaxed);
+        out->kv_cache_capacity_tokens = kv_cache_capacity_tokens.load(std::memory_order_relaxed);
+        out->kv_cache_bytes_saved = kv_cache_bytes_saved.load(std::memory_order_relaxed);
+        out->decode_tokens = decode_tokens.load(std::memory_order_relaxed);
+        out->decode_time_us = decode_time_us.load(std::memory_order_relaxed);
+        out->requests_in_flight = static_cast<uint64_t>(std::max<int64_t>(0, requests_in_flight.load(std::memory_order_relaxed)));
+        out->kv_tokens_in_use = static_cast<uint64_t>(std::max<int64_t>(0, kv_tokens_in_use.load(std::memory_order_relaxed)));
+        out->completion_tokens_generated = completion_tokens_generated.load(std::memory_order_relaxed);
+        out->ttft_samples = ttft_samples.load(std::memory_order_relaxed);
+        out->ttft_total_us = ttft_total_us.load(std::memory_order_relaxed);
+        out->prewarm_prefixes = prewarm_prefixes.load(std::memory_order_relaxed);
+        out->prewarm_prefix_tokens = prewarm_prefix_tokens.load(std::memory_order_relaxed);
+        out->prewarm_completions = prewarm_completions.load(std::memory_order_relaxed);
+        out->prewarm_preemptions = prewarm_preemptions.load(std::memory_order_relaxed);
+        out->continuations = continuations.load(std::memory_order_relaxed);
+        out->continuation_misses = continuation_misses.load(std::memory_order_relaxed);
+        out->race_fallback_starts = race_fallback_starts.load(std::memory_order_relaxed);
+        out->race_fallback_wins = race_fallback_wins.load(std::memory_order_relaxed);
+    }
+};
+
+#endif /* MLCMetrics_h */
@@ -0,0 +1,664 @@
+#include "MLCOpenAIBackend.h"
+#include "MLCBridge.h"
+#include "MLCCpuTopology.h"
+#include "MLCJson.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#if defined(__APPLE__)
+#include <Security/SecureTransport.h>
+#define MLC_OPENAI_TLS 1
+#else
+#define MLC_OPENAI_TLS 0
+#endif
+
+namespace {
+
+#ifdef MSG_NOSIGNAL
+const int kSendFlags = MSG_NOSIGNAL;
+#else
+const int kSendFlags = 0;
+#endif
+
+// Error bodies are only read this far
+const size_t kMaxErrorBody = 4096;
+
+struct Endpoint {
+    bool tls = false;
+    std::string host;
+    std::string port;
+    std::string path;   // base path without trailing slash
+};
+
+bool parseUrl(const std::string& url, Endpoint* out, std::string* error) {
+    std::string rest;
+    if (url.compare(0, 7, "http://") == 0) {
+        rest = url.substr(7);
+    } else if (url.compare(0, 8, "https://") == 0) {
+        out->tls = true;
+        rest = url.substr(8);
+    } else {
+        if (error) *error = "base_url must start with http:// or https://";
+        return false;
+    }
+
+    size_t slash = rest.find('/');
+    std::string authority = rest.substr(0, slash);
+    out->path = slash == std::string::npos ? "" : rest.substr(slash);
+    while (!out->path.empty() && out->path.back() == '/') out->path.pop_back();
+
+    size_t colon = authority.rfind(':');
+    size_t bracket = authority.rfind(']');
+    if (colon != std::string::npos && (bracket == std::string::npos || colon > bracket)) {
+        out->host = authority.substr(0, colon);
+        out->port = authority.substr(colon + 1);
+    } else {
+        out->host = authority;
+        out->port = out->tls ? "443" : "80";
+    }
+    if (out->host.size() > 2 && out->host.front() == '[' && out->host.back() == ']') {
+        out->host = out->host.substr(1, out->host.size() - 2);
+    }
+    if (out->host.empty() || out->port.empty()) {
+        if (error) *error = "base_url has no host";
+        return false;
+    }
+    return true;
+}
+
+// Incremental decoder for Transfer-Encoding: chunked
+class ChunkedDecoder {
+public:
+    // Appends decoded bytes to `out`; returns false on malformed framing
+    bool feed(const char* data, size_t size, std::string* out) {
+        buffer_.append(data, size);
+        while (!finished_) {
+            if (remaining_ == 0) {
+                size_t line_end = buffer_.find("\r\n", offset_);
+                if (line_end == std::string::npos) break;
+                if (awaiting_crlf_) {
+                    if (line_end != offset_) return false;
+                    awaiting_crlf_ = false;
+                    offset_ = line_end + 2;
+                    continue;
+                }
+                char* end = nullptr;
+                unsigned long chunk_size = std::strtoul(buffer_.c_str() + offset_, &end, 16);
+                if (end == buffer_.c_str() + offset_) return false;
+                offset_ = line_end + 2;
+                if (chunk_size == 0) {
+                    finished_ = true;
+                    break;
+                }
+                remaining_ = chunk_size;
+            }
+            size_t available = std::min(remaining_, buffer_.size() - offset_);
+            if (available == 0) break;
+            out->append(buffer_, offset_, available);
+            offset_ += available;
+            remaining_ -= available;
+            if (remaining_ == 0) awaiting_crlf_ = true;
+        }
+        buffer_.erase(0, offset_);
+        offset_ = 0;
+        return true;
+    }
+
+    bool finished() const { return finished_; }
+
+private:
+    std::string buffer_;
+    size_t offset_ = 0;
+    size_t remaining_ = 0;
+    bool awaiting_crlf_ = false;
+    bool finished_ = false;
+};
+
+std::string lowercase(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return text;
+}
+
+#if MLC_OPENAI_TLS
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdeprecated-declarations"
+
+OSStatus tlsRead(SSLConnectionRef connection, void* data, size_t* length) {
+    int fd = static_cast<int>(reinterpret_cast<intptr_t>(connection));
+    size_t wanted = *length;
+    size_t got = 0;
+    while (got < wanted) {
+        ssize_t n = ::recv(fd, static_cast<char*>(data) + got, wanted - got, 0);
+        if (n > 0) {
+            got += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        *length = got;
+        if (n == 0) return errSSLClosedGraceful;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return errSSLWouldBlock;
+        return errSSLClosedAbort;
+    }
+    *length = got;
+    return noErr;
+}
+
+OSStatus tlsWrite(SSLConnectionRef connection, const void* data, size_t* length) {
+    int fd = static_cast<int>(reinterpret_cast<intptr_t>(connection));
+    size_t wanted = *length;
+    size_t sent = 0;
+    while (sent < wanted) {
+        ssize_t n = ::send(fd, static_cast<const char*>(data) + sent, wanted - sent, kSendFlags);
+        if (n > 0) {
+            sent += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        *length = sent;
+        return errSSLClosedAbort;
+    }
+    *length = sent;
+    return noErr;
+}
+
+#pragma clang diagnostic pop
+#endif
+
+} // namespace
+
+struct MLCOpenAIBackend::Stream : public MLCBackendStream {
+    std::mutex mutex;
+    int fd = -1;
+    bool cancelled = false;
+    bool shutting_down = false;
+    std::atomic<bool> done{false};
+
+    void cancel() override {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelled = true;
+        // Wakes the worker from connect/recv; it closes the fd itself
+        if (fd >= 0) ::shutdown(fd, SHUT_RDWR);
+    }
+
+    void abortForShutdown() {
+        std::lock_guard<std::mutex> lock(mutex);
+        shutting_down = true;
+        cancelled = true;
+        if (fd >= 0) ::shutdown(fd, SHUT_RDWR);
+    }
+
+    bool attach(int socket_fd) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (cancelled) return false;
+        fd = socket_fd;
+        return true;
+    }
+
+    void detach() {
+        std::lock_guard<std::mutex> lock(mutex);
+        fd = -1;
+    }
+
+    bool shuttingDown() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return shutting_down;
+    }
+
+    // A cancelled request ends without reporting anything to its sink
+    bool silenced() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return cancelled && !shutting_down;
+    }
+};
+
+namespace {
+
+// One HTTP(S) connection owned by a worker thread
+class Connection {
+public:
+    ~Connection() { close(); }
+
+    // `stream` (MLCOpenAIBackend::Stream) learns the fd so cancel() can interrupt
+    // connect and reads
+    template <typename StreamT>
+    bool open(const Endpoint& endpoint, int connect_timeout_ms, int read_timeout_ms, StreamT& stream,
+              std::string* error) {
+        addrinfo hints = {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* addresses = nullptr;
+        int rc = getaddrinfo(endpoint.host.c_str(), endpoint.port.c_str(), &hints, &addresses);
+        if (rc != 0) {
+            *error = std::string("cannot resolve ") + endpoint.host + ": " + gai_strerror(rc);
+            return false;
+        }
+
+        for (addrinfo* address = addresses; address && fd_ < 0; address = address->ai_next) {
+            int fd = ::socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+            if (fd < 0) continue;
+            if (!stream.attach(fd)) {
+                ::close(fd);
+                break;
+            }
+            if (connectWithTimeout(fd, address, connect_timeout_ms, error)) {
+                fd_ = fd;
+            } else {
+                stream.detach();
+                ::close(fd);
+            }
+        }
+        freeaddrinfo(addresses);
+        if (fd_ < 0) {
+            if (error->empty()) *error = "cannot connect to " + endpoint.host + ":" + endpoint.port;
+            return false;
+        }
+
+        timeval timeout;
+        timeout.tv_sec = read_timeout_ms / 1000;
+        timeout.tv_usec = (read_timeout_ms % 1000) * 1000;
+        setsockopt(fd_, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+#if defined(SO_NOSIGPIPE)
+        int one = 1;
+        setsockopt(fd_, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+        return !endpoint.tls || startTls(endpoint.host, error);
+    }
+
+    bool sendAll(const std::string& data) {
+#if MLC_OPENAI_TLS
+        if (tls_) {
+            size_t offset = 0;
+            while (offset < data.size()) {
+                size_t processed = 0;
+                OSStatus status = SSLWrite(tls_, data.data() + offset, data.size() - offset, &processed);
+                offset += processed;
+                if (status != noErr && status != errSSLWouldBlock) return false;
+            }
+            return true;
+        }
+#endif
+        size_t offset = 0;
+        while (offset < data.size()) {
+            ssize_t n = ::send(fd_, data.data() + offset, data.size() - offset, kSendFlags);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            offset += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // Bytes read, 0 at end of stream, -1 on error or read timeout
+    ssize_t receive(char* buffer, size_t capacity) {
+#if MLC_OPENAI_TLS
+        if (tls_) {
+            size_t processed = 0;
+            OSStatus status = SSLRead(tls_, buffer, capacity, &processed);
+            if (processed > 0) return static_cast<ssize_t>(processed);
+            if (status == errSSLClosedGraceful || status == errSSLClosedNoNotify) return 0;
+            return -1;
+        }
+#endif
+        while (true) {
+            ssize_t n = ::recv(fd_, buffer, capacity, 0);
+            if (n < 0 && errno == EINTR) continue;
+            return n;
+        }
+    }
+
+    void close() {
+#if MLC_OPENAI_TLS
+        if (tls_) {
+            SSLClose(tls_);
+            CFRelease(tls_);
+            tls_ = nullptr;
+        }
+#endif
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+private:
+    static bool connectWithTimeout(int fd, const addrinfo* address, int timeout_ms, std::string* error) {
+        int flags = fcntl(fd, F_GETFL, 0);
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+        int rc = ::connect(fd, address->ai_addr, address->ai_addrlen);
+        if (rc != 0 && errno != EINPROGRESS) {
+            *error = std::string("connect failed: ") + std::strerror(errno);
+            return false;
+        }
+        if (rc != 0) {
+            pollfd pfd = {fd, POLLOUT, 0};
+            int ready;
+            do {
+                ready = ::poll(&pfd, 1, timeout_ms);
+            } while (ready < 0 && errno == EINTR);
+            if (ready == 0) {
+                *error = "connect timed out";
+                return false;
+            }
+            int socket_error = 0;
+            socklen_t length = sizeof(socket_error);
+            if (ready < 0 || getsockopt(fd, SOL_SOCKET, SO_ERROR, &socket_error, &length) != 0 || socket_error != 0) {
+                *error = std::string("connect failed: ") + std::strerror(socket_error ? socket_error : errno);
+                return false;
+            }
+        }
+        fcntl(fd, F_SETFL, flags);
+        return true;
+    }
+
+    bool startTls(const std::string& host, std::string* error) {
+#if MLC_OPENAI_TLS
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdeprecated-declarations"
+        tls_ = SSLCreateContext(kCFAllocatorDefault, kSSLClientSide, kSSLStreamType);
+        if (!tls_) {
+            *error = "cannot create TLS context";
+            return false;
+        }
+        SSLSetIOFuncs(tls_, tlsRead, tlsWrite);
+        SSLSetConnection(tls_, reinterpret_cast<SSLConnectionRef>(static_cast<intptr_t>(fd_)));
+        // Enables SNI and hostname verification against the system trust store
+        SSLSetPeerDomainName(tls_, host.c_str(), host.size());
+        OSStatus status;
+        do {
+            status = SSLHandshake(tls_);
+        } while (status == errSSLWouldBlock);
+        if (status != noErr) {
+            *error = "TLS handshake failed (" + std::to_string(static_cast<int>(status)) + ")";
+            return false;
+        }
+        return true;
+#pragma clang diagnostic pop
+#else
+        (void)host;
+        *error = "https is not supported on this platform";
+        return false;
+#endif
+    }
+
+    int fd_ = -1;
+#if MLC_OPENAI_TLS
+    SSLContextRef tls_ = nullptr;
+#endif
+};
+
+// Pulls `error.message` out of an OpenAI error body, falling back to the raw text
+std::string errorMessage(int status_code, const std::string& body) {
+    std::string message = body.substr(0, 200);
+    MLCJsonValue parsed;
+    if (MLCJson::parse(body, &parsed)) {
+        const MLCJsonValue* error = parsed.get("error");
+        const MLCJsonValue* text = error ? error->get("message") : nullptr;
+        if (text) message = text->asString();
+    }
+    return "HTTP " + std::to_string(status_code) + ": " + message;
+}
+
+} // namespace
+
+MLCOpenAIBackend::MLCOpenAIBackend(MLCOpenAIConfig config) : config_(std::move(config)) {}
+
+MLCOpenAIBackend::~MLCOpenAIBackend() {
+    shutdown();
+}
+
+bool MLCOpenAIBackend::validateConfig(const MLCOpenAIConfig& config, std::string* error) {
+    Endpoint endpoint;
+    if (!parseUrl(config.base_url, &endpoint, error)) return false;
+#if !MLC_OPENAI_TLS
+    if (endpoint.tls) {
+        if (error) *error = "https is not supported on this platform";
+        return false;
+    }
+#endif
+    return true;
+}
+
+std::string MLCOpenAIBackend::requestBody(const MLCOpenAIConfig& config, const MLCBackendRequest& request) {
+    std::string messages;
+    if (request.has_system) {
+        messages += R"({"role":"system","content":")" + MLCJson::escape(request.system) + R"("},)";
+    }
+    messages += R"({"role":"user","content":")" + MLCJson::escape(request.prompt) + R"("})";
+
+    std::string body = R"({"model":")" + MLCJson::escape(config.model) + R"(","stream":true,)" +
+                       R"("stream_options":{"include_usage":true},)" +
+                       R"("temperature":)" + std::to_string(request.temperature) + ",";
+    if (request.max_tokens > 0) {
+        body += R"("max_tokens":)" + std::to_string(request.max_tokens) + ",";
+    }
+    body += R"("messages":[)" + messages + "]}";
+    return body;
+}
+
+std::shared_ptr<MLCBackendStream> MLCOpenAIBackend::start(const MLCBackendRequest& request,
+                                                          std::unique_ptr<MLCDeliverySink> sink, int* status) {
+    std::string error;
+    if (!validateConfig(config_, &error)) {
+        std::cerr << "❌ Remote backend: " << error << std::endl;
+        *status = MLC_LLM_ERROR_INVALID;
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(workers_mutex_);
+    if (shut_down_) {
+        *status = MLC_LLM_ERROR_FAILED;
+        return nullptr;
+    }
+    reapFinished();
+
+    auto stream = std::make_shared<Stream>();
+    // The worker touches only its own copies and the shared stream state, so
+    // it may outlive a backend that is destroyed from one of its callbacks
+    MLCOpenAIConfig config = config_;
+    std::shared_ptr<MLCDeliverySink> owned_sink(std::move(sink));
+    std::thread thread = MLCCpuTopology::startBridgeThread([config, request, stream, owned_sink]() {
+        run(config, request, stream, *owned_sink);
+        stream->done = true;
+    });
+    workers_.push_back(Worker{std::move(thread), stream});
+    *status = MLC_LLM_OK;
+    return stream;
+}
+
+void MLCOpenAIBackend::shutdown() {
+    std::vector<Worker> workers;
+    {
+        std::lock_guard<std::mutex> lock(workers_mutex_);
+        shut_down_ = true;
+        workers.swap(workers_);
+    }
+    for (Worker& worker : workers) {
+        worker.stream->abortForShutdown();
+    }
+    for (Worker& worker : workers) {
+        // The last reference may be dropped by one of our own workers
+        if (worker.thread.get_id() == std::this_thread::get_id()) {
+            worker.thread.detach();
+        } else if (worker.thread.joinable()) {
+            worker.thread.join();
+        }
+    }
+}
+
+void MLCOpenAIBackend::reapFinished() {
+    for (auto it = workers_.begin(); it != workers_.end();) {
+        if (it->stream->done) {
+            if (it->thread.joinable()) it->thread.join();
+            it = workers_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void MLCOpenAIBackend::run(const MLCOpenAIConfig& config, const MLCBackendRequest& request,
+                           const std::shared_ptr<Stream>& stream, MLCDeliverySink& sink) {
+    auto fail = [&stream, &sink](const std::string& message) {
+        if (stream->silenced()) return;
+        std::string reported = stream->shuttingDown() ? "remote backend shut down" : message;
+        std::cerr << "❌ Remote backend: " << reported << std::endl;
+        sink.onError(reported);
+    };
+
+    Endpoint endpoint;
+    std::string error;
+    parseUrl(config.base_url, &endpoint, &error);
+
+    Connection connection;
+    if (!connection.open(endpoint, config.connect_timeout_ms, config.read_timeout_ms, *stream, &error)) {
+        stream->detach();
+        fail(error);
+        return;
+    }
+
+    std::string body = requestBody(config, request);
+    std::string head = "POST " + endpoint.path + "/chat/completions HTTP/1.1\r\n"
+                       "Host: " + endpoint.host + "\r\n"
+                       "Content-Type: application/json\r\n"
+                       "Accept: text/event-stream\r\n"
+                       "Connection: close\r\n"
+                       "Content-Length: " + std::to_string(body.size()) + "\r\n";
+    if (!config.api_key.empty()) head += "Authorization: Bearer " + config.api_key + "\r\n";
+    head += "\r\n";
+
+    // Closing the connection happens before reporting so a sink that cancels
+    // from its callback finds nothing left to interrupt
+    auto finishWith = [&](const std::function<void()>& report) {
+        stream->detach();
+        connection.close();
+        report();
+    };
+
+    if (!connection.sendAll(head + body)) {
+        finishWith([&]() { fail("failed to send request"); });
+        return;
+    }
+
+    std::string raw;
+    std::string decoded;
+    std::string lines;
+    ChunkedDecoder dechunker;
+    bool headers_done = false;
+    bool chunked = false;
+    int status_code = 0;
+    MLCFinishInfo info;
+    bool saw_done = false;
+    char buffer[16 * 1024];
+
+    while (!saw_done) {
+        ssize_t n = connection.receive(buffer, sizeof(buffer));
+        if (n <= 0) {
+            if (n < 0 || !headers_done) {
+                finishWith([&]() { fail(n < 0 ? "connection lost or timed out" : "empty response"); });
+                return;
+            }
+            break;
+        }
+
+        std::string incoming;
+        if (!headers_done) {
+            raw.append(buffer, static_cast<size_t>(n));
+            size_t end = raw.find("\r\n\r\n");
+            if (end == std::string::npos) continue;
+            std::string header_block = raw.substr(0, end);
+            incoming = raw.substr(end + 4);
+            raw.clear();
+            headers_done = true;
+
+            size_t space = header_block.find(' ');
+            status_code = space == std::string::npos ? 0 : std::atoi(header_block.c_str() + space + 1);
+            chunked = lowercase(header_block).find("transfer-encoding: chunked") != std::string::npos;
+        } else {
+            incoming.assign(buffer, static_cast<size_t>(n));
+        }
+
+        if (chunked) {
+            if (!dechunker.feed(incoming.data(), incoming.size(), &decoded)) {
+                finishWith([&]() { fail("malformed chunked response"); });
+                return;
+            }
+        } else {
+            decoded += incoming;
+        }
+
+        if (status_code != 200) {
+            if (decoded.size() < kMaxErrorBody && !(chunked && dechunker.finished())) continue;
+            finishWith([&]() { fail(errorMessage(status_code, decoded)); });
+            return;
+        }
+
+        // Server-sent events: one JSON completion chunk per "data:" line
+        lines += decoded;
+        decoded.clear();
+        size_t line_start = 0;
+        size_t line_end;
+        while (!saw_done && (line_end = lines.find('\n', line_start)) != std::string::npos) {
+            std::string line = lines.substr(line_start, line_end - line_start);
+            line_start = line_end + 1;
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.compare(0, 5, "data:") != 0) continue;
+            std::string data = line.substr(line[5] == ' ' ? 6 : 5);
+            if (data == "[DONE]") {
+                saw_done = true;
+                break;
+            }
+
+            MLCJsonValue event;
+            if (!MLCJson::parse(data, &event)) continue;
+            if (const MLCJsonValue* event_error = event.get("error")) {
+                const MLCJsonValue* message = event_error->get("message");
+                std::string text = message ? message->asString() : "remote error";
+                finishWith([&]() { fail(text); });
+                return;
+            }
+            const MLCJsonValue* choices = event.get("choices");
+            if (choices && !choices->array.empty()) {
+                const MLCJsonValue& choice = choices->array[0];
+                const MLCJsonValue* delta = choice.get("delta");
+                const MLCJsonValue* content = delta ? delta->get("content") : nullptr;
+                if (content && content->isString() && !content->string.empty() && !stream->silenced()) {
+                    sink.onChunk(content->string);
+                }
+                const MLCJsonValue* reason = choice.get("finish_reason");
+                if (reason && reason->isString()) info.finish_reason = reason->string;
+            }
+            if (const MLCJsonValue* usage = event.get("usage")) {
+                if (const MLCJsonValue* tokens = usage->get("prompt_tokens")) info.prompt_tokens = tokens->asInt();
+                if (const MLCJsonValue* tokens = usage->get("completion_tokens")) info.completion_tokens = tokens->asInt();
+            }
+        }
+        lines.erase(0, line_start);
+        if (!stream->silenced()) sink.flush();
+        if (chunked && dechunker.finished()) break;
+    }
+
+    if (status_code != 200) {
+        finishWith([&]() { fail(errorMessage(status_code, decoded)); });
+        return;
+    }
+    if (!saw_done && info.finish_reason.empty()) {
+        finishWith([&]() { fail("stream ended before completion"); });
+        return;
+    }
+    if (info.finish_reason.empty()) info.finish_reason = "stop";
+    finishWith([&]() {
+        if (!stream->silenced()) sink.onFinish(info);
+    });
+}
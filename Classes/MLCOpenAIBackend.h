@@ -0,0 +1,65 @@
+#ifndef MLCOpenAIBackend_h
+#define MLCOpenAIBackend_h
+
+#include "MLCBackend.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct MLCOpenAIConfig {
+    // API root, e.g. https://api.openai.com/v1 or http://127.0.0.1:8080/v1
+    std::string base_url;
+    std::string api_key;   // sent as a Bearer token when non-empty
+    std::string model;
+    int connect_timeout_ms = 5000;
+    // Longest silence tolerated between two reads of the response
+    int read_timeout_ms = 30000;
+};
+
+// Streams chat completions from an OpenAI-compatible server
+// (POST {base_url}/chat/completions with "stream": true) over plain POSIX
+// sockets, one worker thread per request. Handles chunked transfer encoding
+// and server-sent events. https:// uses the system TLS stack and is only
+// available on Apple platforms; elsewhere only http:// is supported.
+class MLCOpenAIBackend : public MLCBackend {
+public:
+    explicit MLCOpenAIBackend(MLCOpenAIConfig config);
+    ~MLCOpenAIBackend() override;
+
+    MLCOpenAIBackend(const MLCOpenAIBackend&) = delete;
+    MLCOpenAIBackend& operator=(const MLCOpenAIBackend&) = delete;
+
+    const char* name() const override { return "openai"; }
+
+    std::shared_ptr<MLCBackendStream> start(const MLCBackendRequest& request,
+                                            std::unique_ptr<MLCDeliverySink> sink, int* status) override;
+
+    // Ends every running request with an error and joins the workers; later
+    // start() calls fail
+    void shutdown();
+
+    // Checks that base_url can be served on this platform
+    static bool validateConfig(const MLCOpenAIConfig& config, std::string* error);
+
+private:
+    struct Stream;
+    struct Worker {
+        std::thread thread;
+        std::shared_ptr<Stream> stream;
+    };
+
+    static void run(const MLCOpenAIConfig& config, const MLCBackendRequest& request,
+                    const std::shared_ptr<Stream>& stream, MLCDeliverySink& sink);
+    static std::string requestBody(const MLCOpenAIConfig& config, const MLCBackendRequest& request);
+    void reapFinished();
+
+    const MLCOpenAIConfig config_;
+
+    std::mutex workers_mutex_;
+    std::vector<Worker> workers_;
+    bool shut_down_ = false;
+};
+
+#endif /* MLCOpenAIBackend_h */
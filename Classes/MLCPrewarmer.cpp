@@ -0,0 +1,323 @@
+#include "MLCPrewarmer.h"
+#include "MLCCpuTopology.h"
+#include "MLCFlightRecorder.h"
+#include "MLCMetrics.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+constexpr char kFileMagic[8] = {'M', 'L', 'C', 'P', 'R', 'E', 'W', '1'};
+// Observations between halvings of every count
+const uint64_t kAgeEvery = 16384;
+// Items that keep failing to warm are left alone
+const int kMaxFailures = 3;
+
+uint64_t fnv1a(uint64_t hash, const std::string& text) {
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    // Separator, so ("ab", "c") and ("a", "bc") differ
+    hash ^= 0xff;
+    hash *= 0x100000001b3ULL;
+    return hash;
+}
+
+uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+void writeString(std::ofstream& out, const std::string& value) {
+    uint32_t length = static_cast<uint32_t>(value.size());
+    out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    out.write(value.data(), length);
+}
+
+bool readString(std::ifstream& in, std::string* value) {
+    uint32_t length = 0;
+    if (!in.read(reinterpret_cast<char*>(&length), sizeof(length))) return false;
+    if (length > (64u << 20)) return false;
+    value->resize(length);
+    return static_cast<bool>(in.read(&(*value)[0], length));
+}
+
+} // namespace
+
+uint64_t MLCPrewarmItem::key() const {
+    uint64_t hash = 0xcbf29ce484222325ULL ^ static_cast<uint64_t>(kind);
+    hash = fnv1a(hash, has_system ? "1" + system : "0");
+    if (kind == Kind::Completion) {
+        hash = fnv1a(hash, request_class);
+        hash = fnv1a(hash, prompt);
+    }
+    return hash;
+}
+
+MLCCountMinSketch::MLCCountMinSketch(size_t width, int depth)
+    : width_(std::max<size_t>(width, 1)), depth_(std::max(depth, 1)), counters_(width_ * depth_, 0) {}
+
+size_t MLCCountMinSketch::index(int row, uint64_t key) const {
+    return static_cast<size_t>(row) * width_ + mix(key + 0x9e3779b97f4a7c15ULL * (row + 1)) % width_;
+}
+
+uint32_t MLCCountMinSketch::add(uint64_t key, uint32_t amount) {
+    uint32_t target = estimate(key) + amount;
+    for (int row = 0; row < depth_; ++row) {
+        uint32_t& counter = counters_[index(row, key)];
+        counter = std::max(counter, target);
+    }
+    return target;
+}
+
+uint32_t MLCCountMinSketch::estimate(uint64_t key) const {
+    uint32_t lowest = UINT32_MAX;
+    for (int row = 0; row < depth_; ++row) {
+        lowest = std::min(lowest, counters_[index(row, key)]);
+    }
+    return lowest;
+}
+
+void MLCCountMinSketch::halve() {
+    for (uint32_t& counter : counters_) counter >>= 1;
+}
+
+MLCPrewarmer::MLCPrewarmer(MLCPrewarmConfig config, MLCMetrics* metrics, Runner runner, Cancel cancel, BusyCheck busy)
+    : config_(std::move(config)), metrics_(metrics), runner_(std::move(runner)), cancel_(std::move(cancel)),
+      busy_(std::move(busy)), last_busy_(std::chrono::steady_clock::now()) {
+    if (!config_.persist_path.empty() && load(config_.persist_path)) {
+        std::cout << "🔥 Loaded " << candidates_.size() << " hot prompt items to prewarm" << std::endl;
+    }
+    thread_ = MLCCpuTopology::startBridgeThread([this]() {
+        MLCFlightRecorder::nameThread("prewarm");
+        run();
+    });
+}
+
+MLCPrewarmer::~MLCPrewarmer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) thread_.join();
+    std::string running_id;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_id = running_id_;
+    }
+    // The cancelled request's sink reports back before cancel returns
+    if (!running_id.empty()) cancel_(running_id);
+    if (!config_.persist_path.empty()) save(config_.persist_path);
+}
+
+void MLCPrewarmer::observe(const MLCPrewarmItem& item) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    observeLocked(item, 1);
+}
+
+void MLCPrewarmer::observeLocked(const MLCPrewarmItem& item, uint32_t amount) {
+    uint64_t key = item.key();
+    uint32_t count = sketch_.add(key, amount);
+    if (++observations_ % kAgeEvery == 0) {
+        sketch_.halve();
+        for (auto& entry : candidates_) entry.second.count >>= 1;
+    }
+
+    auto it = candidates_.find(key);
+    if (it != candidates_.end()) {
+        it->second.count = count;
+        it->second.item.max_tokens = item.max_tokens;
+        return;
+    }
+    if (count < config_.min_count) return;
+
+    if (candidates_.size() >= config_.top_k) {
+        auto coldest = std::min_element(candidates_.begin(), candidates_.end(), [](const auto& a, const auto& b) {
+            return a.second.count < b.second.count;
+        });
+        if (coldest == candidates_.end() || coldest->second.count >= count) return;
+        // Its KV is left to the engine's own eviction
+        if (coldest->second.warmed) warmed_prefix_tokens_ -= coldest->second.tokens;
+        candidates_.erase(coldest);
+    }
+    Candidate candidate;
+    candidate.item = item;
+    candidate.count = count;
+    candidates_.emplace(key, std::move(candidate));
+}
+
+MLCPrewarmer::Candidate* MLCPrewarmer::pickLocked() {
+    Candidate* best = nullptr;
+    for (auto& entry : candidates_) {
+        Candidate& candidate = entry.second;
+        if (candidate.warmed || candidate.failures >= kMaxFailures || candidate.count < config_.min_count) continue;
+        if (candidate.item.kind == MLCPrewarmItem::Kind::Prefix && warmed_prefix_tokens_ >= config_.max_prefix_tokens) {
+            continue;
+        }
+        if (!best || candidate.count > best->count) best = &candidate;
+    }
+    return best;
+}
+
+void MLCPrewarmer::preempt() {
+    std::string running_id;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        last_busy_ = std::chrono::steady_clock::now();
+        if (!running_) return;
+        // A warm-up still being submitted is cancelled once its id is known
+        preempt_requested_ = true;
+        running_id = running_id_;
+    }
+    if (!running_id.empty()) cancel_(running_id);
+}
+
+void MLCPrewarmer::onDone(uint64_t key, bool ok, int tokens) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool preempted = preempt_requested_;
+    running_ = false;
+    running_id_.clear();
+    preempt_requested_ = false;
+    cv_.notify_all();
+
+    auto it = candidates_.find(key);
+    if (it == candidates_.end()) return;
+    Candidate& candidate = it->second;
+    if (preempted && !ok) {
+        metrics_->prewarm_preemptions++;
+        return;
+    }
+    if (!ok) {
+        candidate.failures++;
+        return;
+    }
+    candidate.warmed = true;
+    if (candidate.item.kind == MLCPrewarmItem::Kind::Prefix) {
+        candidate.tokens = tokens;
+        warmed_prefix_tokens_ += tokens;
+        metrics_->prewarm_prefixes++;
+        metrics_->prewarm_prefix_tokens += static_cast<uint64_t>(tokens);
+    } else {
+        metrics_->prewarm_completions++;
+    }
+}
+
+void MLCPrewarmer::run() {
+    const auto poll = std::min(config_.idle, std::chrono::milliseconds(250));
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        cv_.wait_for(lock, poll, [this]() { return stopping_; });
+        if (stopping_ || running_) continue;
+
+        // The busy check takes the engine's request lock; never hold ours across it
+        lock.unlock();
+        bool busy = busy_();
+        lock.lock();
+        auto now = std::chrono::steady_clock::now();
+        if (busy) last_busy_ = now;
+        if (busy || now - last_busy_ < config_.idle || stopping_ || running_) continue;
+
+        Candidate* next = pickLocked();
+        if (!next) continue;
+        MLCPrewarmItem item = next->item;
+        uint64_t key = item.key();
+        int max_tokens = item.kind == MLCPrewarmItem::Kind::Prefix
+                             ? 1
+                             : std::min(item.max_tokens > 0 ? item.max_tokens : config_.completion_max_tokens,
+                                        config_.completion_max_tokens);
+        running_ = true;
+        running_key_ = key;
+        preempt_requested_ = false;
+
+        lock.unlock();
+        std::string request_id = runner_(item, max_tokens, [this, key](bool ok, int tokens) { onDone(key, ok, tokens); });
+        lock.lock();
+        if (!running_ || running_key_ != key) continue;
+        running_id_ = request_id;
+        if (preempt_requested_ && !request_id.empty()) {
+            lock.unlock();
+            cancel_(request_id);
+            lock.lock();
+        }
+    }
+}
+
+bool MLCPrewarmer::save(const std::string& path) const {
+    if (path.empty()) return false;
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "❌ Cannot write prewarm items to " << temp_path << std::endl;
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        out.write(kFileMagic, sizeof(kFileMagic));
+        uint32_t count = static_cast<uint32_t>(candidates_.size());
+        out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        for (const auto& entry : candidates_) {
+            const Candidate& candidate = entry.second;
+            uint8_t kind = static_cast<uint8_t>(candidate.item.kind);
+            uint8_t has_system = candidate.item.has_system ? 1 : 0;
+            int32_t max_tokens = candidate.item.max_tokens;
+            out.write(reinterpret_cast<const char*>(&kind), sizeof(kind));
+            out.write(reinterpret_cast<const char*>(&has_system), sizeof(has_system));
+            out.write(reinterpret_cast<const char*>(&candidate.count), sizeof(candidate.count));
+            out.write(reinterpret_cast<const char*>(&max_tokens), sizeof(max_tokens));
+            writeString(out, candidate.item.system);
+            writeString(out, candidate.item.request_class);
+            writeString(out, candidate.item.prompt);
+        }
+        if (!out.flush()) return false;
+    }
+    return std::rename(temp_path.c_str(), path.c_str()) == 0;
+}
+
+bool MLCPrewarmer::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+
+    char magic[sizeof(kFileMagic)];
+    uint32_t count = 0;
+    if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), kFileMagic) ||
+        !in.read(reinterpret_cast<char*>(&count), sizeof(count))) {
+        std::cerr << "❌ Ignoring prewarm items with unknown format: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<std::pair<MLCPrewarmItem, uint32_t>> loaded;
+    for (uint32_t i = 0; i < count; ++i) {
+        MLCPrewarmItem item;
+        uint8_t kind = 0;
+        uint8_t has_system = 0;
+        uint32_t item_count = 0;
+        int32_t max_tokens = 0;
+        if (!in.read(reinterpret_cast<char*>(&kind), sizeof(kind)) ||
+            !in.read(reinterpret_cast<char*>(&has_system), sizeof(has_system)) ||
+            !in.read(reinterpret_cast<char*>(&item_count), sizeof(item_count)) ||
+            !in.read(reinterpret_cast<char*>(&max_tokens), sizeof(max_tokens)) || !readString(in, &item.system) ||
+            !readString(in, &item.request_class) || !readString(in, &item.prompt) || kind > 1) {
+            std::cerr << "❌ Truncated prewarm items: " << path << std::endl;
+            return false;
+        }
+        item.kind = static_cast<MLCPrewarmItem::Kind>(kind);
+        item.has_system = has_system != 0;
+        item.max_tokens = max_tokens;
+        loaded.emplace_back(std::move(item), item_count);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& entry : loaded) {
+        observeLocked(entry.first, entry.second);
+    }
+    return true;
+}
@@ -0,0 +1,126 @@
+#ifndef MLCPrewarmer_h
+#define MLCPrewarmer_h
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class MLCMetrics;
+
+struct MLCPrewarmConfig {
+    size_t top_k = 16;                          // hot items tracked
+    uint32_t min_count = 3;                     // requests before an item is worth warming
+    std::chrono::milliseconds idle{2000};       // engine idle time before warming starts
+    int max_prefix_tokens = 8192;               // KV tokens spent on warmed prefixes
+    int completion_max_tokens = 256;
+    std::string persist_path;                   // hot items survive restarts here
+};
+
+// Something worth having warm before it is asked for: the system block of a
+// prompt (its KV stays in the engine's prefix cache) or a whole prompt whose
+// greedy completion goes into the similarity cache
+struct MLCPrewarmItem {
+    enum class Kind : uint8_t { Prefix = 0, Completion = 1 };
+    Kind kind = Kind::Prefix;
+    bool has_system = false;   // false uses the template's default system message
+    std::string system;
+    std::string request_class;  // Completion only
+    std::string prompt;         // Completion only
+    int max_tokens = 0;         // Completion only
+
+    uint64_t key() const;
+};
+
+// Count-min sketch with conservative update: only the smallest of a key's
+// counters grow, which keeps the overestimate of rare keys low
+class MLCCountMinSketch {
+public:
+    explicit MLCCountMinSketch(size_t width = 2048, int depth = 4);
+
+    // Returns the key's new estimate
+    uint32_t add(uint64_t key, uint32_t amount = 1);
+    uint32_t estimate(uint64_t key) const;
+    // Ages all counts so the sketch follows current traffic
+    void halve();
+
+private:
+    size_t index(int row, uint64_t key) const;
+
+    size_t width_;
+    int depth_;
+    std::vector<uint32_t> counters_;
+};
+
+// Tracks request frequency in a count-min sketch plus a top-K table of the
+// items behind the heaviest keys, and warms those items while the engine is
+// idle: one warm-up at a time, only after `idle` without caller requests, and
+// cancelled as soon as a caller request arrives.
+class MLCPrewarmer {
+public:
+    // Starts warming `item` and returns its request id, or "" when it was
+    // settled at once. `done` is called exactly once, with the KV tokens a
+    // prefix warm-up filled.
+    using Done = std::function<void(bool ok, int tokens)>;
+    using Runner = std::function<std::string(const MLCPrewarmItem& item, int max_tokens, Done done)>;
+    using Cancel = std::function<void(const std::string& request_id)>;
+    // True while caller requests are in flight
+    using BusyCheck = std::function<bool()>;
+
+    MLCPrewarmer(MLCPrewarmConfig config, MLCMetrics* metrics, Runner runner, Cancel cancel, BusyCheck busy);
+    // Cancels a running warm-up and saves the hot items when persist_path is set
+    ~MLCPrewarmer();
+
+    MLCPrewarmer(const MLCPrewarmer&) = delete;
+    MLCPrewarmer& operator=(const MLCPrewarmer&) = delete;
+
+    void observe(const MLCPrewarmItem& item);
+    // A caller request is about to reach the engine
+    void preempt();
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+
+private:
+    struct Candidate {
+        MLCPrewarmItem item;
+        uint32_t count = 0;
+        bool warmed = false;
+        int tokens = 0;     // KV tokens of a warmed prefix
+        int failures = 0;
+    };
+
+    void observeLocked(const MLCPrewarmItem& item, uint32_t amount);
+    Candidate* pickLocked();
+    void onDone(uint64_t key, bool ok, int tokens);
+    void run();
+
+    const MLCPrewarmConfig config_;
+    MLCMetrics* metrics_;
+    Runner runner_;
+    Cancel cancel_;
+    BusyCheck busy_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    MLCCountMinSketch sketch_;
+    uint64_t observations_ = 0;
+    std::unordered_map<uint64_t, Candidate> candidates_;
+    int warmed_prefix_tokens_ = 0;
+
+    bool running_ = false;
+    uint64_t running_key_ = 0;
+    std::string running_id_;
+    bool preempt_requested_ = false;
+    std::chrono::steady_clock::time_point last_busy_;
+
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+#endif /* MLCPrewarmer_h */
@@ -0,0 +1,76 @@
+#include "MLCRepetitionDetector.h"
+#include <algorithm>
+
+namespace {
+
+constexpr uint64_t kHashBase = 0x100000001b3ULL;
+
+} // namespace
+
+MLCRepetitionDetector::MLCRepetitionDetector(const MLCRepetitionConfig& config)
+    : config_(config),
+      base_power_(1),
+      rolling_hash_(0),
+      position_(0),
+      period_(0),
+      run_length_(0),
+      triggered_(false) {
+    config_.ngram_size = std::max(1, config_.ngram_size);
+    config_.max_period = std::max(1, config_.max_period);
+    config_.min_repeats = std::max(2, config_.min_repeats);
+    for (int i = 0; i < config_.ngram_size; ++i) base_power_ *= kHashBase;
+    tokens_.assign(config_.ngram_size, 0);
+    ngram_ring_.assign(config_.max_period + 1, 0);
+}
+
+bool MLCRepetitionDetector::addToken(uint64_t token_hash) {
+    if (!config_.enabled || triggered_) return triggered_;
+
+    const int n = config_.ngram_size;
+    const int64_t i = position_++;
+    uint64_t& slot = tokens_[i % n];
+    rolling_hash_ = rolling_hash_ * kHashBase + token_hash;
+    if (i >= n) rolling_hash_ -= slot * base_power_;
+    slot = token_hash;
+    if (i + 1 < n) return false;
+
+    // Index of this n-gram (by its last token) in the n-gram stream
+    const int64_t g = i - (n - 1);
+    const int64_t ring_size = static_cast<int64_t>(ngram_ring_.size());
+    const uint64_t h = rolling_hash_;
+
+    if (period_ > 0 && g >= period_ && ngram_ring_[(g - period_) % ring_size] == h) {
+        ++run_length_;
+    } else {
+        auto it = last_seen_.find(h);
+        int64_t distance = it != last_seen_.end() ? g - it->second : 0;
+        if (distance > 0 && distance <= config_.max_period) {
+            period_ = static_cast<int>(distance);
+            run_length_ = 1;
+        } else {
+            period_ = 0;
+            run_length_ = 0;
+        }
+    }
+
+    ngram_ring_[g % ring_size] = h;
+    last_seen_[h] = g;
+
+    // Entries older than max_period can never produce a candidate again
+    if (last_seen_.size() > static_cast<size_t>(4 * ring_size)) {
+        for (auto it = last_seen_.begin(); it != last_seen_.end();) {
+            if (g - it->second > config_.max_period) it = last_seen_.erase(it);
+            else ++it;
+        }
+    }
+
+    if (period_ > 0) {
+        // Tokens equal to the token one period earlier
+        int64_t repeated_tokens = run_length_ + n - 1;
+        int64_t covered_periods = (repeated_tokens + period_) / period_;
+        if (covered_periods >= config_.min_repeats && repeated_tokens >= config_.min_loop_tokens) {
+            triggered_ = true;
+        }
+    }
+    return triggered_;
+}
@@ -0,0 +1,51 @@
+#ifndef MLCRepetitionDetector_h
+#define MLCRepetitionDetector_h
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+struct MLCRepetitionConfig {
+    bool enabled = true;
+    // Tokens per hashed n-gram; larger values ignore short legitimate repeats
+    int ngram_size = 4;
+    // A loop must cover at least this many full periods
+    int min_repeats = 3;
+    // Longest loop period considered, in tokens
+    int max_period = 64;
+    // Minimum number of repeated tokens before the detector fires
+    int min_loop_tokens = 24;
+    // Abort the sequence when a loop is found; otherwise only report it
+    bool abort_on_loop = true;
+};
+
+// Streaming detector for degenerate periodic output. Every token is hashed,
+// a rolling polynomial hash is kept over the last `ngram_size` tokens, and the
+// detector tracks how long the n-gram stream has matched itself at a fixed
+// distance. A sustained self-match at distance p means the output repeats with
+// period p. Cost is O(1) per token and memory is bounded by `max_period`.
+class MLCRepetitionDetector {
+public:
+    explicit MLCRepetitionDetector(const MLCRepetitionConfig& config);
+
+    // Feeds one token; returns true once the output is considered looping
+    bool addToken(uint64_t token_hash);
+
+    int period() const { return period_; }
+
+private:
+    MLCRepetitionConfig config_;
+    uint64_t base_power_;       // base^ngram_size, to drop the oldest token
+    uint64_t rolling_hash_;
+    int64_t position_;          // number of tokens seen
+
+    std::vector<uint64_t> tokens_;        // ring of the last ngram_size tokens
+    std::vector<uint64_t> ngram_ring_;    // ring of the last max_period + 1 n-gram hashes
+    std::unordered_map<uint64_t, int64_t> last_seen_;
+
+    int period_;
+    int64_t run_length_;
+    bool triggered_;
+};
+
+#endif /* MLCRepetitionDetector_h */
@@ -0,0 +1,155 @@
+#include "MLCReplicaRouter.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+const uint64_t kFnvOffset = 1469598103934665603ULL;
+const uint64_t kFnvPrime = 1099511628211ULL;
+
+uint64_t mixToken(uint64_t hash, int32_t token) {
+    uint32_t value = static_cast<uint32_t>(token);
+    for (int i = 0; i < 4; ++i) {
+        hash ^= (value >> (8 * i)) & 0xFF;
+        hash *= kFnvPrime;
+    }
+    return hash;
+}
+
+} // namespace
+
+MLCReplicaRouter::MLCReplicaRouter(size_t replicas, const MLCRouterConfig& config)
+    : config_(config), replicas_(std::max<size_t>(1, replicas)), next_expiry_(Clock::now()) {}
+
+std::vector<uint64_t> MLCReplicaRouter::blockChain(const std::vector<int32_t>& prompt_ids) const {
+    // Each hash covers the whole prefix up to the end of its block, so equal
+    // hashes mean equal prefixes, as in the engine's prefix cache
+    size_t block = static_cast<size_t>(std::max(1, config_.block_tokens));
+    std::vector<uint64_t> chain;
+    chain.reserve(prompt_ids.size() / block);
+    uint64_t hash = kFnvOffset;
+    for (size_t i = 0; i + block <= prompt_ids.size(); i += block) {
+        for (size_t j = i; j < i + block; ++j) hash = mixToken(hash, prompt_ids[j]);
+        chain.push_back(hash);
+    }
+    return chain;
+}
+
+int MLCReplicaRouter::cachedBlocksLocked(const Replica& replica, const std::vector<uint64_t>& chain) const {
+    int cached = 0;
+    for (uint64_t hash : chain) {
+        if (!replica.blocks.count(hash)) break;
+        ++cached;
+    }
+    return cached;
+}
+
+void MLCReplicaRouter::rememberLocked(Replica& replica, const std::vector<uint64_t>& chain) {
+    // Touched tail first so a prompt's leading blocks are the last evicted;
+    // a match stops at the first missing block
+    for (auto block = chain.rbegin(); block != chain.rend(); ++block) {
+        uint64_t hash = *block;
+        auto it = replica.blocks.find(hash);
+        if (it != replica.blocks.end()) {
+            replica.lru.splice(replica.lru.begin(), replica.lru, it->second);
+        } else {
+            replica.lru.push_front(hash);
+            replica.blocks[hash] = replica.lru.begin();
+        }
+    }
+    while (replica.blocks.size() > config_.max_cached_blocks) {
+        replica.blocks.erase(replica.lru.back());
+        replica.lru.pop_back();
+    }
+}
+
+void MLCReplicaRouter::expireSessionsLocked(Clock::time_point now) {
+    if (now < next_expiry_) return;
+    auto ttl = std::chrono::milliseconds(config_.session_ttl_ms);
+    for (auto it = sessions_.begin(); it != sessions_.end();) {
+        it = now - it->second.last_used > ttl ? sessions_.erase(it) : std::next(it);
+    }
+    // Sweeping once per minute keeps routing O(replicas)
+    next_expiry_ = now + std::chrono::minutes(1);
+}
+
+MLCReplicaRouter::Route MLCReplicaRouter::route(const std::vector<int32_t>& prompt_ids, const std::string& session_id) {
+    std::vector<uint64_t> chain = blockChain(prompt_ids);
+    int block = std::max(1, config_.block_tokens);
+    Clock::time_point now = Clock::now();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    expireSessionsLocked(now);
+
+    const Session* session = nullptr;
+    if (!session_id.empty()) {
+        auto it = sessions_.find(session_id);
+        if (it != sessions_.end() && now - it->second.last_used <= std::chrono::milliseconds(config_.session_ttl_ms)) {
+            session = &it->second;
+        }
+    }
+
+    std::vector<int> cached(replicas_.size());
+    size_t best_cached = 0;
+    for (size_t i = 0; i < replicas_.size(); ++i) {
+        cached[i] = cachedBlocksLocked(replicas_[i], chain) * block;
+        if (session && session->replica == i) {
+            // The session's own last prompt is a prefix of this one as far as
+            // their blocks agree, whether or not we still remember them
+            int shared = 0;
+            while (shared < static_cast<int>(std::min(chain.size(), session->chain.size())) &&
+                   chain[shared] == session->chain[shared]) {
+                ++shared;
+            }
+            cached[i] = std::max(cached[i], shared * block);
+        }
+        if (cached[i] > cached[best_cached]) best_cached = i;
+    }
+
+    size_t chosen = 0;
+    double best_score = std::numeric_limits<double>::max();
+    for (size_t i = 0; i < replicas_.size(); ++i) {
+        double score = static_cast<double>(replicas_[i].stats.in_flight) * config_.load_cost_tokens - cached[i];
+        // Ties go to the session's replica, then the lower index
+        bool preferred = session && session->replica == i;
+        if (score < best_score || (score == best_score && preferred)) {
+            best_score = score;
+            chosen = i;
+        }
+    }
+
+    Replica& replica = replicas_[chosen];
+    replica.stats.requests++;
+    replica.stats.in_flight++;
+    replica.stats.prompt_tokens += prompt_ids.size();
+    replica.stats.prefix_hit_tokens += cached[chosen];
+    if (session && session->replica == chosen) replica.stats.sticky_routes++;
+    if (cached[best_cached] > cached[chosen]) replica.stats.rebalanced++;
+    rememberLocked(replica, chain);
+
+    if (!session_id.empty()) {
+        Session& entry = sessions_[session_id];
+        entry.replica = chosen;
+        entry.chain = std::move(chain);
+        entry.last_used = now;
+    }
+
+    Route route;
+    route.replica = chosen;
+    route.cached_tokens = cached[chosen];
+    return route;
+}
+
+void MLCReplicaRouter::onFinish(size_t replica) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (replica < replicas_.size() && replicas_[replica].stats.in_flight > 0) {
+        replicas_[replica].stats.in_flight--;
+    }
+}
+
+std::vector<MLCReplicaStats> MLCReplicaRouter::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<MLCReplicaStats> out;
+    for (const Replica& replica : replicas_) out.push_back(replica.stats);
+    return out;
+}
@@ -0,0 +1,90 @@
+#ifndef MLCReplicaRouter_h
+#define MLCReplicaRouter_h
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct MLCRouterConfig {
+    // Prompt prefixes are compared in blocks of this many tokens
+    int block_tokens = 16;
+    // Blocks remembered per replica, approximating its prefix cache (LRU)
+    size_t max_cached_blocks = 16384;
+    // Prefill tokens one extra in-flight request is worth; a replica with a
+    // longer cached prefix is preferred until its extra load costs more than this
+    int load_cost_tokens = 256;
+    // Sessions idle for longer lose their stickiness
+    int session_ttl_ms = 10 * 60 * 1000;
+};
+
+struct MLCReplicaStats {
+    uint64_t requests = 0;
+    int in_flight = 0;
+    uint64_t prompt_tokens = 0;
+    uint64_t prefix_hit_tokens = 0;   // prompt tokens expected to be served from the replica's prefix cache
+    uint64_t sticky_routes = 0;       // routed by session id
+    uint64_t rebalanced = 0;          // sent away from the best-cached replica because of load
+};
+
+// Prefix-cache-aware dispatch over engine replicas serving the same model.
+// Each replica's prefix cache is approximated by the chained hashes of the
+// prompt blocks recently sent to it. A request goes to the replica minimising
+//
+//     in_flight * load_cost_tokens - expected_cached_prefix_tokens
+//
+// so requests sharing a system prompt or conversation stay together until the
+// load imbalance outweighs the prefill they would save. A session's previous
+// replica counts as caching the session's last prompt even after the router
+// has forgotten its blocks.
+class MLCReplicaRouter {
+public:
+    struct Route {
+        size_t replica = 0;
+        int cached_tokens = 0;
+    };
+
+    MLCReplicaRouter(size_t replicas, const MLCRouterConfig& config);
+
+    // Picks a replica for `prompt_ids`, counts the request as in flight there
+    // and records its blocks as cached
+    Route route(const std::vector<int32_t>& prompt_ids, const std::string& session_id);
+    void onFinish(size_t replica);
+
+    size_t replicaCount() const { return replicas_.size(); }
+    std::vector<MLCReplicaStats> stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Replica {
+        // LRU of block-chain hashes, most recent at the front
+        std::list<uint64_t> lru;
+        std::unordered_map<uint64_t, std::list<uint64_t>::iterator> blocks;
+        MLCReplicaStats stats;
+    };
+
+    struct Session {
+        size_t replica = 0;
+        std::vector<uint64_t> chain;   // block hashes of the session's last prompt
+        Clock::time_point last_used;
+    };
+
+    std::vector<uint64_t> blockChain(const std::vector<int32_t>& prompt_ids) const;
+    int cachedBlocksLocked(const Replica& replica, const std::vector<uint64_t>& chain) const;
+    void rememberLocked(Replica& replica, const std::vector<uint64_t>& chain);
+    void expireSessionsLocked(Clock::time_point now);
+
+    const MLCRouterConfig config_;
+
+    mutable std::mutex mutex_;
+    std::vector<Replica> replicas_;
+    std::unordered_map<std::string, Session> sessions_;
+    Clock::time_point next_expiry_;
+};
+
+#endif /* MLCReplicaRouter_h */
@@ -0,0 +1,296 @@
+#include "MLCSimilarityCache.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+constexpr char kFileMagic[8] = {'M', 'L', 'C', 'S', 'I', 'M', 'C', '1'};
+
+uint64_t fnv1a(const char* data, size_t length) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+uint64_t mix64(uint64_t x) {
+    // splitmix64 finalizer, spreads shingle hashes over all 64 bits
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+void writeString(std::ofstream& out, const std::string& value) {
+    uint32_t length = static_cast<uint32_t>(value.size());
+    out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+    out.write(value.data(), length);
+}
+
+bool readString(std::ifstream& in, std::string* value) {
+    uint32_t length = 0;
+    if (!in.read(reinterpret_cast<char*>(&length), sizeof(length))) return false;
+    if (length > (64u << 20)) return false;
+    value->resize(length);
+    return static_cast<bool>(in.read(&(*value)[0], length));
+}
+
+} // namespace
+
+void MLCSimilarityCache::configure(const MLCSimilarityCacheConfig& config) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config_ = config;
+    if (config_.capacity == 0) config_.capacity = 1;
+    if (config_.max_hamming_distance > kMaxHammingDistance) {
+        std::cerr << "⚠️ Similarity cache max_hamming_distance " << config_.max_hamming_distance << " capped at "
+                  << kMaxHammingDistance << std::endl;
+        config_.max_hamming_distance = kMaxHammingDistance;
+    }
+    // Pigeonhole: fingerprints within distance d agree on one of d + 1 bands
+    int bands_count = std::max(config_.max_hamming_distance, 0) + 1;
+    if (bands_count != bands_count_) {
+        bands_count_ = bands_count;
+        bands_.clear();
+        for (auto it = entries_.begin(); it != entries_.end(); ++it) indexLocked(it);
+    }
+    while (entries_.size() > config_.capacity) {
+        evictLocked(std::prev(entries_.end()));
+    }
+}
+
+bool MLCSimilarityCache::acceptsClass(const std::string& request_class) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return !request_class.empty() && config_.request_classes.count(request_class) > 0;
+}
+
+std::string MLCSimilarityCache::persistPath() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return config_.persist_path;
+}
+
+size_t MLCSimilarityCache::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+}
+
+std::string MLCSimilarityCache::normalize(const std::string& text) {
+    // Lowercase ASCII, drop punctuation entirely ("what's" -> "whats") and
+    // collapse whitespace runs. Non-ASCII bytes are kept as-is.
+    std::string out;
+    out.reserve(text.size());
+    bool pending_space = false;
+    for (unsigned char c : text) {
+        if (c >= 0x80 || std::isalnum(c)) {
+            if (pending_space && !out.empty()) out.push_back(' ');
+            pending_space = false;
+            out.push_back(static_cast<char>(c < 0x80 ? std::tolower(c) : c));
+        } else if (std::isspace(c)) {
+            pending_space = true;
+        }
+    }
+    return out;
+}
+
+std::vector<uint32_t> MLCSimilarityCache::shingle(const std::string& normalized) {
+    std::vector<uint32_t> shingles;
+    if (normalized.size() < 3) {
+        if (!normalized.empty()) shingles.push_back(static_cast<uint32_t>(fnv1a(normalized.data(), normalized.size())));
+        return shingles;
+    }
+    shingles.reserve(normalized.size() - 2);
+    for (size_t i = 0; i + 3 <= normalized.size(); ++i) {
+        shingles.push_back(static_cast<uint32_t>(fnv1a(normalized.data() + i, 3)));
+    }
+    std::sort(shingles.begin(), shingles.end());
+    shingles.erase(std::unique(shingles.begin(), shingles.end()), shingles.end());
+    return shingles;
+}
+
+uint64_t MLCSimilarityCache::simhash(const std::vector<uint32_t>& shingles) {
+    int weights[64] = {0};
+    for (uint32_t shingle : shingles) {
+        uint64_t hash = mix64(shingle);
+        for (int bit = 0; bit < 64; ++bit) {
+            weights[bit] += (hash >> bit) & 1 ? 1 : -1;
+        }
+    }
+    uint64_t fingerprint = 0;
+    for (int bit = 0; bit < 64; ++bit) {
+        if (weights[bit] > 0) fingerprint |= 1ULL << bit;
+    }
+    return fingerprint;
+}
+
+double MLCSimilarityCache::jaccard(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b) {
+    if (a.empty() && b.empty()) return 1.0;
+    size_t i = 0, j = 0, intersection = 0;
+    while (i < a.size() && j < b.size()) {
+        if (a[i] == b[j]) {
+            ++intersection;
+            ++i;
+            ++j;
+        } else if (a[i] < b[j]) {
+            ++i;
+        } else {
+            ++j;
+        }
+    }
+    size_t union_size = a.size() + b.size() - intersection;
+    return static_cast<double>(intersection) / static_cast<double>(union_size);
+}
+
+uint64_t MLCSimilarityCache::bandKey(int band, uint64_t fingerprint) const {
+    // Band widths differ by at most one bit when 64 does not divide evenly
+    int low = 64 * band / bands_count_;
+    int bits = 64 * (band + 1) / bands_count_ - low;
+    uint64_t value = (fingerprint >> low) & (bits == 64 ? ~0ULL : (1ULL << bits) - 1);
+    return value ^ mix64(static_cast<uint64_t>(band) + 1);
+}
+
+bool MLCSimilarityCache::lookup(const std::string& request_class, const std::string& prompt, std::string* completion) {
+    std::string normalized = normalize(prompt);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (entries_.empty()) return false;
+
+    auto exact = exact_.find(request_class + '\n' + normalized);
+    if (exact != exact_.end()) {
+        entries_.splice(entries_.begin(), entries_, exact->second);
+        *completion = exact->second->completion;
+        return true;
+    }
+
+    std::vector<uint32_t> shingles = shingle(normalized);
+    uint64_t fingerprint = simhash(shingles);
+
+    EntryList::iterator best = entries_.end();
+    double best_similarity = config_.min_similarity;
+    for (int band = 0; band < bands_count_; ++band) {
+        auto bucket = bands_.find(bandKey(band, fingerprint));
+        if (bucket == bands_.end()) continue;
+        for (EntryList::iterator candidate : bucket->second) {
+            if (candidate->request_class != request_class) continue;
+            if (__builtin_popcountll(candidate->fingerprint ^ fingerprint) > config_.max_hamming_distance) continue;
+            double similarity = jaccard(shingles, candidate->shingles);
+            if (similarity >= best_similarity) {
+                best_similarity = similarity;
+                best = candidate;
+            }
+        }
+    }
+
+    if (best == entries_.end()) return false;
+    entries_.splice(entries_.begin(), entries_, best);
+    *completion = best->completion;
+    return true;
+}
+
+void MLCSimilarityCache::insert(const std::string& request_class, const std::string& prompt, const std::string& completion) {
+    Entry entry;
+    entry.request_class = request_class;
+    entry.normalized_prompt = normalize(prompt);
+    entry.completion = completion;
+    entry.shingles = shingle(entry.normalized_prompt);
+    entry.fingerprint = simhash(entry.shingles);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    insertLocked(std::move(entry));
+}
+
+void MLCSimilarityCache::insertLocked(Entry entry) {
+    auto existing = exact_.find(entry.request_class + '\n' + entry.normalized_prompt);
+    if (existing != exact_.end()) {
+        evictLocked(existing->second);
+    }
+
+    entries_.push_front(std::move(entry));
+    EntryList::iterator it = entries_.begin();
+    exact_[it->request_class + '\n' + it->normalized_prompt] = it;
+    indexLocked(it);
+
+    while (entries_.size() > config_.capacity) {
+        evictLocked(std::prev(entries_.end()));
+    }
+}
+
+void MLCSimilarityCache::indexLocked(EntryList::iterator it) {
+    for (int band = 0; band < bands_count_; ++band) {
+        bands_[bandKey(band, it->fingerprint)].push_back(it);
+    }
+}
+
+void MLCSimilarityCache::evictLocked(EntryList::iterator it) {
+    for (int band = 0; band < bands_count_; ++band) {
+        auto bucket = bands_.find(bandKey(band, it->fingerprint));
+        if (bucket == bands_.end()) continue;
+        auto& members = bucket->second;
+        members.erase(std::remove(members.begin(), members.end(), it), members.end());
+        if (members.empty()) bands_.erase(bucket);
+    }
+    exact_.erase(it->request_class + '\n' + it->normalized_prompt);
+    entries_.erase(it);
+}
+
+bool MLCSimilarityCache::save(const std::string& path) const {
+    if (path.empty()) return false;
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "❌ Cannot write similarity cache to " << temp_path << std::endl;
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        out.write(kFileMagic, sizeof(kFileMagic));
+        uint32_t count = static_cast<uint32_t>(entries_.size());
+        out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        // Least recently used first so a reload restores the same LRU order
+        for (auto it = entries_.rbegin(); it != entries_.rend(); ++it) {
+            writeString(out, it->request_class);
+            writeString(out, it->normalized_prompt);
+            writeString(out, it->completion);
+        }
+        if (!out.flush()) return false;
+    }
+    return std::rename(temp_path.c_str(), path.c_str()) == 0;
+}
+
+bool MLCSimilarityCache::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+
+    char magic[sizeof(kFileMagic)];
+    uint32_t count = 0;
+    if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), kFileMagic) ||
+        !in.read(reinterpret_cast<char*>(&count), sizeof(count))) {
+        std::cerr << "❌ Ignoring similarity cache with unknown format: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<Entry> loaded;
+    for (uint32_t i = 0; i < count; ++i) {
+        Entry entry;
+        if (!readString(in, &entry.request_class) || !readString(in, &entry.normalized_prompt) ||
+            !readString(in, &entry.completion)) {
+            std::cerr << "❌ Truncated similarity cache: " << path << std::endl;
+            return false;
+        }
+        entry.shingles = shingle(entry.normalized_prompt);
+        entry.fingerprint = simhash(entry.shingles);
+        loaded.push_back(std::move(entry));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (Entry& entry : loaded) {
+        insertLocked(std::move(entry));
+    }
+    return true;
+}
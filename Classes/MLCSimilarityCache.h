@@ -0,0 +1,81 @@
+#ifndef MLCSimilarityCache_h
+#define MLCSimilarityCache_h
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+struct MLCSimilarityCacheConfig {
+    // Request classes allowed to read and populate the cache; empty disables it
+    std::unordered_set<std::string> request_classes;
+    // Minimum Jaccard similarity of character trigrams for a hit
+    double min_similarity = 0.8;
+    // SimHash prefilter. The LSH index is split into max_hamming_distance + 1
+    // bands so every fingerprint within the distance shares a band with the
+    // query; capped at kMaxHammingDistance.
+    int max_hamming_distance = 3;
+    size_t capacity = 1024;
+    std::string persist_path;
+};
+
+// Near-duplicate prompt cache. Prompts are normalized (case, punctuation,
+// whitespace), shingled into character trigrams and fingerprinted with a 64-bit
+// SimHash. The fingerprint is split into max_hamming_distance + 1 bands that
+// key an LSH index (four 16-bit bands by default), so lookups only touch
+// entries sharing a band. Candidates are then
+// verified with the exact trigram Jaccard similarity. Entries are evicted in
+// LRU order beyond `capacity`.
+class MLCSimilarityCache {
+public:
+    // Bands narrower than 4 bits put most entries in every bucket
+    static constexpr int kMaxHammingDistance = 15;
+
+    MLCSimilarityCache() = default;
+
+    void configure(const MLCSimilarityCacheConfig& config);
+    bool acceptsClass(const std::string& request_class) const;
+
+    // Returns true and fills `completion` when a cached prompt is similar enough
+    bool lookup(const std::string& request_class, const std::string& prompt, std::string* completion);
+    void insert(const std::string& request_class, const std::string& prompt, const std::string& completion);
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path);
+    std::string persistPath() const;
+    size_t size() const;
+
+    static std::string normalize(const std::string& text);
+    static uint64_t simhash(const std::vector<uint32_t>& shingles);
+
+private:
+    struct Entry {
+        std::string request_class;
+        std::string normalized_prompt;
+        std::string completion;
+        uint64_t fingerprint;
+        std::vector<uint32_t> shingles;  // sorted, unique
+    };
+
+    using EntryList = std::list<Entry>;
+
+    static std::vector<uint32_t> shingle(const std::string& normalized);
+    static double jaccard(const std::vector<uint32_t>& a, const std::vector<uint32_t>& b);
+    uint64_t bandKey(int band, uint64_t fingerprint) const;
+
+    void indexLocked(EntryList::iterator it);
+    void insertLocked(Entry entry);
+    void evictLocked(EntryList::iterator it);
+
+    mutable std::mutex mutex_;
+    MLCSimilarityCacheConfig config_;
+    int bands_count_ = 4;
+    EntryList entries_;  // most recently used first
+    std::unordered_map<uint64_t, std::vector<EntryList::iterator>> bands_;
+    std::unordered_map<std::string, EntryList::iterator> exact_;  // class + '\n' + normalized prompt
+};
+
+#endif /* MLCSimilarityCache_h */
@@ -0,0 +1,113 @@
+#include "MLCTelemetryPage.h"
+#include "MLCCpuTopology.h"
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+MLCTelemetryPage::MLCTelemetryPage(std::string name, std::chrono::milliseconds interval, Collector collector)
+    : name_(std::move(name)), interval_(interval), collector_(std::move(collector)) {}
+
+MLCTelemetryPage::~MLCTelemetryPage() {
+    stop();
+}
+
+bool MLCTelemetryPage::isFilePath() const {
+    return name_.find('/', 1) != std::string::npos;
+}
+
+bool MLCTelemetryPage::start(std::string* error) {
+    if (page_) return true;
+    // POSIX shm names are one leading slash and no others
+    int fd = isFilePath() ? open(name_.c_str(), O_RDWR | O_CREAT, 0644)
+                          : shm_open(name_.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        *error = "cannot open " + name_ + ": " + strerror(errno);
+        return false;
+    }
+    if (ftruncate(fd, sizeof(mlc_llm_telemetry_page_t)) != 0) {
+        *error = "cannot size " + name_ + ": " + strerror(errno);
+        close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, sizeof(mlc_llm_telemetry_page_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        *error = "cannot map " + name_ + ": " + strerror(errno);
+        return false;
+    }
+
+    page_ = static_cast<mlc_llm_telemetry_page_t*>(mapped);
+    // A segment left by an earlier run may still hold an odd sequence
+    std::memset(page_, 0, sizeof(*page_));
+    page_->magic = MLC_LLM_TELEMETRY_MAGIC;
+    page_->version = MLC_LLM_TELEMETRY_VERSION;
+    page_->page_size = sizeof(mlc_llm_telemetry_page_t);
+    page_->pid = static_cast<uint32_t>(getpid());
+    page_->interval_us = static_cast<uint64_t>(interval_.count()) * 1000;
+    scratch_ = *page_;
+    publish();
+
+    stopping_ = false;
+    thread_ = MLCCpuTopology::startBridgeThread([this]() { run(); });
+    return true;
+}
+
+void MLCTelemetryPage::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_one();
+    if (thread_.joinable()) thread_.join();
+    if (!page_) return;
+
+    publish();
+    munmap(page_, sizeof(mlc_llm_telemetry_page_t));
+    page_ = nullptr;
+    if (isFilePath()) {
+        unlink(name_.c_str());
+    } else {
+        shm_unlink(name_.c_str());
+    }
+}
+
+void MLCTelemetryPage::publish() {
+    // Collected outside the write window, which then lasts one memcpy
+    collector_(&scratch_);
+    scratch_.published_unix_us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+
+    const size_t body = offsetof(mlc_llm_telemetry_page_t, published_unix_us);
+    uint64_t sequence = __atomic_load_n(&page_->sequence, __ATOMIC_RELAXED);
+    __atomic_store_n(&page_->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    // The header is constant; copy from the timestamp on
+    std::memcpy(reinterpret_cast<char*>(page_) + body, reinterpret_cast<const char*>(&scratch_) + body,
+                sizeof(mlc_llm_telemetry_page_t) - body);
+    __atomic_store_n(&page_->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+void MLCTelemetryPage::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        cv_.wait_for(lock, interval_, [this]() { return stopping_; });
+        if (stopping_) break;
+        lock.unlock();
+        publish();
+        lock.lock();
+    }
+}
+
+bool MLCTelemetryPage::read(const mlc_llm_telemetry_page_t* page, mlc_llm_telemetry_page_t* out, int attempts) {
+    for (int i = 0; i < attempts; ++i) {
+        uint64_t before = __atomic_load_n(&page->sequence, __ATOMIC_ACQUIRE);
+        if (before & 1) continue;
+        std::memcpy(out, page, sizeof(*out));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&page->sequence, __ATOMIC_RELAXED) == before) return true;
+    }
+    return false;
+}
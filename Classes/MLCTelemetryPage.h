@@ -0,0 +1,52 @@
+#ifndef MLCTelemetryPage_h
+#define MLCTelemetryPage_h
+
+#include "MLCBridge.h"
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Publishes mlc_llm_telemetry_page_t snapshots into a shared-memory segment
+// (or a mapped file) from a background thread. Each snapshot is assembled
+// off to the side and copied in under a seqlock, so the inference threads
+// never wait on readers and readers never block the writer.
+class MLCTelemetryPage {
+public:
+    // Fills everything but the header and sequence
+    using Collector = std::function<void(mlc_llm_telemetry_page_t* page)>;
+
+    MLCTelemetryPage(std::string name, std::chrono::milliseconds interval, Collector collector);
+    ~MLCTelemetryPage();
+
+    MLCTelemetryPage(const MLCTelemetryPage&) = delete;
+    MLCTelemetryPage& operator=(const MLCTelemetryPage&) = delete;
+
+    bool start(std::string* error);
+    // Publishes a last snapshot, then unmaps and removes the segment
+    void stop();
+
+    // Seqlock read for monitors; false if no consistent copy was obtained
+    static bool read(const mlc_llm_telemetry_page_t* page, mlc_llm_telemetry_page_t* out, int attempts = 100);
+
+private:
+    bool isFilePath() const;
+    void publish();
+    void run();
+
+    const std::string name_;
+    const std::chrono::milliseconds interval_;
+    Collector collector_;
+
+    mlc_llm_telemetry_page_t* page_ = nullptr;
+    mlc_llm_telemetry_page_t scratch_ = {};
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+#endif /* MLCTelemetryPage_h */
@@ -0,0 +1,58 @@
+#include "MLCTokenizer.h"
+#include <stdexcept>
+
+using namespace tvm::runtime;
+
+PackedFunc MLCTokenizer::getGlobal(const char* name) {
+    const PackedFunc* func = Registry::Get(name);
+    if (!func) {
+        throw std::runtime_error(std::string("Cannot find ") + name + " function");
+    }
+    return *func;
+}
+
+MLCTokenizer::MLCTokenizer(const std::string& model_path) {
+    PackedFunc create = getGlobal("mlc.tokenizers.Tokenizer");
+    encode_ = getGlobal("mlc.tokenizers.TokenizerEncode");
+    decode_ = getGlobal("mlc.tokenizers.TokenizerDecode");
+    create_streamer_ = getGlobal("mlc.tokenizers.TextStreamer");
+    streamer_put_ = getGlobal("mlc.tokenizers.TextStreamerPut");
+    streamer_finish_ = getGlobal("mlc.tokenizers.TextStreamerFinish");
+
+    ObjectRef handle = create(String(model_path));
+    handle_ = handle;
+}
+
+ShapeTuple MLCTokenizer::toTuple(const std::vector<int32_t>& token_ids) {
+    std::vector<int64_t> values(token_ids.begin(), token_ids.end());
+    return ShapeTuple(values.begin(), values.end());
+}
+
+std::vector<int32_t> MLCTokenizer::encode(const std::string& text) const {
+    ShapeTuple encoded = encode_(handle_, String(text));
+    return std::vector<int32_t>(encoded.begin(), encoded.end());
+}
+
+std::string MLCTokenizer::decode(const std::vector<int32_t>& token_ids) const {
+    String decoded = decode_(handle_, toTuple(token_ids));
+    return decoded;
+}
+
+MLCTokenizer::Streamer MLCTokenizer::createStreamer() const {
+    Streamer streamer;
+    ObjectRef handle = create_streamer_(handle_);
+    streamer.handle_ = handle;
+    streamer.put_ = streamer_put_;
+    streamer.finish_ = streamer_finish_;
+    return streamer;
+}
+
+std::string MLCTokenizer::Streamer::put(const std::vector<int32_t>& token_ids) {
+    String text = put_(handle_, MLCTokenizer::toTuple(token_ids));
+    return text;
+}
+
+std::string MLCTokenizer::Streamer::finish() {
+    String text = finish_(handle_);
+    return text;
+}
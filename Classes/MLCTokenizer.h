@@ -0,0 +1,50 @@
+#ifndef MLCTokenizer_h
+#define MLCTokenizer_h
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <tvm/runtime/packed_func.h>
+#include <tvm/runtime/registry.h>
+
+// Thin wrapper over the MLC-LLM tokenizer registered with the TVM runtime
+// (mlc.tokenizers.*). Loaded from the model directory's tokenizer files.
+class MLCTokenizer {
+public:
+    // Incremental detokenizer for one output stream. Holds back bytes until
+    // they form complete UTF-8 characters.
+    class Streamer {
+    public:
+        std::string put(const std::vector<int32_t>& token_ids);
+        std::string finish();
+
+    private:
+        friend class MLCTokenizer;
+        tvm::runtime::ObjectRef handle_;
+        tvm::runtime::PackedFunc put_;
+        tvm::runtime::PackedFunc finish_;
+    };
+
+    // Throws std::runtime_error if the tokenizer functions are not linked in
+    // or the model directory has no tokenizer
+    explicit MLCTokenizer(const std::string& model_path);
+
+    std::vector<int32_t> encode(const std::string& text) const;
+    std::string decode(const std::vector<int32_t>& token_ids) const;
+    Streamer createStreamer() const;
+
+    static tvm::runtime::ShapeTuple toTuple(const std::vector<int32_t>& token_ids);
+
+private:
+    static tvm::runtime::PackedFunc getGlobal(const char* name);
+
+    tvm::runtime::ObjectRef handle_;
+    tvm::runtime::PackedFunc encode_;
+    tvm::runtime::PackedFunc decode_;
+    tvm::runtime::PackedFunc create_streamer_;
+    tvm::runtime::PackedFunc streamer_put_;
+    tvm::runtime::PackedFunc streamer_finish_;
+};
+
+#endif /* MLCTokenizer_h */
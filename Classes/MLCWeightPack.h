@@ -0,0 +1,103 @@
+#ifndef MLCWeightPack_h
+#define MLCWeightPack_h
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// Packed weight files written by tools/mlc_repack. A model's shards are
+// rewritten into a few params_packed_N.bin files holding the tensors in the
+// order the forward pass first reads them, so loading is one sequential read.
+// Tensors of at least `alignment` bytes (2 MB by default) start on an
+// alignment boundary, so a mapping of the file can be backed by huge pages
+// without copying; smaller ones are packed at kWeightPackMinAlignment.
+//
+// The rewritten ndarray-cache.json lists the same tensors at their new
+// offsets, so MLC-LLM's own loader reads packed files unchanged. The index at
+// the start of each file lets a loader that maps the file find tensors
+// without parsing JSON. Layout, all little-endian as written by the host:
+//
+//   MLCWeightPackHeader | tensor_count MLCWeightPackEntry, in file order |
+//   names_bytes of tensor names (not terminated) | tensor data
+//
+// The index is covered by `data_offset`; tensor offsets are from the start of
+// the file.
+constexpr uint32_t kWeightPackVersion = 1;
+constexpr uint64_t kWeightPackMinAlignment = 64;
+
+struct MLCWeightPackHeader {
+    char magic[8];             // "MLCPACK1"
+    uint32_t version;
+    uint32_t file_index;
+    uint32_t file_count;
+    uint32_t tensor_count;
+    uint64_t alignment;
+    uint64_t source_hash;      // of the source ndarray-cache.json, as MLCWeightPrefetcher::modelHash
+    uint64_t data_offset;      // first byte past the index
+    uint32_t names_bytes;
+    uint32_t reserved;
+};
+static_assert(sizeof(MLCWeightPackHeader) == 56, "MLCWeightPackHeader is part of the file format");
+
+struct MLCWeightPackEntry {
+    uint64_t offset;
+    uint64_t nbytes;
+    uint32_t name_offset;      // into the name table
+    uint32_t name_length;
+};
+static_assert(sizeof(MLCWeightPackEntry) == 24, "MLCWeightPackEntry is part of the file format");
+
+constexpr char kWeightPackMagic[8] = {'M', 'L', 'C', 'P', 'A', 'C', 'K', '1'};
+
+// Reads the index of a packed file in place, typically straight from its
+// mapping; nothing is copied
+class MLCWeightPackIndex {
+public:
+    // False unless `data` starts with a complete index of a known version
+    bool parse(const void* data, size_t size) {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        if (size < sizeof(MLCWeightPackHeader)) return false;
+        std::memcpy(&header_, bytes, sizeof(header_));
+        if (std::memcmp(header_.magic, kWeightPackMagic, sizeof(kWeightPackMagic)) != 0 ||
+            header_.version != kWeightPackVersion) {
+            return false;
+        }
+        size_t entries_end = sizeof(MLCWeightPackHeader) + static_cast<size_t>(header_.tensor_count) * sizeof(MLCWeightPackEntry);
+        if (entries_end + header_.names_bytes > size || entries_end + header_.names_bytes > header_.data_offset) return false;
+        entries_ = bytes + sizeof(MLCWeightPackHeader);
+        names_ = reinterpret_cast<const char*>(bytes + entries_end);
+        return true;
+    }
+
+    const MLCWeightPackHeader& header() const { return header_; }
+    uint32_t size() const { return header_.tensor_count; }
+
+    MLCWeightPackEntry entry(uint32_t index) const {
+        MLCWeightPackEntry entry;
+        std::memcpy(&entry, entries_ + static_cast<size_t>(index) * sizeof(entry), sizeof(entry));
+        return entry;
+    }
+
+    // Empty if the entry's name lies outside the name table
+    std::string_view name(uint32_t index) const {
+        MLCWeightPackEntry value = entry(index);
+        if (static_cast<uint64_t>(value.name_offset) + value.name_length > header_.names_bytes) return {};
+        return std::string_view(names_ + value.name_offset, value.name_length);
+    }
+
+    // Index of the tensor called `name`, or -1
+    int64_t find(std::string_view name) const {
+        for (uint32_t i = 0; i < size(); ++i) {
+            if (this->name(i) == name) return i;
+        }
+        return -1;
+    }
+
+private:
+    MLCWeightPackHeader header_ = {};
+    const uint8_t* entries_ = nullptr;
+    const char* names_ = nullptr;
+};
+
+#endif /* MLCWeightPack_h */
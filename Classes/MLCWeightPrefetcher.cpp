@@ -0,0 +1,275 @@
+#include "MLCWeightPrefetcher.h"
+#include "MLCCpuTopology.h"
+#include "MLCJson.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char kFileMagic[8] = {'M', 'L', 'C', 'S', 'T', 'R', 'T', '1'};
+
+// Sampling period of the profiler and its upper bound on a profiling run
+const auto kSamplePeriod = std::chrono::milliseconds(2);
+const auto kMaxProfilingTime = std::chrono::minutes(10);
+
+// Read size of the prefetch thread
+const size_t kPrefetchChunkBytes = 1 << 20;
+
+uint64_t fnv1a(const std::string& data) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+template <typename T>
+void writeValue(std::ofstream& out, T value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template <typename T>
+bool readValue(std::ifstream& in, T* value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(value), sizeof(*value)));
+}
+
+// mincore() fills a char vector on Darwin and an unsigned char one elsewhere
+#if defined(__APPLE__)
+using ResidencyByte = char;
+#else
+using ResidencyByte = unsigned char;
+#endif
+
+// A mapped shard whose page-cache residency can be queried
+struct MappedShard {
+    int fd = -1;
+    void* base = nullptr;
+    size_t size = 0;
+    std::vector<ResidencyByte> residency;
+};
+
+} // namespace
+
+MLCWeightPrefetcher::MLCWeightPrefetcher(const std::string& model_path) : model_path_(model_path) {}
+
+MLCWeightPrefetcher::~MLCWeightPrefetcher() {
+    stop();
+}
+
+std::string MLCWeightPrefetcher::defaultProfilePath(const std::string& model_path) {
+    return model_path + "/mlc-startup-profile.bin";
+}
+
+bool MLCWeightPrefetcher::loadLayout(std::string* error) {
+    std::string cache_path = model_path_ + "/ndarray-cache.json";
+    std::ifstream in(cache_path, std::ios::binary);
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    MLCJsonValue cache;
+    if (!in || text.empty() || !MLCJson::parse(text, &cache, error)) {
+        if (error && error->empty()) *error = "cannot read " + cache_path;
+        return false;
+    }
+    model_hash_ = fnv1a(text);
+
+    const MLCJsonValue* shards = cache.get("records");
+    if (!shards || !shards->isArray()) {
+        if (error) *error = "ndarray-cache.json has no records";
+        return false;
+    }
+    for (const MLCJsonValue& shard : shards->array) {
+        const MLCJsonValue* data_path = shard.get("dataPath");
+        const MLCJsonValue* records = shard.get("records");
+        if (!data_path || !records) continue;
+        uint32_t shard_index = static_cast<uint32_t>(shard_paths_.size());
+        shard_paths_.push_back(model_path_ + "/" + data_path->asString());
+        for (const MLCJsonValue& record : records->array) {
+            MLCWeightRange range;
+            range.shard = shard_index;
+            if (const MLCJsonValue* name = record.get("name")) range.name = name->asString();
+            if (const MLCJsonValue* offset = record.get("byteOffset")) range.offset = static_cast<uint64_t>(offset->asNumber());
+            if (const MLCJsonValue* nbytes = record.get("nbytes")) range.nbytes = static_cast<uint64_t>(nbytes->asNumber());
+            if (range.nbytes > 0) ranges_.push_back(std::move(range));
+        }
+    }
+    return !ranges_.empty();
+}
+
+bool MLCWeightPrefetcher::loadProfile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+
+    char magic[sizeof(kFileMagic)];
+    uint32_t version = 0;
+    uint64_t model_hash = 0;
+    uint32_t range_count = 0;
+    uint32_t count = 0;
+    if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), kFileMagic) ||
+        !readValue(in, &version) || version != kProfileVersion) {
+        std::cerr << "❌ Ignoring startup profile with unknown format: " << path << std::endl;
+        return false;
+    }
+    if (!readValue(in, &model_hash) || !readValue(in, &range_count) || !readValue(in, &count) ||
+        model_hash != model_hash_ || range_count != ranges_.size() || count > range_count) {
+        std::cout << "🔄 Startup profile does not match this model, re-recording" << std::endl;
+        return false;
+    }
+
+    std::vector<MLCStartupProfileEntry> entries(count);
+    for (MLCStartupProfileEntry& entry : entries) {
+        if (!readValue(in, &entry.range) || !readValue(in, &entry.first_touch_us) || entry.range >= range_count) {
+            std::cerr << "❌ Truncated startup profile: " << path << std::endl;
+            return false;
+        }
+    }
+    profile_ = std::move(entries);
+    return true;
+}
+
+bool MLCWeightPrefetcher::saveProfile(const std::string& path) const {
+    std::string temp_path = path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cerr << "❌ Cannot write startup profile to " << temp_path << std::endl;
+            return false;
+        }
+        out.write(kFileMagic, sizeof(kFileMagic));
+        writeValue(out, kProfileVersion);
+        writeValue(out, model_hash_);
+        writeValue(out, static_cast<uint32_t>(ranges_.size()));
+        writeValue(out, static_cast<uint32_t>(profile_.size()));
+        for (const MLCStartupProfileEntry& entry : profile_) {
+            writeValue(out, entry.range);
+            writeValue(out, entry.first_touch_us);
+        }
+        if (!out.flush()) return false;
+    }
+    return std::rename(temp_path.c_str(), path.c_str()) == 0;
+}
+
+void MLCWeightPrefetcher::startProfiling() {
+    stop();
+    stopping_ = false;
+    profiling_ = true;
+    profile_.clear();
+    thread_ = MLCCpuTopology::startBridgeThread([this]() { sampleLoop(); });
+}
+
+void MLCWeightPrefetcher::finishProfiling() {
+    if (!profiling_) return;
+    stop();
+    profiling_ = false;
+}
+
+void MLCWeightPrefetcher::startPrefetch() {
+    stop();
+    stopping_ = false;
+    thread_ = MLCCpuTopology::startBridgeThread([this]() { prefetchLoop(); });
+}
+
+void MLCWeightPrefetcher::stop() {
+    stopping_ = true;
+    if (thread_.joinable()) thread_.join();
+}
+
+void MLCWeightPrefetcher::sampleLoop() {
+    const size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    std::vector<MappedShard> shards(shard_paths_.size());
+    for (size_t i = 0; i < shards.size(); ++i) {
+        MappedShard& shard = shards[i];
+        shard.fd = open(shard_paths_[i].c_str(), O_RDONLY);
+        struct stat info;
+        if (shard.fd < 0 || fstat(shard.fd, &info) != 0 || info.st_size == 0) continue;
+#if defined(POSIX_FADV_DONTNEED)
+        // Start cold where the platform allows it, otherwise touches are invisible
+        posix_fadvise(shard.fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+        shard.size = static_cast<size_t>(info.st_size);
+        shard.base = mmap(nullptr, shard.size, PROT_READ, MAP_SHARED, shard.fd, 0);
+        if (shard.base == MAP_FAILED) {
+            shard.base = nullptr;
+            continue;
+        }
+        shard.residency.resize((shard.size + page_size - 1) / page_size);
+    }
+
+    std::vector<bool> touched(ranges_.size(), false);
+    size_t remaining = ranges_.size();
+    const auto start = std::chrono::steady_clock::now();
+    auto elapsedUs = [&start]() {
+        return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    };
+
+    while (!stopping_ && remaining > 0 && std::chrono::steady_clock::now() - start < kMaxProfilingTime) {
+        for (MappedShard& shard : shards) {
+            if (shard.base) {
+                mincore(shard.base, shard.size, shard.residency.data());
+            }
+        }
+        uint32_t now_us = elapsedUs();
+        for (size_t i = 0; i < ranges_.size(); ++i) {
+            if (touched[i]) continue;
+            const MLCWeightRange& range = ranges_[i];
+            const MappedShard& shard = shards[range.shard];
+            size_t page = static_cast<size_t>(range.offset / page_size);
+            if (!shard.base || page >= shard.residency.size() || !(shard.residency[page] & 1)) continue;
+            touched[i] = true;
+            --remaining;
+            profile_.push_back(MLCStartupProfileEntry{static_cast<uint32_t>(i), now_us});
+        }
+        std::this_thread::sleep_for(kSamplePeriod);
+    }
+
+    // Anything never observed keeps file order at the end
+    uint32_t end_us = elapsedUs();
+    for (size_t i = 0; i < ranges_.size(); ++i) {
+        if (!touched[i]) profile_.push_back(MLCStartupProfileEntry{static_cast<uint32_t>(i), end_us});
+    }
+
+    for (MappedShard& shard : shards) {
+        if (shard.base) munmap(shard.base, shard.size);
+        if (shard.fd >= 0) close(shard.fd);
+    }
+}
+
+void MLCWeightPrefetcher::prefetchLoop() {
+    std::vector<int> fds(shard_paths_.size(), -1);
+    for (size_t i = 0; i < fds.size(); ++i) {
+        fds[i] = open(shard_paths_[i].c_str(), O_RDONLY);
+    }
+
+    // Plain reads rather than advisory hints: hints are asynchronous and would
+    // lose the order
+    std::vector<char> buffer(kPrefetchChunkBytes);
+    uint64_t prefetched = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (const MLCStartupProfileEntry& entry : profile_) {
+        if (stopping_) break;
+        const MLCWeightRange& range = ranges_[entry.range];
+        int fd = fds[range.shard];
+        if (fd < 0) continue;
+        for (uint64_t done = 0; done < range.nbytes && !stopping_;) {
+            size_t length = static_cast<size_t>(std::min<uint64_t>(buffer.size(), range.nbytes - done));
+            ssize_t read_bytes = pread(fd, buffer.data(), length, static_cast<off_t>(range.offset + done));
+            if (read_bytes <= 0) break;
+            done += static_cast<uint64_t>(read_bytes);
+            prefetched += static_cast<uint64_t>(read_bytes);
+        }
+    }
+
+    for (int fd : fds) {
+        if (fd >= 0) close(fd);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << "📦 Prefetched " << (prefetched >> 20) << " MB of weights in " << elapsed.count() << " ms" << std::endl;
+}
@@ -0,0 +1,83 @@
+#ifndef MLCWeightPrefetcher_h
+#define MLCWeightPrefetcher_h
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One parameter's bytes inside a weight shard, as listed in ndarray-cache.json
+struct MLCWeightRange {
+    std::string name;
+    uint32_t shard = 0;
+    uint64_t offset = 0;
+    uint64_t nbytes = 0;
+};
+
+struct MLCStartupProfileEntry {
+    uint32_t range = 0;          // index into the layout
+    uint32_t first_touch_us = 0; // since profiling started
+};
+
+// Learns and replays the order in which model weights are first read at
+// startup.
+//
+// Profiling run: the shards are mapped read-only and a sampler polls mincore()
+// to see when each parameter range first enters the page cache while the
+// engine loads. The resulting order is saved as a startup profile next to the
+// model:
+//
+//   "MLCSTRT1" | u32 version | u64 model hash | u32 range count |
+//   u32 entry count | entries { u32 range, u32 first_touch_us }
+//
+// The model hash covers ndarray-cache.json, so a profile recorded against
+// other weights is ignored and re-recorded. Later starts read the ranges in
+// profile order on a prefetch thread running alongside the engine's loader, so
+// the loader finds the ranges it needs first already cached, and flash I/O
+// overlaps its decode and upload work.
+class MLCWeightPrefetcher {
+public:
+    static constexpr uint32_t kProfileVersion = 1;
+
+    explicit MLCWeightPrefetcher(const std::string& model_path);
+    ~MLCWeightPrefetcher();
+
+    MLCWeightPrefetcher(const MLCWeightPrefetcher&) = delete;
+    MLCWeightPrefetcher& operator=(const MLCWeightPrefetcher&) = delete;
+
+    // Parses ndarray-cache.json and computes the model hash
+    bool loadLayout(std::string* error);
+    // True if `path` holds a profile matching this model
+    bool loadProfile(const std::string& path);
+    bool saveProfile(const std::string& path) const;
+
+    void startProfiling();
+    // Stops the sampler; ranges never seen are appended in file order
+    void finishProfiling();
+    void startPrefetch();
+    void stop();
+
+    bool isProfiling() const { return profiling_; }
+    uint64_t modelHash() const { return model_hash_; }
+    const std::vector<MLCWeightRange>& ranges() const { return ranges_; }
+    const std::vector<MLCStartupProfileEntry>& profile() const { return profile_; }
+
+    static std::string defaultProfilePath(const std::string& model_path);
+
+private:
+    void sampleLoop();
+    void prefetchLoop();
+
+    std::string model_path_;
+    std::vector<std::string> shard_paths_;
+    std::vector<MLCWeightRange> ranges_;
+    uint64_t model_hash_ = 0;
+
+    std::vector<MLCStartupProfileEntry> profile_;
+    std::atomic<bool> profiling_{false};
+    std::atomic<bool> stopping_{false};
+    std::thread thread_;
+};
+
+#endif /* MLCWeightPrefetcher_h */
@@ -503,6 +503,38 @@ class MLCLlamaEngine: NSObject {
         return tokens
     }
     
+    /// Generates the whole answer as one string. Deltas are appended as they
+    /// arrive, without the word splitting `generate` does for streaming UIs.
+    func generateText(prompt: String, maxTokens: Int = 2048, temperature: Float = 0.7) async throws -> String {
+        guard isInitialized else {
+            throw NSError(domain: "MLCLlamaEngine", code: -4,
+                         userInfo: [NSLocalizedDescriptionKey: "Engine not initialized"])
+        }
+        
+        guard let engine = mlcEngine else {
+            throw NSError(domain: "MLCLlamaEngine", code: -5,
+                         userInfo: [NSLocalizedDescriptionKey: "MLCEngine not available"])
+        }
+        
+        let messages = [ChatCompletionMessage(role: "user", content: prompt)]
+        let stream = await engine.chat.completions.create(
+            messages: messages,
+            max_tokens: maxTokens,
+            temperature: temperature
+        )
+        
+        var text = ""
+        text.reserveCapacity(maxTokens * 4)
+        for await response in stream {
+            for choice in response.choices {
+                text += choice.delta.content
+            }
+        }
+        
+        print("✅ Generated \(text.count) characters from TinyLlama-1.1B")
+        return text
+    }
+    
     private func splitIntoStreamingTokens(_ text: String) -> [String] {
         // Split text into word-level tokens for streaming
         let words = text.components(separatedBy: .whitespacesAndNewlines)
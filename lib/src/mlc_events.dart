@@ -0,0 +1,133 @@
+import 'dart:convert';
+import 'dart:typed_data';
+
+/// Binary bridge events (MLC_LLM_EVENT_*, layout in MLCBridge.h), as posted
+/// to a native port in `[3, Uint8List events]` messages when `dart_binary` is
+/// set, or written to an fd with MLC_LLM_FRAMING_BINARY. Fields are read in
+/// place from the batch; nothing is decoded until it is asked for.
+class MlcEventType {
+  static const int chunk = 1;
+  static const int tokens = 2;
+  static const int logprobs = 3;
+  static const int usage = 4;
+  static const int finish = 5;
+  static const int error = 6;
+  static const int toolCall = 7;
+}
+
+class MlcFinishCode {
+  static const int stop = 0;
+  static const int length = 1;
+  static const int repetition = 2;
+  static const int cache = 3;
+  static const int other = 255;
+}
+
+/// Port message kind of an event batch (MLCDartPortSink::kMessageEvents)
+const int mlcMessageEvents = 3;
+
+const int _headerSize = 16;
+
+class MlcEvent {
+  MlcEvent._(this._data, this._offset);
+
+  final ByteData _data;
+  final int _offset;
+
+  int get size => _u32(0);
+  int get type => _data.getUint16(_offset + 4, Endian.little);
+  int get version => _data.getUint16(_offset + 6, Endian.little);
+  int get count => _u32(8);
+  int get aux => _u32(12);
+
+  /// UTF-8 bytes of a chunk, finish reason or error message, as a view
+  Uint8List get textBytes {
+    if (type != MlcEventType.chunk && type != MlcEventType.finish && type != MlcEventType.error) {
+      return Uint8List(0);
+    }
+    return _bytes(0, count);
+  }
+
+  String get text => utf8.decode(textBytes, allowMalformed: true);
+
+  // Tokens
+  int get tokenCount => type == MlcEventType.tokens ? count : 0;
+  int tokenId(int index) => _data.getInt32(_offset + _headerSize + 4 * index, Endian.little);
+
+  // Logprobs; rank 0 is the sampled token, 1..topK its alternatives
+  int get logprobTokenCount => type == MlcEventType.logprobs ? count : 0;
+  int get topK => type == MlcEventType.logprobs ? aux : 0;
+  double logprob(int token, int rank) =>
+      _data.getFloat32(_offset + _logprobEntry(token, rank), Endian.little);
+  String logprobToken(int token, int rank) {
+    final entry = _logprobEntry(token, rank);
+    return utf8.decode(_bytes(_u32(entry + 4), _u32(entry + 8)), allowMalformed: true);
+  }
+
+  // Usage
+  int get promptTokens => type == MlcEventType.usage ? _u32(_headerSize) : 0;
+  int get completionTokens => type == MlcEventType.usage ? _u32(_headerSize + 4) : 0;
+
+  // Finish
+  int get finishCode => aux;
+
+  // Tool call
+  String get toolName => type == MlcEventType.toolCall ? utf8.decode(_bytes(0, count), allowMalformed: true) : '';
+  String get toolArguments =>
+      type == MlcEventType.toolCall ? utf8.decode(_bytes(count, aux), allowMalformed: true) : '';
+
+  int _u32(int offset) => _data.getUint32(_offset + offset, Endian.little);
+
+  Uint8List _bytes(int payloadOffset, int length) =>
+      _data.buffer.asUint8List(_data.offsetInBytes + _offset + _headerSize + payloadOffset, length);
+
+  int _logprobEntry(int token, int rank) => _headerSize + 12 * (token * (1 + aux) + rank);
+}
+
+/// Walks the events of one batch. Iteration stops at the first event that
+/// does not fit, which [truncated] then reports.
+class MlcEventReader extends Iterable<MlcEvent> {
+  MlcEventReader(Uint8List batch) : _data = ByteData.sublistView(batch);
+
+  final ByteData _data;
+  bool _truncated = false;
+
+  bool get truncated {
+    for (final _ in this) {}
+    return _truncated;
+  }
+
+  @override
+  Iterator<MlcEvent> get iterator => _MlcEventIterator(this);
+}
+
+class _MlcEventIterator implements Iterator<MlcEvent> {
+  _MlcEventIterator(this._reader);
+
+  final MlcEventReader _reader;
+  int _offset = 0;
+  MlcEvent? _current;
+
+  @override
+  MlcEvent get current => _current!;
+
+  @override
+  bool moveNext() {
+    final data = _reader._data;
+    final remaining = data.lengthInBytes - _offset;
+    if (remaining < _headerSize) {
+      _reader._truncated = remaining != 0;
+      _current = null;
+      return false;
+    }
+    final size = data.getUint32(_offset, Endian.little);
+    if (size < _headerSize || size % 8 != 0 || size > remaining) {
+      _reader._truncated = true;
+      _current = null;
+      return false;
+    }
+    _current = MlcEvent._(data, _offset);
+    _offset += size;
+    return true;
+  }
+}
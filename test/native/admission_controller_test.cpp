@@ -0,0 +1,131 @@
+// MLCAdmissionController with its seeded throughput figures (200 prompt
+// tokens/s, 20 decode tokens/s, 256-token completions): wait estimates for
+// slot and KV contention, refusals on queue depth and wait, retry hints, and
+// the KV reservation that finished requests teach it.
+
+#include "MLCAdmissionController.h"
+#include "test_support.h"
+
+namespace {
+
+MLCAdmissionControlConfig shedding(int max_queued, int max_wait_ms) {
+    MLCAdmissionControlConfig config;
+    config.enabled = true;
+    config.max_queued = max_queued;
+    config.max_wait_ms = max_wait_ms;
+    return config;
+}
+
+void testIdleEngineAdmitsImmediately() {
+    MLCAdmissionController controller(2, 0);
+    controller.configure(shedding(0, 0));
+    MLCAdmissionDecision decision = controller.admit("a", 200, 100);
+    CHECK(decision.admitted);
+    CHECK_EQ(decision.estimated_wait_ms, static_cast<int64_t>(0));
+    CHECK_EQ(decision.queue_depth, 0);
+    // A second slot is still free
+    CHECK(controller.admit("b", 200, 100).admitted);
+}
+
+void testWaitEstimateAndRefusal() {
+    MLCAdmissionController controller(1, 0);
+    CHECK(controller.admit("a", 200, 100).admitted);
+
+    // "a" needs 200/200 s of prefill and 100/20 s of decode
+    MLCAdmissionDecision tracked = controller.admit("probe", 200, 100);
+    CHECK(tracked.admitted);  // shedding is off, but the estimate is kept
+    CHECK_EQ(tracked.estimated_wait_ms, static_cast<int64_t>(6000));
+    controller.onFinish("probe", false);
+
+    controller.configure(shedding(4, 3000));
+    MLCAdmissionDecision refused = controller.admit("b", 200, 100);
+    CHECK(!refused.admitted);
+    CHECK_EQ(refused.estimated_wait_ms, static_cast<int64_t>(6000));
+    // Retry once the slot is expected to be free
+    CHECK_EQ(refused.retry_after_ms, static_cast<int64_t>(6000));
+    CHECK_EQ(controller.load().queue_depth, 0);
+
+    // Once "a" is gone the engine is idle again
+    controller.onFinish("a", false);
+    CHECK(controller.admit("b", 200, 100).admitted);
+}
+
+void testPredictedLengthShortensWait() {
+    MLCAdmissionController controller(1, 0);
+    CHECK(controller.admit("a", 200, 100, 20).admitted);
+    MLCAdmissionDecision decision = controller.admit("b", 200, 100);
+    CHECK_EQ(decision.estimated_wait_ms, static_cast<int64_t>(2000));
+
+    // Progress counts: 10 of 20 expected tokens leave 0.5 s
+    controller.onFinish("b", false);
+    controller.onTokens("a", 10);
+    CHECK_EQ(controller.estimatedWaitMs(), static_cast<int64_t>(500));
+}
+
+void testQueueDepthLimit() {
+    MLCAdmissionController controller(1, 0);
+    controller.configure(shedding(1, 1000000));
+    CHECK(controller.admit("a", 200, 100).admitted);
+    MLCAdmissionDecision second = controller.admit("b", 200, 100);
+    CHECK(second.admitted);
+    CHECK_EQ(second.queue_depth, 0);
+
+    MLCAdmissionDecision third = controller.admit("c", 200, 100);
+    CHECK(!third.admitted);
+    CHECK_EQ(third.queue_depth, 1);
+    CHECK(third.retry_after_ms > 0);
+    CHECK_EQ(controller.load().queue_depth, 1);
+}
+
+void testKVCapacity() {
+    MLCAdmissionController controller(4, 1000);
+    // Explicit reservations: 600 + 100 and 300 + 100 do not fit together
+    CHECK(controller.admit("a", 600, 100, 0, 100).admitted);
+    MLCAdmissionDecision decision = controller.admit("b", 300, 100, 0, 100);
+    CHECK(decision.admitted);
+    CHECK_EQ(decision.estimated_wait_ms, static_cast<int64_t>(8000));
+
+    MLCAdmissionController::Load load = controller.load();
+    CHECK_EQ(load.kv_capacity_tokens, 1000);
+    CHECK_EQ(load.kv_reserved_tokens, 1100);
+
+    // Without KV tracking only the slots count
+    controller.setKVCapacity(0);
+    controller.onFinish("b", false);
+    CHECK_EQ(controller.admit("b", 300, 100, 0, 100).estimated_wait_ms, static_cast<int64_t>(0));
+}
+
+void testFinishedRequestsSetTheReservation() {
+    MLCAdmissionController controller(4, 100000);
+    // Unknown length: the seeded 256-token average, capped by max_tokens
+    CHECK(controller.admit("a", 100, 1000).admitted);
+    CHECK_EQ(controller.load().kv_reserved_tokens, 100 + 256);
+    controller.onTokens("a", 40);
+    controller.onFinish("a", true);
+    CHECK_EQ(controller.load().kv_reserved_tokens, 0);
+
+    // The first finished request replaces the seed
+    CHECK(controller.admit("b", 100, 1000).admitted);
+    CHECK_EQ(controller.load().kv_reserved_tokens, 100 + 40);
+    CHECK(controller.admit("c", 100, 10).admitted);
+    CHECK_EQ(controller.load().kv_reserved_tokens, 100 + 40 + 100 + 10);
+
+    // Cancelled requests teach nothing
+    controller.onTokens("b", 500);
+    controller.onFinish("b", false);
+    controller.onFinish("c", false);
+    CHECK(controller.admit("d", 100, 1000).admitted);
+    CHECK_EQ(controller.load().kv_reserved_tokens, 100 + 40);
+}
+
+} // namespace
+
+int main() {
+    testIdleEngineAdmitsImmediately();
+    testWaitEstimateAndRefusal();
+    testPredictedLengthShortensWait();
+    testQueueDepthLimit();
+    testKVCapacity();
+    testFinishedRequestsSetTheReservation();
+    return testResult("admission_controller_test");
+}
@@ -0,0 +1,124 @@
+// MLCAdmissionQueue: a burst inside the window is dispatched as one batch,
+// the token budget closes the window early and splits oversized bursts,
+// batches run shortest expected completion first, and stop() flushes.
+
+#include "MLCAdmissionQueue.h"
+#include "test_support.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using std::chrono::milliseconds;
+
+// What the admission thread did, in order
+struct Log {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<std::string> dispatched;
+    std::vector<std::pair<size_t, int>> batches;
+
+    MLCAdmissionQueue::BatchObserver observer() {
+        return [this](size_t requests, int tokens) {
+            std::lock_guard<std::mutex> lock(mutex);
+            batches.emplace_back(requests, tokens);
+            cv.notify_all();
+        };
+    }
+
+    MLCAdmissionQueue::Dispatch dispatch(const std::string& name) {
+        return [this, name]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            dispatched.push_back(name);
+        };
+    }
+
+    bool waitForBatches(size_t count) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return cv.wait_for(lock, std::chrono::seconds(5), [&]() { return batches.size() >= count; });
+    }
+};
+
+void testBurstWithinWindow() {
+    Log log;
+    MLCAdmissionQueue queue(milliseconds(30), 1000, log.observer());
+    auto start = Clock::now();
+    queue.push(10, 0, log.dispatch("a"));
+    queue.push(20, 0, log.dispatch("b"));
+    queue.push(30, 0, log.dispatch("c"));
+    CHECK(log.waitForBatches(1));
+    // Nothing is dispatched before the window closes
+    CHECK(Clock::now() - start >= milliseconds(30));
+
+    std::lock_guard<std::mutex> lock(log.mutex);
+    if (CHECK_EQ(log.batches.size(), static_cast<size_t>(1))) {
+        CHECK_EQ(log.batches[0].first, static_cast<size_t>(3));
+        CHECK_EQ(log.batches[0].second, 60);
+    }
+    CHECK(log.dispatched == std::vector<std::string>({"a", "b", "c"}));
+}
+
+void testBudgetClosesWindowAndSplits() {
+    Log log;
+    // A window long enough that only the budget can close it
+    MLCAdmissionQueue queue(std::chrono::seconds(30), 100, log.observer());
+    auto start = Clock::now();
+    queue.push(40, 0, log.dispatch("a"));
+    queue.push(40, 0, log.dispatch("b"));
+    queue.push(40, 0, log.dispatch("c"));
+    // 120 pending tokens close the window; the leftover goes right after
+    CHECK(log.waitForBatches(2));
+    CHECK(Clock::now() - start < std::chrono::seconds(5));
+
+    std::lock_guard<std::mutex> lock(log.mutex);
+    if (CHECK_EQ(log.batches.size(), static_cast<size_t>(2))) {
+        CHECK(log.batches[0] == std::make_pair(static_cast<size_t>(2), 80));
+        CHECK(log.batches[1] == std::make_pair(static_cast<size_t>(1), 40));
+    }
+    CHECK(log.dispatched == std::vector<std::string>({"a", "b", "c"}));
+}
+
+void testOversizedRequestGoesAlone() {
+    Log log;
+    MLCAdmissionQueue queue(std::chrono::seconds(30), 100, log.observer());
+    queue.push(500, 0, log.dispatch("huge"));
+    CHECK(log.waitForBatches(1));
+    std::lock_guard<std::mutex> lock(log.mutex);
+    if (CHECK_EQ(log.batches.size(), static_cast<size_t>(1))) {
+        CHECK(log.batches[0] == std::make_pair(static_cast<size_t>(1), 500));
+    }
+}
+
+void testShortestExpectedFirstAndStopFlushes() {
+    Log log;
+    MLCAdmissionQueue queue(std::chrono::seconds(30), 1000, log.observer());
+    queue.push(10, 0, log.dispatch("unknown"));
+    queue.push(10, 300, log.dispatch("long"));
+    queue.push(10, 20, log.dispatch("short"));
+    queue.push(10, 0, log.dispatch("unknown2"));
+    queue.push(10, 100, log.dispatch("medium"));
+    // stop() dispatches the open window instead of waiting it out
+    auto start = Clock::now();
+    queue.stop();
+    CHECK(Clock::now() - start < std::chrono::seconds(5));
+
+    std::lock_guard<std::mutex> lock(log.mutex);
+    CHECK_EQ(log.batches.size(), static_cast<size_t>(1));
+    // Unknown lengths keep their arrival order behind the predicted ones
+    CHECK(log.dispatched == std::vector<std::string>({"short", "medium", "long", "unknown", "unknown2"}));
+}
+
+} // namespace
+
+int main() {
+    testBurstWithinWindow();
+    testBudgetClosesWindowAndSplits();
+    testOversizedRequestGoesAlone();
+    testShortestExpectedFirstAndStopFlushes();
+    return testResult("admission_queue_test");
+}
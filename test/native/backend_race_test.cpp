@@ -0,0 +1,383 @@
+// MLCBackendRace with a scripted local backend and MLCOpenAIBackend talking to
+// a loopback stub of the chat completions endpoint: checks which arm answers,
+// when the fallback starts, and that the caller's sink ends exactly once.
+
+#include "MLCBackendRace.h"
+#include "MLCBridge.h"
+#include "MLCMetrics.h"
+#include "MLCOpenAIBackend.h"
+#include "test_support.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using std::chrono::milliseconds;
+
+// Serves POST /v1/chat/completions on 127.0.0.1 with a chunked SSE stream,
+// one connection at a time
+class StubServer {
+public:
+    int status = 200;
+    int delay_ms = 0;                 // before the response head
+    std::vector<std::string> deltas;  // content of each streamed event
+
+    StubServer() {
+        listener_ = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(address);
+        if (listener_ < 0 || bind(listener_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+            listen(listener_, 4) != 0 || getsockname(listener_, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+            return;
+        }
+        port_ = ntohs(address.sin_port);
+        thread_ = std::thread([this]() { serve(); });
+    }
+
+    ~StubServer() {
+        shutdown(listener_, SHUT_RDWR);
+        close(listener_);
+        if (thread_.joinable()) thread_.join();
+    }
+
+    bool ok() const { return port_ != 0; }
+    int requests() const { return requests_; }
+    std::string baseUrl() const { return "http://127.0.0.1:" + std::to_string(port_) + "/v1"; }
+
+private:
+    void serve() {
+        while (true) {
+            int client = accept(listener_, nullptr, nullptr);
+            if (client < 0) return;
+            requests_++;
+            respond(client);
+            close(client);
+        }
+    }
+
+    static void sendAll(int fd, const std::string& data) {
+        size_t offset = 0;
+        while (offset < data.size()) {
+            ssize_t n = send(fd, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+            if (n <= 0) return;
+            offset += static_cast<size_t>(n);
+        }
+    }
+
+    static std::string chunk(const std::string& data) {
+        char size[16];
+        snprintf(size, sizeof(size), "%zx\r\n", data.size());
+        return size + data + "\r\n";
+    }
+
+    void respond(int client) {
+        // Request head, then Content-Length bytes of body
+        std::string request;
+        char buffer[4096];
+        size_t body_at = std::string::npos;
+        size_t body_size = 0;
+        while (body_at == std::string::npos || request.size() < body_at + body_size) {
+            ssize_t n = recv(client, buffer, sizeof(buffer), 0);
+            if (n <= 0) return;
+            request.append(buffer, static_cast<size_t>(n));
+            if (body_at == std::string::npos && (body_at = request.find("\r\n\r\n")) != std::string::npos) {
+                body_at += 4;
+                size_t header = request.find("Content-Length: ");
+                if (header != std::string::npos) body_size = std::strtoul(request.c_str() + header + 16, nullptr, 10);
+            }
+        }
+        CHECK(request.compare(0, 31, "POST /v1/chat/completions HTTP/") == 0);
+        CHECK(request.find("\"stream\":true") != std::string::npos);
+
+        std::this_thread::sleep_for(milliseconds(delay_ms));
+        if (status != 200) {
+            std::string body = R"({"error":{"message":"stub failure"}})";
+            sendAll(client, "HTTP/1.1 " + std::to_string(status) + " Internal Server Error\r\n"
+                            "Content-Type: application/json\r\nContent-Length: " + std::to_string(body.size()) +
+                            "\r\nConnection: close\r\n\r\n" + body);
+            return;
+        }
+        sendAll(client, "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n"
+                        "Transfer-Encoding: chunked\r\nConnection: close\r\n\r\n");
+        for (const std::string& delta : deltas) {
+            sendAll(client, chunk("data: {\"choices\":[{\"delta\":{\"content\":\"" + delta + "\"}}]}\n\n"));
+        }
+        sendAll(client, chunk("data: {\"choices\":[{\"delta\":{},\"finish_reason\":\"stop\"}],"
+                              "\"usage\":{\"prompt_tokens\":4,\"completion_tokens\":2}}\n\n"));
+        sendAll(client, chunk("data: [DONE]\n\n") + "0\r\n\r\n");
+    }
+
+    int listener_ = -1;
+    int port_ = 0;
+    std::atomic<int> requests_{0};
+    std::thread thread_;
+};
+
+// Stand-in for the on-device engine: refuses, fails or answers after a delay
+class ScriptedBackend : public MLCBackend {
+public:
+    enum class Mode { Answer, Fail, Refuse };
+
+    Mode mode = Mode::Answer;
+    int delay_ms = 0;
+    std::string answer = "local";
+    std::atomic<bool> cancelled{false};
+    std::atomic<int> starts{0};
+
+    ~ScriptedBackend() override {
+        for (std::thread& thread : threads_) {
+            // The last reference may be dropped by one of our own threads
+            if (thread.get_id() == std::this_thread::get_id()) {
+                thread.detach();
+            } else {
+                thread.join();
+            }
+        }
+    }
+
+    const char* name() const override { return "scripted"; }
+
+    std::shared_ptr<MLCBackendStream> start(const MLCBackendRequest&, std::unique_ptr<MLCDeliverySink> sink,
+                                            int* status) override {
+        starts++;
+        if (mode == Mode::Refuse) {
+            *status = MLC_LLM_ERROR_OVERLOADED;
+            return nullptr;
+        }
+        auto stream = std::make_shared<Stream>(this);
+        std::shared_ptr<MLCDeliverySink> owned(std::move(sink));
+        threads_.emplace_back([this, stream, owned]() {
+            auto until = Clock::now() + milliseconds(delay_ms);
+            while (Clock::now() < until && !stream->cancelled) std::this_thread::sleep_for(milliseconds(2));
+            if (stream->cancelled) return;
+            if (mode == Mode::Fail) {
+                owned->onError("local failure");
+                return;
+            }
+            owned->onChunk(answer);
+            owned->flush();
+            MLCFinishInfo info;
+            info.finish_reason = "stop";
+            owned->onFinish(info);
+        });
+        *status = MLC_LLM_OK;
+        return stream;
+    }
+
+private:
+    struct Stream : public MLCBackendStream {
+        explicit Stream(ScriptedBackend* backend) : backend(backend) {}
+        void cancel() override {
+            cancelled = true;
+            backend->cancelled = true;
+        }
+        ScriptedBackend* backend;
+        std::atomic<bool> cancelled{false};
+    };
+
+    std::vector<std::thread> threads_;
+};
+
+// Records what reaches the caller; counters are shared so they survive the
+// race dropping the sink
+struct Outcome {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::string text;
+    std::string error;
+    int finishes = 0;
+    int errors = 0;
+    Clock::time_point first_chunk_at;
+
+    bool waitEnded(milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return cv.wait_for(lock, timeout, [this]() { return finishes + errors > 0; });
+    }
+};
+
+class RecordingSink : public MLCDeliverySink {
+public:
+    explicit RecordingSink(std::shared_ptr<Outcome> outcome) : outcome_(std::move(outcome)) {}
+
+    void onChunk(const std::string& text) override {
+        std::lock_guard<std::mutex> lock(outcome_->mutex);
+        if (outcome_->text.empty()) outcome_->first_chunk_at = Clock::now();
+        outcome_->text += text;
+    }
+
+    void onFinish(const MLCFinishInfo&) override {
+        std::lock_guard<std::mutex> lock(outcome_->mutex);
+        outcome_->finishes++;
+        outcome_->cv.notify_all();
+    }
+
+    void onError(const std::string& message) override {
+        std::lock_guard<std::mutex> lock(outcome_->mutex);
+        outcome_->errors++;
+        outcome_->error = message;
+        outcome_->cv.notify_all();
+    }
+
+private:
+    std::shared_ptr<Outcome> outcome_;
+};
+
+struct Fixture {
+    MLCMetrics metrics;
+    StubServer server;
+    std::shared_ptr<ScriptedBackend> local = std::make_shared<ScriptedBackend>();
+    std::shared_ptr<MLCOpenAIBackend> remote;
+    std::shared_ptr<Outcome> outcome = std::make_shared<Outcome>();
+    Clock::time_point started_at;
+
+    Fixture() {
+        server.deltas = {"re", "mote"};
+        MLCOpenAIConfig config;
+        config.base_url = server.baseUrl();
+        config.model = "stub";
+        config.connect_timeout_ms = 1000;
+        config.read_timeout_ms = 2000;
+        remote = std::make_shared<MLCOpenAIBackend>(config);
+    }
+
+    int run(MLCBackendRace& race, milliseconds deadline) {
+        MLCBackendRequest request;
+        request.prompt = "hello";
+        request.max_tokens = 8;
+        started_at = Clock::now();
+        return race.start(request, local, remote, deadline, std::make_unique<RecordingSink>(outcome));
+    }
+
+    // Waits for the end, then a little longer so a second terminal call shows
+    void settle() {
+        CHECK(outcome->waitEnded(milliseconds(5000)));
+        std::this_thread::sleep_for(milliseconds(300));
+    }
+
+    milliseconds firstChunkAfter() {
+        return std::chrono::duration_cast<milliseconds>(outcome->first_chunk_at - started_at);
+    }
+};
+
+void testLocalWins() {
+    Fixture fixture;
+    fixture.local->delay_ms = 20;
+    MLCBackendRace race(&fixture.metrics);
+    CHECK_EQ(fixture.run(race, milliseconds(500)), static_cast<int>(MLC_LLM_OK));
+    fixture.settle();
+    CHECK_EQ(fixture.outcome->text, std::string("local"));
+    CHECK_EQ(fixture.outcome->finishes, 1);
+    CHECK_EQ(fixture.outcome->errors, 0);
+    // Answered before the deadline: the remote is never asked
+    std::this_thread::sleep_for(milliseconds(400));
+    CHECK_EQ(fixture.server.requests(), 0);
+    CHECK_EQ(fixture.metrics.race_fallback_starts.load(), 0u);
+}
+
+void testRemoteWinsAfterDeadline() {
+    Fixture fixture;
+    fixture.local->delay_ms = 3000;
+    MLCBackendRace race(&fixture.metrics);
+    CHECK_EQ(fixture.run(race, milliseconds(150)), static_cast<int>(MLC_LLM_OK));
+    fixture.settle();
+    CHECK_EQ(fixture.outcome->text, std::string("remote"));
+    CHECK_EQ(fixture.outcome->finishes, 1);
+    CHECK_EQ(fixture.outcome->errors, 0);
+    CHECK(fixture.firstChunkAfter() >= milliseconds(150));
+    CHECK_EQ(fixture.server.requests(), 1);
+    // The losing local arm is cancelled rather than left generating
+    CHECK(fixture.local->cancelled);
+    CHECK_EQ(fixture.metrics.race_fallback_starts.load(), 1u);
+    CHECK_EQ(fixture.metrics.race_fallback_wins.load(), 1u);
+}
+
+void testLocalRefusalStartsFallbackAtOnce() {
+    Fixture fixture;
+    fixture.local->mode = ScriptedBackend::Mode::Refuse;
+    MLCBackendRace race(&fixture.metrics);
+    CHECK_EQ(fixture.run(race, milliseconds(5000)), static_cast<int>(MLC_LLM_OK));
+    fixture.settle();
+    CHECK_EQ(fixture.outcome->text, std::string("remote"));
+    CHECK_EQ(fixture.outcome->finishes, 1);
+    CHECK_EQ(fixture.outcome->errors, 0);
+    // No waiting for the deadline
+    CHECK(fixture.firstChunkAfter() < milliseconds(1000));
+    CHECK_EQ(fixture.local->starts.load(), 1);
+    CHECK_EQ(fixture.server.requests(), 1);
+}
+
+void testBothFailBeforeDeadline() {
+    Fixture fixture;
+    fixture.local->mode = ScriptedBackend::Mode::Fail;
+    fixture.local->delay_ms = 10;
+    fixture.server.status = 500;
+    MLCBackendRace race(&fixture.metrics);
+    CHECK_EQ(fixture.run(race, milliseconds(5000)), static_cast<int>(MLC_LLM_OK));
+    fixture.settle();
+    CHECK_EQ(fixture.outcome->errors, 1);
+    CHECK_EQ(fixture.outcome->finishes, 0);
+    CHECK(fixture.outcome->text.empty());
+    CHECK_EQ(fixture.server.requests(), 1);
+}
+
+void testBothFailAfterDeadline() {
+    // The remote fails first while the local arm is still running; the error
+    // waits for the local arm and is reported once
+    Fixture fixture;
+    fixture.local->mode = ScriptedBackend::Mode::Fail;
+    fixture.local->delay_ms = 600;
+    fixture.server.status = 500;
+    MLCBackendRace race(&fixture.metrics);
+    CHECK_EQ(fixture.run(race, milliseconds(100)), static_cast<int>(MLC_LLM_OK));
+    fixture.settle();
+    CHECK_EQ(fixture.outcome->errors, 1);
+    CHECK_EQ(fixture.outcome->finishes, 0);
+    CHECK_EQ(fixture.outcome->error, std::string("local failure"));
+    CHECK_EQ(fixture.server.requests(), 1);
+}
+
+void testBothRefuse() {
+    // Nothing reaches the sink when neither arm can start; start() reports it
+    Fixture fixture;
+    fixture.local->mode = ScriptedBackend::Mode::Refuse;
+    MLCOpenAIConfig config;
+    config.base_url = "ftp://127.0.0.1/v1";
+    fixture.remote = std::make_shared<MLCOpenAIBackend>(config);
+    MLCBackendRace race(&fixture.metrics);
+    CHECK(fixture.run(race, milliseconds(100)) != MLC_LLM_OK);
+    std::this_thread::sleep_for(milliseconds(200));
+    CHECK_EQ(fixture.outcome->errors, 0);
+    CHECK_EQ(fixture.outcome->finishes, 0);
+}
+
+} // namespace
+
+int main() {
+    {
+        StubServer probe;
+        if (!probe.ok()) {
+            printf("backend_race_test: no loopback TCP, skipping\n");
+            return 0;
+        }
+    }
+    testLocalWins();
+    testRemoteWinsAfterDeadline();
+    testLocalRefusalStartsFallbackAtOnce();
+    testBothFailBeforeDeadline();
+    testBothFailAfterDeadline();
+    testBothRefuse();
+    return testResult("backend_race_test");
+}
@@ -0,0 +1,172 @@
+// MLCChatTemplate with a byte-level encoder that keeps special strings
+// atomic: the assembled ids must equal encoding the whole rendered prompt,
+// static fragments must come from the cache on repeat requests, and the
+// template options (system override, role templates, roles after the system
+// message, prefix ids) must render like MLC-LLM's conversation template.
+
+#include "MLCChatTemplate.h"
+#include "test_support.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+const char* const kChatml = R"({
+  "conv_template": {
+    "name": "chatml",
+    "system_template": "<|im_start|>system\n{system_message}<|im_end|>\n",
+    "system_message": "You are helpful.",
+    "roles": {"user": "<|im_start|>user", "assistant": "<|im_start|>assistant"},
+    "role_content_sep": "\n",
+    "role_empty_sep": "\n",
+    "seps": ["<|im_end|>\n"],
+    "stop_str": ["<|im_end|>"],
+    "stop_token_ids": [2]
+  }
+})";
+
+const char* const kLlama2 = R"({
+  "conv_template": {
+    "name": "llama-2",
+    "system_template": "[INST] <<SYS>>\n{system_message}\n<</SYS>>\n\n",
+    "system_message": "",
+    "roles": {"user": "[INST]", "assistant": "[/INST]"},
+    "role_templates": {"user": "{user_message} ", "assistant": "{assistant_message}"},
+    "add_role_after_system_message": false,
+    "role_content_sep": " ",
+    "role_empty_sep": " ",
+    "seps": [" ", " </s><s>"],
+    "system_prefix_token_ids": [1]
+  }
+})";
+
+const std::vector<std::string> kSpecials = {"<|im_start|>", "<|im_end|>", "</s>", "<s>"};
+
+// One id per byte; special strings are single ids from 1000 up
+struct FakeTokenizer {
+    int calls = 0;
+
+    std::vector<int32_t> encode(const std::string& text) {
+        ++calls;
+        std::vector<int32_t> ids;
+        for (size_t pos = 0; pos < text.size();) {
+            bool special = false;
+            for (size_t i = 0; i < kSpecials.size(); ++i) {
+                if (text.compare(pos, kSpecials[i].size(), kSpecials[i]) == 0) {
+                    ids.push_back(1000 + static_cast<int32_t>(i));
+                    pos += kSpecials[i].size();
+                    special = true;
+                    break;
+                }
+            }
+            if (!special) ids.push_back(static_cast<unsigned char>(text[pos++]));
+        }
+        return ids;
+    }
+};
+
+bool loadTemplate(MLCChatTemplate* chat_template, const char* config_json) {
+    MLCJsonValue config;
+    std::string error;
+    if (!MLCJson::parse(config_json, &config, &error)) {
+        fprintf(stderr, "bad test config: %s\n", error.c_str());
+        return false;
+    }
+    return chat_template->load(config, &error);
+}
+
+std::vector<MLCChatMessage> conversation() {
+    return {{"user", "Hi"}, {"assistant", "Hello"}, {"user", "Bye"}};
+}
+
+void testChatmlRendering() {
+    FakeTokenizer tokenizer;
+    MLCChatTemplate chat_template([&tokenizer](const std::string& text) { return tokenizer.encode(text); });
+    if (!CHECK_EQ(loadTemplate(&chat_template, kChatml), true)) return;
+    CHECK_EQ(chat_template.name(), std::string("chatml"));
+    CHECK(chat_template.stopStrings() == std::vector<std::string>({"<|im_end|>"}));
+    CHECK(chat_template.stopTokenIds() == std::vector<int32_t>({2}));
+
+    const std::string rendered = "<|im_start|>system\nYou are helpful.<|im_end|>\n"
+                                 "<|im_start|>user\nHi<|im_end|>\n"
+                                 "<|im_start|>assistant\nHello<|im_end|>\n"
+                                 "<|im_start|>user\nBye<|im_end|>\n"
+                                 "<|im_start|>assistant\n";
+    MLCChatTemplate::Stats first;
+    std::vector<int32_t> ids = chat_template.encodePrompt(nullptr, conversation(), &first);
+    CHECK(ids == tokenizer.encode(rendered));
+    CHECK_EQ(first.cached_tokens + first.encoded_tokens, static_cast<uint64_t>(ids.size()));
+
+    // Only the message contents are tokenized again
+    MLCChatTemplate::Stats second;
+    int calls_before = tokenizer.calls;
+    CHECK(chat_template.encodePrompt(nullptr, conversation(), &second) == ids);
+    CHECK_EQ(second.encoded_tokens, static_cast<uint64_t>(std::string("HiHelloBye").size()));
+    CHECK_EQ(second.cached_tokens + second.encoded_tokens, static_cast<uint64_t>(ids.size()));
+    CHECK_EQ(tokenizer.calls - calls_before, 3);  // one anchored encode per content
+    CHECK(chat_template.cachedFragmentCount() > 0);
+
+    // The system block is a prefix of every prompt sharing the system message
+    std::vector<int32_t> prefix = chat_template.encodeSystemPrefix(nullptr);
+    CHECK(prefix == tokenizer.encode("<|im_start|>system\nYou are helpful.<|im_end|>\n"));
+    CHECK(std::equal(prefix.begin(), prefix.end(), ids.begin()));
+}
+
+void testSystemOverride() {
+    FakeTokenizer tokenizer;
+    MLCChatTemplate chat_template([&tokenizer](const std::string& text) { return tokenizer.encode(text); });
+    if (!CHECK_EQ(loadTemplate(&chat_template, kChatml), true)) return;
+
+    std::string system = "Answer in French.";
+    MLCChatTemplate::Stats stats;
+    std::vector<int32_t> ids = chat_template.encodePrompt(&system, {{"user", "Hi"}}, &stats);
+    CHECK(ids == tokenizer.encode("<|im_start|>system\nAnswer in French.<|im_end|>\n"
+                                  "<|im_start|>user\nHi<|im_end|>\n<|im_start|>assistant\n"));
+    // A caller's system prompt is dynamic text, not a cached fragment
+    CHECK(stats.encoded_tokens >= system.size() + 2);
+
+    CHECK(chat_template.encodeSystemPrefix(&system) ==
+          tokenizer.encode("<|im_start|>system\nAnswer in French.<|im_end|>\n"));
+}
+
+void testRoleTemplatesWithoutRoleAfterSystem() {
+    FakeTokenizer tokenizer;
+    MLCChatTemplate chat_template([&tokenizer](const std::string& text) { return tokenizer.encode(text); });
+    if (!CHECK_EQ(loadTemplate(&chat_template, kLlama2), true)) return;
+
+    std::string system = "Be brief.";
+    std::vector<int32_t> ids = chat_template.encodePrompt(&system, conversation());
+    std::vector<int32_t> expected = {1};
+    std::vector<int32_t> body = tokenizer.encode("[INST] <<SYS>>\nBe brief.\n<</SYS>>\n\n"
+                                                 "Hi  [/INST] Hello </s><s>[INST] Bye  [/INST] ");
+    expected.insert(expected.end(), body.begin(), body.end());
+    CHECK(ids == expected);
+}
+
+void testErrors() {
+    FakeTokenizer tokenizer;
+    MLCChatTemplate chat_template([&tokenizer](const std::string& text) { return tokenizer.encode(text); });
+    CHECK(!loadTemplate(&chat_template, R"({"model_type": "llama"})"));
+    CHECK(!loadTemplate(&chat_template, R"({"conv_template": {"roles": {"user": "U"}}})"));
+
+    if (!CHECK_EQ(loadTemplate(&chat_template, kChatml), true)) return;
+    bool threw = false;
+    try {
+        chat_template.encodePrompt(nullptr, {{"tool", "{}"}});
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    CHECK(threw);
+}
+
+} // namespace
+
+int main() {
+    testChatmlRendering();
+    testSystemOverride();
+    testRoleTemplatesWithoutRoleAfterSystem();
+    testErrors();
+    return testResult("chat_template_test");
+}
@@ -0,0 +1,211 @@
+// MLCCpuTopology against fake sysfs trees: a big.LITTLE phone ranked by
+// cpu_capacity, an SMT desktop ranked by frequency, the compute_threads /
+// compute_cpus overrides, CPU list syntax, and bridge threads starting on the
+// CPUs every registered engine leaves free.
+
+#include "MLCCpuTopology.h"
+#include "test_support.h"
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdlib.h>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+namespace fs = std::filesystem;
+
+struct FakeCore {
+    int cpu;
+    std::string siblings;  // empty: no topology directory
+    int capacity;          // 0: no cpu_capacity file
+    int64_t max_freq_khz;  // 0: no cpufreq directory
+};
+
+void writeFile(const fs::path& path, const std::string& text) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << text << "\n";
+}
+
+// A sysfs cpu directory in a fresh temporary directory
+struct FakeSysfs {
+    fs::path root;
+
+    FakeSysfs(const std::string& online, const std::vector<FakeCore>& cores) {
+        char pattern[] = "/tmp/cpu_topology_test.XXXXXX";
+        root = mkdtemp(pattern);
+        writeFile(root / "online", online);
+        for (const FakeCore& core : cores) {
+            fs::path dir = root / ("cpu" + std::to_string(core.cpu));
+            fs::create_directories(dir);
+            if (!core.siblings.empty()) writeFile(dir / "topology" / "thread_siblings_list", core.siblings);
+            if (core.capacity > 0) writeFile(dir / "cpu_capacity", std::to_string(core.capacity));
+            if (core.max_freq_khz > 0) writeFile(dir / "cpufreq" / "cpuinfo_max_freq", std::to_string(core.max_freq_khz));
+        }
+    }
+    ~FakeSysfs() { fs::remove_all(root); }
+
+    MLCCpuTopology detect() const { return MLCCpuTopology::detect(root.string()); }
+};
+
+// 4 little, 3 mid and 1 prime core
+FakeSysfs phone() {
+    std::vector<FakeCore> cores;
+    for (int cpu = 0; cpu < 4; ++cpu) cores.push_back({cpu, std::to_string(cpu), 400, 1800000});
+    for (int cpu = 4; cpu < 7; ++cpu) cores.push_back({cpu, std::to_string(cpu), 860, 2400000});
+    cores.push_back({7, "7", 1024, 3000000});
+    return FakeSysfs("0-7", cores);
+}
+
+std::string cpuList(const std::vector<int>& cpus) {
+    return MLCCpuTopology::formatCpuList(cpus);
+}
+
+void testCpuLists() {
+    std::vector<int> cpus;
+    CHECK(MLCCpuTopology::parseCpuList("0-3, 6,2\n", &cpus));
+    CHECK(cpus == std::vector<int>({0, 1, 2, 3, 6}));
+    CHECK_EQ(cpuList({6, 0, 1, 2, 3, 9, 10}), std::string("0-3,6,9-10"));
+    CHECK_EQ(cpuList({}), std::string());
+
+    CHECK(!MLCCpuTopology::parseCpuList("", &cpus));
+    CHECK(!MLCCpuTopology::parseCpuList("3-1", &cpus));
+    CHECK(!MLCCpuTopology::parseCpuList("a", &cpus));
+    CHECK(!MLCCpuTopology::parseCpuList("-1", &cpus));
+    CHECK(!MLCCpuTopology::parseCpuList("0-5000", &cpus));
+}
+
+void testPhoneUsesFastCores() {
+    FakeSysfs sysfs = phone();
+    MLCCpuTopology topology = sysfs.detect();
+    CHECK_EQ(topology.cores.size(), static_cast<size_t>(8));
+
+    // Mid cores are within 80% of the prime core; little cores are not
+    MLCThreadLayout layout = topology.plan(0, "");
+    CHECK_EQ(layout.fast_cores, 4);
+    CHECK_EQ(layout.compute_threads, 4);
+    CHECK_EQ(cpuList(layout.compute_cpus), std::string("4-7"));
+    CHECK_EQ(cpuList(layout.bridge_cpus), std::string("0-3"));
+    CHECK(!layout.overridden);
+    // The prime core takes the first compute thread
+    CHECK_EQ(layout.compute_cpus.front(), 7);
+}
+
+void testSmtDesktopByFrequency() {
+    // 4 physical cores with SMT siblings 4-7, no cpu_capacity, one core type
+    std::vector<FakeCore> cores;
+    for (int cpu = 0; cpu < 8; ++cpu) {
+        int core = cpu % 4;
+        cores.push_back({cpu, std::to_string(core) + "," + std::to_string(core + 4), 0, 4200000});
+    }
+    FakeSysfs sysfs("0-7", cores);
+    MLCThreadLayout layout = sysfs.detect().plan(0, "");
+    CHECK_EQ(layout.fast_cores, 4);
+    // One core goes to the bridge threads, its SMT sibling with it
+    CHECK_EQ(cpuList(layout.compute_cpus), std::string("0-2"));
+    CHECK_EQ(cpuList(layout.bridge_cpus), std::string("3,7"));
+}
+
+void testFrequencyRanksWithoutCapacity() {
+    std::vector<FakeCore> cores = {{0, "", 0, 1000000}, {1, "", 0, 1000000}, {2, "", 0, 2500000}, {3, "", 0, 2400000}};
+    FakeSysfs sysfs("0-3", cores);
+    MLCThreadLayout layout = sysfs.detect().plan(0, "");
+    CHECK_EQ(layout.fast_cores, 2);
+    CHECK(layout.compute_cpus == std::vector<int>({2, 3}));
+    CHECK_EQ(cpuList(layout.bridge_cpus), std::string("0-1"));
+}
+
+void testOverrides() {
+    FakeSysfs sysfs = phone();
+    MLCCpuTopology topology = sysfs.detect();
+
+    MLCThreadLayout two = topology.plan(2, "");
+    CHECK(two.overridden);
+    CHECK(two.compute_cpus == std::vector<int>({7, 4}));
+    CHECK_EQ(cpuList(two.bridge_cpus), std::string("0-3,5-6"));
+
+    MLCThreadLayout listed = topology.plan(0, "0-1");
+    CHECK_EQ(listed.compute_threads, 2);
+    CHECK_EQ(cpuList(listed.bridge_cpus), std::string("2-7"));
+    // threads trims the list
+    CHECK_EQ(topology.plan(1, "0-1").compute_threads, 1);
+
+    // More threads than cores: taken as asked, unpinned, bridge unpinned too
+    MLCThreadLayout many = topology.plan(16, "");
+    CHECK_EQ(many.compute_threads, 16);
+    CHECK(many.compute_cpus.empty());
+    CHECK(many.bridge_cpus.empty());
+    CHECK_EQ(many.describe(), std::string("16 compute threads (unpinned) (configured)"));
+}
+
+void testNoSysfs() {
+    MLCCpuTopology topology = MLCCpuTopology::detect("/nonexistent/cpu");
+    CHECK(topology.cores.empty());
+    MLCThreadLayout layout = topology.plan(0, "");
+    CHECK_EQ(layout.compute_threads, 0);
+    CHECK(layout.bridge_cpus.empty());
+    CHECK_EQ(layout.describe(), std::string("runtime default"));
+}
+
+void testBridgeCpuRegistry() {
+    CHECK(MLCCpuTopology::bridgeCpus().empty());
+    MLCCpuTopology::addBridgeCpus({0, 1, 2, 3});
+    MLCCpuTopology::addBridgeCpus({2, 3, 4});
+    MLCCpuTopology::addBridgeCpus({});
+    // Only CPUs no engine computes on
+    CHECK_EQ(cpuList(MLCCpuTopology::bridgeCpus()), std::string("2-3"));
+    MLCCpuTopology::removeBridgeCpus({2, 3, 4});
+    CHECK_EQ(cpuList(MLCCpuTopology::bridgeCpus()), std::string("0-3"));
+    MLCCpuTopology::removeBridgeCpus({0, 1, 2, 3});
+    CHECK(MLCCpuTopology::bridgeCpus().empty());
+}
+
+#if defined(__linux__)
+std::vector<int> currentAffinity() {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    std::vector<int> cpus;
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) != 0) return cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+void testBridgeThreadsArePinned() {
+    std::vector<int> allowed = currentAffinity();
+    if (allowed.empty()) return;
+    std::vector<int> bridge = {allowed.back()};
+
+    MLCCpuTopology::addBridgeCpus(bridge);
+    std::vector<int> seen;
+    MLCCpuTopology::startBridgeThread([&seen]() { seen = currentAffinity(); }).join();
+    CHECK(seen == bridge);
+    MLCCpuTopology::removeBridgeCpus(bridge);
+
+    // Nothing registered: the thread keeps the process affinity
+    MLCCpuTopology::startBridgeThread([&seen]() { seen = currentAffinity(); }).join();
+    CHECK(seen == allowed);
+}
+#endif
+
+} // namespace
+
+int main() {
+    testCpuLists();
+    testPhoneUsesFastCores();
+    testSmtDesktopByFrequency();
+    testFrequencyRanksWithoutCapacity();
+    testOverrides();
+    testNoSysfs();
+    testBridgeCpuRegistry();
+#if defined(__linux__)
+    testBridgeThreadsArePinned();
+#endif
+    return testResult("cpu_topology_test");
+}
@@ -0,0 +1,272 @@
+// MLCDartPortSink against a stub of the Dart DL API: checks the batching and
+// the shape of every message the sink posts, and that external typed data is
+// handed over exactly once (run under ASan for the ownership half).
+
+#include "MLCDartSink.h"
+#include "MLCEvents.h"
+#include "dart_api_dl.h"
+#include "test_support.h"
+#include <string>
+#include <vector>
+
+namespace {
+
+const int64_t kPort = 42;
+
+// Deep copy of one posted Dart_CObject tree
+struct Posted {
+    Dart_CObject_Type type = Dart_CObject_kNull;
+    int64_t integer = 0;
+    std::string bytes;              // string, typed data or external typed data contents
+    Dart_TypedData_Type typed = Dart_TypedData_kInvalid;
+    intptr_t length = 0;
+    bool external_owned = false;    // peer == data and a finalizer was set
+    std::vector<Posted> items;
+};
+
+struct PostLog {
+    bool accept = true;
+    std::vector<Dart_Port> ports;
+    std::vector<Posted> messages;
+} g_log;
+
+Posted copy(const Dart_CObject* object) {
+    Posted out;
+    out.type = object->type;
+    switch (object->type) {
+        case Dart_CObject_kInt32:
+            out.integer = object->value.as_int32;
+            break;
+        case Dart_CObject_kInt64:
+            out.integer = object->value.as_int64;
+            break;
+        case Dart_CObject_kString:
+            out.bytes = object->value.as_string;
+            break;
+        case Dart_CObject_kArray:
+            for (intptr_t i = 0; i < object->value.as_array.length; ++i) {
+                out.items.push_back(copy(object->value.as_array.values[i]));
+            }
+            break;
+        case Dart_CObject_kTypedData: {
+            const auto& data = object->value.as_typed_data;
+            size_t width = data.type == Dart_TypedData_kInt32 ? 4 : 1;
+            out.typed = data.type;
+            out.length = data.length;
+            out.bytes.assign(reinterpret_cast<const char*>(data.values), data.length * width);
+            break;
+        }
+        case Dart_CObject_kExternalTypedData: {
+            const auto& data = object->value.as_external_typed_data;
+            out.typed = data.type;
+            out.length = data.length;
+            out.bytes.assign(reinterpret_cast<const char*>(data.data), data.length);
+            out.external_owned = data.peer == data.data && data.callback != nullptr;
+            break;
+        }
+        default:
+            break;
+    }
+    return out;
+}
+
+// The VM adopts external typed data on a successful post and runs the
+// finalizer once the object dies; the stub does both right away
+void adopt(Dart_CObject* object) {
+    if (object->type == Dart_CObject_kArray) {
+        for (intptr_t i = 0; i < object->value.as_array.length; ++i) adopt(object->value.as_array.values[i]);
+    } else if (object->type == Dart_CObject_kExternalTypedData) {
+        const auto& data = object->value.as_external_typed_data;
+        data.callback(nullptr, data.peer);
+    }
+}
+
+bool postStub(Dart_Port port, Dart_CObject* message) {
+    if (!g_log.accept) return false;
+    g_log.ports.push_back(port);
+    g_log.messages.push_back(copy(message));
+    adopt(message);
+    return true;
+}
+
+std::vector<int32_t> int32s(const Posted& typed) {
+    std::vector<int32_t> values(typed.length);
+    std::memcpy(values.data(), typed.bytes.data(), typed.bytes.size());
+    return values;
+}
+
+void reset() {
+    g_log = PostLog();
+}
+
+void testBatchesChunksUntilFlush() {
+    reset();
+    MLCDartPortSink sink(kPort);
+    sink.onChunk("Hel");
+    sink.onChunk("");
+    sink.onChunk("lo, ");
+    sink.onChunk("wörld");
+    CHECK(g_log.messages.empty());
+    sink.flush();
+    CHECK_EQ(g_log.messages.size(), 1u);
+    CHECK_EQ(g_log.ports[0], kPort);
+
+    const Posted& message = g_log.messages[0];
+    CHECK_EQ(message.type, Dart_CObject_kArray);
+    CHECK_EQ(message.items.size(), 3u);
+    CHECK_EQ(message.items[0].integer, MLCDartPortSink::kMessageChunks);
+    CHECK_EQ(message.items[1].type, Dart_CObject_kExternalTypedData);
+    CHECK_EQ(message.items[1].typed, Dart_TypedData_kUint8);
+    CHECK(message.items[1].external_owned);
+    CHECK_EQ(message.items[1].bytes, std::string("Hello, wörld"));
+    CHECK_EQ(message.items[2].type, Dart_CObject_kTypedData);
+    CHECK_EQ(message.items[2].typed, Dart_TypedData_kInt32);
+    std::vector<int32_t> ends = int32s(message.items[2]);
+    CHECK_EQ(ends.size(), 3u);
+    CHECK_EQ(ends[0], 3);
+    CHECK_EQ(ends[1], 7);
+    CHECK_EQ(ends[2], static_cast<int32_t>(std::string("Hello, wörld").size()));
+
+    // Nothing pending: no empty batch
+    sink.flush();
+    CHECK_EQ(g_log.messages.size(), 1u);
+}
+
+void testFlushesEarlyAtBatchLimit() {
+    reset();
+    MLCDartPortSink sink(kPort, false, 8);
+    sink.onChunk("abcd");
+    CHECK(g_log.messages.empty());
+    sink.onChunk("efgh");
+    CHECK_EQ(g_log.messages.size(), 1u);
+    CHECK_EQ(g_log.messages[0].items[1].bytes, std::string("abcdefgh"));
+    sink.onChunk("ij");
+    sink.flush();
+    CHECK_EQ(g_log.messages.size(), 2u);
+    CHECK_EQ(g_log.messages[1].items[1].bytes, std::string("ij"));
+    CHECK_EQ(int32s(g_log.messages[1].items[2])[0], 2);
+}
+
+void testFinishAndError() {
+    reset();
+    MLCDartPortSink sink(kPort);
+    sink.onChunk("done");
+    MLCFinishInfo info;
+    info.finish_reason = "length";
+    info.prompt_tokens = 12;
+    info.completion_tokens = 34;
+    sink.onFinish(info);
+    CHECK_EQ(g_log.messages.size(), 2u);
+    CHECK_EQ(g_log.messages[0].items[0].integer, MLCDartPortSink::kMessageChunks);
+    const Posted& finish = g_log.messages[1];
+    CHECK_EQ(finish.items.size(), 4u);
+    CHECK_EQ(finish.items[0].integer, MLCDartPortSink::kMessageFinish);
+    CHECK_EQ(finish.items[1].bytes, std::string("length"));
+    CHECK_EQ(finish.items[2].integer, 12);
+    CHECK_EQ(finish.items[3].integer, 34);
+
+    reset();
+    MLCDartPortSink failing(kPort);
+    failing.onError("engine stopped");
+    CHECK_EQ(g_log.messages.size(), 1u);
+    CHECK_EQ(g_log.messages[0].items[0].integer, MLCDartPortSink::kMessageError);
+    CHECK_EQ(g_log.messages[0].items[1].bytes, std::string("engine stopped"));
+}
+
+void testBinaryEvents() {
+    reset();
+    MLCDartPortSink sink(kPort, true);
+    sink.onChunk("Hi");
+    sink.onTokens({17, 4});
+    sink.onLogprobs({R"({"token": "Hi", "logprob": -0.25, "top_logprobs": []})"});
+    MLCFinishInfo info;
+    info.finish_reason = "stop";
+    info.prompt_tokens = 5;
+    info.completion_tokens = 2;
+    sink.onFinish(info);
+    CHECK_EQ(g_log.messages.size(), 1u);
+
+    const Posted& message = g_log.messages[0];
+    CHECK_EQ(message.items.size(), 2u);
+    CHECK_EQ(message.items[0].integer, MLCDartPortSink::kMessageEvents);
+    CHECK_EQ(message.items[1].type, Dart_CObject_kExternalTypedData);
+    CHECK(message.items[1].external_owned);
+
+    const std::string& batch = message.items[1].bytes;
+    MLCEventReader reader(reinterpret_cast<const uint8_t*>(batch.data()), batch.size());
+    MLCEventView event;
+    std::vector<uint16_t> types;
+    while (reader.next(&event)) {
+        types.push_back(event.type());
+        if (event.type() == MLC_LLM_EVENT_CHUNK) CHECK_EQ(std::string(event.text()), std::string("Hi"));
+        if (event.type() == MLC_LLM_EVENT_TOKENS) {
+            CHECK_EQ(event.numTokens(), 2u);
+            CHECK_EQ(event.tokenId(1), 4);
+        }
+        if (event.type() == MLC_LLM_EVENT_LOGPROBS) CHECK_EQ(event.logprob(0, 0), -0.25f);
+        if (event.type() == MLC_LLM_EVENT_USAGE) CHECK_EQ(event.completionTokens(), 2u);
+        if (event.type() == MLC_LLM_EVENT_FINISH) CHECK_EQ(event.finishCode(), static_cast<uint32_t>(MLC_LLM_FINISH_STOP));
+    }
+    CHECK(!reader.truncated());
+    std::vector<uint16_t> expected = {MLC_LLM_EVENT_CHUNK, MLC_LLM_EVENT_TOKENS, MLC_LLM_EVENT_LOGPROBS,
+                                      MLC_LLM_EVENT_USAGE, MLC_LLM_EVENT_FINISH};
+    CHECK(types == expected);
+}
+
+void testRefusedPostKeepsOwnership() {
+    // The sink frees what the VM did not adopt; ASan reports a leak otherwise
+    reset();
+    g_log.accept = false;
+    MLCDartPortSink text(kPort);
+    text.onChunk("lost");
+    text.flush();
+    MLCDartPortSink binary(kPort, true);
+    binary.onChunk("lost");
+    binary.flush();
+    CHECK(g_log.messages.empty());
+}
+
+void testIllegalPortPostsNothing() {
+    reset();
+    MLCDartPortSink sink(ILLEGAL_PORT);
+    sink.onChunk("nowhere");
+    sink.flush();
+    sink.onError("nowhere");
+    CHECK(g_log.messages.empty());
+}
+
+} // namespace
+
+// Stub DL API: initialization just installs the recording post function
+extern "C" {
+Dart_PostCObject_Type Dart_PostCObject_DL = nullptr;
+
+intptr_t Dart_InitializeApiDL(void* data) {
+    if (!data) return -1;
+    Dart_PostCObject_DL = postStub;
+    return 0;
+}
+}
+
+int main() {
+    CHECK(!MLCDartPortSink::isApiInitialized());
+    CHECK(MLCDartPortSink::initializeApi(nullptr) != 0);
+    {
+        // Before initialization posts are dropped rather than crashing
+        MLCDartPortSink sink(kPort);
+        sink.onChunk("early");
+        sink.flush();
+        CHECK(g_log.messages.empty());
+    }
+    int api_data = 0;
+    CHECK_EQ(MLCDartPortSink::initializeApi(&api_data), 0);
+    CHECK(MLCDartPortSink::isApiInitialized());
+
+    testBatchesChunksUntilFlush();
+    testFlushesEarlyAtBatchLimit();
+    testFinishAndError();
+    testBinaryEvents();
+    testRefusedPostKeepsOwnership();
+    testIllegalPortPostsNothing();
+    return testResult("dart_sink_test");
+}
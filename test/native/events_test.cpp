@@ -0,0 +1,176 @@
+// MLCEventWriter against MLCEventReader/MLCEventView: every MLC_LLM_EVENT_*
+// type is written and read back, the byte layout the Swift and Dart readers
+// rely on is pinned for one event, and damaged batches stop at the bad event.
+
+#include "MLCEvents.h"
+#include "test_support.h"
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<MLCEventView> readAll(const uint8_t* data, size_t size, bool* truncated) {
+    std::vector<MLCEventView> events;
+    MLCEventReader reader(data, size);
+    MLCEventView event;
+    while (reader.next(&event)) events.push_back(event);
+    *truncated = reader.truncated();
+    return events;
+}
+
+void testRoundTrip() {
+    MLCEventWriter writer;
+    writer.chunk("Hello, \"world\"\n");
+    writer.tokens({15043, -1, 0, 2147483647});
+    writer.logprobs({
+        R"({"token": "Hi", "logprob": -0.25, "top_logprobs": [{"token": "Hey", "logprob": -1.5}, {"token": "Yo", "logprob": -3}]})",
+        R"({"token": "!", "logprob": 0})",
+    });
+    writer.toolCall("get_weather", R"({"city":"Oslo"})");
+    MLCFinishInfo info;
+    info.finish_reason = "length";
+    info.prompt_tokens = 12;
+    info.completion_tokens = 34;
+    writer.finish(info);
+    writer.error("engine \xE2\x9A\xA0 failed");
+
+    bool truncated = true;
+    std::vector<MLCEventView> events = readAll(writer.data(), writer.size(), &truncated);
+    CHECK(!truncated);
+    if (!CHECK_EQ(events.size(), static_cast<size_t>(7))) return;
+
+    for (const MLCEventView& event : events) {
+        CHECK_EQ(event.size() % 8, 0u);
+        CHECK_EQ(event.version(), static_cast<uint16_t>(MLC_LLM_EVENT_VERSION));
+    }
+
+    CHECK_EQ(events[0].type(), static_cast<uint16_t>(MLC_LLM_EVENT_CHUNK));
+    CHECK_EQ(std::string(events[0].text()), std::string("Hello, \"world\"\n"));
+
+    CHECK_EQ(events[1].type(), static_cast<uint16_t>(MLC_LLM_EVENT_TOKENS));
+    CHECK_EQ(events[1].numTokens(), 4u);
+    CHECK_EQ(events[1].tokenId(0), 15043);
+    CHECK_EQ(events[1].tokenId(1), -1);
+    CHECK_EQ(events[1].tokenId(2), 0);
+    CHECK_EQ(events[1].tokenId(3), 2147483647);
+    CHECK(events[1].text().empty());
+
+    // The second token has no alternatives: its rank 1 and 2 slots are blank
+    const MLCEventView& logprobs = events[2];
+    CHECK_EQ(logprobs.type(), static_cast<uint16_t>(MLC_LLM_EVENT_LOGPROBS));
+    CHECK_EQ(logprobs.numLogprobTokens(), 2u);
+    CHECK_EQ(logprobs.topK(), 2u);
+    CHECK_EQ(std::string(logprobs.logprobToken(0, 0)), std::string("Hi"));
+    CHECK_EQ(logprobs.logprob(0, 0), -0.25f);
+    CHECK_EQ(std::string(logprobs.logprobToken(0, 1)), std::string("Hey"));
+    CHECK_EQ(logprobs.logprob(0, 1), -1.5f);
+    CHECK_EQ(std::string(logprobs.logprobToken(0, 2)), std::string("Yo"));
+    CHECK_EQ(logprobs.logprob(0, 2), -3.0f);
+    CHECK_EQ(std::string(logprobs.logprobToken(1, 0)), std::string("!"));
+    CHECK_EQ(logprobs.logprob(1, 0), 0.0f);
+    CHECK(logprobs.logprobToken(1, 1).empty());
+    CHECK(std::isinf(logprobs.logprob(1, 2)) && logprobs.logprob(1, 2) < 0);
+
+    CHECK_EQ(events[3].type(), static_cast<uint16_t>(MLC_LLM_EVENT_TOOL_CALL));
+    CHECK_EQ(std::string(events[3].toolName()), std::string("get_weather"));
+    CHECK_EQ(std::string(events[3].toolArguments()), std::string(R"({"city":"Oslo"})"));
+
+    CHECK_EQ(events[4].type(), static_cast<uint16_t>(MLC_LLM_EVENT_USAGE));
+    CHECK_EQ(events[4].promptTokens(), 12u);
+    CHECK_EQ(events[4].completionTokens(), 34u);
+
+    CHECK_EQ(events[5].type(), static_cast<uint16_t>(MLC_LLM_EVENT_FINISH));
+    CHECK_EQ(events[5].finishCode(), static_cast<uint32_t>(MLC_LLM_FINISH_LENGTH));
+    CHECK_EQ(std::string(events[5].text()), std::string("length"));
+
+    CHECK_EQ(events[6].type(), static_cast<uint16_t>(MLC_LLM_EVENT_ERROR));
+    CHECK_EQ(std::string(events[6].text()), std::string("engine \xE2\x9A\xA0 failed"));
+}
+
+void testChunkLayout() {
+    // The wire format for the other readers: 16-byte little-endian header,
+    // payload, zero padding to 8 bytes
+    MLCEventWriter writer;
+    writer.chunk("abc");
+    const uint8_t expected[] = {24, 0, 0, 0, MLC_LLM_EVENT_CHUNK, 0, MLC_LLM_EVENT_VERSION, 0,
+                                3,  0, 0, 0, 0,                   0, 0,                     0,
+                                'a', 'b', 'c', 0, 0, 0, 0, 0};
+    if (!CHECK_EQ(writer.size(), sizeof(expected))) return;
+    CHECK(std::memcmp(writer.data(), expected, sizeof(expected)) == 0);
+}
+
+void testFinishCodes() {
+    CHECK_EQ(MLCEventWriter::finishCode("stop"), static_cast<uint32_t>(MLC_LLM_FINISH_STOP));
+    CHECK_EQ(MLCEventWriter::finishCode("length"), static_cast<uint32_t>(MLC_LLM_FINISH_LENGTH));
+    CHECK_EQ(MLCEventWriter::finishCode("repetition"), static_cast<uint32_t>(MLC_LLM_FINISH_REPETITION));
+    CHECK_EQ(MLCEventWriter::finishCode("cache"), static_cast<uint32_t>(MLC_LLM_FINISH_CACHE));
+    CHECK_EQ(MLCEventWriter::finishCode("tool_calls"), static_cast<uint32_t>(MLC_LLM_FINISH_OTHER));
+}
+
+void testUnusableInputWritesNothing() {
+    MLCEventWriter writer;
+    writer.tokens({});
+    writer.logprobs({"not json", R"({"token": "x"})"});
+    CHECK(writer.empty());
+
+    bool truncated = true;
+    CHECK(readAll(writer.data(), 0, &truncated).empty());
+    CHECK(!truncated);
+}
+
+void testTruncatedBatch() {
+    MLCEventWriter writer;
+    writer.chunk("first");
+    writer.chunk("second event");
+    std::vector<uint8_t> batch(writer.data(), writer.data() + writer.size());
+
+    // Cut inside the second event: the first still reads
+    bool truncated = false;
+    std::vector<MLCEventView> events = readAll(batch.data(), batch.size() - 8, &truncated);
+    CHECK(truncated);
+    if (CHECK_EQ(events.size(), static_cast<size_t>(1))) CHECK_EQ(std::string(events[0].text()), std::string("first"));
+
+    // Cut inside a header
+    events = readAll(batch.data(), 8, &truncated);
+    CHECK(truncated);
+    CHECK(events.empty());
+
+    // A size that is not a multiple of 8 is rejected
+    batch[0] = 23;
+    events = readAll(batch.data(), batch.size(), &truncated);
+    CHECK(truncated);
+    CHECK(events.empty());
+}
+
+void testRelease() {
+    MLCEventWriter writer;
+    writer.error("gone");
+    size_t size = 0;
+    uint8_t* batch = writer.release(&size);
+    CHECK(writer.empty());
+    CHECK_EQ(size, static_cast<size_t>(24));
+
+    // The writer starts a fresh buffer afterwards
+    writer.chunk("next");
+    CHECK(writer.data() != batch);
+
+    bool truncated = true;
+    std::vector<MLCEventView> events = readAll(batch, size, &truncated);
+    CHECK(!truncated);
+    if (CHECK_EQ(events.size(), static_cast<size_t>(1))) CHECK_EQ(std::string(events[0].text()), std::string("gone"));
+    std::free(batch);
+}
+
+} // namespace
+
+int main() {
+    testRoundTrip();
+    testChunkLayout();
+    testFinishCodes();
+    testUnusableInputWritesNothing();
+    testTruncatedBatch();
+    testRelease();
+    return testResult("events_test");
+}
@@ -0,0 +1,162 @@
+// MLCFdSink against socketpairs and a loopback TCP connection: checks the
+// framings, that flush() never blocks on a reader that stopped reading, that
+// such a reader closes the sink once the write timeout passes, and that
+// zerocopy batches arrive intact after the sink is gone (run under ASan for
+// the buffer lifetime half).
+
+#include "MLCFdSink.h"
+#include "test_support.h"
+#include <arpa/inet.h>
+#include <chrono>
+#include <netinet/in.h>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Reads until `expected` bytes arrived or nothing came for two seconds
+std::string readAll(int fd, size_t expected) {
+    std::string out;
+    char buffer[65536];
+    while (out.size() < expected) {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, 2000) <= 0) break;
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n <= 0) break;
+        out.append(buffer, static_cast<size_t>(n));
+    }
+    return out;
+}
+
+void testSseFraming() {
+    int fds[2];
+    CHECK_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    std::string expected = "data: {\"delta\":\"Hi \\\"there\\\"\"}\n\n"
+                           "event: finish\ndata: {\"finish_reason\":\"stop\",\"prompt_tokens\":3,\"completion_tokens\":1}"
+                           "\n\ndata: [DONE]\n\n";
+    {
+        MLCFdSink sink(fds[0], MLCFdSink::Framing::Sse, false);
+        sink.onChunk("Hi \"there\"");
+        MLCFinishInfo info;
+        info.finish_reason = "stop";
+        info.prompt_tokens = 3;
+        info.completion_tokens = 1;
+        sink.onFinish(info);
+        CHECK(!sink.closed());
+    }
+    // The sink writes through its own dup; the caller's fd stays open
+    close(fds[0]);
+    CHECK_EQ(readAll(fds[1], expected.size()), expected);
+    close(fds[1]);
+}
+
+void testLengthPrefixedFraming() {
+    int fds[2];
+    CHECK_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    {
+        MLCFdSink sink(fds[0], MLCFdSink::Framing::LengthPrefixed, false);
+        sink.onChunk("abc");
+        sink.onError("boom");
+    }
+    close(fds[0]);
+    std::string expected = std::string("\0\3\0\0\0abc", 8) + std::string("\2\4\0\0\0boom", 9);
+    CHECK_EQ(readAll(fds[1], expected.size()), expected);
+    close(fds[1]);
+}
+
+void testStalledReaderTimesOut() {
+    int fds[2];
+    CHECK_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    int small = 4096;
+    setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &small, sizeof(small));
+    {
+        MLCFdSink sink(fds[0], MLCFdSink::Framing::Raw, false, 200);
+        std::string chunk(64 * 1024, 'x');
+        auto start = Clock::now();
+        for (int i = 0; i < 8; ++i) {
+            sink.onChunk(chunk);
+            sink.flush();
+        }
+        // Nobody reads fds[1], yet queueing never waits on the socket
+        CHECK(Clock::now() - start < std::chrono::milliseconds(100));
+        CHECK(!sink.closed());
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(400));
+        CHECK(sink.closed());
+        // Output after the failure is dropped
+        sink.onChunk("late");
+        sink.flush();
+        CHECK(sink.closed());
+    }
+    close(fds[0]);
+    close(fds[1]);
+}
+
+void testBacklogLimitClosesSink() {
+    int fds[2];
+    CHECK_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    {
+        MLCFdSink sink(fds[0], MLCFdSink::Framing::Raw, false, 60000);
+        std::string chunk(1 << 20, 'y');
+        for (size_t queued = 0; queued <= MLCFdSink::kMaxQueuedBytes + chunk.size(); queued += chunk.size()) {
+            sink.onChunk(chunk);
+            sink.flush();
+        }
+        CHECK(sink.closed());
+    }
+    close(fds[0]);
+    close(fds[1]);
+}
+
+void testZerocopyBatchesOutliveSink() {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listener, 1) != 0 || getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+        printf("fd_sink_test: no loopback TCP, skipping zerocopy\n");
+        if (listener >= 0) close(listener);
+        return;
+    }
+    int client = socket(AF_INET, SOCK_STREAM, 0);
+    CHECK_EQ(connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)), 0);
+    int server = accept(listener, nullptr, nullptr);
+    close(listener);
+
+    std::string expected;
+    {
+        MLCFdSink sink(server, MLCFdSink::Framing::Raw, true);
+        for (int i = 0; i < 16; ++i) {
+            std::string chunk(MLCFdSink::kZerocopyMinBytes * 2, static_cast<char>('a' + i));
+            expected += chunk;
+            sink.onChunk(chunk);
+            sink.flush();
+        }
+    }
+    close(server);
+    // Every byte arrives although the sink, and the caller's fd, are gone
+    std::string received = readAll(client, expected.size());
+    CHECK_EQ(received.size(), expected.size());
+    CHECK(received == expected);
+    close(client);
+}
+
+} // namespace
+
+int main() {
+    testSseFraming();
+    testLengthPrefixedFraming();
+    testStalledReaderTimesOut();
+    testBacklogLimitClosesSink();
+    testZerocopyBatchesOutliveSink();
+    // Let detached writers finish their drains before the leak check
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+    return testResult("fd_sink_test");
+}
@@ -0,0 +1,141 @@
+// MLCJsonStream fed whole and one byte at a time: checks path matching and
+// wildcards, the raw text of closed containers, string deltas and escape
+// decoding across feed boundaries, and the preamble/done/failed states.
+
+#include "MLCJsonStream.h"
+#include "test_support.h"
+#include <string>
+#include <vector>
+
+namespace {
+
+using Kind = MLCJsonStreamEvent::Kind;
+using Type = MLCJsonValue::Type;
+
+struct Run {
+    std::vector<MLCJsonStreamEvent> events;
+    bool done = false;
+    bool failed = false;
+
+    // Closed values only, as "subscription path=data"
+    std::vector<std::string> values() const {
+        std::vector<std::string> out;
+        for (const MLCJsonStreamEvent& event : events) {
+            if (event.kind != Kind::Value) continue;
+            out.push_back(std::to_string(event.subscription) + " " + event.path + "=" + event.data);
+        }
+        return out;
+    }
+};
+
+Run feed(const std::vector<std::string>& paths, const std::string& text, size_t step) {
+    Run run;
+    MLCJsonStream stream(paths, [&run](const MLCJsonStreamEvent& event) { run.events.push_back(event); });
+    for (size_t pos = 0; pos < text.size(); pos += step) {
+        stream.feed(text.substr(pos, step));
+    }
+    run.done = stream.done();
+    run.failed = stream.failed();
+    return run;
+}
+
+std::string joined(const std::vector<std::string>& lines) {
+    std::string out;
+    for (const std::string& line : lines) out += line + "\n";
+    return out;
+}
+
+void testPathsAndWildcards() {
+    const std::string text = R"({"title": "Plan", "items": [{"name": "a", "n": 1}, {"name": "b", "n": -2.5e1}],
+                                 "meta": {"tags": ["x", "y"], "ok": true, "none": null}})";
+    const std::vector<std::string> paths = {"title", "items[*].name", "$.meta.tags[1]", "items[1]", "meta.*",
+                                            "missing", "bad[path"};
+    const std::string expected = joined({
+        "0 title=Plan",
+        "1 items[0].name=a",
+        "1 items[1].name=b",
+        "3 items[1]={\"name\": \"b\", \"n\": -2.5e1}",
+        "2 meta.tags[1]=y",
+        "4 meta.tags=[\"x\", \"y\"]",
+        "4 meta.ok=true",
+        "4 meta.none=null",
+    });
+    // The same events whether the text arrives at once or byte by byte
+    for (size_t step : {text.size(), static_cast<size_t>(1), static_cast<size_t>(7)}) {
+        Run run = feed(paths, text, step);
+        CHECK(run.done);
+        CHECK(!run.failed);
+        CHECK_EQ(joined(run.values()), expected);
+    }
+
+    Run run = feed(paths, text, 1);
+    for (const MLCJsonStreamEvent& event : run.events) {
+        if (event.kind != Kind::Value) continue;
+        if (event.path == "items[1]") CHECK(event.type == Type::Object);
+        if (event.path == "meta.tags") CHECK(event.type == Type::Array);
+        if (event.path == "meta.ok") CHECK(event.type == Type::Bool);
+        if (event.path == "meta.none") CHECK(event.type == Type::Null);
+    }
+}
+
+void testRootSubscription() {
+    Run run = feed({"$"}, "[1, [], {}]", 1);
+    CHECK(run.done);
+    CHECK_EQ(joined(run.values()), joined({"0 $=[1, [], {}]"}));
+}
+
+void testStringDeltas() {
+    // The escape and the surrogate pair are split across feeds
+    std::vector<std::string> deltas;
+    std::string value;
+    MLCJsonStream stream({"answer"}, [&](const MLCJsonStreamEvent& event) {
+        if (event.kind == Kind::StringDelta) deltas.push_back(event.data);
+        if (event.kind == Kind::Value) value = event.data;
+    });
+    stream.feed(R"({"answer": "Hel)");
+    stream.feed(R"(lo\)");
+    stream.feed(R"(n \ud83d)");
+    stream.feed(R"(\ude00 é")");
+    stream.feed("}");
+    CHECK(stream.done());
+
+    std::vector<std::string> expected = {"Hel", "lo", "\n ", "\xF0\x9F\x98\x80 \xC3\xA9"};
+    CHECK_EQ(joined(deltas), joined(expected));
+    CHECK_EQ(value, std::string("Hello\n \xF0\x9F\x98\x80 \xC3\xA9"));
+}
+
+void testLoneSurrogateIsReplaced() {
+    Run run = feed({"s"}, R"({"s": "a\ud800b"})", 1);
+    CHECK_EQ(joined(run.values()), joined({"0 s=a\xEF\xBF\xBD" "b"}));
+}
+
+void testPreambleAndTrailingText() {
+    Run run = feed({"a"}, "Sure! ```json\n{\"a\": 1}\n``` and {\"a\": 2}", 3);
+    CHECK(run.done);
+    CHECK(!run.failed);
+    CHECK_EQ(joined(run.values()), joined({"0 a=1"}));
+}
+
+void testMalformedInputFails() {
+    CHECK(feed({"a"}, R"({"a" 1})", 1).failed);
+    CHECK(feed({"a"}, R"({"a": tru})", 1).failed);
+    CHECK(feed({"a"}, R"({"a": "\q"})", 1).failed);
+    CHECK(feed({"a"}, R"([1 2])", 1).failed);
+
+    // Still open: neither done nor failed
+    Run partial = feed({"a"}, R"({"a": [1, 2)", 1);
+    CHECK(!partial.done);
+    CHECK(!partial.failed);
+}
+
+} // namespace
+
+int main() {
+    testPathsAndWildcards();
+    testRootSubscription();
+    testStringDeltas();
+    testLoneSurrogateIsReplaced();
+    testPreambleAndTrailingText();
+    testMalformedInputFails();
+    return testResult("json_stream_test");
+}
@@ -0,0 +1,113 @@
+// MLCKVCacheLayout on TinyLlama's attention shape: per-token bytes for each
+// page format, the float16-budget conversion, reading the shape and the
+// compiled format from mlc-chat-config.json, and rejecting incomplete configs.
+
+#include "MLCKVCacheLayout.h"
+#include "MLCJson.h"
+#include "test_support.h"
+#include <string>
+
+namespace {
+
+// 22 layers, 32 query heads sharing 4 KV heads, head_dim 2048 / 32 = 64
+const char* const kTinyLlama = R"({
+  "model_type": "llama",
+  "model_config": {"hidden_size": 2048, "num_hidden_layers": 22, "num_attention_heads": 32,
+                   "num_key_value_heads": 4}
+})";
+
+MLCJsonValue parse(const char* json) {
+    MLCJsonValue value;
+    std::string error;
+    if (!MLCJson::parse(json, &value, &error)) fprintf(stderr, "bad test config: %s\n", error.c_str());
+    return value;
+}
+
+void testDtypeNames() {
+    MLCKVCacheDtype dtype = MLCKVCacheDtype::Int8;
+    CHECK(MLCKVCacheLayout::parseDtype("", &dtype));
+    CHECK(dtype == MLCKVCacheDtype::Float16);
+    for (MLCKVCacheDtype each : {MLCKVCacheDtype::Float16, MLCKVCacheDtype::Int8, MLCKVCacheDtype::Float8E4M3}) {
+        CHECK(MLCKVCacheLayout::parseDtype(MLCKVCacheLayout::dtypeName(each), &dtype));
+        CHECK(dtype == each);
+    }
+    CHECK(!MLCKVCacheLayout::parseDtype("int4", &dtype));
+    CHECK(!MLCKVCacheLayout::parseDtype("Float16", &dtype));
+}
+
+void testTinyLlamaBytes() {
+    MLCJsonValue config = parse(kTinyLlama);
+    MLCKVCacheLayout layout;
+    if (!CHECK_EQ(MLCKVCacheLayout::fromChatConfig(config, MLCKVCacheDtype::Float16, &layout), true)) return;
+    CHECK_EQ(layout.layers, 22);
+    CHECK_EQ(layout.kv_heads, 4);
+    CHECK_EQ(layout.head_dim, 64);
+    // K and V * 22 layers * 4 heads * 64 elements * 2 bytes
+    CHECK_EQ(layout.bytesPerToken(), static_cast<int64_t>(22528));
+    CHECK_EQ(layout.float16BytesPerToken(), static_cast<int64_t>(22528));
+    CHECK_EQ(layout.tokensForFloat16Budget(2048), 2048);
+
+    // One byte per element plus a float16 scale per head and token
+    for (MLCKVCacheDtype dtype : {MLCKVCacheDtype::Int8, MLCKVCacheDtype::Float8E4M3}) {
+        MLCKVCacheLayout quantized;
+        CHECK(MLCKVCacheLayout::fromChatConfig(config, dtype, &quantized));
+        CHECK_EQ(quantized.bytesPerToken(), static_cast<int64_t>(2 * 22 * 4 * (64 + 2)));
+        CHECK_EQ(quantized.float16BytesPerToken(), static_cast<int64_t>(22528));
+        // The same memory holds 22528 / 11616 times as many tokens
+        CHECK_EQ(quantized.tokensForFloat16Budget(2048), 3971);
+    }
+}
+
+void testShapeFallbacks() {
+    MLCKVCacheLayout layout;
+    // Explicit head_dim wins; no num_key_value_heads means plain multi-head attention
+    CHECK(MLCKVCacheLayout::fromChatConfig(
+        parse(R"({"model_config": {"num_hidden_layers": 2, "num_attention_heads": 8, "head_dim": 128,
+                                   "hidden_size": 512}})"),
+        MLCKVCacheDtype::Float16, &layout));
+    CHECK_EQ(layout.kv_heads, 8);
+    CHECK_EQ(layout.head_dim, 128);
+
+    MLCKVCacheLayout untouched;
+    untouched.layers = 99;
+    CHECK(!MLCKVCacheLayout::fromChatConfig(parse(R"({"num_hidden_layers": 2})"), MLCKVCacheDtype::Float16,
+                                            &untouched));
+    CHECK(!MLCKVCacheLayout::fromChatConfig(
+        parse(R"({"model_config": {"num_hidden_layers": 2, "num_attention_heads": 0, "hidden_size": 512}})"),
+        MLCKVCacheDtype::Float16, &untouched));
+    CHECK(!MLCKVCacheLayout::fromChatConfig(
+        parse(R"({"model_config": {"num_hidden_layers": 2, "num_attention_heads": 8}})"),
+        MLCKVCacheDtype::Float16, &untouched));
+    CHECK_EQ(untouched.layers, 99);
+
+    // An empty layout never divides by zero
+    CHECK_EQ(MLCKVCacheLayout().tokensForFloat16Budget(1000), 1000);
+}
+
+void testCompiledDtype() {
+    MLCKVCacheDtype dtype = MLCKVCacheDtype::Int8;
+    CHECK(MLCKVCacheLayout::compiledDtype(parse(kTinyLlama), &dtype));
+    CHECK(dtype == MLCKVCacheDtype::Float16);
+
+    CHECK(MLCKVCacheLayout::compiledDtype(parse(R"({"kv_cache_dtype": "int8"})"), &dtype));
+    CHECK(dtype == MLCKVCacheDtype::Int8);
+    CHECK(MLCKVCacheLayout::compiledDtype(parse(R"({"model_config": {"kv_cache_dtype": "float8_e4m3"}})"), &dtype));
+    CHECK(dtype == MLCKVCacheDtype::Float8E4M3);
+    // The top-level declaration wins over model_config
+    CHECK(MLCKVCacheLayout::compiledDtype(
+        parse(R"({"kv_cache_dtype": "float16", "model_config": {"kv_cache_dtype": "int8"}})"), &dtype));
+    CHECK(dtype == MLCKVCacheDtype::Float16);
+
+    CHECK(!MLCKVCacheLayout::compiledDtype(parse(R"({"kv_cache_dtype": "int4"})"), &dtype));
+    CHECK(!MLCKVCacheLayout::compiledDtype(parse(R"({"kv_cache_dtype": 8})"), &dtype));
+}
+
+} // namespace
+
+int main() {
+    testDtypeNames();
+    testTinyLlamaBytes();
+    testShapeFallbacks();
+    testCompiledDtype();
+    return testResult("kv_cache_layout_test");
+}
@@ -0,0 +1,103 @@
+// MLCLengthPredictor: no opinion during warm-up, separates request classes
+// with different completion lengths, caps at max_tokens, keeps the reservation
+// above the point estimate, scores outcomes and learns only the lower bound
+// from truncated requests.
+
+#include "MLCLengthPredictor.h"
+#include "test_support.h"
+#include <string>
+
+namespace {
+
+MLCLengthFeatures features(const std::string& request_class, const std::string& lead_word, int max_tokens = 2048) {
+    MLCLengthFeatures out;
+    out.request_class = request_class;
+    out.template_name = "chatml";
+    out.lead_word = lead_word;
+    out.prompt_tokens = 120;
+    out.max_tokens = max_tokens;
+    return out;
+}
+
+// Alternates the two classes so neither is learned in isolation
+void train(MLCLengthPredictor* predictor, int rounds) {
+    for (int i = 0; i < rounds; ++i) {
+        // Small jitter around 40 and 600 tokens
+        int jitter = (i % 5) - 2;
+        predictor->observe(features("summary", "summarize"), MLCLengthPrediction(), 40 + jitter * 2, false);
+        predictor->observe(features("story", "write"), MLCLengthPrediction(), 600 + jitter * 20, false);
+    }
+}
+
+void testWarmup() {
+    MLCLengthPredictor predictor;
+    CHECK_EQ(predictor.predict(features("summary", "summarize")).expected_tokens, 0);
+    // Empty completions carry no information and do not count
+    for (int i = 0; i < 20; ++i) predictor.observe(features("summary", "summarize"), MLCLengthPrediction(), 0, false);
+    CHECK_EQ(predictor.predict(features("summary", "summarize")).expected_tokens, 0);
+
+    for (int i = 0; i < 7; ++i) predictor.observe(features("summary", "summarize"), MLCLengthPrediction(), 40, false);
+    CHECK_EQ(predictor.predict(features("summary", "summarize")).reserve_tokens, 0);
+    predictor.observe(features("summary", "summarize"), MLCLengthPrediction(), 40, false);
+    CHECK(predictor.predict(features("summary", "summarize")).expected_tokens > 0);
+}
+
+void testSeparatesClasses() {
+    MLCLengthPredictor predictor;
+    train(&predictor, 150);
+
+    MLCLengthPrediction summary = predictor.predict(features("summary", "summarize"));
+    MLCLengthPrediction story = predictor.predict(features("story", "write"));
+    CHECK(summary.expected_tokens >= 27 && summary.expected_tokens <= 60);
+    CHECK(story.expected_tokens >= 400 && story.expected_tokens <= 900);
+    CHECK(summary.reserve_tokens >= summary.expected_tokens);
+    CHECK(story.reserve_tokens >= story.expected_tokens);
+    // The reservation stays a quantile, not a worst case
+    CHECK(story.reserve_tokens < 2048);
+
+    // max_tokens caps both numbers
+    MLCLengthPrediction capped = predictor.predict(features("story", "write", 100));
+    CHECK_EQ(capped.expected_tokens, 100);
+    CHECK_EQ(capped.reserve_tokens, 100);
+}
+
+void testOutcomeScoring() {
+    MLCLengthPredictor predictor;
+    CHECK(!predictor.observe(features("a", "x"), MLCLengthPrediction(), 50, false).scored);
+
+    MLCLengthPrediction predicted;
+    predicted.expected_tokens = 100;
+    predicted.reserve_tokens = 150;
+    MLCLengthPredictor::Outcome within = predictor.observe(features("a", "x"), predicted, 120, false);
+    CHECK(within.scored);
+    CHECK(!within.underpredicted);
+    CHECK_EQ(within.abs_error_tokens, 20);
+
+    MLCLengthPredictor::Outcome over = predictor.observe(features("a", "x"), predicted, 151, false);
+    CHECK(over.underpredicted);
+    CHECK_EQ(over.abs_error_tokens, 51);
+}
+
+void testTruncatedRequestsOnlyRaise() {
+    MLCLengthPredictor predictor;
+    train(&predictor, 150);
+    int before = predictor.predict(features("story", "write")).expected_tokens;
+
+    // Stopped at a low max_tokens: says nothing about the true length
+    for (int i = 0; i < 50; ++i) predictor.observe(features("story", "write"), MLCLengthPrediction(), 30, true);
+    CHECK_EQ(predictor.predict(features("story", "write")).expected_tokens, before);
+
+    // Truncated above the estimate: the true length is at least that
+    for (int i = 0; i < 50; ++i) predictor.observe(features("story", "write"), MLCLengthPrediction(), 1500, true);
+    CHECK(predictor.predict(features("story", "write")).expected_tokens > before);
+}
+
+} // namespace
+
+int main() {
+    testWarmup();
+    testSeparatesClasses();
+    testOutcomeScoring();
+    testTruncatedRequestsOnlyRaise();
+    return testResult("length_predictor_test");
+}
@@ -0,0 +1,275 @@
+// MLCCountMinSketch and MLCPrewarmer with a scripted runner: counts, aging,
+// top-K replacement, hottest-first warming once idle, the prefix token
+// budget, preemption by caller requests, giving up on failing items, and hot
+// items surviving a restart through persist_path.
+
+#include "MLCPrewarmer.h"
+#include "MLCMetrics.h"
+#include "test_support.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using std::chrono::milliseconds;
+
+MLCPrewarmItem prefix(const std::string& system) {
+    MLCPrewarmItem item;
+    item.has_system = true;
+    item.system = system;
+    return item;
+}
+
+MLCPrewarmItem completion(const std::string& prompt, int max_tokens) {
+    MLCPrewarmItem item;
+    item.kind = MLCPrewarmItem::Kind::Completion;
+    item.request_class = "faq";
+    item.prompt = prompt;
+    item.max_tokens = max_tokens;
+    return item;
+}
+
+MLCPrewarmConfig quickConfig() {
+    MLCPrewarmConfig config;
+    config.top_k = 2;
+    config.min_count = 3;
+    config.idle = milliseconds(20);
+    return config;
+}
+
+void observe(MLCPrewarmer* prewarmer, const MLCPrewarmItem& item, int times) {
+    for (int i = 0; i < times; ++i) prewarmer->observe(item);
+}
+
+// Records warm-ups and settles them the way `result` says
+struct Engine {
+    std::mutex mutex;
+    std::vector<std::string> started;    // system or prompt of each warm-up
+    std::vector<int> max_tokens;
+    std::vector<std::string> cancelled;
+    MLCPrewarmer::Done pending;          // an unfinished warm-up
+    std::atomic<bool> busy{false};
+    // ok = true finishes at once with `tokens`; `hold` leaves it running
+    bool ok = true;
+    bool hold = false;
+    int tokens = 100;
+
+    MLCPrewarmer::Runner runner() {
+        return [this](const MLCPrewarmItem& item, int limit, MLCPrewarmer::Done done) -> std::string {
+            std::unique_lock<std::mutex> lock(mutex);
+            started.push_back(item.kind == MLCPrewarmItem::Kind::Prefix ? item.system : item.prompt);
+            max_tokens.push_back(limit);
+            if (hold) {
+                pending = std::move(done);
+                return "warm-" + std::to_string(started.size());
+            }
+            bool result = ok;
+            int filled = tokens;
+            lock.unlock();
+            done(result, filled);
+            return "";
+        };
+    }
+
+    MLCPrewarmer::Cancel cancel() {
+        return [this](const std::string& request_id) {
+            MLCPrewarmer::Done done;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                cancelled.push_back(request_id);
+                done = std::move(pending);
+                pending = nullptr;
+            }
+            if (done) done(false, 0);
+        };
+    }
+
+    MLCPrewarmer::BusyCheck busyCheck() {
+        return [this]() { return busy.load(); };
+    }
+
+    size_t startedCount() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return started.size();
+    }
+
+    bool waitForStarts(size_t count) {
+        auto deadline = Clock::now() + std::chrono::seconds(5);
+        while (startedCount() < count) {
+            if (Clock::now() > deadline) return false;
+            std::this_thread::sleep_for(milliseconds(5));
+        }
+        return true;
+    }
+};
+
+void testSketch() {
+    MLCCountMinSketch sketch(1024, 4);
+    CHECK_EQ(sketch.estimate(42), 0u);
+    CHECK_EQ(sketch.add(42), 1u);
+    CHECK_EQ(sketch.add(42, 4), 5u);
+    CHECK_EQ(sketch.add(7), 1u);
+    CHECK_EQ(sketch.estimate(42), 5u);
+    sketch.halve();
+    CHECK_EQ(sketch.estimate(42), 2u);
+    CHECK_EQ(sketch.estimate(7), 0u);
+
+    // A one-counter row collides everything yet never underestimates
+    MLCCountMinSketch tiny(1, 1);
+    tiny.add(1, 3);
+    tiny.add(2, 2);
+    CHECK(tiny.estimate(1) >= 3u);
+    CHECK(tiny.estimate(2) >= 2u);
+}
+
+void testItemKeys() {
+    CHECK(prefix("a").key() == prefix("a").key());
+    CHECK(prefix("a").key() != prefix("b").key());
+    MLCPrewarmItem default_system;
+    MLCPrewarmItem empty_system = prefix("");
+    CHECK(default_system.key() != empty_system.key());
+    CHECK(completion("ab", 8).key() == completion("ab", 64).key());
+    MLCPrewarmItem split = completion("c", 8);
+    split.request_class = "fa";
+    MLCPrewarmItem joined = completion("qc", 8);
+    joined.request_class = "f";
+    CHECK(split.key() != joined.key());
+}
+
+void testHottestFirstOnceIdle() {
+    Engine engine;
+    MLCMetrics metrics;
+    MLCPrewarmConfig config = quickConfig();
+    config.completion_max_tokens = 64;
+    engine.busy = true;
+    MLCPrewarmer prewarmer(config, &metrics, engine.runner(), engine.cancel(), engine.busyCheck());
+
+    observe(&prewarmer, prefix("A"), 5);
+    observe(&prewarmer, prefix("B"), 3);
+    // Below min_count: never a candidate
+    observe(&prewarmer, prefix("rare"), 2);
+    // Hotter than B, which it replaces in the top 2
+    observe(&prewarmer, completion("C", 500), 4);
+
+    // Nothing runs while caller requests are in flight
+    std::this_thread::sleep_for(milliseconds(100));
+    CHECK_EQ(engine.startedCount(), static_cast<size_t>(0));
+
+    engine.busy = false;
+    CHECK(engine.waitForStarts(2));
+    std::this_thread::sleep_for(milliseconds(100));
+    std::lock_guard<std::mutex> lock(engine.mutex);
+    CHECK(engine.started == std::vector<std::string>({"A", "C"}));
+    // Prefixes prefill only; completions are capped by completion_max_tokens
+    CHECK(engine.max_tokens == std::vector<int>({1, 64}));
+    CHECK_EQ(metrics.prewarm_prefixes.load(), static_cast<uint64_t>(1));
+    CHECK_EQ(metrics.prewarm_prefix_tokens.load(), static_cast<uint64_t>(100));
+    CHECK_EQ(metrics.prewarm_completions.load(), static_cast<uint64_t>(1));
+}
+
+void testPrefixTokenBudget() {
+    Engine engine;
+    engine.tokens = 300;
+    MLCMetrics metrics;
+    MLCPrewarmConfig config = quickConfig();
+    config.max_prefix_tokens = 200;
+    engine.busy = true;
+    MLCPrewarmer prewarmer(config, &metrics, engine.runner(), engine.cancel(), engine.busyCheck());
+    observe(&prewarmer, prefix("A"), 5);
+    observe(&prewarmer, prefix("B"), 4);
+    engine.busy = false;
+
+    CHECK(engine.waitForStarts(1));
+    std::this_thread::sleep_for(milliseconds(150));
+    // A's 300 tokens use up the budget, so B waits
+    std::lock_guard<std::mutex> lock(engine.mutex);
+    CHECK(engine.started == std::vector<std::string>({"A"}));
+}
+
+void testPreemptCancelsAndRetries() {
+    Engine engine;
+    engine.hold = true;
+    MLCMetrics metrics;
+    MLCPrewarmer prewarmer(quickConfig(), &metrics, engine.runner(), engine.cancel(), engine.busyCheck());
+    observe(&prewarmer, prefix("A"), 3);
+
+    CHECK(engine.waitForStarts(1));
+    // Give run() time to record the returned request id
+    std::this_thread::sleep_for(milliseconds(20));
+    prewarmer.preempt();
+    {
+        std::lock_guard<std::mutex> lock(engine.mutex);
+        CHECK(engine.cancelled == std::vector<std::string>({"warm-1"}));
+    }
+    CHECK_EQ(metrics.prewarm_preemptions.load(), static_cast<uint64_t>(1));
+    CHECK_EQ(metrics.prewarm_prefixes.load(), static_cast<uint64_t>(0));
+
+    // A preempted item is not a failure: it is tried again once idle
+    {
+        std::lock_guard<std::mutex> lock(engine.mutex);
+        engine.hold = false;
+    }
+    CHECK(engine.waitForStarts(2));
+    std::this_thread::sleep_for(milliseconds(20));
+    CHECK_EQ(metrics.prewarm_prefixes.load(), static_cast<uint64_t>(1));
+}
+
+void testFailingItemsAreDropped() {
+    Engine engine;
+    engine.ok = false;
+    MLCMetrics metrics;
+    MLCPrewarmer prewarmer(quickConfig(), &metrics, engine.runner(), engine.cancel(), engine.busyCheck());
+    observe(&prewarmer, prefix("broken"), 3);
+
+    CHECK(engine.waitForStarts(3));
+    std::this_thread::sleep_for(milliseconds(300));
+    CHECK_EQ(engine.startedCount(), static_cast<size_t>(3));
+    CHECK_EQ(metrics.prewarm_prefixes.load(), static_cast<uint64_t>(0));
+}
+
+void testHotItemsPersist() {
+    std::string path = "/tmp/prewarmer_test." + std::to_string(getpid());
+    MLCPrewarmConfig config = quickConfig();
+    config.persist_path = path;
+    {
+        Engine engine;
+        engine.busy = true;
+        MLCMetrics metrics;
+        MLCPrewarmer prewarmer(config, &metrics, engine.runner(), engine.cancel(), engine.busyCheck());
+        observe(&prewarmer, prefix("A"), 3);
+        observe(&prewarmer, completion("How do I reset my password?", 32), 4);
+    }
+
+    // The next process warms them without seeing a request
+    Engine engine;
+    MLCMetrics metrics;
+    MLCPrewarmer prewarmer(config, &metrics, engine.runner(), engine.cancel(), engine.busyCheck());
+    CHECK(engine.waitForStarts(2));
+    {
+        std::lock_guard<std::mutex> lock(engine.mutex);
+        CHECK(engine.started == std::vector<std::string>({"How do I reset my password?", "A"}));
+        CHECK_EQ(engine.max_tokens[0], 32);
+    }
+
+    CHECK(!prewarmer.load("/nonexistent/prewarm"));
+    unlink(path.c_str());
+}
+
+} // namespace
+
+int main() {
+    testSketch();
+    testItemKeys();
+    testHottestFirstOnceIdle();
+    testPrefixTokenBudget();
+    testPreemptCancelsAndRetries();
+    testFailingItemsAreDropped();
+    testHotItemsPersist();
+    return testResult("prewarmer_test");
+}
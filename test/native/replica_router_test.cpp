@@ -0,0 +1,116 @@
+// MLCReplicaRouter with 4-token blocks: shared prefixes stay on the replica
+// that cached them, load moves requests away once it outweighs the saved
+// prefill, sessions stick after their blocks are evicted, and the stats
+// account for every route.
+
+#include "MLCReplicaRouter.h"
+#include "test_support.h"
+#include <string>
+#include <vector>
+
+namespace {
+
+MLCRouterConfig smallBlocks(size_t max_cached_blocks = 1024) {
+    MLCRouterConfig config;
+    config.block_tokens = 4;
+    config.max_cached_blocks = max_cached_blocks;
+    config.load_cost_tokens = 10;
+    return config;
+}
+
+// `length` tokens from `first` upwards, then `tail`
+std::vector<int32_t> prompt(int32_t first, int length, const std::vector<int32_t>& tail = {}) {
+    std::vector<int32_t> ids;
+    for (int i = 0; i < length; ++i) ids.push_back(first + i);
+    ids.insert(ids.end(), tail.begin(), tail.end());
+    return ids;
+}
+
+void testSharedPrefixStaysTogether() {
+    MLCReplicaRouter router(3, smallBlocks());
+    CHECK_EQ(router.replicaCount(), static_cast<size_t>(3));
+
+    MLCReplicaRouter::Route first = router.route(prompt(100, 16, {1, 2, 3}), "");
+    CHECK_EQ(first.replica, static_cast<size_t>(0));
+    CHECK_EQ(first.cached_tokens, 0);
+
+    // Unrelated prompt: replica 0 is busy, so it goes elsewhere
+    MLCReplicaRouter::Route other = router.route(prompt(500, 16), "");
+    CHECK_EQ(other.replica, static_cast<size_t>(1));
+
+    // Same 16-token system prompt: four whole blocks cached on replica 0, and
+    // one request in flight there costs less than the 16 tokens saved
+    MLCReplicaRouter::Route second = router.route(prompt(100, 16, {7, 8, 9, 10, 11}), "");
+    CHECK_EQ(second.replica, static_cast<size_t>(0));
+    CHECK_EQ(second.cached_tokens, 16);
+
+    // A prefix that diverges inside the second block only shares the first
+    std::vector<int32_t> diverging = prompt(100, 6, {-1, -2, -3, -4, -5, -6});
+    router.onFinish(0);
+    router.onFinish(0);
+    router.onFinish(1);
+    MLCReplicaRouter::Route partial = router.route(diverging, "");
+    CHECK_EQ(partial.replica, static_cast<size_t>(0));
+    CHECK_EQ(partial.cached_tokens, 4);
+}
+
+void testLoadOutweighsCache() {
+    MLCReplicaRouter router(2, smallBlocks());
+    router.route(prompt(100, 16), "");
+    router.route(prompt(100, 16), "");
+    // Replica 0 now scores 2 * 10 - 16 = 4 against replica 1's 0
+    MLCReplicaRouter::Route moved = router.route(prompt(100, 16), "");
+    CHECK_EQ(moved.replica, static_cast<size_t>(1));
+    CHECK_EQ(moved.cached_tokens, 0);
+
+    std::vector<MLCReplicaStats> stats = router.stats();
+    CHECK_EQ(stats[0].requests, static_cast<uint64_t>(2));
+    CHECK_EQ(stats[0].in_flight, 2);
+    CHECK_EQ(stats[0].prefix_hit_tokens, static_cast<uint64_t>(16));
+    CHECK_EQ(stats[1].requests, static_cast<uint64_t>(1));
+    CHECK_EQ(stats[1].rebalanced, static_cast<uint64_t>(1));
+    CHECK_EQ(stats[0].prompt_tokens + stats[1].prompt_tokens, static_cast<uint64_t>(48));
+
+    // Finishing more than was routed never goes negative; bad indices are ignored
+    router.onFinish(1);
+    router.onFinish(1);
+    router.onFinish(7);
+    CHECK_EQ(router.stats()[1].in_flight, 0);
+}
+
+void testSessionOutlivesEvictedBlocks() {
+    // Two blocks per replica: any other prompt evicts the session's blocks
+    MLCReplicaRouter router(2, smallBlocks(2));
+    std::vector<int32_t> turn1 = prompt(100, 8);
+    MLCReplicaRouter::Route first = router.route(turn1, "chat-1");
+    router.onFinish(first.replica);
+
+    // Both replicas idle: the filler takes replica 0 and evicts turn 1
+    MLCReplicaRouter::Route filler = router.route(prompt(300, 8), "");
+    CHECK_EQ(filler.replica, first.replica);
+    router.onFinish(filler.replica);
+
+    // The session's last prompt still counts as cached on its replica
+    std::vector<int32_t> turn2 = prompt(100, 8, {42, 43, 44, 45});
+    MLCReplicaRouter::Route second = router.route(turn2, "chat-1");
+    CHECK_EQ(second.replica, first.replica);
+    CHECK_EQ(second.cached_tokens, 8);
+    CHECK_EQ(router.stats()[first.replica].sticky_routes, static_cast<uint64_t>(1));
+}
+
+void testShortPromptsHaveNoBlocks() {
+    MLCReplicaRouter router(2, smallBlocks());
+    router.route(prompt(1, 3), "");
+    router.onFinish(0);
+    CHECK_EQ(router.route(prompt(1, 3), "").cached_tokens, 0);
+}
+
+} // namespace
+
+int main() {
+    testSharedPrefixStaysTogether();
+    testLoadOutweighsCache();
+    testSessionOutlivesEvictedBlocks();
+    testShortPromptsHaveNoBlocks();
+    return testResult("replica_router_test");
+}
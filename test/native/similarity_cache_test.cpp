@@ -0,0 +1,163 @@
+// MLCSimilarityCache: normalization, exact and near-duplicate hits, request
+// class isolation, LRU eviction and the save/load round trip.
+
+#include "MLCSimilarityCache.h"
+#include "test_support.h"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+const std::string kInstruction = "Summarize the following support ticket in two sentences.";
+const std::string kTicket =
+    " The customer reports that the mobile app crashes every time they open the settings page after "
+    "updating to the latest version on their phone.";
+const std::string kPrompt = kInstruction + kTicket;
+
+MLCSimilarityCacheConfig faqConfig(size_t capacity = 16) {
+    MLCSimilarityCacheConfig config;
+    config.request_classes = {"faq"};
+    config.capacity = capacity;
+    // Wide enough that a one-word edit of kPrompt reaches the Jaccard check
+    config.max_hamming_distance = 8;
+    return config;
+}
+
+std::string tempPath(const char* name) {
+    return std::string("/tmp/") + name + "." + std::to_string(getpid());
+}
+
+void testNormalize() {
+    CHECK_EQ(MLCSimilarityCache::normalize("  What's   the\tWEATHER?\n"), std::string("whats the weather"));
+    CHECK_EQ(MLCSimilarityCache::normalize("Caf\xC3\xA9, OK!"), std::string("caf\xC3\xA9 ok"));
+    CHECK_EQ(MLCSimilarityCache::normalize("?!"), std::string());
+}
+
+void testExactAndNearDuplicateHits() {
+    MLCSimilarityCache cache;
+    cache.configure(faqConfig());
+    CHECK(cache.acceptsClass("faq"));
+    CHECK(!cache.acceptsClass("chat"));
+    CHECK(!cache.acceptsClass(""));
+
+    cache.insert("faq", kPrompt, "cached summary");
+    std::string completion;
+
+    // Same prompt after normalization
+    CHECK(cache.lookup("faq", "  SUMMARIZE the following support ticket, in two sentences:" + kTicket, &completion));
+    CHECK_EQ(completion, std::string("cached summary"));
+
+    // One word changed
+    completion.clear();
+    std::string edited = kPrompt;
+    edited.replace(edited.find("latest"), 6, "newest");
+    CHECK(cache.lookup("faq", edited, &completion));
+    CHECK_EQ(completion, std::string("cached summary"));
+
+    // Unrelated prompt, and the same prompt under another class
+    completion.clear();
+    CHECK(!cache.lookup("faq", "Translate 'good morning' into French and Spanish, please.", &completion));
+    CHECK(!cache.lookup("chat", kPrompt, &completion));
+    CHECK(completion.empty());
+}
+
+void testStrictThresholdRejectsEdits() {
+    MLCSimilarityCacheConfig config = faqConfig();
+    config.min_similarity = 1.0;
+    MLCSimilarityCache cache;
+    cache.configure(config);
+    cache.insert("faq", kPrompt, "cached summary");
+
+    std::string edited = kPrompt;
+    edited.replace(edited.find("latest"), 6, "newest");
+    std::string completion;
+    CHECK(!cache.lookup("faq", edited, &completion));
+    CHECK(cache.lookup("faq", kPrompt, &completion));
+}
+
+void testLruEviction() {
+    MLCSimilarityCache cache;
+    cache.configure(faqConfig(2));
+    cache.insert("faq", "first question about billing", "1");
+    cache.insert("faq", "second question about shipping", "2");
+
+    // Touching the first makes the second the eviction victim
+    std::string completion;
+    CHECK(cache.lookup("faq", "first question about billing", &completion));
+    cache.insert("faq", "third question about returns", "3");
+    CHECK_EQ(cache.size(), static_cast<size_t>(2));
+    CHECK(cache.lookup("faq", "first question about billing", &completion));
+    CHECK(!cache.lookup("faq", "second question about shipping", &completion));
+
+    // Re-inserting a prompt replaces its completion instead of adding an entry
+    cache.insert("faq", "third question about returns", "3b");
+    CHECK_EQ(cache.size(), static_cast<size_t>(2));
+    CHECK(cache.lookup("faq", "third question about returns", &completion));
+    CHECK_EQ(completion, std::string("3b"));
+
+    // Shrinking the capacity evicts right away
+    cache.configure(faqConfig(1));
+    CHECK_EQ(cache.size(), static_cast<size_t>(1));
+}
+
+void testSaveAndLoad() {
+    std::string path = tempPath("similarity_cache_test");
+    {
+        MLCSimilarityCache cache;
+        cache.configure(faqConfig());
+        cache.insert("faq", kPrompt, "cached summary");
+        cache.insert("faq", "Where is my order?", "tracking");
+        CHECK(cache.save(path));
+    }
+
+    MLCSimilarityCache restored;
+    restored.configure(faqConfig(1));
+    CHECK(restored.load(path));
+    // The most recently used entry is the one kept
+    CHECK_EQ(restored.size(), static_cast<size_t>(1));
+    std::string completion;
+    CHECK(restored.lookup("faq", "where is my order", &completion));
+    CHECK_EQ(completion, std::string("tracking"));
+
+    // A truncated file is rejected as a whole
+    {
+        std::ifstream in(path, std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size() - 3));
+    }
+    MLCSimilarityCache truncated;
+    truncated.configure(faqConfig());
+    CHECK(!truncated.load(path));
+    CHECK_EQ(truncated.size(), static_cast<size_t>(0));
+
+    {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << "not a cache file";
+    }
+    CHECK(!truncated.load(path));
+    std::remove(path.c_str());
+    CHECK(!truncated.load(path));
+}
+
+void testSimhash() {
+    std::vector<uint32_t> shingles = {1, 2, 3, 4, 5};
+    CHECK_EQ(MLCSimilarityCache::simhash(shingles), MLCSimilarityCache::simhash(shingles));
+    CHECK_EQ(MLCSimilarityCache::simhash({}), static_cast<uint64_t>(0));
+}
+
+} // namespace
+
+int main() {
+    testNormalize();
+    testExactAndNearDuplicateHits();
+    testStrictThresholdRejectsEdits();
+    testLruEviction();
+    testSaveAndLoad();
+    testSimhash();
+    return testResult("similarity_cache_test");
+}
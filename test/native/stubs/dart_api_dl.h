@@ -0,0 +1,86 @@
+#ifndef DART_API_DL_STUB_H
+#define DART_API_DL_STUB_H
+
+// Stand-in for the Dart SDK's dart_api_dl.h so the native sinks build and run
+// on Linux without a Dart VM. Declares the subset of the DL API the bridge
+// uses, with the SDK's names; the test defines the two entry points and
+// records what is posted.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef int64_t Dart_Port;
+#define ILLEGAL_PORT ((Dart_Port)0)
+
+typedef void (*Dart_HandleFinalizer)(void* isolate_callback_data, void* peer);
+
+typedef enum {
+    Dart_TypedData_kByteData = 0,
+    Dart_TypedData_kInt8,
+    Dart_TypedData_kUint8,
+    Dart_TypedData_kUint8Clamped,
+    Dart_TypedData_kInt16,
+    Dart_TypedData_kUint16,
+    Dart_TypedData_kInt32,
+    Dart_TypedData_kUint32,
+    Dart_TypedData_kInt64,
+    Dart_TypedData_kUint64,
+    Dart_TypedData_kFloat32,
+    Dart_TypedData_kFloat64,
+    Dart_TypedData_kInvalid
+} Dart_TypedData_Type;
+
+typedef enum {
+    Dart_CObject_kNull = 0,
+    Dart_CObject_kBool,
+    Dart_CObject_kInt32,
+    Dart_CObject_kInt64,
+    Dart_CObject_kDouble,
+    Dart_CObject_kString,
+    Dart_CObject_kArray,
+    Dart_CObject_kTypedData,
+    Dart_CObject_kExternalTypedData,
+    Dart_CObject_kNumberOfTypes
+} Dart_CObject_Type;
+
+typedef struct _Dart_CObject {
+    Dart_CObject_Type type;
+    union {
+        bool as_bool;
+        int32_t as_int32;
+        int64_t as_int64;
+        double as_double;
+        const char* as_string;
+        struct {
+            intptr_t length;
+            struct _Dart_CObject** values;
+        } as_array;
+        struct {
+            Dart_TypedData_Type type;
+            intptr_t length;
+            const uint8_t* values;
+        } as_typed_data;
+        struct {
+            Dart_TypedData_Type type;
+            intptr_t length;
+            uint8_t* data;
+            void* peer;
+            Dart_HandleFinalizer callback;
+        } as_external_typed_data;
+    } value;
+} Dart_CObject;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef bool (*Dart_PostCObject_Type)(Dart_Port port_id, Dart_CObject* message);
+extern Dart_PostCObject_Type Dart_PostCObject_DL;
+
+intptr_t Dart_InitializeApiDL(void* data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DART_API_DL_STUB_H */
@@ -0,0 +1,45 @@
+#ifndef test_support_h
+#define test_support_h
+
+// Minimal checks for the native tests: failures are counted and reported,
+// and the test keeps going so one run shows every broken expectation.
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+inline int& testFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+template <typename A, typename B>
+bool checkEqual(const A& actual, const B& expected, const char* expression, const char* file, int line) {
+    if (actual == expected) return true;
+    std::ostringstream message;
+    message << actual << " != " << expected;
+    fprintf(stderr, "%s:%d: CHECK_EQ(%s) failed: %s\n", file, line, expression, message.str().c_str());
+    testFailures()++;
+    return false;
+}
+
+#define CHECK(condition)                                                          \
+    do {                                                                          \
+        if (!(condition)) {                                                       \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            testFailures()++;                                                     \
+        }                                                                         \
+    } while (0)
+
+#define CHECK_EQ(actual, expected) checkEqual((actual), (expected), #actual ", " #expected, __FILE__, __LINE__)
+
+inline int testResult(const char* name) {
+    if (testFailures() == 0) {
+        printf("%s: all checks passed\n", name);
+        return 0;
+    }
+    printf("%s: %d check(s) failed\n", name, testFailures());
+    return 1;
+}
+
+#endif /* test_support_h */
@@ -0,0 +1,161 @@
+// mlc_flight_decode: prints a flight-recorder dump (mlc_llm_flight_recorder_dump,
+// stall or crash dumps) as one timeline, merged across threads.
+//
+// Build:  c++ -std=c++17 -O2 -I../Classes mlc_flight_decode.cpp -o mlc_flight_decode
+// Usage:  mlc_flight_decode [--request N] [--last N] DUMP
+
+#include "MLCFlightRecorder.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+const char* finishName(uint32_t reason) {
+    switch (reason) {
+        case kFlightFinishStop: return "stop";
+        case kFlightFinishLength: return "length";
+        case kFlightFinishRepetition: return "repetition";
+    }
+    return "other";
+}
+
+const char* dumpReasonName(uint32_t reason) {
+    switch (reason) {
+        case kFlightDumpRequested: return "requested";
+        case kFlightDumpStall: return "stall";
+        case kFlightDumpSignal: return "fatal signal";
+    }
+    return "unknown";
+}
+
+std::string describe(const MLCFlightEvent& event) {
+    char text[128];
+    switch (static_cast<MLCFlightEventType>(event.type)) {
+        case MLCFlightEventType::Submit:
+            snprintf(text, sizeof(text), "~%u prompt tokens, max %lld", event.arg0, static_cast<long long>(event.arg1));
+            break;
+        case MLCFlightEventType::Admit:
+        case MLCFlightEventType::Reject:
+            snprintf(text, sizeof(text), "queue %u, est. wait %lld ms", event.arg0, static_cast<long long>(event.arg1));
+            break;
+        case MLCFlightEventType::Dispatch:
+            snprintf(text, sizeof(text), "%u prompt tokens", event.arg0);
+            break;
+        case MLCFlightEventType::AdmissionBatch:
+            snprintf(text, sizeof(text), "%u requests, %lld prompt tokens", event.arg0, static_cast<long long>(event.arg1));
+            break;
+        case MLCFlightEventType::Payload:
+            snprintf(text, sizeof(text), "%u outputs", event.arg0);
+            break;
+        case MLCFlightEventType::Tokens:
+            snprintf(text, sizeof(text), "+%u -> %lld", event.arg0, static_cast<long long>(event.arg1));
+            break;
+        case MLCFlightEventType::Finish:
+            snprintf(text, sizeof(text), "%s after %lld tokens", finishName(event.arg0), static_cast<long long>(event.arg1));
+            break;
+        case MLCFlightEventType::Reload:
+            snprintf(text, sizeof(text), "%s", event.arg0 == 0 ? "start" : event.arg0 == 1 ? "done" : "failed");
+            break;
+        case MLCFlightEventType::Stall:
+            snprintf(text, sizeof(text), "engine %u silent for %lld ms", event.arg0, static_cast<long long>(event.arg1));
+            break;
+        case MLCFlightEventType::Dump:
+            snprintf(text, sizeof(text), "%s", dumpReasonName(event.arg0));
+            break;
+        default:
+            text[0] = '\0';
+    }
+    return text;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    const char* path = nullptr;
+    long long request_filter = -1;
+    size_t last = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--request") == 0 && i + 1 < argc) {
+            request_filter = atoll(argv[++i]);
+        } else if (strcmp(argv[i], "--last") == 0 && i + 1 < argc) {
+            last = static_cast<size_t>(atoll(argv[++i]));
+        } else {
+            path = argv[i];
+        }
+    }
+    if (!path) {
+        fprintf(stderr, "usage: mlc_flight_decode [--request N] [--last N] DUMP\n");
+        return 2;
+    }
+
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        perror(path);
+        return 1;
+    }
+    MLCFlightDumpHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, "MLCFLT01", 8) != 0 ||
+        header.event_size != sizeof(MLCFlightEvent)) {
+        fprintf(stderr, "%s: not a flight recorder dump\n", path);
+        return 1;
+    }
+
+    std::vector<MLCFlightEvent> events;
+    std::unordered_map<uint32_t, std::string> thread_names;
+    for (uint32_t r = 0; r < header.ring_count; ++r) {
+        MLCFlightRingHeader ring;
+        if (fread(&ring, sizeof(ring), 1, file) != 1 || ring.capacity == 0 || ring.capacity > (1u << 20)) {
+            fprintf(stderr, "%s: truncated at ring %u\n", path, r);
+            break;
+        }
+        std::vector<MLCFlightEvent> slots(ring.capacity);
+        if (fread(slots.data(), sizeof(MLCFlightEvent), slots.size(), file) != slots.size()) {
+            fprintf(stderr, "%s: truncated at ring %u\n", path, r);
+            break;
+        }
+        ring.thread_name[sizeof(ring.thread_name) - 1] = '\0';
+        if (ring.thread_name[0]) thread_names[ring.thread] = ring.thread_name;
+        uint64_t count = std::min<uint64_t>(ring.head, ring.capacity);
+        for (uint64_t i = 0; i < count; ++i) {
+            const MLCFlightEvent& event = slots[i];
+            if (event.time_ns == 0) continue;
+            if (request_filter >= 0 && event.request != static_cast<uint64_t>(request_filter)) continue;
+            events.push_back(event);
+        }
+    }
+    fclose(file);
+
+    std::stable_sort(events.begin(), events.end(),
+                     [](const MLCFlightEvent& a, const MLCFlightEvent& b) { return a.time_ns < b.time_ns; });
+    if (last > 0 && events.size() > last) events.erase(events.begin(), events.end() - static_cast<long>(last));
+
+    time_t dump_seconds = static_cast<time_t>(header.dump_unix_ns / 1000000000ULL);
+    char dump_time[64];
+    strftime(dump_time, sizeof(dump_time), "%Y-%m-%d %H:%M:%S", localtime(&dump_seconds));
+    printf("flight dump (%s", dumpReasonName(header.reason));
+    if (header.reason == kFlightDumpSignal) printf(", signal %d", header.signal);
+    printf(") at %s, %u threads, %zu events\n", dump_time, header.ring_count, events.size());
+    printf("%14s  %-16s %-16s %8s  %s\n", "ms before dump", "thread", "event", "request", "details");
+
+    for (const MLCFlightEvent& event : events) {
+        double before_ms = (static_cast<double>(header.dump_steady_ns) - static_cast<double>(event.time_ns)) / 1e6;
+        auto name = thread_names.find(event.thread);
+        char thread[32];
+        if (name != thread_names.end()) {
+            snprintf(thread, sizeof(thread), "%s", name->second.c_str());
+        } else {
+            snprintf(thread, sizeof(thread), "thread-%u", event.thread);
+        }
+        char request[24] = "-";
+        if (event.request) snprintf(request, sizeof(request), "%llu", static_cast<unsigned long long>(event.request));
+        printf("%14.3f  %-16s %-16s %8s  %s\n", before_ms, thread, MLCFlightEventName(event.type), request,
+               describe(event).c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,458 @@
+// mlc_guardrail: checks that performance modes keep output quality. Runs a
+// fixed evaluation set through the bridge once per mode and compares each
+// mode with a float16, cache-free baseline:
+//
+//   exact match  greedy outputs identical to the baseline's
+//   perplexity   teacher-forced over the baseline's output tokens through
+//                mlc_llm_score_tokens (the next token's logprob among the
+//                top 5; a token outside them counts as the 5th's logprob)
+//   throughput   completion tokens per second and mean time to first token
+//
+// A mode passes when its exact-match rate and perplexity ratio stay within
+// the tolerances. Exit status is 0 when every mode passes, 1 otherwise.
+//
+// Modes:  kv-int8, kv-fp8   quantized KV pages (kv_cache_dtype)
+//         prefix            every prompt again with the prefix cache warm
+//         similarity        the set's "variant" prompts, answered from the
+//                           similarity cache filled by the originals
+//
+// Evaluation set: JSON lines {"prompt": ..., "system": ..., "variant": ...},
+// system and variant optional (tools/guardrail_eval.jsonl).
+//
+// Build:  c++ -std=c++17 -O2 -I../Classes mlc_guardrail.cpp ../Classes/*.cpp -o mlc_guardrail
+//         (link the same MLC/TVM runtime libraries as the plugin, plus -lpthread)
+// Usage:  mlc_guardrail [--modes kv-int8,kv-fp8,prefix,similarity] [--set FILE]
+//                       [--model-lib LIB] [--max-tokens N] [--ppl-tokens N]
+//                       [--min-exact-match F] [--max-ppl-increase F]
+//                       [--min-speedup F] MODEL_DIR
+
+#include "MLCBridge.h"
+#include "MLCEvents.h"
+#include "MLCJson.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+const int kScoreTopLogprobs = 5;
+const char* kRequestClass = "guardrail";
+
+struct Mode {
+    const char* name;
+    const char* kv_cache_dtype;   // nullptr keeps float16
+    bool warm_pass;               // run the set once before measuring
+    bool similarity;              // measure variants answered from the similarity cache
+};
+
+const Mode kModes[] = {
+    {"baseline", nullptr, false, false},
+    {"kv-int8", "int8", false, false},
+    {"kv-fp8", "float8_e4m3", false, false},
+    {"prefix", nullptr, true, false},
+    {"similarity", nullptr, false, true},
+};
+
+struct Item {
+    std::string prompt;
+    bool has_system = false;
+    std::string system;
+    std::string variant;
+};
+
+struct Options {
+    std::string model_dir;
+    std::string model_lib;
+    std::string set_path = "guardrail_eval.jsonl";
+    std::vector<std::string> modes = {"kv-int8", "kv-fp8", "prefix", "similarity"};
+    int max_tokens = 64;
+    int ppl_tokens = 32;
+    double min_exact_match = 0.9;
+    double max_ppl_increase = 0.05;
+    double min_speedup = 0.0;
+};
+
+// One request's output, gathered from binary events
+struct Output {
+    std::string text;
+    std::vector<int32_t> tokens;
+    std::vector<std::string> token_strings;  // sampled token text, from the logprob records
+    std::string finish_reason;
+    int completion_tokens = 0;
+    double ttft_ms = 0.0;
+    double total_ms = 0.0;
+    bool failed = false;
+};
+
+struct Pending {
+    std::mutex mutex;
+    std::condition_variable done_cv;
+    bool done = false;
+    bool first_chunk = true;
+    std::chrono::steady_clock::time_point started;
+    Output output;
+};
+
+void onEvents(void* user_data, const uint8_t* data, size_t size) {
+    auto* pending = static_cast<Pending*>(user_data);
+    std::lock_guard<std::mutex> lock(pending->mutex);
+    Output& output = pending->output;
+    auto now = std::chrono::steady_clock::now();
+    MLCEventReader reader(data, size);
+    MLCEventView event;
+    while (reader.next(&event)) {
+        switch (event.type()) {
+            case MLC_LLM_EVENT_CHUNK:
+                if (pending->first_chunk) {
+                    output.ttft_ms = std::chrono::duration<double, std::milli>(now - pending->started).count();
+                    pending->first_chunk = false;
+                }
+                output.text.append(event.text());
+                break;
+            case MLC_LLM_EVENT_TOKENS:
+                for (uint32_t i = 0; i < event.numTokens(); ++i) output.tokens.push_back(event.tokenId(i));
+                break;
+            case MLC_LLM_EVENT_LOGPROBS:
+                for (uint32_t i = 0; i < event.numLogprobTokens(); ++i) {
+                    output.token_strings.emplace_back(event.logprobToken(i, 0));
+                }
+                break;
+            case MLC_LLM_EVENT_USAGE:
+                output.completion_tokens = static_cast<int>(event.completionTokens());
+                break;
+            case MLC_LLM_EVENT_FINISH:
+            case MLC_LLM_EVENT_ERROR:
+                output.failed = event.type() == MLC_LLM_EVENT_ERROR;
+                output.finish_reason = std::string(event.text());
+                output.total_ms = std::chrono::duration<double, std::milli>(now - pending->started).count();
+                pending->done = true;
+                break;
+        }
+    }
+    if (pending->done) pending->done_cv.notify_all();
+}
+
+Output generate(void* engine, const Item& item, const std::string& prompt, const Options& options, bool cacheable) {
+    Pending pending;
+    mlc_llm_request_t req;
+    mlc_llm_request_init(&req);
+    req.prompt = prompt.c_str();
+    req.system = item.has_system ? item.system.c_str() : nullptr;
+    req.max_tokens = options.max_tokens;
+    req.temperature = 0.0f;
+    req.request_class = cacheable ? kRequestClass : nullptr;
+    req.event_callback = onEvents;
+    req.event_user_data = &pending;
+    req.top_logprobs = 1;
+    pending.started = std::chrono::steady_clock::now();
+    if (mlc_llm_submit(engine, &req) != MLC_LLM_OK) {
+        pending.output.failed = true;
+        return pending.output;
+    }
+    std::unique_lock<std::mutex> lock(pending.mutex);
+    pending.done_cv.wait(lock, [&pending]() { return pending.done; });
+    return pending.output;
+}
+
+struct ScoreLookup {
+    const std::string* token;
+    float logprob;
+    float lowest;
+    bool found;
+};
+
+void onScore(void* user_data, const mlc_llm_token_logprob_t* entries, int count) {
+    auto* lookup = static_cast<ScoreLookup*>(user_data);
+    for (int i = 0; i < count; ++i) {
+        lookup->lowest = std::min(lookup->lowest, entries[i].logprob);
+        if (!lookup->found && entries[i].token && *lookup->token == entries[i].token) {
+            lookup->logprob = entries[i].logprob;
+            lookup->found = true;
+        }
+    }
+}
+
+// Sum of next-token logprobs over `reference`, which must carry token strings
+// for its ids; returns the number of positions scored
+int scoreReference(void* engine, const Output& reference, int max_positions, double* logprob_sum, int* outside_top) {
+    size_t length = std::min(reference.tokens.size(), reference.token_strings.size());
+    length = std::min(length, static_cast<size_t>(max_positions) + 1);
+    int scored = 0;
+    for (size_t i = 1; i < length; ++i) {
+        ScoreLookup lookup{&reference.token_strings[i], 0.0f, 0.0f, false};
+        if (mlc_llm_score_tokens(engine, reference.tokens.data(), static_cast<int>(i), 0, kScoreTopLogprobs, onScore,
+                                 &lookup) != MLC_LLM_OK) {
+            continue;
+        }
+        if (!lookup.found) {
+            (*outside_top)++;
+            lookup.logprob = lookup.lowest;
+        }
+        *logprob_sum += lookup.logprob;
+        scored++;
+    }
+    return scored;
+}
+
+struct ModeResult {
+    const Mode* mode = nullptr;
+    bool ran = false;
+    int compared = 0;
+    int exact = 0;
+    int cache_hits = 0;
+    int failures = 0;
+    double perplexity = NAN;
+    int outside_top = 0;
+    double tokens_per_second = 0.0;
+    double ttft_ms = 0.0;
+    std::vector<Output> outputs;   // per item (variants for similarity)
+};
+
+void* createEngine(const Options& options, const Mode& mode) {
+    mlc_llm_engine_config_t config;
+    mlc_llm_engine_config_init(&config);
+    config.admission_window_us = 0;
+    config.disable_startup_prefetch = 1;
+    if (!options.model_lib.empty()) config.model_lib = options.model_lib.c_str();
+    config.kv_cache_dtype = mode.kv_cache_dtype;
+    void* engine = mlc_llm_create_engine_ex(options.model_dir.c_str(), &config);
+    if (engine && mode.similarity) {
+        const char* classes[] = {kRequestClass};
+        mlc_llm_similarity_cache_config_t cache = {};
+        cache.request_classes = classes;
+        cache.num_request_classes = 1;
+        mlc_llm_configure_similarity_cache(engine, &cache);
+    }
+    return engine;
+}
+
+// Runs the set under `mode`; `baseline` is null for the baseline itself
+bool runMode(const Options& options, const std::vector<Item>& items, const Mode& mode, const ModeResult* baseline,
+             ModeResult* result) {
+    result->mode = &mode;
+    void* engine = createEngine(options, mode);
+    if (!engine) {
+        fprintf(stderr, "mlc_guardrail: cannot create the %s engine\n", mode.name);
+        return false;
+    }
+
+    if (mode.warm_pass || mode.similarity) {
+        for (const Item& item : items) generate(engine, item, item.prompt, options, mode.similarity);
+    }
+
+    // The baseline also answers every variant, for the similarity mode
+    bool variants = mode.similarity || !baseline;
+    double generate_ms = 0.0;
+    double ttft_total = 0.0;
+    long long completion_tokens = 0;
+    int answered = 0;
+    for (size_t i = 0; i < items.size(); ++i) {
+        const Item& item = items[i];
+        std::vector<std::string> prompts;
+        if (!mode.similarity) prompts.push_back(item.prompt);
+        if (variants && !item.variant.empty()) prompts.push_back(item.variant);
+        for (size_t p = 0; p < prompts.size(); ++p) {
+            Output output = generate(engine, item, prompts[p], options, mode.similarity);
+            if (output.failed) result->failures++;
+            if (output.finish_reason == "cache") result->cache_hits++;
+            generate_ms += output.total_ms;
+            ttft_total += output.ttft_ms;
+            completion_tokens += output.completion_tokens;
+            answered++;
+            result->outputs.push_back(std::move(output));
+        }
+    }
+    result->tokens_per_second = generate_ms > 0.0 ? 1000.0 * completion_tokens / generate_ms : 0.0;
+    result->ttft_ms = answered > 0 ? ttft_total / answered : 0.0;
+
+    if (baseline) {
+        // Baseline outputs are laid out [prompt, variant?] per item
+        size_t base = 0;
+        size_t own = 0;
+        for (const Item& item : items) {
+            const Output* reference_prompt = &baseline->outputs[base++];
+            const Output* reference_variant = item.variant.empty() ? nullptr : &baseline->outputs[base++];
+            const Output* reference = mode.similarity ? reference_variant : reference_prompt;
+            if (!reference) continue;
+            const Output& output = result->outputs[own++];
+            result->compared++;
+            if (!output.failed && !reference->failed && output.text == reference->text) result->exact++;
+        }
+    }
+
+    // Cached answers have no logprobs to score
+    if (!mode.similarity) {
+        double logprob_sum = 0.0;
+        int scored = 0;
+        const ModeResult& reference = baseline ? *baseline : *result;
+        for (const Output& output : reference.outputs) {
+            scored += scoreReference(engine, output, options.ppl_tokens, &logprob_sum, &result->outside_top);
+        }
+        if (scored > 0) result->perplexity = std::exp(-logprob_sum / scored);
+    }
+
+    mlc_llm_destroy_engine(engine);
+    result->ran = true;
+    return true;
+}
+
+bool loadSet(const std::string& path, std::vector<Item>* items) {
+    std::ifstream in(path);
+    if (!in) {
+        fprintf(stderr, "mlc_guardrail: cannot read %s\n", path.c_str());
+        return false;
+    }
+    std::string line;
+    int number = 0;
+    while (std::getline(in, line)) {
+        number++;
+        if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+        MLCJsonValue value;
+        std::string error;
+        const MLCJsonValue* prompt = nullptr;
+        if (!MLCJson::parse(line, &value, &error) || !(prompt = value.get("prompt")) || !prompt->isString()) {
+            fprintf(stderr, "%s:%d: expected {\"prompt\": ...} %s\n", path.c_str(), number, error.c_str());
+            return false;
+        }
+        Item item;
+        item.prompt = prompt->string;
+        if (const MLCJsonValue* system = value.get("system")) {
+            item.has_system = true;
+            item.system = system->asString();
+        }
+        if (const MLCJsonValue* variant = value.get("variant")) item.variant = variant->asString();
+        items->push_back(std::move(item));
+    }
+    return !items->empty();
+}
+
+std::vector<std::string> splitList(const std::string& text) {
+    std::vector<std::string> parts;
+    std::stringstream stream(text);
+    std::string part;
+    while (std::getline(stream, part, ',')) {
+        if (!part.empty()) parts.push_back(part);
+    }
+    return parts;
+}
+
+const Mode* findMode(const std::string& name) {
+    for (const Mode& mode : kModes) {
+        if (name == mode.name) return &mode;
+    }
+    return nullptr;
+}
+
+void usage() {
+    fprintf(stderr,
+            "usage: mlc_guardrail [--modes kv-int8,kv-fp8,prefix,similarity] [--set FILE] [--model-lib LIB]\n"
+            "                     [--max-tokens N] [--ppl-tokens N] [--min-exact-match F]\n"
+            "                     [--max-ppl-increase F] [--min-speedup F] MODEL_DIR\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--modes") == 0 && has_value) {
+            options.modes = splitList(argv[++i]);
+        } else if (strcmp(argv[i], "--set") == 0 && has_value) {
+            options.set_path = argv[++i];
+        } else if (strcmp(argv[i], "--model-lib") == 0 && has_value) {
+            options.model_lib = argv[++i];
+        } else if (strcmp(argv[i], "--max-tokens") == 0 && has_value) {
+            options.max_tokens = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--ppl-tokens") == 0 && has_value) {
+            options.ppl_tokens = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--min-exact-match") == 0 && has_value) {
+            options.min_exact_match = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--max-ppl-increase") == 0 && has_value) {
+            options.max_ppl_increase = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--min-speedup") == 0 && has_value) {
+            options.min_speedup = atof(argv[++i]);
+        } else if (argv[i][0] == '-') {
+            usage();
+            return 2;
+        } else {
+            options.model_dir = argv[i];
+        }
+    }
+    if (options.model_dir.empty() || options.max_tokens <= 0) {
+        usage();
+        return 2;
+    }
+    std::vector<const Mode*> modes;
+    for (const std::string& name : options.modes) {
+        const Mode* mode = findMode(name);
+        if (!mode || mode == &kModes[0]) {
+            fprintf(stderr, "mlc_guardrail: unknown mode %s\n", name.c_str());
+            return 2;
+        }
+        modes.push_back(mode);
+    }
+
+    std::vector<Item> items;
+    if (!loadSet(options.set_path, &items)) return 2;
+
+    ModeResult baseline;
+    if (!runMode(options, items, kModes[0], nullptr, &baseline)) return 2;
+    std::vector<ModeResult> results(modes.size());
+    for (size_t i = 0; i < modes.size(); ++i) {
+        if (!runMode(options, items, *modes[i], &baseline, &results[i])) results[i].mode = modes[i];
+    }
+
+    printf("\nguardrail: %zu prompts, max_tokens %d, greedy\n", items.size(), options.max_tokens);
+    printf("%-11s %8s %9s %10s %8s %9s %8s  %s\n", "mode", "exact", "ppl", "ppl ratio", "tok/s", "speedup", "ttft ms",
+           "result");
+    printf("%-11s %8s %9.3f %10s %8.1f %9s %8.1f\n", "baseline", "-", baseline.perplexity, "-",
+           baseline.tokens_per_second, "-", baseline.ttft_ms);
+    bool all_passed = true;
+    for (const ModeResult& result : results) {
+        if (!result.ran) {
+            printf("%-11s %s\n", result.mode->name, "FAIL (engine did not start)");
+            all_passed = false;
+            continue;
+        }
+        double exact = result.compared > 0 ? static_cast<double>(result.exact) / result.compared : 0.0;
+        double ppl_ratio = result.perplexity / baseline.perplexity;
+        double speedup = baseline.tokens_per_second > 0.0 ? result.tokens_per_second / baseline.tokens_per_second : 0.0;
+        std::string failed;
+        if (result.failures > 0) failed += " requests failed;";
+        if (result.compared == 0) failed += " nothing to compare;";
+        if (exact < options.min_exact_match) failed += " exact match;";
+        if (!std::isnan(ppl_ratio) && ppl_ratio > 1.0 + options.max_ppl_increase) failed += " perplexity;";
+        if (options.min_speedup > 0.0 && speedup < options.min_speedup) failed += " speedup;";
+        all_passed = all_passed && failed.empty();
+
+        char exact_text[16];
+        snprintf(exact_text, sizeof(exact_text), "%d/%d", result.exact, result.compared);
+        char ppl_text[16] = "-";
+        char ratio_text[16] = "-";
+        if (!std::isnan(result.perplexity)) {
+            snprintf(ppl_text, sizeof(ppl_text), "%.3f", result.perplexity);
+            snprintf(ratio_text, sizeof(ratio_text), "%.3f", ppl_ratio);
+        }
+        printf("%-11s %8s %9s %10s %8.1f %8.2fx %8.1f  %s%s\n", result.mode->name, exact_text, ppl_text, ratio_text,
+               result.tokens_per_second, speedup, result.ttft_ms, failed.empty() ? "PASS" : "FAIL:", failed.c_str());
+        if (result.mode->similarity) printf("%-11s %d of %d answered from the cache\n", "", result.cache_hits,
+                                            result.compared);
+        if (result.outside_top > 0) {
+            printf("%-11s %d scored tokens outside the top %d\n", "", result.outside_top, kScoreTopLogprobs);
+        }
+    }
+    printf("tolerances: exact match >= %.2f, perplexity increase <= %.1f%%%s\n", options.min_exact_match,
+           100.0 * options.max_ppl_increase, options.min_speedup > 0.0 ? ", speedup >= min" : "");
+    printf("%s\n", all_passed ? "PASS" : "FAIL");
+    return all_passed ? 0 : 1;
+}
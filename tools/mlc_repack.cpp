@@ -0,0 +1,455 @@
+// mlc_repack: rewrites a model's params_shard_*.bin files into a few packed
+// files (MLCWeightPack.h) laid out in first-use order, so loading the weights
+// is one sequential read and large tensors sit on huge-page boundaries.
+//
+// First-use order comes from the model's startup profile
+// (mlc-startup-profile.bin, recorded by MLCWeightPrefetcher) when one matches
+// the weights; otherwise from the parameter names: embeddings, then each
+// layer in forward order (attention norm, attention, MLP norm, MLP), then the
+// final norm and the output head.
+//
+// OUT_DIR gets the packed files, a matching ndarray-cache.json and copies of
+// the model's other files, so it replaces MODEL_DIR as a model path.
+//
+// MLC-LLM's loader reads each raw-shard file whole before copying its tensors
+// to the device, so the largest file sets the extra peak memory of a load.
+// Files are therefore capped at 32 MB by default, the size of the converter's
+// own shards; a tensor larger than the cap gets a file to itself. A bigger
+// --max-file-mb means fewer files and longer sequential reads, at the cost of
+// up to that much more resident memory while the model loads.
+//
+// Build:  c++ -std=c++17 -O2 -I../Classes mlc_repack.cpp ../Classes/MLCWeightPrefetcher.cpp
+//             ../Classes/MLCJson.cpp ../Classes/MLCCpuTopology.cpp -lpthread -o mlc_repack
+// Usage:  mlc_repack [--align-mb N] [--max-file-mb N] [--profile FILE] MODEL_DIR OUT_DIR
+//         mlc_repack --inspect PACKED_FILE
+
+#include "MLCJson.h"
+#include "MLCWeightPack.h"
+#include "MLCWeightPrefetcher.h"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const size_t kCopyChunkBytes = 4 << 20;
+
+struct Tensor {
+    MLCJsonValue record;       // the ndarray-cache.json entry, byteOffset rewritten on output
+    std::string name;
+    uint32_t shard = 0;
+    uint64_t source_offset = 0;
+    uint64_t nbytes = 0;
+    uint64_t offset = 0;       // in its packed file
+};
+
+struct PackedFile {
+    std::vector<size_t> tensors;   // indices into the tensor list, in file order
+    uint64_t size = 0;
+};
+
+uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+std::string packedFileName(size_t index) {
+    return "params_packed_" + std::to_string(index) + ".bin";
+}
+
+// Layer number in names like "model.layers.12.mlp.down_proj.q_weight", or -1
+int layerIndex(const std::string& name) {
+    for (const char* marker : {".layers.", ".layer.", ".h.", ".blocks."}) {
+        size_t at = name.find(marker);
+        if (at == std::string::npos) continue;
+        const char* digits = name.c_str() + at + std::strlen(marker);
+        if (*digits >= '0' && *digits <= '9') return std::atoi(digits);
+    }
+    return -1;
+}
+
+bool contains(const std::string& name, std::initializer_list<const char*> parts) {
+    for (const char* part : parts) {
+        if (name.find(part) != std::string::npos) return true;
+    }
+    return false;
+}
+
+// (stage, layer, role) in forward-pass order; ties keep converter order
+struct ForwardKey {
+    int stage;
+    int layer;
+    int role;
+    bool operator<(const ForwardKey& other) const {
+        if (stage != other.stage) return stage < other.stage;
+        if (layer != other.layer) return layer < other.layer;
+        return role < other.role;
+    }
+};
+
+ForwardKey forwardKey(const std::string& name) {
+    int layer = layerIndex(name);
+    if (layer < 0) {
+        if (contains(name, {"embed", "wte", "tok_embeddings"})) return {0, 0, 0};
+        if (contains(name, {"lm_head"}) || name.compare(0, 6, "output") == 0) return {3, 0, 0};
+        return {2, 0, 0};
+    }
+    // Norm names first: "post_attention_layernorm" also contains "attention"
+    int role = 5;
+    if (contains(name, {"input_layernorm", "ln_1", "attention_norm"})) {
+        role = 0;
+    } else if (contains(name, {"post_attention_layernorm", "ln_2", "ffn_norm"})) {
+        role = 3;
+    } else if (contains(name, {"qkv", "q_proj", "k_proj", "v_proj", "c_attn", "query_key_value"})) {
+        role = 1;
+    } else if (contains(name, {"attn", "attention"})) {
+        role = 2;
+    } else if (contains(name, {"mlp", "feed_forward", "ffn", "moe"})) {
+        role = 4;
+    }
+    return {1, layer, role};
+}
+
+bool readText(const std::string& path, std::string* text) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    text->assign((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return true;
+}
+
+bool copyFile(const std::string& from, const std::string& to) {
+    std::ifstream in(from, std::ios::binary);
+    std::ofstream out(to, std::ios::binary | std::ios::trunc);
+    if (!in || !out) return false;
+    out << in.rdbuf();
+    return static_cast<bool>(out.flush());
+}
+
+// Zero-fills up to `offset`, then copies `nbytes` from `source` at `source_offset`
+bool copyTensor(FILE* out, uint64_t* position, uint64_t offset, int source, uint64_t source_offset, uint64_t nbytes,
+                std::vector<char>* buffer) {
+    if (offset > *position) {
+        std::fill(buffer->begin(), buffer->end(), 0);
+        for (uint64_t gap = offset - *position; gap > 0;) {
+            size_t length = static_cast<size_t>(std::min<uint64_t>(gap, buffer->size()));
+            if (fwrite(buffer->data(), 1, length, out) != length) return false;
+            gap -= length;
+        }
+    }
+    for (uint64_t done = 0; done < nbytes;) {
+        size_t length = static_cast<size_t>(std::min<uint64_t>(buffer->size(), nbytes - done));
+        ssize_t read_bytes = pread(source, buffer->data(), length, static_cast<off_t>(source_offset + done));
+        if (read_bytes <= 0) return false;
+        if (fwrite(buffer->data(), 1, static_cast<size_t>(read_bytes), out) != static_cast<size_t>(read_bytes)) return false;
+        done += static_cast<uint64_t>(read_bytes);
+    }
+    *position = offset + nbytes;
+    return true;
+}
+
+int inspect(const char* path) {
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || info.st_size == 0) {
+        fprintf(stderr, "mlc_repack: cannot open %s: %s\n", path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return 2;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "mlc_repack: cannot map %s: %s\n", path, strerror(errno));
+        return 2;
+    }
+    MLCWeightPackIndex index;
+    int status = 0;
+    if (!index.parse(data, size)) {
+        fprintf(stderr, "mlc_repack: %s is not a packed weight file\n", path);
+        status = 1;
+    } else {
+        const MLCWeightPackHeader& header = index.header();
+        printf("%s: file %u of %u, %u tensors, alignment %llu, data from %llu, source %016llx\n", path,
+               header.file_index + 1, header.file_count, header.tensor_count,
+               static_cast<unsigned long long>(header.alignment), static_cast<unsigned long long>(header.data_offset),
+               static_cast<unsigned long long>(header.source_hash));
+        for (uint32_t i = 0; i < index.size(); ++i) {
+            MLCWeightPackEntry entry = index.entry(i);
+            bool fits = entry.offset >= header.data_offset && entry.offset + entry.nbytes <= size;
+            if (!fits) status = 1;
+            printf("%12llu %12llu  %.*s%s\n", static_cast<unsigned long long>(entry.offset),
+                   static_cast<unsigned long long>(entry.nbytes), static_cast<int>(index.name(i).size()),
+                   index.name(i).data(), fits ? "" : "  (outside the file)");
+        }
+    }
+    munmap(data, size);
+    return status;
+}
+
+void usage() {
+    fprintf(stderr,
+            "usage: mlc_repack [--align-mb N] [--max-file-mb N] [--profile FILE] MODEL_DIR OUT_DIR\n"
+            "       mlc_repack --inspect PACKED_FILE\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    uint64_t alignment = 2ull << 20;
+    uint64_t max_file_bytes = 32ull << 20;
+    std::string profile_path;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        bool has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--inspect") == 0 && has_value) {
+            return inspect(argv[i + 1]);
+        } else if (strcmp(argv[i], "--align-mb") == 0 && has_value) {
+            alignment = strtoull(argv[++i], nullptr, 10) << 20;
+        } else if (strcmp(argv[i], "--max-file-mb") == 0 && has_value) {
+            max_file_bytes = strtoull(argv[++i], nullptr, 10) << 20;
+        } else if (strcmp(argv[i], "--profile") == 0 && has_value) {
+            profile_path = argv[++i];
+        } else if (argv[i][0] == '-') {
+            usage();
+            return 2;
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.size() != 2 || alignment == 0) {
+        usage();
+        return 2;
+    }
+    const std::string model_dir = paths[0];
+    const std::string out_dir = paths[1];
+
+    char model_real[PATH_MAX];
+    char out_real[PATH_MAX];
+    if (mkdir(out_dir.c_str(), 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "mlc_repack: cannot create %s: %s\n", out_dir.c_str(), strerror(errno));
+        return 2;
+    }
+    if (!realpath(model_dir.c_str(), model_real) || !realpath(out_dir.c_str(), out_real) ||
+        strcmp(model_real, out_real) == 0) {
+        fprintf(stderr, "mlc_repack: OUT_DIR must be an existing or new directory other than MODEL_DIR\n");
+        return 2;
+    }
+
+    // The prefetcher's layout supplies the model hash and the startup profile
+    MLCWeightPrefetcher prefetcher(model_dir);
+    std::string error;
+    if (!prefetcher.loadLayout(&error)) {
+        fprintf(stderr, "mlc_repack: %s\n", error.c_str());
+        return 2;
+    }
+    std::string cache_text;
+    MLCJsonValue cache;
+    if (!readText(model_dir + "/ndarray-cache.json", &cache_text) || !MLCJson::parse(cache_text, &cache, &error)) {
+        fprintf(stderr, "mlc_repack: cannot read ndarray-cache.json %s\n", error.c_str());
+        return 2;
+    }
+
+    std::vector<std::string> shard_paths;
+    std::unordered_set<std::string> shard_names;
+    std::vector<Tensor> tensors;
+    for (const MLCJsonValue& shard : cache.get("records")->array) {
+        const MLCJsonValue* data_path = shard.get("dataPath");
+        const MLCJsonValue* records = shard.get("records");
+        if (!data_path || !records) continue;
+        uint32_t shard_index = static_cast<uint32_t>(shard_paths.size());
+        shard_paths.push_back(model_dir + "/" + data_path->asString());
+        shard_names.insert(data_path->asString());
+        for (const MLCJsonValue& record : records->array) {
+            Tensor tensor;
+            tensor.record = record;
+            tensor.shard = shard_index;
+            if (const MLCJsonValue* name = record.get("name")) tensor.name = name->asString();
+            if (const MLCJsonValue* offset = record.get("byteOffset")) tensor.source_offset = static_cast<uint64_t>(offset->asNumber());
+            if (const MLCJsonValue* nbytes = record.get("nbytes")) tensor.nbytes = static_cast<uint64_t>(nbytes->asNumber());
+            tensors.push_back(std::move(tensor));
+        }
+    }
+
+    // First-use order: profile position where there is one, names otherwise
+    std::vector<size_t> order(tensors.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    if (profile_path.empty()) profile_path = MLCWeightPrefetcher::defaultProfilePath(model_dir);
+    if (prefetcher.loadProfile(profile_path)) {
+        std::unordered_map<std::string, size_t> position;
+        for (const MLCStartupProfileEntry& entry : prefetcher.profile()) {
+            position.emplace(prefetcher.ranges()[entry.range].name, position.size());
+        }
+        auto rank = [&position](const Tensor& tensor) {
+            auto found = position.find(tensor.name);
+            return found == position.end() ? position.size() : found->second;
+        };
+        std::stable_sort(order.begin(), order.end(),
+                         [&](size_t a, size_t b) { return rank(tensors[a]) < rank(tensors[b]); });
+        printf("Ordering %zu tensors by the startup profile %s\n", tensors.size(), profile_path.c_str());
+    } else {
+        std::stable_sort(order.begin(), order.end(), [&tensors](size_t a, size_t b) {
+            return forwardKey(tensors[a].name) < forwardKey(tensors[b].name);
+        });
+        printf("Ordering %zu tensors by forward pass (no matching startup profile)\n", tensors.size());
+    }
+
+    // Every file reserves room for an index over all tensors; a few KB at most
+    uint64_t names_bytes = 0;
+    for (const Tensor& tensor : tensors) names_bytes += tensor.name.size();
+    uint64_t index_bytes = alignUp(sizeof(MLCWeightPackHeader) + tensors.size() * sizeof(MLCWeightPackEntry) + names_bytes,
+                                   kWeightPackMinAlignment);
+
+    std::vector<PackedFile> files(1);
+    uint64_t position = index_bytes;
+    for (size_t i : order) {
+        Tensor& tensor = tensors[i];
+        uint64_t tensor_alignment = tensor.nbytes >= alignment ? alignment : kWeightPackMinAlignment;
+        uint64_t offset = alignUp(position, tensor_alignment);
+        if (max_file_bytes > 0 && !files.back().tensors.empty() && offset + tensor.nbytes > max_file_bytes) {
+            files.emplace_back();
+            offset = alignUp(index_bytes, tensor_alignment);
+        }
+        tensor.offset = offset;
+        files.back().tensors.push_back(i);
+        position = offset + tensor.nbytes;
+        files.back().size = position;
+    }
+
+    std::vector<int> sources(shard_paths.size(), -1);
+    for (size_t i = 0; i < shard_paths.size(); ++i) {
+        sources[i] = open(shard_paths[i].c_str(), O_RDONLY);
+        if (sources[i] < 0) {
+            fprintf(stderr, "mlc_repack: cannot open %s: %s\n", shard_paths[i].c_str(), strerror(errno));
+            return 2;
+        }
+    }
+
+    std::vector<char> buffer(kCopyChunkBytes);
+    uint64_t padding = 0;
+    MLCJsonValue packed_records;
+    packed_records.type = MLCJsonValue::Type::Array;
+    for (size_t f = 0; f < files.size(); ++f) {
+        PackedFile& file = files[f];
+        std::string path = out_dir + "/" + packedFileName(f);
+        FILE* out = fopen(path.c_str(), "wb");
+        if (!out) {
+            fprintf(stderr, "mlc_repack: cannot write %s: %s\n", path.c_str(), strerror(errno));
+            return 2;
+        }
+
+        MLCWeightPackHeader header = {};
+        std::memcpy(header.magic, kWeightPackMagic, sizeof(header.magic));
+        header.version = kWeightPackVersion;
+        header.file_index = static_cast<uint32_t>(f);
+        header.file_count = static_cast<uint32_t>(files.size());
+        header.tensor_count = static_cast<uint32_t>(file.tensors.size());
+        header.alignment = alignment;
+        header.source_hash = prefetcher.modelHash();
+        header.data_offset = index_bytes;
+        std::vector<MLCWeightPackEntry> entries;
+        std::string names;
+        for (size_t i : file.tensors) {
+            const Tensor& tensor = tensors[i];
+            entries.push_back(MLCWeightPackEntry{tensor.offset, tensor.nbytes, static_cast<uint32_t>(names.size()),
+                                                 static_cast<uint32_t>(tensor.name.size())});
+            names += tensor.name;
+        }
+        header.names_bytes = static_cast<uint32_t>(names.size());
+        bool ok = fwrite(&header, sizeof(header), 1, out) == 1 &&
+                  (entries.empty() || fwrite(entries.data(), sizeof(MLCWeightPackEntry), entries.size(), out) == entries.size()) &&
+                  fwrite(names.data(), 1, names.size(), out) == names.size();
+        uint64_t written = sizeof(header) + entries.size() * sizeof(MLCWeightPackEntry) + names.size();
+
+        MLCJsonValue records;
+        records.type = MLCJsonValue::Type::Array;
+        uint64_t payload = 0;
+        for (size_t k = 0; ok && k < file.tensors.size(); ++k) {
+            Tensor& tensor = tensors[file.tensors[k]];
+            ok = copyTensor(out, &written, tensor.offset, sources[tensor.shard], tensor.source_offset, tensor.nbytes, &buffer);
+            payload += tensor.nbytes;
+            MLCJsonValue record = tensor.record;
+            for (auto& member : record.object) {
+                if (member.first == "byteOffset") member.second.number = static_cast<double>(tensor.offset);
+            }
+            records.array.push_back(std::move(record));
+        }
+        ok = fclose(out) == 0 && ok;
+        if (!ok) {
+            fprintf(stderr, "mlc_repack: writing %s failed\n", path.c_str());
+            return 2;
+        }
+        padding += file.size - payload;
+
+        MLCJsonValue shard;
+        shard.type = MLCJsonValue::Type::Object;
+        MLCJsonValue value;
+        value.type = MLCJsonValue::Type::String;
+        value.string = packedFileName(f);
+        shard.object.emplace_back("dataPath", value);
+        value.string = "raw-shard";
+        shard.object.emplace_back("format", value);
+        MLCJsonValue size;
+        size.type = MLCJsonValue::Type::Number;
+        size.number = static_cast<double>(file.size);
+        shard.object.emplace_back("nbytes", size);
+        shard.object.emplace_back("records", std::move(records));
+        packed_records.array.push_back(std::move(shard));
+    }
+    for (int fd : sources) close(fd);
+
+    // Same document with the records pointing at the packed files
+    for (auto& member : cache.object) {
+        if (member.first == "records") member.second = packed_records;
+    }
+    {
+        std::ofstream out(out_dir + "/ndarray-cache.json", std::ios::binary | std::ios::trunc);
+        out << MLCJson::serialize(cache);
+        if (!out.flush()) {
+            fprintf(stderr, "mlc_repack: cannot write %s/ndarray-cache.json\n", out_dir.c_str());
+            return 2;
+        }
+    }
+
+    // Everything else the model directory holds (config, tokenizer, model lib).
+    // The startup profile is left out: it describes the old layout.
+    const std::string profile_name = "mlc-startup-profile.bin";
+    DIR* dir = opendir(model_dir.c_str());
+    if (dir) {
+        while (struct dirent* entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name[0] == '.' || name == "ndarray-cache.json" || shard_names.count(name) ||
+                name == profile_name) {
+                continue;
+            }
+            std::string path = model_dir + "/" + name;
+            struct stat info;
+            if (stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) continue;
+            if (!copyFile(path, out_dir + "/" + name)) {
+                fprintf(stderr, "mlc_repack: cannot copy %s\n", path.c_str());
+                closedir(dir);
+                return 2;
+            }
+        }
+        closedir(dir);
+    }
+
+    uint64_t total = 0;
+    for (const PackedFile& file : files) total += file.size;
+    printf("Packed %zu shards into %zu file%s: %llu MB, %llu MB of index and alignment padding\n", shard_paths.size(), files.size(),
+           files.size() == 1 ? "" : "s", static_cast<unsigned long long>(total >> 20),
+           static_cast<unsigned long long>(padding >> 20));
+    return 0;
+}
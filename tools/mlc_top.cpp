@@ -0,0 +1,133 @@
+// mlc_top: live view of an engine's shared-memory telemetry page
+// (mlc_llm_telemetry_start). Maps the page read-only and copies it under its
+// seqlock, so watching never slows down the inference process.
+//
+// Build:  c++ -std=c++17 -O2 -I../Classes mlc_top.cpp ../Classes/MLCTelemetryPage.cpp \
+//             ../Classes/MLCCpuTopology.cpp -o mlc_top
+//         (add -lrt -lpthread on older Linux)
+// Usage:  mlc_top [--once] [--interval-ms N] [NAME]     NAME defaults to /mlc_llm
+
+#include "MLCBridge.h"
+#include "MLCTelemetryPage.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+const mlc_llm_telemetry_page_t* mapPage(const std::string& name) {
+    bool file = name.find('/', 1) != std::string::npos;
+    int fd = file ? open(name.c_str(), O_RDONLY) : shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) return nullptr;
+    void* mapped = mmap(nullptr, sizeof(mlc_llm_telemetry_page_t), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    return mapped == MAP_FAILED ? nullptr : static_cast<const mlc_llm_telemetry_page_t*>(mapped);
+}
+
+// Latency at quantile `q` of a log2 histogram, taken as the bucket's midpoint
+double quantileMs(const uint64_t* buckets, double q) {
+    uint64_t total = 0;
+    for (int i = 0; i < MLC_LLM_TELEMETRY_BUCKETS; ++i) total += buckets[i];
+    if (total == 0) return 0.0;
+    uint64_t target = static_cast<uint64_t>(q * static_cast<double>(total - 1)) + 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < MLC_LLM_TELEMETRY_BUCKETS; ++i) {
+        seen += buckets[i];
+        if (seen >= target) return 1.5 * static_cast<double>(1ULL << i) / 1000.0;
+    }
+    return 0.0;
+}
+
+double ratio(uint64_t numerator, uint64_t denominator) {
+    return denominator ? static_cast<double>(numerator) / static_cast<double>(denominator) : 0.0;
+}
+
+double ageMs(const mlc_llm_telemetry_page_t& page) {
+    uint64_t now_us = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    return now_us > page.published_unix_us ? (now_us - page.published_unix_us) / 1000.0 : 0.0;
+}
+
+// The writer missed several intervals: stopped, hung or restarted
+bool isStale(const mlc_llm_telemetry_page_t& page) {
+    return ageMs(page) * 1000.0 > 3.0 * static_cast<double>(page.interval_us);
+}
+
+void render(const mlc_llm_telemetry_page_t& page, bool clear) {
+    const mlc_llm_metrics_t& m = page.metrics;
+    double age_ms = ageMs(page);
+    bool stale = isStale(page);
+
+    if (clear) printf("\033[H\033[J");
+    printf("mlc_top  pid %u  snapshot %.0f ms old%s\n\n", page.pid, age_ms, stale ? "  (STALE)" : "");
+    printf("requests   in flight %-6llu queued %-6lld est. wait %lld ms\n",
+           static_cast<unsigned long long>(m.requests_in_flight), static_cast<long long>(page.queue_depth),
+           static_cast<long long>(page.estimated_wait_ms));
+    printf("           submitted %-6llu completed %-6llu failed %-6llu rejected %llu\n",
+           static_cast<unsigned long long>(m.requests_submitted), static_cast<unsigned long long>(m.requests_completed),
+           static_cast<unsigned long long>(m.requests_failed), static_cast<unsigned long long>(m.requests_rejected));
+    printf("throughput %.1f tok/s   decode %.1f tok/s per sequence\n", page.tokens_per_second,
+           ratio(m.decode_tokens * 1000000ULL, m.decode_time_us));
+    printf("ttft       mean %.1f ms   p50 %.1f   p90 %.1f   p99 %.1f\n", ratio(m.ttft_total_us, m.ttft_samples) / 1000.0,
+           quantileMs(page.ttft_us, 0.5), quantileMs(page.ttft_us, 0.9), quantileMs(page.ttft_us, 0.99));
+    printf("itl        p50 %.1f ms   p99 %.1f\n", quantileMs(page.inter_token_us, 0.5),
+           quantileMs(page.inter_token_us, 0.99));
+    printf("kv cache   in use %lld / %lld tokens (%.0f%%)   reserved %lld\n",
+           static_cast<long long>(m.kv_tokens_in_use), static_cast<long long>(page.kv_capacity_tokens),
+           100.0 * ratio(m.kv_tokens_in_use, static_cast<uint64_t>(page.kv_capacity_tokens)),
+           static_cast<long long>(page.kv_reserved_tokens));
+    printf("caches     similarity %llu hit / %llu miss   prompt tokens cached %llu / encoded %llu\n",
+           static_cast<unsigned long long>(m.similarity_cache_hits),
+           static_cast<unsigned long long>(m.similarity_cache_misses),
+           static_cast<unsigned long long>(m.prompt_tokens_cached),
+           static_cast<unsigned long long>(m.prompt_tokens_encoded));
+    fflush(stdout);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string name = "/mlc_llm";
+    bool once = false;
+    int interval_ms = 500;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--once") == 0) {
+            once = true;
+        } else if (strcmp(argv[i], "--interval-ms") == 0 && i + 1 < argc) {
+            interval_ms = std::max(50, atoi(argv[++i]));
+        } else {
+            name = argv[i];
+        }
+    }
+
+    const mlc_llm_telemetry_page_t* page = nullptr;
+    mlc_llm_telemetry_page_t snapshot;
+    while (true) {
+        if (!page) page = mapPage(name);
+        if (!page) {
+            fprintf(stderr, "mlc_top: no telemetry page at %s\n", name.c_str());
+            if (once) return 1;
+        } else if (page->magic != MLC_LLM_TELEMETRY_MAGIC || page->version != MLC_LLM_TELEMETRY_VERSION ||
+                   page->page_size != sizeof(mlc_llm_telemetry_page_t)) {
+            fprintf(stderr, "mlc_top: %s has an incompatible layout (version %u, %u bytes)\n", name.c_str(),
+                    page->version, page->page_size);
+            return 1;
+        } else if (MLCTelemetryPage::read(page, &snapshot)) {
+            render(snapshot, !once);
+            if (once) return 0;
+            // A restarted engine publishes to a new segment under the same name
+            if (isStale(snapshot)) {
+                munmap(const_cast<mlc_llm_telemetry_page_t*>(page), sizeof(*page));
+                page = nullptr;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+    }
+}